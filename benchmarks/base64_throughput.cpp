@@ -0,0 +1,62 @@
+// base64 encode and decode throughput per kernel
+//
+//   ./build/benchmarks/bench_base64_throughput [megabytes]
+//
+// "scalar" is the vendored codec to_base64 and from_base64 used before, the others are
+// the vectorized kernels in base64_simd, only the ones this cpu supports are run. MB/s is
+// of raw value bytes on both sides, so encode and decode numbers compare directly
+
+#include "storage/base64.hpp"
+#include "storage/base64_simd.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+
+// keeps the compiler from dropping the work
+static size_t sink = 0;
+
+template <typename Fn>
+double mbPerSecond(size_t bytes, size_t iterations, Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < iterations; i++) {
+        sink += fn();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return bytes * iterations / elapsed / 1e6;
+}
+
+int main(int argc, char* argv[]) {
+    size_t megabytes = 512;
+    if(argc > 1) megabytes = std::stoul(argv[1]);
+
+    std::printf("detected %s\n\n", base64::isa_name(base64::detected_isa()));
+
+    std::mt19937_64 gen(1);
+    for(size_t value_bytes : {1024, 16384, 65536}) {
+        std::string data(value_bytes, '\0');
+        for(auto& c : data) {
+            c = static_cast<char>(gen());
+        }
+        std::string text = base64::encode_into<std::string>(data);
+        size_t iterations = std::max<size_t>(100, megabytes * 1000000 / value_bytes);
+
+        std::printf("%zu byte values, %zu each\n", value_bytes, iterations);
+        for(auto isa : {base64::Isa::SCALAR, base64::Isa::SSSE3, base64::Isa::AVX2}) {
+            if(isa > base64::detected_isa()) {
+                continue;
+            }
+            double encode = mbPerSecond(value_bytes, iterations, [&] {
+                return isa == base64::Isa::SCALAR ? base64::encode_into<std::string>(data).size() : base64::encode_with(isa, data).size();
+            });
+            double decode = mbPerSecond(value_bytes, iterations, [&] {
+                return isa == base64::Isa::SCALAR ? base64::decode_into<std::string>(text).size() : base64::decode_with(isa, text).size();
+            });
+            std::printf("  %-8s encode %8.0f MB/s  decode %8.0f MB/s\n", base64::isa_name(isa), encode, decode);
+        }
+        std::printf("\n");
+    }
+
+    return sink == 0;
+}
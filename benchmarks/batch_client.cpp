@@ -0,0 +1,142 @@
+// single key /put and /get against /mput and /mget on a running cluster
+//
+//   ./launch_cluster.sh
+//   ./build/benchmarks/bench_batch_client [host] [port] [keys] [batch] [value bytes]
+//
+// "single" sends one request per key to one node and follows its redirects, like a
+// client that doesn't know the ring. "batched" sends the same keys batch at a time to the
+// same node, which coordinates all of them with one replication request per replica node.
+// one client thread, so this is the per key cost a client sees, not the cluster's limit
+
+#include "storage/base64.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "httplib.h"
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+struct Config {
+    std::string host = "localhost";
+    int port = 8080;
+    size_t keys = 2000;
+    size_t batch = 100;
+    size_t value_bytes = 256;
+};
+
+struct Run {
+    size_t keys = 0;
+    size_t failed = 0;
+    double seconds = 0;
+};
+
+void report(const char* name, const Run& run) {
+    std::printf("  %-14s %8.0f keys/s  %8.1f us/key  %zu failed\n",
+        name, run.keys / run.seconds, run.seconds * 1e6 / run.keys, run.failed);
+}
+
+template <typename Fn>
+Run timed(size_t keys, Fn fn) {
+    Run run{keys};
+    auto start = std::chrono::steady_clock::now();
+    run.failed = fn();
+    run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return run;
+}
+
+int main(int argc, char* argv[]) {
+    Config config;
+    if(argc > 1) config.host = argv[1];
+    if(argc > 2) config.port = std::stoi(argv[2]);
+    if(argc > 3) config.keys = std::stoul(argv[3]);
+    if(argc > 4) config.batch = std::stoul(argv[4]);
+    if(argc > 5) config.value_bytes = std::stoul(argv[5]);
+
+    httplib::Client client(config.host, config.port);
+    client.set_follow_location(true);
+    client.set_keep_alive(true);
+    client.set_read_timeout(std::chrono::seconds(10));
+
+    // a put without a context is outdated against any earlier one, so each run and each
+    // way of writing gets keys of its own
+    auto run_id = std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
+    std::vector<std::string> keys, batch_keys;
+    for(size_t i = 0; i < config.keys; i++) {
+        keys.push_back("bench-single-" + run_id + "-" + std::to_string(i));
+        batch_keys.push_back("bench-batch-" + run_id + "-" + std::to_string(i));
+    }
+    std::string data = base64::to_base64(std::string(config.value_bytes, 'v'));
+
+    std::printf("%zu keys, %zu per batch, %zu byte values, via %s:%d\n",
+        config.keys, config.batch, config.value_bytes, config.host.c_str(), config.port);
+
+    Run single_put = timed(keys.size(), [&] {
+        size_t failed = 0;
+        for(auto &key : keys) {
+            json body{{"key", key}, {"data", data}, {"context", ""}};
+            auto res = client.Post("/put", body.dump(), "application/json");
+            failed += !res || res->status != 200;
+        }
+        return failed;
+    });
+
+    Run batched_put = timed(batch_keys.size(), [&] {
+        size_t failed = 0;
+        for(size_t start = 0; start < batch_keys.size(); start += config.batch) {
+            json puts = json::array();
+            size_t end = std::min(batch_keys.size(), start + config.batch);
+            for(size_t i = start; i < end; i++) {
+                puts.push_back({{"key", batch_keys[i]}, {"data", data}, {"context", ""}});
+            }
+            auto res = client.Post("/mput", json{{"puts", puts}}.dump(), "application/json");
+            if(!res || res->status != 200) {
+                failed += end - start;
+                continue;
+            }
+            json answer = json::parse(res->body);
+            for(auto &result : answer["results"]) {
+                failed += result.contains("error");
+            }
+        }
+        return failed;
+    });
+
+    Run single_get = timed(keys.size(), [&] {
+        size_t failed = 0;
+        for(auto &key : keys) {
+            auto res = client.Post("/get", json{{"key", key}}.dump(), "application/json");
+            failed += !res || res->status != 200;
+        }
+        return failed;
+    });
+
+    Run batched_get = timed(batch_keys.size(), [&] {
+        size_t failed = 0;
+        for(size_t start = 0; start < batch_keys.size(); start += config.batch) {
+            size_t end = std::min(batch_keys.size(), start + config.batch);
+            std::vector<std::string> batch(batch_keys.begin() + start, batch_keys.begin() + end);
+            auto res = client.Post("/mget", json{{"keys", batch}}.dump(), "application/json");
+            if(!res || res->status != 200) {
+                failed += end - start;
+                continue;
+            }
+            json answer = json::parse(res->body);
+            for(auto &[key, result] : answer.items()) {
+                failed += result.contains("error");
+            }
+        }
+        return failed;
+    });
+
+    report("single put", single_put);
+    report("batched put", batched_put);
+    report("single get", single_get);
+    report("batched get", batched_get);
+    std::printf("\nput speedup %.1fx, get speedup %.1fx\n",
+        single_put.seconds / batched_put.seconds, single_get.seconds / batched_get.seconds);
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+#!/bin/bash
+
+# Measures how long a launch_cluster.sh style bring-up takes until every node
+# serves and sees the whole cluster in its membership.
+#
+#   ./benchmarks/cluster_startup.sh            # 10 nodes, http gossip
+#   NODES=20 MEMBERSHIP=swim ./benchmarks/cluster_startup.sh
+
+trap "kill 0" EXIT
+
+NODES=${NODES:-10}
+MEMBERSHIP=${MEMBERSHIP:-gossip}
+BASE_PORT=${BASE_PORT:-8080}
+EXECUTABLE="./build/app"
+LOG_DIR=$(mktemp -d)
+
+if [ ! -f "$EXECUTABLE" ]; then
+    echo "Error: $EXECUTABLE not found, build first (see launch_cluster.sh)"
+    exit 1
+fi
+
+# fresh start, stale gossip files would skew the numbers
+for ((i = 0; i < NODES; i++)); do
+    rm -rf "/tmp/dynamo$((BASE_PORT + i))" "/tmp/dynamo$((BASE_PORT + i))-handoff" "/tmp/localhost:$((BASE_PORT + i))-gossip" "/tmp/localhost:$((BASE_PORT + i))-membership"
+done
+
+now_ms() {
+    date +%s%3N
+}
+
+start=$(now_ms)
+
+# every node at once, the seed included
+for ((i = 0; i < NODES; i++)); do
+    PORT=$((BASE_PORT + i))
+    if [ $i -eq 0 ]; then
+        $EXECUTABLE --port $PORT --address localhost --membership $MEMBERSHIP > "$LOG_DIR/$PORT.log" 2>&1 &
+    else
+        $EXECUTABLE --port $PORT --address localhost --bootstrap-servers localhost:$BASE_PORT \
+            --membership $MEMBERSHIP > "$LOG_DIR/$PORT.log" 2>&1 &
+    fi
+done
+
+members() {
+    curl -s -X POST "http://localhost:$1/admin/membership" 2>/dev/null | grep -o '"status_":0' | wc -l
+}
+
+serving_at=""
+converged_at=""
+
+while [ -z "$converged_at" ]; do
+    serving=0
+    converged=0
+    for ((i = 0; i < NODES; i++)); do
+        PORT=$((BASE_PORT + i))
+        if curl -s -o /dev/null -w "%{http_code}" "http://localhost:$PORT/admin/health" 2>/dev/null | grep -q 200; then
+            serving=$((serving + 1))
+            if [ "$(members $PORT)" -ge "$NODES" ]; then
+                converged=$((converged + 1))
+            fi
+        fi
+    done
+
+    if [ -z "$serving_at" ] && [ $serving -eq $NODES ]; then
+        serving_at=$(now_ms)
+    fi
+    if [ $converged -eq $NODES ]; then
+        converged_at=$(now_ms)
+    fi
+
+    if [ $(( $(now_ms) - start )) -gt 120000 ]; then
+        echo "Timed out after 120s ($serving serving, $converged converged). Logs in $LOG_DIR"
+        exit 1
+    fi
+    sleep 0.05
+done
+
+echo "nodes:            $NODES ($MEMBERSHIP)"
+echo "all serving:      $((serving_at - start)) ms"
+echo "full membership:  $((converged_at - start)) ms"
+echo "per node join times:"
+grep -h "Cluster join finished" "$LOG_DIR"/*.log | sed 's/^.*Cluster join/  join/'
@@ -0,0 +1,150 @@
+// multi threaded get/put throughput of the storage engines
+//
+//   ./build/benchmarks/bench_engine_throughput [ops per thread] [keys] [read %] [value bytes]
+//
+// every engine is prefilled with all keys, then each thread does uniform random
+// gets and puts. MemoryEngine sits behind a single lock and is there as the
+// baseline the sharded engine is supposed to beat
+
+#include "metrics/histogram.h"
+#include "storage/concurrent_memory_engine.h"
+#include "storage/disk_engine.h"
+#include "storage/memory_engine.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+struct Config {
+    size_t ops_per_thread = 200000;
+    size_t keys = 100000;
+    int read_pct = 90;
+    size_t value_bytes = 100;
+};
+
+struct Result {
+    double ops_per_sec;
+    HistogramSnapshot latency;
+};
+
+std::string keyFor(size_t i) {
+    return "key-" + std::to_string(i);
+}
+
+// get and put are passed as callables so engines with different locking can share the driver
+Result run(const Config& config,
+           int threads,
+           const std::function<void(const std::string&)>& get,
+           const std::function<void(const std::string&, const std::string&)>& put) {
+    Histogram latency;
+    std::atomic<int> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> workers;
+
+    for(int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            std::mt19937_64 gen(t + 1);
+            std::uniform_int_distribution<size_t> key_dist(0, config.keys - 1);
+            std::uniform_int_distribution<int> op_dist(0, 99);
+            std::string value(config.value_bytes, 'v');
+
+            ready++;
+            while(!go.load(std::memory_order_acquire)) {}
+
+            for(size_t i = 0; i < config.ops_per_thread; i++) {
+                std::string key = keyFor(key_dist(gen));
+                bool read = op_dist(gen) < config.read_pct;
+                ScopedTimer timer{latency};
+                if(read) {
+                    get(key);
+                } else {
+                    put(key, value);
+                }
+            }
+        });
+    }
+
+    while(ready.load() < threads) {}
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for(auto& w : workers) {
+        w.join();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return {config.ops_per_thread * threads / elapsed, latency.snapshot()};
+}
+
+void report(const char* name, int threads, const Result& result) {
+    std::printf("%-24s %3d threads %12.0f ops/s   p50 %6lluus   p99 %6lluus\n",
+        name, threads, result.ops_per_sec,
+        static_cast<unsigned long long>(result.latency.percentile(0.50)),
+        static_cast<unsigned long long>(result.latency.percentile(0.99)));
+}
+
+int main(int argc, char* argv[]) {
+    Config config;
+    if(argc > 1) config.ops_per_thread = std::stoul(argv[1]);
+    if(argc > 2) config.keys = std::stoul(argv[2]);
+    if(argc > 3) config.read_pct = std::stoi(argv[3]);
+    if(argc > 4) config.value_bytes = std::stoul(argv[4]);
+
+    int max_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int> thread_counts;
+    for(int t = 1; t < max_threads; t *= 2) {
+        thread_counts.push_back(t);
+    }
+    thread_counts.push_back(max_threads);
+
+    std::printf("%zu ops/thread, %zu keys, %d%% reads, %zu byte values\n\n",
+        config.ops_per_thread, config.keys, config.read_pct, config.value_bytes);
+
+    std::string value(config.value_bytes, 'v');
+
+    {
+        ConcurrentMemoryEngine engine;
+        for(size_t i = 0; i < config.keys; i++) engine.put(keyFor(i), value);
+        for(int t : thread_counts) {
+            auto result = run(config, t,
+                [&](const std::string& k) { engine.get(k); },
+                [&](const std::string& k, const std::string& v) { engine.put(k, v); });
+            report("ConcurrentMemoryEngine", t, result);
+        }
+    }
+
+    {
+        MemoryEngine engine;
+        for(size_t i = 0; i < config.keys; i++) engine.put(keyFor(i), value);
+        for(int t : thread_counts) {
+            auto result = run(config, t,
+                [&](const std::string& k) { engine.get(k); },
+                [&](const std::string& k, const std::string& v) { engine.put(k, v); });
+            report("MemoryEngine", t, result);
+        }
+    }
+
+    {
+        std::string id = "-bench-" + std::to_string(getpid());
+        {
+            DiskEngine engine{id, ""};
+            for(size_t i = 0; i < config.keys; i++) engine.put(keyFor(i), value);
+            for(int t : thread_counts) {
+                auto result = run(config, t,
+                    [&](const std::string& k) { engine.get(k); },
+                    [&](const std::string& k, const std::string& v) { engine.put(k, v); });
+                report("DiskEngine", t, result);
+            }
+        }
+        std::filesystem::remove_all("/tmp/dynamo" + id);
+    }
+
+    return 0;
+}
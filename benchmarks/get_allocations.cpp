@@ -0,0 +1,202 @@
+// heap allocations per GET, the old copy-everything response path vs views and the writer
+//
+//   ./build/benchmarks/bench_get_allocations [gets] [keys] [value bytes] [siblings]
+//
+// both paths read a key's versions from the engine, decode them and produce the /get body.
+// "copy" is how handleGet used to do it: get() into a string, decode, base64 every field
+// into a GetResponse, copy it again to drop duplicates, build a json tree and dump it.
+// "view" decodes from the engine's buffer and streams the body through GetResponseWriter
+// into a reused buffer, standing in for the socket. single threaded, operator new is
+// counted for the whole process
+// what the decode allocates is up to cereal's archive, so each path's read and decode
+// is also run on its own. the "decode" rows move with the cereal build, the difference
+// to the full path is what the response building allocates
+
+#include "hash_ring/rpc.h"
+#include "server/get_response_writer.h"
+#include "storage/base64.hpp"
+#include "storage/concurrent_memory_engine.h"
+#include "storage/disk_engine.h"
+#include "storage/serializer.h"
+#include <atomic>
+#include <boost/functional/hash.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <new>
+#include <string>
+#include <unistd.h>
+#include <unordered_set>
+#include <utility>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+static std::atomic<uint64_t> allocations{0};
+static std::atomic<uint64_t> allocated_bytes{0};
+
+void* operator new(std::size_t n) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(n, std::memory_order_relaxed);
+    if(void* p = std::malloc(n == 0 ? 1 : n)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+struct Config {
+    size_t gets = 200000;
+    size_t keys = 10000;
+    size_t value_bytes = 1024;
+    size_t siblings = 1;
+};
+
+std::string keyFor(size_t i) {
+    return "key-" + std::to_string(i);
+}
+
+GetResponse filterDuplicates(const GetResponse& resp) {
+    GetResponse out{0};
+    std::unordered_set<std::pair<std::string, std::string>,
+                    boost::hash<std::pair<std::string, std::string>>> seen;
+    for(const auto& v : resp.values) {
+        if(seen.insert(std::make_pair(v.data, v.context)).second) {
+            out.values.push_back(v);
+        }
+    }
+    return out;
+}
+
+template <typename Engine>
+size_t copyPath(Engine& engine, const std::string& key) {
+    auto values = Serializer::fromBinary<ValueList>(engine.get(key));
+    GetResponse resp{values.size()};
+    for(size_t i = 0; i < values.size(); i++) {
+        resp.values[i].context = base64::to_base64(Serializer::toBinary(values[i].clock_));
+        resp.values[i].data = base64::to_base64(values[i].data_);
+    }
+    json j = filterDuplicates(resp);
+    std::string body = j.dump();
+    return body.size();
+}
+
+template <typename Engine>
+size_t viewPath(Engine& engine, const std::string& key, std::string& socket) {
+    ValueList decoded;
+    engine.view(key, [&decoded](std::string_view stored) {
+        decoded = Serializer::fromBinary<ValueList>(stored);
+    });
+    GetResponseWriter writer{std::make_shared<const ValueList>(std::move(decoded)), nullptr};
+    socket.clear();
+    writer.writeTo([&socket](const char* data, size_t n) {
+        socket.append(data, n);
+        return true;
+    });
+    return socket.size();
+}
+
+template <typename Engine>
+size_t copyDecode(Engine& engine, const std::string& key) {
+    return Serializer::fromBinary<ValueList>(engine.get(key)).size();
+}
+
+template <typename Engine>
+size_t viewDecode(Engine& engine, const std::string& key) {
+    size_t versions = 0;
+    engine.view(key, [&versions](std::string_view stored) {
+        versions = Serializer::fromBinary<ValueList>(stored).size();
+    });
+    return versions;
+}
+
+template <typename Engine>
+void run(const char* name, Engine& engine, const Config& config) {
+    std::string socket;
+    socket.reserve(4 * config.value_bytes * config.siblings + 4096);
+
+    const char* modes[] = {"copy", "view", "copy decode", "view decode"};
+    auto once = [&](int mode, const std::string& key) {
+        switch(mode) {
+            case 0: return copyPath(engine, key);
+            case 1: return viewPath(engine, key, socket);
+            case 2: return copyDecode(engine, key);
+            default: return viewDecode(engine, key);
+        }
+    };
+
+    for(int mode = 0; mode < 4; mode++) {
+        // one warm up pass so thread local buffers and the socket stand in are sized
+        for(size_t i = 0; i < config.keys; i++) {
+            once(mode, keyFor(i));
+        }
+
+        std::vector<std::string> keys;
+        keys.reserve(config.gets);
+        for(size_t i = 0; i < config.gets; i++) {
+            keys.push_back(keyFor(i % config.keys));
+        }
+
+        uint64_t allocs_before = allocations.load();
+        uint64_t bytes_before = allocated_bytes.load();
+        size_t body_bytes = 0;
+        auto start = std::chrono::steady_clock::now();
+        for(auto& key : keys) {
+            body_bytes += once(mode, key);
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double gets = static_cast<double>(config.gets);
+
+        // the decode rows count versions instead of body bytes
+        std::printf("%-22s %-11s %6.1f allocs/get  %8.0f bytes/get  %7.0f ns/get  (%zu %s)\n",
+            name, modes[mode],
+            (allocations.load() - allocs_before) / gets,
+            (allocated_bytes.load() - bytes_before) / gets,
+            elapsed * 1e9 / gets,
+            body_bytes / config.gets, mode < 2 ? "byte bodies" : "versions");
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Config config;
+    if(argc > 1) config.gets = std::stoul(argv[1]);
+    if(argc > 2) config.keys = std::stoul(argv[2]);
+    if(argc > 3) config.value_bytes = std::stoul(argv[3]);
+    if(argc > 4) config.siblings = std::stoul(argv[4]);
+
+    ValueList versions;
+    for(size_t s = 0; s < config.siblings; s++) {
+        VectorClock clock;
+        clock.increment("node-" + std::to_string(s));
+        versions.push_back(Value{std::string(config.value_bytes, 'a' + s % 26), clock});
+    }
+    std::string stored = Serializer::toBinary(versions);
+
+    std::printf("%zu gets over %zu keys, %zu sibling(s) of %zu bytes\n\n",
+        config.gets, config.keys, config.siblings, config.value_bytes);
+
+    {
+        ConcurrentMemoryEngine memory;
+        for(size_t i = 0; i < config.keys; i++) memory.put(keyFor(i), stored);
+        run("ConcurrentMemoryEngine", memory, config);
+    }
+
+    std::string id = "-bench-get-alloc-" + std::to_string(getpid());
+    {
+        DiskEngine disk{id, ""};
+        for(size_t i = 0; i < config.keys; i++) disk.put(keyFor(i), stored);
+        run("DiskEngine", disk, config);
+    }
+    std::filesystem::remove_all("/tmp/dynamo" + id);
+
+    return 0;
+}
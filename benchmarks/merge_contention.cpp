@@ -0,0 +1,126 @@
+// contention on the local sibling merge with hot keys
+//
+//   ./build/benchmarks/bench_merge_contention [ops per thread] [threads] [value bytes]
+//
+// every thread acts as a different coordinator, bumping its own clock entry, so its
+// versions are concurrent with everyone else's and each key ends up with one sibling
+// per writer. that makes lost updates easy to see: after the run every key written by
+// n threads must hold exactly n siblings. each workload runs with a single lock for
+// everything and with the striped per key locks
+
+#include "metrics/histogram.h"
+#include "server/local_merge.h"
+#include "storage/concurrent_memory_engine.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Config {
+    size_t ops_per_thread = 50000;
+    int threads = 8;
+    size_t value_bytes = 100;
+};
+
+struct Workload {
+    const char* name;
+    size_t keys;
+};
+
+struct Result {
+    double ops_per_sec;
+    HistogramSnapshot latency;
+    // keys holding fewer siblings than threads wrote to them
+    size_t lost_keys;
+};
+
+std::string keyFor(size_t i) {
+    return "key-" + std::to_string(i);
+}
+
+Result run(const Config& config, size_t keys, size_t stripes) {
+    auto engine = std::make_shared<ConcurrentMemoryEngine>();
+    LocalMerge<ConcurrentMemoryEngine> local(engine, 32 << 20, stripes);
+    Histogram latency;
+    std::string value(config.value_bytes, 'v');
+
+    std::vector<std::set<size_t>> written(config.threads);
+    std::atomic<int> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> workers;
+    for(int t = 0; t < config.threads; t++) {
+        workers.emplace_back([&, t] {
+            std::mt19937_64 gen(t + 1);
+            std::uniform_int_distribution<size_t> key_dist(0, keys - 1);
+            std::string id = "node" + std::to_string(t);
+            VectorClock clock;
+
+            ready.fetch_add(1);
+            while(!go.load(std::memory_order_acquire)) {}
+
+            for(size_t i = 0; i < config.ops_per_thread; i++) {
+                size_t k = key_dist(gen);
+                written[t].insert(k);
+                clock.increment(id);
+                ScopedTimer timer{latency};
+                local.merge(keyFor(k), Value{value, clock});
+            }
+        });
+    }
+
+    while(ready.load() < config.threads) {}
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for(auto& w : workers) {
+        w.join();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t lost = 0;
+    for(size_t k = 0; k < keys; k++) {
+        size_t writers = std::count_if(written.begin(), written.end(), [k](const std::set<size_t>& s) {
+            return s.contains(k);
+        });
+        if(local.load(keyFor(k))->size() < writers) {
+            lost++;
+        }
+    }
+
+    return {config.ops_per_thread * config.threads / elapsed, latency.snapshot(), lost};
+}
+
+void report(const char* workload, const char* locking, const Result& result) {
+    std::printf("%-12s %-10s %12.0f merges/s   p50 %6lluus   p99 %6lluus   lost keys %zu\n",
+        workload, locking, result.ops_per_sec,
+        static_cast<unsigned long long>(result.latency.percentile(0.50)),
+        static_cast<unsigned long long>(result.latency.percentile(0.99)),
+        result.lost_keys);
+}
+
+int main(int argc, char* argv[]) {
+    Config config;
+    if(argc > 1) config.ops_per_thread = std::stoul(argv[1]);
+    if(argc > 2) config.threads = std::stoi(argv[2]);
+    if(argc > 3) config.value_bytes = std::stoul(argv[3]);
+
+    std::printf("%d threads, %zu merges/thread, %zu byte values\n\n",
+        config.threads, config.ops_per_thread, config.value_bytes);
+
+    std::vector<Workload> workloads{
+        {"1 key", 1},
+        {"16 keys", 16},
+        {"256 keys", 256},
+        {"64k keys", 65536},
+    };
+    for(auto& w : workloads) {
+        report(w.name, "global", run(config, w.keys, 1));
+        report(w.name, "striped", run(config, w.keys, 1024));
+    }
+    return 0;
+}
@@ -0,0 +1,147 @@
+// miss heavy reads, each engine's old read path vs lookup
+//
+//   ./build/benchmarks/bench_miss_path [threads] [ops per thread] [keys]
+//
+// "throw" is how MemoryEngine::get used to report a miss, StorageError caught by the
+// caller. DiskEngine never threw on a miss, its get returned "" and the caller asked
+// contains first, so "two-read" is that: one leveldb read to check and a second for the
+// value on a hit. "lookup" is the expected based read every engine has now. each engine
+// is run at a few miss ratios, a fresh key or a partitioned replica is mostly misses.
+// exceptions also take a lock in the unwinder, so run with a few threads to see that
+
+#include "error/storage_error.h"
+#include "metrics/histogram.h"
+#include "storage/disk_engine.h"
+#include "storage/memory_engine.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <leveldb/db.h>
+#include <random>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+struct Config {
+    int threads = 4;
+    size_t ops_per_thread = 200000;
+    size_t keys = 100000;
+    size_t value_bytes = 100;
+};
+
+std::string keyFor(size_t i) {
+    return "key-" + std::to_string(i);
+}
+
+// MemoryEngine's old contract, a miss unwinds out of the engine
+bool throwingRead(MemoryEngine& engine, const std::string& key) {
+    try {
+        auto value = engine.lookup(key);
+        if(!value) {
+            throw StorageError(value.error().message_);
+        }
+        return true;
+    } catch(const StorageError&) {
+        return false;
+    }
+}
+
+// DiskEngine's old contains and get, straight on leveldb like they were
+bool twoReads(DiskEngine& engine, const std::string& key) {
+    std::string data;
+    if(engine.getDB()->Get(leveldb::ReadOptions(), key, &data).IsNotFound()) {
+        return false;
+    }
+    leveldb::Status s = engine.getDB()->Get(leveldb::ReadOptions(), key, &data);
+    if(!s.ok() && !s.IsNotFound()) {
+        throw StorageError("Error fetching key: " + s.ToString());
+    }
+    return true;
+}
+
+template <typename Engine>
+bool lookupRead(Engine& engine, const std::string& key) {
+    return engine.lookup(key).has_value();
+}
+
+// read returns whether the key was there
+template <typename Engine, typename Read>
+void run(const char* name, const char* path, Engine& engine, const Config& config, int miss_pct, Read read) {
+    Histogram latency;
+    std::atomic<bool> go{false};
+    std::atomic<uint64_t> misses{0};
+    std::vector<std::thread> workers;
+
+    for(int t = 0; t < config.threads; t++) {
+        workers.emplace_back([&, t] {
+            std::mt19937_64 gen(t + 1);
+            std::uniform_int_distribution<size_t> key_dist(0, config.keys - 1);
+            std::uniform_int_distribution<int> miss_dist(0, 99);
+            uint64_t local_misses = 0;
+            while(!go.load(std::memory_order_acquire)) {}
+
+            for(size_t i = 0; i < config.ops_per_thread; i++) {
+                // keys past the prefilled range are never written
+                size_t k = key_dist(gen);
+                std::string key = keyFor(miss_dist(gen) < miss_pct ? k + config.keys : k);
+                ScopedTimer timer{latency};
+                if(!read(engine, key)) {
+                    local_misses++;
+                }
+            }
+            misses.fetch_add(local_misses, std::memory_order_relaxed);
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for(auto& w : workers) {
+        w.join();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    auto snap = latency.snapshot();
+    uint64_t total = config.ops_per_thread * config.threads;
+
+    std::printf("%-12s %-8s miss %3d%%  %12.0f ops/s   p50 %5lluus   p99 %5lluus   (%.1f%% missed)\n",
+        name, path, miss_pct, total / elapsed,
+        static_cast<unsigned long long>(snap.percentile(0.50)),
+        static_cast<unsigned long long>(snap.percentile(0.99)),
+        100.0 * misses.load() / total);
+}
+
+template <typename Engine, typename Read>
+void compare(const char* name, const char* old_path, Engine& engine, const Config& config, Read old_read) {
+    for(int miss_pct : {0, 50, 90, 100}) {
+        run(name, old_path, engine, config, miss_pct, old_read);
+        run(name, "lookup", engine, config, miss_pct, lookupRead<Engine>);
+    }
+    std::printf("\n");
+}
+
+int main(int argc, char* argv[]) {
+    Config config;
+    if(argc > 1) config.threads = std::stoi(argv[1]);
+    if(argc > 2) config.ops_per_thread = std::stoul(argv[2]);
+    if(argc > 3) config.keys = std::stoul(argv[3]);
+
+    std::string value(config.value_bytes, 'v');
+    std::printf("%d threads, %zu ops/thread, %zu keys\n\n", config.threads, config.ops_per_thread, config.keys);
+
+    {
+        MemoryEngine memory;
+        for(size_t i = 0; i < config.keys; i++) memory.put(keyFor(i), value);
+        compare("MemoryEngine", "throw", memory, config, throwingRead);
+    }
+
+    std::string id = "-bench-miss-" + std::to_string(getpid());
+    {
+        DiskEngine disk{id, ""};
+        for(size_t i = 0; i < config.keys; i++) disk.put(keyFor(i), value);
+        compare("DiskEngine", "two-read", disk, config, twoReads);
+    }
+    std::filesystem::remove_all("/tmp/dynamo" + id);
+
+    return 0;
+}
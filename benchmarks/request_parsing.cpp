@@ -0,0 +1,73 @@
+// cost of turning a /put body into key, data and context
+//
+//   ./build/benchmarks/bench_request_parsing [iterations]
+//
+// "json x2" is what handlePut used to do, handleRedirect parsed the body for the key and
+// then the handler parsed it again for everything. "json x1" is a single nlohmann parse,
+// "scanner" is ClientRequest::parse. bodies are the shape the web ui sends, with the value
+// base64 encoded in data
+
+#include "server/client_request.h"
+#include "storage/base64.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+// keeps the compiler from dropping the work
+static size_t sink = 0;
+
+size_t doubleParse(const std::string& body) {
+    auto routing = json::parse(body);
+    std::string key{routing["key"]};
+
+    auto parsed = json::parse(body);
+    std::string data{parsed["data"]};
+    std::string context{parsed["context"]};
+    return key.size() + data.size() + context.size();
+}
+
+size_t singleParse(const std::string& body) {
+    auto request = ClientRequest::parseJson(body);
+    return request->key_.size() + request->data_.size() + request->context_.size();
+}
+
+size_t scanner(const std::string& body) {
+    auto request = ClientRequest::parse(body);
+    return request->key_.size() + request->data_.size() + request->context_.size();
+}
+
+template <typename Fn>
+void run(const char* name, const std::string& body, size_t iterations, Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < iterations; i++) {
+        sink += fn(body);
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("  %-8s %9.0f ns/request  %8.0f MB/s\n",
+        name, elapsed * 1e9 / iterations, body.size() * iterations / elapsed / 1e6);
+}
+
+int main(int argc, char* argv[]) {
+    size_t iterations = 200000;
+    if(argc > 1) iterations = std::stoul(argv[1]);
+
+    std::string context = base64::to_base64(std::string(60, 'c'));
+    for(size_t value_bytes : {16, 1024, 65536}) {
+        std::string data = base64::to_base64(std::string(value_bytes, 'v'));
+        json j{{"key", "user:12345"}, {"data", data}, {"context", context}};
+        std::string body = j.dump();
+
+        size_t n = std::max<size_t>(1000, iterations * 64 / (value_bytes + 64));
+        std::printf("%zu byte value, %zu byte body, %zu requests\n", value_bytes, body.size(), n);
+        run("json x2", body, n, doubleParse);
+        run("json x1", body, n, singleParse);
+        run("scanner", body, n, scanner);
+        std::printf("\n");
+    }
+
+    return sink == 0;
+}
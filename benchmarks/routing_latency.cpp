@@ -0,0 +1,90 @@
+// end to end client latency with requests spread over every node, like a load balancer
+//
+//   ROUTING=redirect ./launch_cluster.sh    then    ./build/benchmarks/bench_routing_latency
+//   ROUTING=proxy ./launch_cluster.sh       then    ./build/benchmarks/bench_routing_latency
+//
+//   ./build/benchmarks/bench_routing_latency [nodes] [requests] [value bytes] [base port]
+//
+// each request goes to a random node over a kept alive connection to it. with redirect
+// most of them come back as a 307 and the client follows on a new connection, with proxy
+// the node answers itself or through its pooled connection to a replica. compare the two
+// runs, the difference is what the routing mode costs a client
+
+#include "metrics/histogram.h"
+#include "storage/base64.hpp"
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "httplib.h"
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+struct Config {
+    size_t nodes = 10;
+    size_t requests = 5000;
+    size_t value_bytes = 256;
+    int base_port = 8080;
+};
+
+void report(const char* name, const Histogram& latency, size_t failed) {
+    auto s = latency.snapshot();
+    std::printf("  %-4s p50 %6llu us  p90 %6llu us  p99 %6llu us  mean %8.1f us  %zu failed\n", name,
+        static_cast<unsigned long long>(s.percentile(0.5)),
+        static_cast<unsigned long long>(s.percentile(0.9)),
+        static_cast<unsigned long long>(s.percentile(0.99)),
+        s.mean(), failed);
+}
+
+int main(int argc, char* argv[]) {
+    Config config;
+    if(argc > 1) config.nodes = std::stoul(argv[1]);
+    if(argc > 2) config.requests = std::stoul(argv[2]);
+    if(argc > 3) config.value_bytes = std::stoul(argv[3]);
+    if(argc > 4) config.base_port = std::stoi(argv[4]);
+
+    std::vector<std::unique_ptr<httplib::Client>> clients;
+    for(size_t i = 0; i < config.nodes; i++) {
+        auto client = std::make_unique<httplib::Client>("localhost", config.base_port + static_cast<int>(i));
+        client->set_keep_alive(true);
+        client->set_follow_location(true);
+        client->set_read_timeout(std::chrono::seconds(5));
+        clients.push_back(std::move(client));
+    }
+
+    std::mt19937_64 gen(1);
+    auto anyNode = [&]() -> httplib::Client& {
+        return *clients[gen() % clients.size()];
+    };
+    std::string data = base64::to_base64(std::string(config.value_bytes, 'v'));
+
+    std::printf("%zu requests of each over %zu nodes, %zu byte values\n",
+        config.requests, config.nodes, config.value_bytes);
+
+    Histogram put_latency;
+    size_t put_failed = 0;
+    for(size_t i = 0; i < config.requests; i++) {
+        json body{{"key", "bench-routing-" + std::to_string(i)}, {"data", data}, {"context", ""}};
+        std::string dumped = body.dump();
+        httplib::Client& client = anyNode();
+        ScopedTimer timer{put_latency};
+        auto res = client.Post("/put", dumped, "application/json");
+        put_failed += !res || res->status != 200;
+    }
+
+    Histogram get_latency;
+    size_t get_failed = 0;
+    for(size_t i = 0; i < config.requests; i++) {
+        std::string dumped = json{{"key", "bench-routing-" + std::to_string(gen() % config.requests)}}.dump();
+        httplib::Client& client = anyNode();
+        ScopedTimer timer{get_latency};
+        auto res = client.Post("/get", dumped, "application/json");
+        get_failed += !res || res->status != 200;
+    }
+
+    report("put", put_latency, put_failed);
+    report("get", get_latency, get_failed);
+    return 0;
+}
@@ -0,0 +1,138 @@
+// read heavy zipfian workload against DiskEngine alone and behind a memory tier
+//
+//   ./build/benchmarks/bench_tiered_skew [threads] [ops per thread] [keys] [cache % of data] [zipf theta]
+//
+// the dataset is prefilled, then every thread does 95% gets / 5% puts with keys drawn
+// from a zipf distribution, the usual shape of kv traffic where a few keys are most of it
+
+#include "metrics/histogram.h"
+#include "storage/disk_engine.h"
+#include "storage/memory_engine.h"
+#include "storage/tiered_engine.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+struct Config {
+    int threads = 4;
+    size_t ops_per_thread = 200000;
+    size_t keys = 200000;
+    double cache_pct = 10;
+    double theta = 0.99;
+    size_t value_bytes = 200;
+};
+
+// inverse cdf lookup over precomputed weights, fine for a few million keys
+class Zipf {
+    public:
+        Zipf(size_t n, double theta) : cdf_(n) {
+            double sum = 0;
+            for(size_t i = 0; i < n; i++) {
+                sum += 1.0 / std::pow(static_cast<double>(i + 1), theta);
+                cdf_[i] = sum;
+            }
+            for(auto& c : cdf_) {
+                c /= sum;
+            }
+        }
+
+        size_t operator()(std::mt19937_64& gen) {
+            double u = std::uniform_real_distribution<double>(0.0, 1.0)(gen);
+            return std::lower_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin();
+        }
+
+    private:
+        std::vector<double> cdf_;
+};
+
+std::string keyFor(size_t i) {
+    return "key-" + std::to_string(i);
+}
+
+template <typename Engine>
+void run(const char* name, Engine& engine, const Config& config, Zipf& zipf) {
+    Histogram latency;
+    std::atomic<bool> go{false};
+    std::vector<std::thread> workers;
+    std::string value(config.value_bytes, 'v');
+
+    for(int t = 0; t < config.threads; t++) {
+        workers.emplace_back([&, t] {
+            std::mt19937_64 gen(t + 1);
+            std::uniform_int_distribution<int> op_dist(0, 99);
+            while(!go.load(std::memory_order_acquire)) {}
+
+            for(size_t i = 0; i < config.ops_per_thread; i++) {
+                std::string key = keyFor(zipf(gen));
+                ScopedTimer timer{latency};
+                if(op_dist(gen) < 95) {
+                    engine.get(key);
+                } else {
+                    engine.put(key, value);
+                }
+            }
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for(auto& w : workers) {
+        w.join();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    auto snap = latency.snapshot();
+
+    std::printf("%-20s %12.0f ops/s   p50 %5lluus   p99 %5lluus\n",
+        name, config.ops_per_thread * config.threads / elapsed,
+        static_cast<unsigned long long>(snap.percentile(0.50)),
+        static_cast<unsigned long long>(snap.percentile(0.99)));
+}
+
+int main(int argc, char* argv[]) {
+    Config config;
+    if(argc > 1) config.threads = std::stoi(argv[1]);
+    if(argc > 2) config.ops_per_thread = std::stoul(argv[2]);
+    if(argc > 3) config.keys = std::stoul(argv[3]);
+    if(argc > 4) config.cache_pct = std::stod(argv[4]);
+    if(argc > 5) config.theta = std::stod(argv[5]);
+
+    Zipf zipf{config.keys, config.theta};
+    std::string id = "-bench-tiered-" + std::to_string(getpid());
+    std::string value(config.value_bytes, 'v');
+
+    // rough bytes per cached entry, key + value + bookkeeping
+    size_t data_bytes = config.keys * (config.value_bytes + 16 + 96);
+    size_t cache_bytes = static_cast<size_t>(data_bytes * config.cache_pct / 100.0);
+
+    std::printf("%d threads, %zu ops/thread, %zu keys, zipf %.2f, cache %zu KB (%.0f%% of data)\n\n",
+        config.threads, config.ops_per_thread, config.keys, config.theta, cache_bytes >> 10, config.cache_pct);
+
+    {
+        auto disk = std::make_shared<DiskEngine>(id, "");
+        for(size_t i = 0; i < config.keys; i++) disk->put(keyFor(i), value);
+
+        run("DiskEngine", *disk, config, zipf);
+
+        auto hot = std::make_shared<MemoryEngine>(cache_bytes);
+        TieredEngine<MemoryEngine, DiskEngine> tiered{hot, disk};
+        run("Tiered (cold start)", tiered, config, zipf);
+        run("Tiered (warm)", tiered, config, zipf);
+
+        auto stats = hot->stats();
+        std::printf("\nmemory tier: %zu entries, %zu KB, hit ratio %.3f, %llu evictions\n",
+            stats.entries_, stats.bytes_ >> 10, stats.hitRatio(),
+            static_cast<unsigned long long>(stats.evictions_));
+    }
+    std::filesystem::remove_all("/tmp/dynamo" + id);
+
+    return 0;
+}
@@ -3,11 +3,13 @@
 #include "hash_ring/hash_ring.h"
 #include <atomic>
 #include <condition_variable>
+#include <functional>
 #include <memory>
 #include <queue>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 class ErrorDetector {
     public:
         ErrorDetector(std::shared_ptr<HashRing> ring, int threshhold) :
@@ -18,6 +20,11 @@ class ErrorDetector {
         void markError(const std::string& key);
         void markSuccess(const std::string& key);
         void start();
+        // called with the node id whenever a node we marked as down passes a health check again
+        // must be called before start()
+        void onRecovered(std::function<void(const std::string&)> listener) {
+            recovery_listeners_.push_back(std::move(listener));
+        }
 
     private:
         std::unordered_map<std::string, std::atomic<int>> err_counts_;
@@ -29,4 +36,5 @@ class ErrorDetector {
         std::condition_variable cv_;
         std::atomic<bool> running_;
         int threshhold_;
+        std::vector<std::function<void(const std::string&)>> recovery_listeners_;
 };
\ No newline at end of file
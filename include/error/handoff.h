@@ -1,16 +1,30 @@
 #pragma once
 
 #include "hash_ring/hash_ring.h"
-#include "storage/disk_engine.h"
+#include "hash_ring/rpc.h"
+#include "storage/storage_engine.h"
 #include "storage/value.h"
 #include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include "storage/serializer.h"
 #include "logging/logger.h"
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
 
+// old on disk format, one record per key holding every target
+// only read once at startup to move it over to the per target layout
 struct HandoffData {
     template <class Archive>
     void serialize(Archive & archive) {
@@ -30,103 +44,375 @@ bool contains(const std::vector<T>& vec, const T& item) {
     return std::find(vec.begin(), vec.end(), item) !=  vec.end();
 }
 
-// abstract underlying storage layer out later
-// TODO: 
+struct HandoffConfig {
+    // how many targets are drained at the same time
+    int workers_{4};
+    // hints per batch rpc, and a cap on the batch size in bytes
+    size_t batch_size_{64};
+    size_t max_batch_bytes_{1 << 20};
+    // hints per second delivered to a single target, 0 means unthrottled
+    size_t max_rate_{2000};
+    // catches targets we never saw go down, e.g. hints another coordinator sent us
+    std::chrono::milliseconds sweep_interval_{5000};
+};
+
+struct HandoffTargetStats {
+    uint64_t backlog_{0};
+    uint64_t delivered_{0};
+    uint64_t failed_batches_{0};
+    // hints per second over the most recent drain
+    double drain_rate_{0};
+    bool draining_{false};
+};
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(HandoffTargetStats, backlog_, delivered_, failed_batches_, drain_rate_, draining_)
+
+// hinted handoff over any StorageEngine with ordered scans
+// hints are keyed by target + '\0' + key so every target is one contiguous key range.
+// a target is only drained when we hear it is back (error detector, membership) or the slow
+// sweep finds it active with a backlog, so the work done is proportional to the hints of
+// recovered targets instead of every hint we hold
+template <typename Store>
 class Handoff {
+    static_assert(std::is_base_of_v<StorageEngine<Store>, Store>, "Store must be a StorageEngine");
+
     private:
-        std::shared_ptr<DiskEngine> storage_;
+        std::shared_ptr<Store> storage_;
         std::shared_ptr<HashRing> ring_;
-        std::thread t_;
-        std::atomic<bool> running_;
+        HandoffConfig config_;
 
-    public:
-        Handoff(std::shared_ptr<DiskEngine> storage, std::shared_ptr<HashRing> ring) :
-            ring_(ring),
-            storage_(storage) {}
+        // guards hint read-modify-writes and stats_
+        std::mutex mu_;
+        std::unordered_map<std::string, HandoffTargetStats> stats_;
+        // total hints, read by the vitals without taking mu_
+        std::atomic<uint64_t> backlog_{0};
 
-        void append(const std::string& key, const std::string& tag, const Value& val) {
-            HandoffData handoff = Serializer::fromBinary<HandoffData>(storage_ -> get(key));
+        std::mutex queue_mu_;
+        std::condition_variable queue_cv_;
+        std::deque<std::string> queue_;
+        // targets queued or being drained, so a target never has two streams
+        std::unordered_set<std::string> scheduled_;
+        // the sweeper's own, so a schedule() can't spend its notify_one on it
+        std::condition_variable sweep_cv_;
 
-            // add to targets if not already present
-            if (std::find(handoff.targets_.begin(), handoff.targets_.end(), tag) == handoff.targets_.end()) {
-                handoff.targets_.push_back(tag);
+        std::vector<std::thread> workers_;
+        std::thread sweeper_;
+        std::atomic<bool> running_{false};
+
+        static std::string hintKey(const std::string& target, const std::string& key) {
+            std::string out;
+            out.reserve(target.size() + 1 + key.size());
+            out.append(target);
+            out.push_back('\0');
+            out.append(key);
+            return out;
+        }
+
+        // caller holds mu_
+        void appendLocked(const std::string& key, const std::string& target, const Value& val) {
+            std::string hint_key = hintKey(target, key);
+            ValueList values = Serializer::fromBinary<ValueList>(storage_->get(hint_key));
+            bool was_empty = values.empty();
+
+            // we already hold something at least as new
+            bool outdated = std::any_of(values.begin(), values.end(), [&val](const Value& v) {
+                return val.clock_ < v.clock_;
+            });
+            if (outdated) {
+                return;
             }
 
-            handoff.data = val;
+            // keep siblings, drop anything the new value supersedes
+            values.erase(
+                std::remove_if(values.begin(), values.end(), [&val](const Value& v) {
+                    return v.clock_ < val.clock_;
+                }),
+                values.end()
+            );
+            values.push_back(val);
+            storage_->put(hint_key, Serializer::toBinary(values));
 
-            storage_->put(key, Serializer::toBinary(handoff));
+            if (was_empty) {
+                stats_[target].backlog_++;
+                backlog_++;
+            }
         }
 
-        void start() {
-            if (t_.joinable()) return;
-
-            running_.store(true);
-
-            t_ = std::thread([this] {
-                while (running_.load()) {
-                    leveldb::DB* db = storage_ -> getDB();
-                    auto snapshot = db->GetSnapshot();
-
-                    auto ro = leveldb::ReadOptions();
-                    ro.snapshot = snapshot;
-
-                    auto it = std::unique_ptr<leveldb::Iterator>(
-                        db->NewIterator(ro)
-                    );
-
-                    for (it->SeekToFirst();
-                        it->Valid() && running_.load();
-                        it->Next()) {
-
-                        std::string key(it->key().data(), it->key().size());
-                        HandoffData data =
-                            Serializer::fromBinary<HandoffData>(std::string(it->value().data(), it->value().size()));
-
-                        std::vector<std::string> succeeded;
-                        succeeded.reserve(data.targets_.size());
-
-                        for (const auto& target : data.targets_) {
-                            if (!running_.load()) break;
-
-                            auto node = ring_->getNode(target);
-                            
-                            Logger::instance().debug("Attempting to replicate to: " + target);
-                            if (node && node->replicatePut(key, data.data)) {
-                                Logger::instance().debug("Handoff successful to: " + target);
-                                succeeded.push_back(target);
-                            }
-                        }
-
-                        data.targets_.erase(
-                            std::remove_if(
-                                data.targets_.begin(),
-                                data.targets_.end(),
-                                [&](const std::string& t) {
-                                    return contains(succeeded, t);
-                            }),
-                            data.targets_.end()
-                        );
-
-                        if (data.targets_.empty()) {
-                            storage_->remove(key);
-                        } else {
-                            storage_->put(key, Serializer::toBinary(data));
-                        }
+        void load() {
+            std::vector<std::pair<std::string, HandoffData>> legacy;
+            {
+                std::lock_guard<std::mutex> lk(mu_);
+                storage_->scan("", [&](const std::string& key, const ByteString& value) {
+                    auto sep = key.find('\0');
+                    if (sep == std::string::npos) {
+                        legacy.emplace_back(key, Serializer::fromBinary<HandoffData>(value));
+                    } else {
+                        stats_[key.substr(0, sep)].backlog_++;
+                        backlog_++;
                     }
+                    return true;
+                });
 
-                    db -> ReleaseSnapshot(snapshot);
-                    std::this_thread::sleep_for(std::chrono::seconds(5));
+                for (auto& [key, data] : legacy) {
+                    for (auto& target : data.targets_) {
+                        appendLocked(key, target, data.data);
+                    }
+                    storage_->remove(key);
                 }
-        });
+            }
 
-        Logger::instance().info("Starting handoff process in background thread...");
-    }
+            if (!legacy.empty()) {
+                Logger::instance().info("Migrated " + std::to_string(legacy.size()) + " hints to the per target layout");
+            }
+            Logger::instance().info("Loaded " + std::to_string(backlog_.load()) + " pending hints for " + std::to_string(stats_.size()) + " targets");
+        }
 
-    void stop() {
-        Logger::instance().info("Stopping handoff process...");
-        running_.store(false);
-        if (t_.joinable()) {
-            t_.join();
+        void schedule(const std::string& target) {
+            {
+                std::lock_guard<std::mutex> lk(queue_mu_);
+                if (!scheduled_.insert(target).second) {
+                    return;
+                }
+                queue_.push_back(target);
+            }
+            queue_cv_.notify_one();
         }
-    }
-};
\ No newline at end of file
+
+        void finish(const std::string& target) {
+            std::lock_guard<std::mutex> lk(queue_mu_);
+            scheduled_.erase(target);
+        }
+
+        // sends one batch and deletes the hints that did not change while it was in flight
+        bool deliver(const std::shared_ptr<Node>& node,
+                     const std::string& target,
+                     std::vector<PutRpc>& batch,
+                     std::vector<std::pair<std::string, std::string>>& sent) {
+            if (batch.empty()) {
+                return true;
+            }
+
+            if (!node->replicateBatch(batch)) {
+                std::lock_guard<std::mutex> lk(mu_);
+                stats_[target].failed_batches_++;
+                return false;
+            }
+
+            std::lock_guard<std::mutex> lk(mu_);
+            uint64_t removed = 0;
+            for (auto& [hint_key, raw] : sent) {
+                // a newer hint for the same key landed after we read it, leave it for the next drain
+                if (storage_->get(hint_key) != raw) {
+                    continue;
+                }
+                storage_->remove(hint_key);
+                removed++;
+            }
+
+            auto& stats = stats_[target];
+            stats.backlog_ -= std::min(stats.backlog_, removed);
+            stats.delivered_ += removed;
+            backlog_ -= removed;
+
+            batch.clear();
+            sent.clear();
+            return true;
+        }
+
+        void drain(const std::string& target) {
+            auto node = ring_->getNode(target);
+            if (!node || !node->isActive()) {
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lk(mu_);
+                stats_[target].draining_ = true;
+            }
+
+            Logger::instance().info("Draining hints for " + target);
+            auto start = std::chrono::steady_clock::now();
+            uint64_t delivered = 0;
+
+            std::vector<PutRpc> batch;
+            std::vector<std::pair<std::string, std::string>> sent;
+            bool ok = true;
+
+            std::string prefix = hintKey(target, "");
+            std::string cursor = prefix;
+
+            while (running_.load()) {
+                // collect one batch, the network call happens outside the scan
+                size_t batch_bytes = 0;
+                storage_->scan(cursor, [&](const std::string& hint_key, const ByteString& raw) {
+                    if (!hint_key.starts_with(prefix)) {
+                        return false;
+                    }
+
+                    std::string key = hint_key.substr(prefix.size());
+                    for (auto& v : Serializer::fromBinary<ValueList>(raw)) {
+                        batch_bytes += key.size() + v.data_.size();
+                        batch.emplace_back(key, std::move(v));
+                    }
+                    sent.emplace_back(hint_key, raw);
+                    // smallest key after this one
+                    cursor = hint_key + '\0';
+
+                    return sent.size() < config_.batch_size_ && batch_bytes < config_.max_batch_bytes_;
+                });
+
+                if (sent.empty()) {
+                    break;
+                }
+
+                size_t count = sent.size();
+                if (!deliver(node, target, batch, sent)) {
+                    ok = false;
+                    break;
+                }
+                delivered += count;
+
+                // pace the stream so a recovering node isn't flattened by its own backlog
+                if (config_.max_rate_ > 0) {
+                    auto due = start + std::chrono::microseconds(delivered * 1000000 / config_.max_rate_);
+                    std::this_thread::sleep_until(due);
+                }
+            }
+
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            {
+                std::lock_guard<std::mutex> lk(mu_);
+                auto& stats = stats_[target];
+                stats.draining_ = false;
+                if (delivered > 0 && elapsed > 0) {
+                    stats.drain_rate_ = delivered / elapsed;
+                }
+            }
+
+            Logger::instance().info(
+                "Delivered " + std::to_string(delivered) + " hints to " + target +
+                (ok ? "" : ", stopped early") + " in " + std::to_string(static_cast<int>(elapsed * 1000)) + "ms"
+            );
+        }
+
+        void work() {
+            while (true) {
+                std::string target;
+                {
+                    std::unique_lock<std::mutex> lk(queue_mu_);
+                    queue_cv_.wait(lk, [this] {
+                        return !running_.load() || !queue_.empty();
+                    });
+                    if (!running_.load()) return;
+                    target = std::move(queue_.front());
+                    queue_.pop_front();
+                }
+
+                drain(target);
+                finish(target);
+            }
+        }
+
+        void sweep() {
+            std::unique_lock<std::mutex> lk(queue_mu_);
+            while (running_.load()) {
+                sweep_cv_.wait_for(lk, config_.sweep_interval_, [this] {
+                    return !running_.load();
+                });
+                if (!running_.load()) return;
+                lk.unlock();
+
+                for (auto& target : pendingTargets()) {
+                    auto node = ring_->getNode(target);
+                    if (node && node->isActive()) {
+                        schedule(target);
+                    }
+                }
+
+                lk.lock();
+            }
+        }
+
+        std::vector<std::string> pendingTargets() {
+            std::lock_guard<std::mutex> lk(mu_);
+            std::vector<std::string> out;
+            for (auto& [target, stats] : stats_) {
+                if (stats.backlog_ > 0) {
+                    out.push_back(target);
+                }
+            }
+            return out;
+        }
+
+    public:
+        Handoff(std::shared_ptr<Store> storage, std::shared_ptr<HashRing> ring, HandoffConfig config = {}) :
+            ring_(ring),
+            storage_(storage),
+            config_(config) {
+                load();
+            }
+
+        ~Handoff() {
+            stop();
+        }
+
+        uint64_t backlog() {
+            return backlog_.load(std::memory_order_relaxed);
+        }
+
+        std::unordered_map<std::string, HandoffTargetStats> stats() {
+            std::lock_guard<std::mutex> lk(mu_);
+            return stats_;
+        }
+
+        void append(const std::string& key, const std::string& tag, const Value& val) {
+            std::lock_guard<std::mutex> lk(mu_);
+            appendLocked(key, tag, val);
+        }
+
+        // called when a target is seen coming back, cheap enough for listener threads
+        void notifyRecovered(const std::string& target) {
+            {
+                std::lock_guard<std::mutex> lk(mu_);
+                auto it = stats_.find(target);
+                if (it == stats_.end() || it->second.backlog_ == 0) {
+                    return;
+                }
+            }
+            schedule(target);
+        }
+
+        void start() {
+            if (running_.exchange(true)) return;
+
+            for (int i = 0; i < config_.workers_; i++) {
+                workers_.emplace_back([this] { work(); });
+            }
+            sweeper_ = std::thread([this] { sweep(); });
+
+            // anything left over from the last run goes out as soon as the target looks alive
+            for (auto& target : pendingTargets()) {
+                schedule(target);
+            }
+
+            Logger::instance().info("Starting handoff process with " + std::to_string(config_.workers_) + " drain workers...");
+        }
+
+        void stop() {
+            if (!running_.exchange(false)) return;
+            Logger::instance().info("Stopping handoff process...");
+            {
+                // taking the lock makes sure nobody is between checking running_ and waiting
+                std::lock_guard<std::mutex> lk(queue_mu_);
+            }
+            queue_cv_.notify_all();
+            sweep_cv_.notify_all();
+            for (auto& t : workers_) {
+                if (t.joinable()) t.join();
+            }
+            workers_.clear();
+            if (sweeper_.joinable()) {
+                sweeper_.join();
+            }
+        }
+};
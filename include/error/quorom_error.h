@@ -1,5 +1,6 @@
 #pragma once
 
+#include <expected>
 #include <stdexcept>
 #include <string>
 
@@ -8,3 +9,18 @@ public:
     explicit QuoromError(const std::string& msg)
         : std::runtime_error(msg) {}
 };
+
+enum class QuoromCode {
+    // fewer nodes in the ring than replicas
+    TOO_FEW_NODES,
+    // R or W replicas didn't answer in time
+    NOT_ENOUGH_RESPONSES
+};
+
+struct QuoromFailure {
+    QuoromCode code_;
+    std::string message_;
+};
+
+template <typename T>
+using QuoromResult = std::expected<T, QuoromFailure>;
@@ -1,10 +1,31 @@
 #pragma once
 
+#include <expected>
 #include <stdexcept>
 #include <string>
 
+// thrown for failures nobody on the request path can do anything about
 class StorageError : public std::runtime_error {
 public:
     explicit StorageError(const std::string& msg)
         : std::runtime_error(msg) {}
 };
+
+enum class StorageCode {
+    // a plain miss, the common case for a fresh key, never thrown
+    NOT_FOUND,
+    IO_ERROR,
+    CORRUPTION
+};
+
+struct StorageFailure {
+    StorageCode code_;
+    std::string message_;
+
+    bool notFound() const {
+        return code_ == StorageCode::NOT_FOUND;
+    }
+};
+
+template <typename T>
+using StorageResult = std::expected<T, StorageFailure>;
@@ -38,12 +38,15 @@ public:
     void addNode(std::shared_ptr<Node> node);
     void removeNode(const std::string& node_id);
 
+    // returns nullptr if the node is not on the ring
     std::shared_ptr<Node> getNode(const std::string& id);
 
     std::vector<std::shared_ptr<Node>> getNodes() {
+        std::shared_lock<std::shared_mutex> lock(rwlock_);
         return nodes_;
     }
     std::vector<VirtualNode> getVirtualNodes() {
+        std::shared_lock<std::shared_mutex> lock(rwlock_);
         return std::vector<VirtualNode>(node_ring_.begin(), node_ring_.end());
     }
 
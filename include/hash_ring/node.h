@@ -5,6 +5,9 @@
 #include <atomic>
 #include <memory>
 #include <string>
+#include <vector>
+
+struct PutRpc;
 
 class Node {
     public:
@@ -12,8 +15,14 @@ class Node {
         Node(std::string addr, int port, size_t tokens = 1000);
         bool send(const std::string& endpoint, const ByteString& data);
         bool replicatePut(const std::string& key, const Value& value);
+        // several versions of one key, on the hot path timeouts
+        bool replicatePut(const std::string& key, const ValueList& values);
+        // one request for many keys, slower timeouts than the single key path
+        bool replicateBatch(const std::vector<PutRpc>& puts);
         bool replicateHandoff(const std::string& key, const Value& value, const std::string& node_id);
         std::optional<ValueList> replicateGet(const std::string& key);
+        // one request for many keys, versions in the order of keys
+        std::optional<std::vector<ValueList>> replicateGetMany(const std::vector<std::string>& keys);
         bool checkHealth();
         std::string getFullAddress();
         std::string getId();
@@ -41,6 +50,8 @@ class Node {
         std::string id_;
         std::string addr_;
         std::shared_ptr<httplib::Client> client_;
+        // separate client so bulk transfers don't inherit the 50ms hot path timeouts
+        std::shared_ptr<httplib::Client> bulk_client_;
         size_t tokens_;
         std::atomic<bool> active_;
         int port_;
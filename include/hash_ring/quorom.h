@@ -1,11 +1,14 @@
 #pragma once
 
 #include "error/error_detector.h"
+#include "error/quorom_error.h"
 #include "hash_ring/hash_ring.h"
+#include "hash_ring/rpc.h"
 #include "storage/value.h"
 #include <httplib.h>
 #include <memory>
 #include <string>
+#include <vector>
 
 class Quorom {
     public:
@@ -17,16 +20,56 @@ class Quorom {
                 W_(W),
                 err_detector_(err_detector) {};
 
+        // a shortfall is returned, not thrown, a partitioned node misses quorum on
+        // every request and those failures shouldn't each cost an unwind
         // TODO: FIX SEGFAULT RACE CONDITION
-        ValueList get(const std::string& key);
+        QuoromResult<ValueList> get(const std::string& key);
 
-        bool put(const std::string& key, const Value& value);
+        QuoromResult<void> put(const std::string& key, const Value& value);
+        // one fan out for several versions of the same key
+        QuoromResult<void> put(const std::string& key, const ValueList& values);
+
+        // many keys at once, one request per replica node instead of one per key and
+        // replica. a result per key in the order given. this node doesn't have to be a
+        // replica of the keys, where it is its own copy is the caller's and counts
+        // towards R or W like it does above
+        std::vector<QuoromResult<ValueList>> getMany(const std::vector<std::string>& keys);
+        std::vector<QuoromResult<void>> putMany(const std::vector<PutRpc>& puts);
+
+        // this node is among the first N of the key's preference list
+        bool isReplica(const std::string& key);
 
         int getN();
 
         std::shared_ptr<Node> getCurrNode();
 
     private:
+        // where one key of a batch goes, as seen from this node
+        struct Placement {
+            bool enough_nodes_{false};
+            bool local_{false};
+            // the first N except this node, each standing in for the one at the same index
+            std::vector<std::shared_ptr<Node>> replicas_;
+            std::vector<std::shared_ptr<Node>> spares_;
+        };
+
+        // the keys one node is asked about in a batch
+        struct NodeBatch {
+            std::shared_ptr<Node> node_;
+            // the replica the node stands in for, empty unless it's a spare
+            std::string hint_for_;
+            std::vector<size_t> keys_;
+        };
+
+        std::vector<Placement> place(const std::vector<std::string>& keys);
+        // every replica of every key, one batch per node
+        std::vector<NodeBatch> replicaBatches(const std::vector<Placement>& placements);
+        // the keys of failed batches, one batch per spare standing in
+        std::vector<NodeBatch> spareBatches(const std::vector<Placement>& placements, const std::vector<NodeBatch>& failed);
+        // one thread per batch, waits for all of them and returns the ones send failed
+        template <typename Send>
+        static std::vector<NodeBatch> runBatches(std::vector<NodeBatch> batches, Send send);
+
         std::shared_ptr<Node> curr_node_;
         std::shared_ptr<HashRing> ring_;
         std::shared_ptr<ErrorDetector> err_detector_;
@@ -48,6 +48,27 @@ struct HandoffRpc : PutRpc {
     std::string target_node_id_;
 };
 
+// many replica writes in one request, used to drain hinted handoff
+struct BatchPutRpc {
+    template <class Archive>
+    void serialize(Archive & archive) {
+        archive(puts_);
+    }
+
+    std::vector<PutRpc> puts_;
+};
+
+// many keys read in one request, the reply is a std::vector<ByteString> with each key's
+// stored versions in the same order, empty for a key the replica doesn't have
+struct BatchGetRpc {
+    template <class Archive>
+    void serialize(Archive & archive) {
+        archive(keys_);
+    }
+
+    std::vector<std::string> keys_;
+};
+
 // json serialized
 struct PutBody {
     std::string key;
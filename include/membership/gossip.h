@@ -3,85 +3,54 @@
 #include "error/error_detector.h"
 #include "hash_ring/hash_ring.h"
 #include "logging/logger.h"
+#include "membership/membership.h"
+#include "membership/snapshot.h"
+#include "membership/swim.h"
+#include "membership/vitals.h"
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <fstream>
+#include <functional>
 #include <memory>
+#include <optional>
+#include <random>
 #include <string>
-#include <nlohmann/json.hpp>
-using json = nlohmann::json;
+#include <thread>
+#include <cereal/types/optional.hpp>
+#include <cereal/types/unordered_map.hpp>
 
-struct NodeState {
-    enum Status {
-        ACTIVE,
-        KILLED
-    };
-
-    std::string id_;
-    std::string address_;
-    int port_;
-    Status status_;
-    uint64_t incarnation_;
-    int tokens_;
+// body of /admin/gossip
+struct GossipMessage {
+    // left out unless membership changed recently or it is a periodic anti-entropy round,
+    // so the vitals below can be gossiped every round without shipping the whole cluster
+    std::optional<ClusterState> membership_;
+    ClusterVitals vitals_;
 
     template <class Archive>
     void serialize(Archive & archive) {
-        archive(id_, address_, port_, status_, incarnation_, tokens_);
-    }
-
-    std::string toString() const {
-        std::ostringstream oss;
-        oss << "NodeState{"
-            << "id=" << id_
-            << ", address=" << address_
-            << ", port=" << port_
-            << ", status=" << (status_ == ACTIVE ? "ACTIVE" : "KILLED")
-            << ", incarnation=" << incarnation_
-            << ", tokens=" << tokens_
-            << "}";
-        return oss.str();
+        archive(membership_, vitals_);
     }
 };
 
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(NodeState, id_, address_, port_, status_, incarnation_)
-
-using ClusterState = std::unordered_map<std::string, NodeState>;
-
 class Gossip {
     public:
         void start();
         Gossip(std::shared_ptr<HashRing> ring, 
                int fanout, std::shared_ptr<Node> curr, 
                std::vector<std::pair<std::string, int>> bootstrap_servers,
-               std::shared_ptr<ErrorDetector> err_detector
+               std::shared_ptr<ErrorDetector> err_detector,
+               std::chrono::milliseconds interval = std::chrono::milliseconds(1000)
             ) : 
             ring_(ring),
+            membership_(std::make_shared<Membership>(ring)),
             fanout_(fanout),
+            interval_(interval),
             curr_node_(curr),
             bootstrap_servers_(bootstrap_servers),
-            err_detector_(err_detector) {
-                std::string path{
-                    "/tmp/" + curr->getAddr() + ":" + std::to_string(curr->getPort()) + "-gossip"
-                };
-
-                std::ifstream in(path);
-
-                uint64_t incarnation = 1;
-                if (in && !(in >> incarnation)) {
-                    incarnation = 1;
-                    Logger::instance().debug("Could not read gossip number from path: " + path + ". settning default instead");
-                }
-
-                Logger::instance().info("gossip number: " + std::to_string(incarnation));
-
-                NodeState initial{
-                        curr->getId(),
-                        curr->getAddr(),
-                        curr->getPort(),
-                        NodeState::Status::ACTIVE,
-                        incarnation + 1,
-                        curr->getTokens()
-                    };
-                addState(initial);
+            err_detector_(err_detector),
+            store_(MembershipStore::pathFor(curr->getAddr(), curr->getPort())) {
+                restore();
             }
 
         ~Gossip() {
@@ -90,22 +59,61 @@ class Gossip {
             if (t_.joinable()) t_.join();
         }
 
-        void addState(NodeState state); 
-        void onRecieve(ClusterState &other_state);
+        void onRecieve(const GossipMessage &message);
+        // merges a joining node's state and hands back our full view
+        ClusterState onJoin(const ClusterState &joiner_state);
         void transmitRandom(std::mt19937 &gen);
         void stop();
 
+        // safe to call from any thread, returns a copy of the latest snapshot
         ClusterState getState() {
-            return state_;
+            return membership_->snapshot()->nodes_;
+        }
+
+        std::shared_ptr<Membership> getMembership() {
+            return membership_;
+        }
+
+        // sampled once per gossip round on the gossip thread
+        void setVitalsProvider(std::function<NodeVitals()> provider) {
+            vitals_provider_ = std::move(provider);
+        }
+
+        ClusterVitals getVitals() {
+            return vitals_.getAll();
+        }
+
+        // hands failure detection and dissemination to swim instead of the http gossip loop
+        // must be called before start()
+        void setSwim(std::shared_ptr<Swim> swim) {
+            swim_ = swim;
         }
 
     private:
+        // loads the last persisted view so routing works before the first gossip round
+        void restore();
+        void persist();
+        bool join(std::optional<std::chrono::steady_clock::time_point> deadline);
+
         std::shared_ptr<HashRing> ring_;
+        std::shared_ptr<Membership> membership_;
+        std::shared_ptr<Swim> swim_;
         std::shared_ptr<ErrorDetector> err_detector_;
         std::shared_ptr<Node> curr_node_;
-        ClusterState state_;
         std::thread t_;
         std::atomic<bool> running{false};
         std::vector<std::pair<std::string, int>> bootstrap_servers_;
         int fanout_;
+        std::chrono::milliseconds interval_;
+        MembershipStore store_;
+        VitalsTable vitals_;
+        std::function<NodeVitals()> vitals_provider_;
+        // membership version we last pushed and how many more rounds to keep pushing it
+        uint64_t sent_version_{0};
+        int membership_rounds_left_{0};
+        uint64_t rounds_{0};
+        // true if restore() found a snapshot, joining becomes best effort
+        bool restored_{false};
+        uint64_t persisted_version_{0};
+        std::chrono::steady_clock::time_point last_persist_{};
 };
\ No newline at end of file
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "hash_ring/hash_ring.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+struct NodeState {
+    // appended values only, the enum is serialized as an int
+    enum Status {
+        ACTIVE,
+        KILLED,
+        SUSPECT
+    };
+
+    std::string id_;
+    std::string address_;
+    int port_;
+    Status status_;
+    uint64_t incarnation_;
+    int tokens_;
+
+    template <class Archive>
+    void serialize(Archive & archive) {
+        archive(id_, address_, port_, status_, incarnation_, tokens_);
+    }
+
+    std::string toString() const {
+        std::ostringstream oss;
+        oss << "NodeState{"
+            << "id=" << id_
+            << ", address=" << address_
+            << ", port=" << port_
+            << ", status=" << statusToStr(status_)
+            << ", incarnation=" << incarnation_
+            << ", tokens=" << tokens_
+            << "}";
+        return oss.str();
+    }
+
+    static const char* statusToStr(Status status) {
+        switch(status) {
+            case ACTIVE: return "ACTIVE";
+            case KILLED: return "KILLED";
+            case SUSPECT: return "SUSPECT";
+        }
+        return "?";
+    }
+
+    // at equal incarnations a death beats a suspicion which beats being alive
+    static int statusRank(Status status) {
+        switch(status) {
+            case ACTIVE: return 0;
+            case SUSPECT: return 1;
+            case KILLED: return 2;
+        }
+        return 0;
+    }
+
+    // true if this state should replace other in a merge
+    bool supersedes(const NodeState& other) const {
+        return incarnation_ > other.incarnation_ ||
+               (incarnation_ == other.incarnation_ && statusRank(status_) > statusRank(other.status_));
+    }
+};
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(NodeState, id_, address_, port_, status_, incarnation_)
+
+using ClusterState = std::unordered_map<std::string, NodeState>;
+
+// immutable view of the cluster, a new one is published on every change
+struct MembershipSnapshot {
+    uint64_t version_{0};
+    ClusterState nodes_;
+};
+
+// copy on write membership table
+// readers grab the current snapshot without blocking, writers copy it, apply their change
+// and publish with a compare and swap, retrying if another writer got there first.
+// the ring is reconciled against the published snapshot afterwards so ring changes
+// land exactly once no matter how many threads raced on the same transition
+class Membership {
+    public:
+        using Listener = std::function<void(const NodeState&)>;
+
+        explicit Membership(std::shared_ptr<HashRing> ring);
+
+        std::shared_ptr<const MembershipSnapshot> snapshot() const;
+        uint64_t version() const;
+        std::optional<NodeState> get(const std::string& id) const;
+
+        // merges a remote view into ours, see NodeState::supersedes
+        // returns true if anything changed
+        bool merge(const ClusterState& other);
+
+        // applies fn to our copy of a node and publishes the result
+        // returns false if the node is unknown
+        bool update(const std::string& id, const std::function<void(NodeState&)>& fn);
+
+        // called with the new state of every node that changed, after the ring is updated
+        // listeners run on the writer's thread so they should be quick
+        void subscribe(Listener listener);
+
+    private:
+        bool publish(std::shared_ptr<const MembershipSnapshot>& expected,
+                     std::shared_ptr<const MembershipSnapshot> next);
+        void onPublished(const MembershipSnapshot& published, const std::vector<std::string>& ids);
+        void reconcileRing(const std::vector<std::string>& ids);
+
+        std::shared_ptr<HashRing> ring_;
+        // std::atomic<std::shared_ptr> is not in libc++ yet, so use the free functions
+        std::shared_ptr<const MembershipSnapshot> current_;
+        // only serializes ring add / remove, membership updates never take it
+        std::mutex ring_mu_;
+        std::mutex listeners_mu_;
+        std::vector<Listener> listeners_;
+};
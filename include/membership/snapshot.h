@@ -0,0 +1,47 @@
+#pragma once
+
+#include "membership/membership.h"
+#include <cstdint>
+#include <optional>
+#include <string>
+
+// what a node last knew about the cluster, written on shutdown and periodically.
+// the ring is not stored separately: vnode positions are md5(node id + index) so
+// (id, tokens) from each NodeState is enough to rebuild the exact same layout
+struct PersistedMembership {
+    static constexpr uint32_t FORMAT_VERSION = 1;
+
+    uint32_t format_version_{FORMAT_VERSION};
+    std::string self_id_;
+    uint64_t saved_at_ms_{0};
+    uint64_t membership_version_{0};
+    ClusterState nodes_;
+
+    template <class Archive>
+    void serialize(Archive & archive) {
+        archive(format_version_, self_id_, saved_at_ms_, membership_version_, nodes_);
+    }
+};
+
+class MembershipStore {
+    public:
+        explicit MembershipStore(std::string path) : path_(std::move(path)) {}
+
+        static std::string pathFor(const std::string& addr, int port) {
+            return "/tmp/" + addr + ":" + std::to_string(port) + "-membership";
+        }
+
+        // writes to a temp file and renames it over the old snapshot so a crash
+        // mid write never leaves a torn file behind
+        bool save(const MembershipSnapshot& snapshot, const std::string& self_id);
+
+        // nullopt if there is no snapshot or it can't be read
+        std::optional<PersistedMembership> load();
+
+        const std::string& path() const {
+            return path_;
+        }
+
+    private:
+        std::string path_;
+};
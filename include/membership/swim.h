@@ -0,0 +1,130 @@
+#pragma once
+
+#include "hash_ring/node.h"
+#include "membership/membership.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <netinet/in.h>
+
+// wire format for every swim datagram
+// membership updates ride along on pings, ping-reqs and acks
+struct SwimMessage {
+    enum Type : uint8_t {
+        PING,
+        PING_REQ,
+        ACK
+    };
+
+    Type type_;
+    uint64_t seq_;
+    std::string from_;
+    // ping-req: node to probe on the sender's behalf
+    // ack: node the ack is vouching for
+    std::string target_;
+    std::vector<NodeState> updates_;
+
+    template <class Archive>
+    void serialize(Archive & archive) {
+        archive(type_, seq_, from_, target_, updates_);
+    }
+};
+
+struct SwimConfig {
+    std::chrono::milliseconds protocol_period_{200};
+    std::chrono::milliseconds ack_timeout_{50};
+    // number of members asked to probe indirectly when a direct ping times out
+    int indirect_probes_{3};
+    // suspects are declared dead after suspicion_mult_ * log2(n + 1) protocol periods
+    int suspicion_mult_{4};
+    // each update is piggybacked retransmit_mult_ * log2(n + 1) times
+    int retransmit_mult_{3};
+    size_t max_piggyback_{8};
+};
+
+// SWIM failure detector and dissemination over udp
+// every protocol period we ping one member (round robin over a shuffled list), fall back
+// to k indirect pings through other members, and suspect the target if nobody gets an ack.
+// suspects that don't refute in time are marked KILLED. all state changes go through the
+// shared Membership so gossip joins and swim updates see the same view, and any change
+// made there is queued for piggybacking. this keeps the cost at O(1) messages per node per period
+//
+// the udp socket binds to the same port number as the http server
+class Swim {
+    public:
+        Swim(std::shared_ptr<Membership> membership, std::shared_ptr<Node> curr, SwimConfig config = {});
+        ~Swim();
+
+        void start();
+        // flushes pending updates (e.g. our own KILLED state) to a few members, then stops
+        void stop();
+
+    private:
+        struct PendingUpdate {
+            NodeState state_;
+            int sent_;
+        };
+
+        // owned through a shared_ptr so the membership listener can outlive us safely
+        struct Dissemination {
+            std::mutex mu_;
+            std::unordered_map<std::string, PendingUpdate> pending_;
+        };
+
+        struct Relay {
+            sockaddr_in requester_;
+            uint64_t seq_;
+            std::chrono::steady_clock::time_point created_;
+        };
+
+        void probeLoop();
+        void receiveLoop();
+        void probe(const NodeState& target);
+        void handle(const SwimMessage& msg, const sockaddr_in& from);
+        void applyUpdates(const std::vector<NodeState>& updates);
+        void checkSuspects();
+
+        bool send(const NodeState& to, SwimMessage msg);
+        void sendTo(const sockaddr_in& addr, SwimMessage msg);
+        bool waitForAck(uint64_t seq, std::chrono::steady_clock::time_point deadline);
+        std::vector<NodeState> takePiggyback();
+        std::vector<NodeState> probeCandidates();
+        bool resolve(const NodeState& node, sockaddr_in& out);
+        int retransmitLimit();
+
+        std::shared_ptr<Membership> membership_;
+        std::shared_ptr<Node> curr_node_;
+        SwimConfig config_;
+        int fd_{-1};
+
+        std::thread probe_t_;
+        std::thread receive_t_;
+        std::atomic<bool> running_{false};
+        std::atomic<uint64_t> seq_{0};
+        std::mt19937 gen_;
+
+        // round robin probe order, only touched by the probe thread
+        std::vector<std::string> probe_order_;
+        size_t probe_idx_{0};
+
+        std::mutex ack_mu_;
+        std::condition_variable ack_cv_;
+        std::unordered_map<uint64_t, bool> acks_;
+        std::unordered_map<uint64_t, Relay> relays_;
+
+        std::shared_ptr<Dissemination> updates_;
+
+        // when each suspect was first suspected by us, probe thread only
+        std::unordered_map<std::string, std::chrono::steady_clock::time_point> suspects_;
+
+        std::mutex addr_mu_;
+        std::unordered_map<std::string, sockaddr_in> addrs_;
+};
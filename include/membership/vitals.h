@@ -0,0 +1,102 @@
+#pragma once
+
+#include "metrics/heavy_hitters.h"
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cereal/types/string.hpp>
+#include <cereal/types/vector.hpp>
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+// load numbers a node publishes about itself over gossip
+// versioned independently of NodeState so they can change every round without
+// forcing a full membership exchange
+struct NodeVitals {
+    // owner's wall clock in ms when these were sampled, newer wins on merge
+    // wall clock rather than a counter so a restarted node doesn't go backwards
+    uint64_t version_{0};
+    double request_rate_{0};
+    uint64_t p99_latency_us_{0};
+    uint64_t handoff_backlog_{0};
+    uint64_t disk_usage_bytes_{0};
+    uint64_t pending_compaction_bytes_{0};
+    // a few of the hottest keys this node coordinates
+    std::vector<HotKey> hot_reads_;
+    std::vector<HotKey> hot_writes_;
+
+    template <class Archive>
+    void serialize(Archive & archive) {
+        archive(
+            version_,
+            request_rate_,
+            p99_latency_us_,
+            handoff_backlog_,
+            disk_usage_bytes_,
+            pending_compaction_bytes_,
+            hot_reads_,
+            hot_writes_
+        );
+    }
+};
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(NodeVitals, version_, request_rate_, p99_latency_us_, handoff_backlog_, disk_usage_bytes_, pending_compaction_bytes_, hot_reads_, hot_writes_)
+
+using ClusterVitals = std::unordered_map<std::string, NodeVitals>;
+
+// every node's latest vitals. a node that left or died stops refreshing its entry, so
+// entries of non members are dropped and never merged back in, and so is anything not
+// refreshed within the ttl, otherwise they would be gossiped around forever
+class VitalsTable {
+    public:
+        using MemberFn = std::function<bool(const std::string& id)>;
+
+        // keeps the newer version of every entry of a member
+        void merge(const ClusterVitals& other, const MemberFn& is_member) {
+            std::lock_guard<std::mutex> lk(mu_);
+            for(auto &[id, v] : other) {
+                if(!is_member(id)) {
+                    continue;
+                }
+                auto it = vitals_.find(id);
+                if(it == vitals_.end() || v.version_ > it->second.version_) {
+                    vitals_[id] = v;
+                }
+            }
+        }
+
+        void set(const std::string& id, const NodeVitals& vitals) {
+            std::lock_guard<std::mutex> lk(mu_);
+            vitals_[id] = vitals;
+        }
+
+        std::optional<NodeVitals> get(const std::string& id) {
+            std::lock_guard<std::mutex> lk(mu_);
+            auto it = vitals_.find(id);
+            if(it == vitals_.end()) {
+                return std::nullopt;
+            }
+            return it->second;
+        }
+
+        // now_ms on the same wall clock the versions are sampled with
+        void prune(const MemberFn& is_member, uint64_t now_ms, uint64_t ttl_ms) {
+            std::lock_guard<std::mutex> lk(mu_);
+            std::erase_if(vitals_, [&](const auto& entry) {
+                return !is_member(entry.first) || entry.second.version_ + ttl_ms < now_ms;
+            });
+        }
+
+        ClusterVitals getAll() {
+            std::lock_guard<std::mutex> lk(mu_);
+            return vitals_;
+        }
+
+    private:
+        std::mutex mu_;
+        ClusterVitals vitals_;
+};
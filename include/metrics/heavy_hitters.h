@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+struct HotKey {
+    std::string key_;
+    // sketch estimate since roughly the last two decays, never an undercount
+    uint64_t count_{0};
+
+    template <class Archive>
+    void serialize(Archive & archive) {
+        archive(key_, count_);
+    }
+};
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(HotKey, key_, count_)
+
+// streaming heavy hitter tracker: count-min sketch plus a small top-k table
+// record() is a few relaxed atomic adds. only a key whose estimate beats the smallest
+// one in the table goes on to update it, and that update is a try_lock, so a busy
+// table skips it instead of blocking the request, the key comes around again anyway.
+// counts are halved every decay so the table follows what is hot now
+class HeavyHitters {
+    public:
+        // width is rounded up to a power of two
+        explicit HeavyHitters(
+            size_t k = 32,
+            size_t width = 4096,
+            size_t depth = 4,
+            uint64_t min_hot = 32,
+            std::chrono::milliseconds decay_interval = std::chrono::seconds(10)
+        );
+
+        void record(const std::string& key);
+        uint64_t estimate(const std::string& key) const;
+
+        // estimate is at least min_hot and would make the top k, lock free
+        bool isHot(const std::string& key) const;
+
+        // hottest first
+        std::vector<HotKey> top(size_t n) const;
+        uint64_t total() const {
+            return total_.load(std::memory_order_relaxed);
+        }
+
+        // halves every counter, increments racing with it may be lost, which only
+        // makes the sketch undercount by a little
+        void decay();
+        // decays if the interval has passed since the last one
+        void decayIfDue();
+
+    private:
+        void admit(const std::string& key, uint64_t estimate);
+        void updateThreshold();
+
+        size_t index(uint64_t hash, size_t row) const;
+
+        size_t k_;
+        size_t width_;
+        size_t depth_;
+        uint64_t min_hot_;
+        std::chrono::milliseconds decay_interval_;
+
+        std::unique_ptr<std::atomic<uint32_t>[]> counters_;
+        std::atomic<uint64_t> total_{0};
+        // smallest estimate in a full table, 0 while it has room
+        std::atomic<uint64_t> threshold_{0};
+
+        mutable std::mutex top_mu_;
+        std::vector<HotKey> top_;
+
+        std::mutex decay_mu_;
+        std::chrono::steady_clock::time_point last_decay_;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+// log-linear buckets: values below 4 get their own bucket, after that every power of two
+// is split into 4 sub buckets, so any recorded value is off by at most 25%
+constexpr size_t HISTOGRAM_BUCKETS = 4 + 62 * 4;
+
+// point in time copy of a histogram, cheap to diff so callers can compute windowed stats
+struct HistogramSnapshot {
+    std::array<uint64_t, HISTOGRAM_BUCKETS> counts_{};
+    uint64_t count_{0};
+    uint64_t sum_{0};
+
+    // upper bound of the bucket holding the p-th percentile, p in [0, 1]
+    uint64_t percentile(double p) const;
+    double mean() const;
+
+    HistogramSnapshot operator-(const HistogramSnapshot& older) const;
+};
+
+void to_json(json& j, const HistogramSnapshot& h);
+
+// lock free histogram, record() is a couple of relaxed atomic adds
+// used for latencies in microseconds and for sizes
+class Histogram {
+    public:
+        void record(uint64_t value);
+        HistogramSnapshot snapshot() const;
+
+        static size_t bucketFor(uint64_t value);
+        static uint64_t bucketUpperBound(size_t bucket);
+
+    private:
+        std::array<std::atomic<uint64_t>, HISTOGRAM_BUCKETS> counts_{};
+        std::atomic<uint64_t> sum_{0};
+};
+
+// records the microseconds between construction and destruction
+class ScopedTimer {
+    public:
+        explicit ScopedTimer(Histogram& histogram) :
+            histogram_(histogram),
+            start_(std::chrono::steady_clock::now()) {}
+
+        ~ScopedTimer() {
+            histogram_.record(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start_
+            ).count());
+        }
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+        Histogram& histogram_;
+        std::chrono::steady_clock::time_point start_;
+};
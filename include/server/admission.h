@@ -0,0 +1,181 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+enum class TrafficClass {
+    // /get and /put from clients, can be retried by the caller
+    CLIENT,
+    // replica reads and writes from coordinators and handoff, a rejected write becomes a hint
+    REPLICATION
+};
+
+// what the storage engine looks like right now, all zero for engines without a disk
+struct EngineHealth {
+    uint64_t pending_compaction_bytes_{0};
+    uint64_t l0_files_{0};
+    // p99 group commit latency since the previous refresh
+    uint64_t put_p99_us_{0};
+    bool stalled_{false};
+    // how long the open stall has lasted so far
+    uint64_t stall_us_{0};
+};
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(EngineHealth, pending_compaction_bytes_, l0_files_, put_p99_us_, stalled_, stall_us_)
+
+enum class Pressure {
+    NONE,
+    // compaction is falling behind, client budget is cut
+    SOFT,
+    // leveldb is throttling or about to block writers, client writes are shed
+    HARD
+};
+
+const char* pressureToStr(Pressure pressure);
+
+struct AdmissionOptions {
+    // concurrent requests per class. the server sizes httplib's worker pool to both of
+    // these plus admin_threads_, so it's these budgets that run out first, not the pool
+    size_t client_inflight_{64};
+    size_t replication_inflight_{128};
+    // gossip, joins and the admin endpoints, which aren't admission controlled
+    size_t admin_threads_{8};
+    // how long a request waits for a slot before it gets a 429
+    std::chrono::milliseconds max_wait_{10};
+
+    // soft thresholds default to where leveldb itself starts to slow writers down,
+    // hard ones to where it stops them
+    uint64_t soft_pending_compaction_bytes_{64 << 20};
+    uint64_t hard_pending_compaction_bytes_{256 << 20};
+    uint64_t soft_l0_files_{8};
+    uint64_t hard_l0_files_{12};
+    uint64_t soft_put_p99_us_{20000};
+    uint64_t hard_put_p99_us_{200000};
+    // any stall is soft, one slow fsync shouldn't shed every write. it's hard once slow
+    // commits have gone on this long
+    uint64_t hard_stall_us_{1000000};
+
+    std::chrono::milliseconds health_interval_{250};
+    // Retry-After for a full budget and for shedding under pressure
+    std::chrono::seconds retry_after_{1};
+    std::chrono::seconds pressure_retry_after_{2};
+
+    size_t workerThreads() const {
+        return client_inflight_ + replication_inflight_ + admin_threads_;
+    }
+};
+
+struct AdmissionClassStats {
+    uint64_t inflight_{0};
+    uint64_t limit_{0};
+    uint64_t admitted_{0};
+    // no slot freed up within max_wait
+    uint64_t rejected_busy_{0};
+    // shed because of engine pressure
+    uint64_t rejected_pressure_{0};
+    // admitted after waiting for a slot
+    uint64_t delayed_{0};
+};
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(AdmissionClassStats, inflight_, limit_, admitted_, rejected_busy_, rejected_pressure_, delayed_)
+
+struct AdmissionStats {
+    Pressure pressure_{Pressure::NONE};
+    EngineHealth health_;
+    AdmissionClassStats client_;
+    AdmissionClassStats replication_;
+};
+
+void to_json(json& j, const AdmissionStats& s);
+
+// decides whether a request gets an httplib worker or is turned away straight away
+// each traffic class has its own in-flight budget so a client burst can't starve
+// replication and the other way around. engine health is polled at most every
+// health_interval from whichever request comes along, and shrinks the budgets as
+// compaction falls behind, before put latency has blown up and workers pile up
+class AdmissionController {
+    public:
+        // holds a slot until destroyed
+        class Ticket {
+            public:
+                Ticket() = default;
+                Ticket(Ticket&& other) noexcept;
+                Ticket& operator=(Ticket&& other) noexcept;
+                ~Ticket();
+
+                explicit operator bool() const {
+                    return owner_ != nullptr;
+                }
+                // for rejected tickets, 429 or 503
+                int status() const {
+                    return status_;
+                }
+                std::chrono::seconds retryAfter() const {
+                    return retry_after_;
+                }
+
+            private:
+                friend class AdmissionController;
+                Ticket(AdmissionController* owner, TrafficClass cls) : owner_(owner), cls_(cls) {}
+                Ticket(int status, std::chrono::seconds retry_after) : status_(status), retry_after_(retry_after) {}
+
+                AdmissionController* owner_{nullptr};
+                TrafficClass cls_{TrafficClass::CLIENT};
+                int status_{200};
+                std::chrono::seconds retry_after_{0};
+        };
+
+        explicit AdmissionController(AdmissionOptions options = {});
+
+        void setHealthProvider(std::function<EngineHealth()> provider);
+
+        // writes are the ones compaction pressure applies to
+        Ticket admit(TrafficClass cls, bool write);
+
+        Pressure pressure() const {
+            return pressure_.load(std::memory_order_relaxed);
+        }
+        Pressure classify(const EngineHealth& health) const;
+        size_t limitFor(TrafficClass cls, Pressure pressure) const;
+
+        // polls the provider now regardless of the interval
+        void refreshHealth();
+
+        AdmissionStats stats();
+
+    private:
+        struct Budget {
+            size_t inflight_{0};
+            std::condition_variable cv_;
+            std::atomic<uint64_t> admitted_{0};
+            std::atomic<uint64_t> rejected_busy_{0};
+            std::atomic<uint64_t> rejected_pressure_{0};
+            std::atomic<uint64_t> delayed_{0};
+        };
+
+        void release(TrafficClass cls);
+        void maybeRefreshHealth();
+        Budget& budget(TrafficClass cls) {
+            return budgets_[static_cast<size_t>(cls)];
+        }
+
+        AdmissionOptions options_;
+
+        std::mutex mu_;
+        std::array<Budget, 2> budgets_;
+
+        std::function<EngineHealth()> provider_;
+        std::atomic<Pressure> pressure_{Pressure::NONE};
+        std::atomic<int64_t> last_refresh_ns_{0};
+        std::atomic<bool> refreshing_{false};
+        std::mutex health_mu_;
+        EngineHealth health_;
+};
@@ -0,0 +1,229 @@
+#pragma once
+
+#include "storage/base64.hpp"
+#include "storage/serializer.h"
+#include "storage/value.h"
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// wire format for the /bin endpoints, values travel as raw bytes instead of base64 in json
+//
+// a context is the vector clock as
+//   varint entries, then per entry sorted by node id: varint id length, id, varint counter
+// sorted so equal clocks always encode to the same bytes. in a header it is base64, a
+// clock with three nodes is ~40 bytes against ~110 for base64 of the cereal encoding
+// that the json endpoints hand out. every endpoint takes either kind, see parseContext
+//
+// several siblings go back as one frame
+//   varint count, then per sibling: varint context length, context, varint data length, data
+class BinaryCodec {
+    public:
+        static constexpr const char* CONTEXT_HEADER = "X-Dynamo-Context";
+        static constexpr const char* SIBLINGS_CONTENT_TYPE = "application/x-dynamo-siblings";
+
+        static void appendVarint(uint64_t v, std::string& out) {
+            while(v >= 0x80) {
+                out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+                v >>= 7;
+            }
+            out.push_back(static_cast<char>(v));
+        }
+
+        // consumes the varint from the front of in, nullopt if it is cut short or too long
+        static std::optional<uint64_t> readVarint(std::string_view& in) {
+            uint64_t v = 0;
+            for(int shift = 0; shift < 64 && !in.empty(); shift += 7) {
+                uint8_t byte = static_cast<uint8_t>(in.front());
+                in.remove_prefix(1);
+                v |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                if((byte & 0x80) == 0) {
+                    return v;
+                }
+            }
+            return std::nullopt;
+        }
+
+        static void appendClock(const VectorClock& clock, std::string& out) {
+            std::vector<std::pair<std::string_view, uint64_t>> entries;
+            entries.reserve(clock.getTimes().size());
+            for(auto& [node, time] : clock.getTimes()) {
+                entries.emplace_back(node, time);
+            }
+            std::sort(entries.begin(), entries.end());
+
+            appendVarint(entries.size(), out);
+            for(auto& [node, time] : entries) {
+                appendVarint(node.size(), out);
+                out.append(node);
+                appendVarint(time, out);
+            }
+        }
+
+        static std::string encodeClock(const VectorClock& clock) {
+            std::string out;
+            appendClock(clock, out);
+            return out;
+        }
+
+        // consumes one clock from the front of in
+        static std::optional<VectorClock> readClock(std::string_view& in) {
+            auto entries = readVarint(in);
+            if(!entries) {
+                return std::nullopt;
+            }
+            VectorClock clock;
+            for(uint64_t i = 0; i < *entries; i++) {
+                auto bytes = readBytes(in);
+                if(!bytes) {
+                    return std::nullopt;
+                }
+                auto time = readVarint(in);
+                if(!time) {
+                    return std::nullopt;
+                }
+                clock.set(std::string{*bytes}, *time);
+            }
+            return clock;
+        }
+
+        // the whole input has to be one clock
+        static std::optional<VectorClock> decodeClock(std::string_view in) {
+            auto clock = readClock(in);
+            if(!clock || !in.empty()) {
+                return std::nullopt;
+            }
+            return clock;
+        }
+
+        static std::string clockHeader(const VectorClock& clock) {
+            return base64::to_base64(encodeClock(clock));
+        }
+
+        // a context from any endpoint, base64 of either the varint or the cereal encoding,
+        // so a client can read over json and write over /bin or the other way round.
+        // an empty context is an empty clock, a write with no context.
+        // cereal bytes never pass as varint: they start with an 8 byte count, so as varint
+        // they would need empty node ids, and those can't round trip to the same bytes
+        static std::optional<VectorClock> parseContext(std::string_view text) {
+            if(text.empty()) {
+                return VectorClock{};
+            }
+            std::string bytes;
+            try {
+                bytes = base64::from_base64(text);
+            } catch(const std::runtime_error&) {
+                return std::nullopt;
+            }
+
+            auto clock = decodeClock(bytes);
+            if(clock && encodeClock(*clock) == bytes) {
+                return clock;
+            }
+            try {
+                return Serializer::fromBinary<VectorClock>(bytes);
+            } catch(const std::exception&) {
+                return std::nullopt;
+            }
+        }
+
+        // drops versions equal in data and clock to an earlier one, order is kept
+        static std::vector<const Value*> unique(const std::vector<const Value*>& values) {
+            std::vector<std::string> clocks;
+            clocks.reserve(values.size());
+            std::vector<const Value*> out;
+            std::vector<size_t> kept;
+            for(size_t i = 0; i < values.size(); i++) {
+                clocks.push_back(encodeClock(values[i]->clock_));
+                bool seen = std::any_of(kept.begin(), kept.end(), [&](size_t j) {
+                    return clocks[j] == clocks[i] && values[j]->data_ == values[i]->data_;
+                });
+                if(!seen) {
+                    kept.push_back(i);
+                    out.push_back(values[i]);
+                }
+            }
+            return out;
+        }
+
+        static std::string encodeSiblings(const std::vector<const Value*>& values) {
+            size_t bytes = 10;
+            for(const Value* v : values) {
+                bytes += 64 + v->data_.size();
+            }
+            std::string out;
+            out.reserve(bytes);
+            std::string clock;
+            appendVarint(values.size(), out);
+            for(const Value* v : values) {
+                clock.clear();
+                appendClock(v->clock_, clock);
+                appendVarint(clock.size(), out);
+                out.append(clock);
+                appendVarint(v->data_.size(), out);
+                out.append(v->data_);
+            }
+            return out;
+        }
+
+        static std::optional<ValueList> decodeSiblings(std::string_view in) {
+            auto count = readVarint(in);
+            if(!count) {
+                return std::nullopt;
+            }
+            ValueList out;
+            for(uint64_t i = 0; i < *count; i++) {
+                auto context = readBytes(in);
+                if(!context) {
+                    return std::nullopt;
+                }
+                auto clock = decodeClock(*context);
+                auto data = readBytes(in);
+                if(!clock || !data) {
+                    return std::nullopt;
+                }
+                out.push_back(Value{std::string{*data}, std::move(*clock)});
+            }
+            if(!in.empty()) {
+                return std::nullopt;
+            }
+            return out;
+        }
+
+        // path of a key's /bin endpoint, anything outside the unreserved set is percent encoded
+        static std::string pathFor(std::string_view key) {
+            static constexpr char HEX[] = "0123456789ABCDEF";
+            std::string out = "/bin/";
+            out.reserve(out.size() + key.size());
+            for(char c : key) {
+                uint8_t b = static_cast<uint8_t>(c);
+                if(std::isalnum(b) || c == '-' || c == '_' || c == '.' || c == '~') {
+                    out.push_back(c);
+                } else {
+                    out.push_back('%');
+                    out.push_back(HEX[b >> 4]);
+                    out.push_back(HEX[b & 0x0F]);
+                }
+            }
+            return out;
+        }
+
+    private:
+        // varint length then that many bytes, viewed in place
+        static std::optional<std::string_view> readBytes(std::string_view& in) {
+            auto size = readVarint(in);
+            if(!size || *size > in.size()) {
+                return std::nullopt;
+            }
+            std::string_view bytes = in.substr(0, *size);
+            in.remove_prefix(*size);
+            return bytes;
+        }
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// the fields of a JSON /get or /put body, parsed once per request and shared by routing
+// and the handler
+// bodies are nearly always a flat object of plain string members, those are read with a
+// single pass scanner straight into the fields. anything else, escapes, numbers, nesting,
+// odd whitespace, goes through nlohmann so the result is the same either way
+struct ClientRequest {
+    std::string key_;
+    // base64 as the client sent them, empty if missing
+    std::string data_;
+    std::string context_;
+
+    // nullopt if the body is not an object with a string "key"
+    static std::optional<ClientRequest> parse(std::string_view body);
+
+    // the slow path on its own, for tests and benchmarks
+    static std::optional<ClientRequest> parseJson(std::string_view body);
+};
+
+// {"keys": [...]} for /mget, a key listed twice is read once
+struct MultiGetRequest {
+    std::vector<std::string> keys_;
+
+    // nullopt unless every key is a string
+    static std::optional<MultiGetRequest> parse(std::string_view body);
+};
+
+// {"puts": [{"key", "data", "context"}, ...]} for /mput, applied in order
+struct MultiPutRequest {
+    std::vector<ClientRequest> puts_;
+
+    // nullopt unless every put would parse on its own
+    static std::optional<MultiPutRequest> parse(std::string_view body);
+};
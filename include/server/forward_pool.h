@@ -0,0 +1,104 @@
+#pragma once
+
+#include "httplib.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+enum class RoutingMode {
+    // 307 to the coordinator, the client makes a second request on a new connection
+    REDIRECT,
+    // coordinate here if this node is a replica of the key, otherwise pass the request
+    // on to a replica and its answer back
+    PROXY
+};
+
+RoutingMode routingModeFromStr(const std::string& mode);
+const char* routingModeToStr(RoutingMode mode);
+
+enum class RouteAction {
+    // coordinate here
+    LOCAL,
+    // 307 to the coordinator
+    REDIRECT,
+    // pass it on to a replica
+    FORWARD
+};
+
+// what a node does with a client request for a key, forwarded is whether another node
+// already passed it on. a replica always coordinates in proxy mode, the quorum counts its
+// copy wherever it is in the preference list. a forwarded request is never passed on
+// again, the rings disagree until gossip settles and it could bounce around
+RouteAction routeFor(RoutingMode mode, bool coordinator, bool replica, bool forwarded);
+
+struct RoutingOptions {
+    RoutingMode mode_{RoutingMode::PROXY};
+    // idle keep alive connections kept to each node
+    size_t idle_per_node_{8};
+    std::chrono::milliseconds connect_timeout_{100};
+    // has to cover the replica's own quorum round
+    std::chrono::milliseconds read_timeout_{1000};
+};
+
+enum class ForwardOutcome {
+    // the node answered, whatever the status, and res has its answer
+    ANSWERED,
+    // no connection could be made so nothing was sent, another node can be tried
+    UNREACHABLE,
+    // the request went out but no answer came back, it may well have been applied
+    NO_ANSWER
+};
+
+struct ForwardStats {
+    uint64_t forwarded_{0};
+    uint64_t unreachable_{0};
+    uint64_t unanswered_{0};
+    uint64_t connections_opened_{0};
+    uint64_t idle_connections_{0};
+};
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(ForwardStats, forwarded_, unreachable_, unanswered_, connections_opened_, idle_connections_)
+
+// keep alive connections to the other nodes for passing client requests on
+// an httplib::Client runs one request at a time, so a node gets a client for every
+// request in flight to it and up to idle_per_node_ of them stay open afterwards. a
+// client whose request failed is dropped, its connection may be half broken
+class ForwardPool {
+    public:
+        // set on a passed on request, the receiver never passes it on again
+        static constexpr const char* FORWARDED_HEADER = "X-Dynamo-Forwarded";
+
+        explicit ForwardPool(RoutingOptions options = {});
+
+        // sends req to path on the node and copies its answer into res, whatever the
+        // status. res is left alone unless it was ANSWERED
+        ForwardOutcome forward(const std::string& host, int port, const std::string& path, const httplib::Request& req, httplib::Response& res);
+
+        // only a failed connect is UNREACHABLE, a write or read failure may come after the
+        // node got the whole request
+        static ForwardOutcome outcomeOf(httplib::Error error);
+
+        ForwardStats stats();
+
+    private:
+        std::unique_ptr<httplib::Client> acquire(const std::string& id, const std::string& host, int port);
+        void release(const std::string& id, std::unique_ptr<httplib::Client> client);
+
+        RoutingOptions options_;
+
+        std::mutex mu_;
+        std::unordered_map<std::string, std::vector<std::unique_ptr<httplib::Client>>> idle_;
+
+        std::atomic<uint64_t> forwarded_{0};
+        std::atomic<uint64_t> unreachable_{0};
+        std::atomic<uint64_t> unanswered_{0};
+        std::atomic<uint64_t> opened_{0};
+};
@@ -0,0 +1,175 @@
+#pragma once
+
+#include "storage/base64_simd.h"
+#include "storage/serializer.h"
+#include "storage/value.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// writes the /get body straight from the decoded versions
+// the output is byte for byte what json(GetResponse).dump() gave after dropping duplicate
+// (data, context) pairs, but without building the GetResponse, its deduplicated copy,
+// the base64 strings or the json tree. the lists are held until the body is written,
+// values are base64 encoded from where they already are through one stack buffer, the
+// only allocations are one string for the serialized clocks and the index of versions
+class GetResponseWriter {
+    public:
+        using ListPtr = std::shared_ptr<const ValueList>;
+
+        // either list may be null
+        GetResponseWriter(ListPtr local, ListPtr replicas) :
+            local_(std::move(local)),
+            replicas_(std::move(replicas)) {
+                entries_.reserve((local_ ? local_->size() : 0) + (replicas_ ? replicas_->size() : 0));
+                for(const ListPtr* list : {&local_, &replicas_}) {
+                    if(!*list) {
+                        continue;
+                    }
+                    for(const Value& v : **list) {
+                        add(v);
+                    }
+                }
+
+                size_ = PREFIX.size() + SUFFIX.size();
+                for(const Entry& e : entries_) {
+                    size_ += ENTRY_OPEN.size() + base64::encoded_size(e.clock_size_) + ENTRY_MIDDLE.size() +
+                        base64::encoded_size(e.value_->data_.size()) + ENTRY_CLOSE.size();
+                }
+                if(!entries_.empty()) {
+                    size_ += entries_.size() - 1;
+                }
+            }
+
+        // exact body length, known before anything is written
+        size_t size() const {
+            return size_;
+        }
+
+        size_t versions() const {
+            return entries_.size();
+        }
+
+        // sink(const char*, size_t) -> bool, false stops the write
+        // output is staged in BUFFER_BYTES pieces so a socket sink sees a few large writes
+        template <typename Sink>
+        bool writeTo(Sink&& sink) const {
+            Out out{sink};
+            if(!out.put(PREFIX)) {
+                return false;
+            }
+            for(size_t i = 0; i < entries_.size(); i++) {
+                const Entry& e = entries_[i];
+                if(i > 0 && !out.put(",")) {
+                    return false;
+                }
+                if(!out.put(ENTRY_OPEN) ||
+                   !out.encode(std::string_view{clocks_}.substr(e.clock_offset_, e.clock_size_)) ||
+                   !out.put(ENTRY_MIDDLE) ||
+                   !out.encode(e.value_->data_) ||
+                   !out.put(ENTRY_CLOSE)) {
+                    return false;
+                }
+            }
+            return out.put(SUFFIX) && out.flush();
+        }
+
+        // for tests and callers that want the whole body anyway
+        std::string str() const {
+            std::string body;
+            body.reserve(size_);
+            writeTo([&body](const char* data, size_t n) {
+                body.append(data, n);
+                return true;
+            });
+            return body;
+        }
+
+    private:
+        static constexpr std::string_view PREFIX{"{\"values\":["};
+        static constexpr std::string_view SUFFIX{"]}"};
+        // nlohmann orders object keys, context comes first
+        static constexpr std::string_view ENTRY_OPEN{"{\"context\":\""};
+        static constexpr std::string_view ENTRY_MIDDLE{"\",\"data\":\""};
+        static constexpr std::string_view ENTRY_CLOSE{"\"}"};
+        static constexpr size_t BUFFER_BYTES = 16384;
+
+        struct Entry {
+            const Value* value_;
+            size_t clock_offset_;
+            size_t clock_size_;
+        };
+
+        template <typename Sink>
+        struct Out {
+            Sink& sink_;
+            char buf_[BUFFER_BYTES];
+            size_t used_{0};
+
+            bool flush() {
+                if(used_ == 0) {
+                    return true;
+                }
+                bool ok = sink_(buf_, used_);
+                used_ = 0;
+                return ok;
+            }
+
+            bool put(std::string_view s) {
+                while(!s.empty()) {
+                    if(used_ == BUFFER_BYTES && !flush()) {
+                        return false;
+                    }
+                    size_t n = std::min(s.size(), BUFFER_BYTES - used_);
+                    std::copy_n(s.data(), n, buf_ + used_);
+                    used_ += n;
+                    s.remove_prefix(n);
+                }
+                return true;
+            }
+
+            // whole groups of 3 bytes per piece, so only the last one is ever padded
+            bool encode(std::string_view s) {
+                while(!s.empty()) {
+                    size_t room = (BUFFER_BYTES - used_) / 4 * 3;
+                    size_t n = s.size() <= room ? s.size() : room;
+                    if(n == 0) {
+                        if(!flush()) {
+                            return false;
+                        }
+                        continue;
+                    }
+                    used_ += base64::encode_to(s.substr(0, n), buf_ + used_);
+                    s.remove_prefix(n);
+                }
+                return true;
+            }
+        };
+
+        // a version equal in data and clock to one already added is dropped
+        void add(const Value& v) {
+            size_t offset = clocks_.size();
+            Serializer::appendBinary(v.clock_, clocks_);
+            size_t clock_size = clocks_.size() - offset;
+            std::string_view clock{clocks_.data() + offset, clock_size};
+
+            for(const Entry& e : entries_) {
+                if(e.value_->data_ == v.data_ &&
+                   std::string_view{clocks_.data() + e.clock_offset_, e.clock_size_} == clock) {
+                    clocks_.resize(offset);
+                    return;
+                }
+            }
+            entries_.push_back(Entry{&v, offset, clock_size});
+        }
+
+        ListPtr local_;
+        ListPtr replicas_;
+        std::string clocks_;
+        std::vector<Entry> entries_;
+        size_t size_{0};
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "error/storage_error.h"
+#include "storage/serializer.h"
+#include "storage/striped_mutex.h"
+#include "storage/value.h"
+#include "storage/value_cache.h"
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class MergeResult {
+    APPLIED,
+    // a stored version already dominates the new one
+    OUTDATED
+};
+
+// the local read-modify-write of a key's versions: load the siblings, drop the ones the
+// new value supersedes, append it, store. two of these racing on one key would each
+// store their own list and one write's siblings would be lost, so same key merges are
+// serialized on a lock stripe while different keys go in parallel. reads don't lock,
+// they see either list through the value cache
+template<typename Engine>
+class LocalMerge {
+    public:
+        LocalMerge(std::shared_ptr<Engine> engine, size_t value_cache_bytes, size_t stripes = 1024) :
+            engine_(engine),
+            values_(value_cache_bytes),
+            locks_(stripes) {}
+
+        // local versions of a key, decoded once and shared until the next write
+        ValueCache::Ptr load(const std::string &key) {
+            if(auto cached = values_.get(key)) {
+                return cached;
+            }
+
+            uint64_t ticket = values_.ticket(key);
+            // decoded straight out of the engine's buffer, a miss is just a key with no
+            // versions yet
+            ValueList decoded;
+            auto found = engine_ -> view(key, [&decoded](std::string_view stored) {
+                decoded = Serializer::fromBinary<ValueList>(stored);
+            });
+            if(!found && !found.error().notFound()) {
+                throw StorageError(found.error().message_);
+            }
+            auto values = std::make_shared<const ValueList>(std::move(decoded));
+            values_.fill(key, values, ticket);
+            return values;
+        }
+
+        MergeResult merge(const std::string &key, const Value &value) {
+            return mergeBatch(key, ValueList{value}).front();
+        }
+
+        // applies the values in order as if merged one by one, with a single engine write
+        std::vector<MergeResult> mergeBatch(const std::string &key, const ValueList &batch) {
+            std::vector<MergeResult> results;
+            results.reserve(batch.size());
+
+            std::lock_guard<std::mutex> lk(locks_.forKey(key));
+            auto current = load(key);
+            ValueList values = *current;
+            bool changed = false;
+
+            for(auto &value : batch) {
+                bool outdated = std::any_of(values.begin(), values.end(), [&value](const Value &v) {
+                    return value.clock_ < v.clock_;
+                });
+                if(outdated) {
+                    results.push_back(MergeResult::OUTDATED);
+                    continue;
+                }
+
+                // anything the new clock doesn't dominate is a sibling
+                std::erase_if(values, [&value](const Value &v) {
+                    return v.clock_ < value.clock_;
+                });
+                values.push_back(value);
+                results.push_back(MergeResult::APPLIED);
+                changed = true;
+            }
+
+            if(changed) {
+                engine_ -> put(key, Serializer::toBinary(values));
+                values_.invalidate(key);
+            }
+            return results;
+        }
+
+        ValueCache& cache() {
+            return values_;
+        }
+
+    private:
+        std::shared_ptr<Engine> engine_;
+        // every local write must invalidate after the engine put
+        ValueCache values_;
+        StripedMutex locks_;
+};
@@ -7,39 +7,69 @@
 #include "hash_ring/rpc.h"
 #include "logging/logger.h"
 #include "membership/gossip.h"
+#include "metrics/heavy_hitters.h"
+#include "metrics/histogram.h"
+#include "server/admission.h"
+#include "server/binary_codec.h"
+#include "server/client_request.h"
+#include "server/forward_pool.h"
+#include "server/get_response_writer.h"
+#include "server/local_merge.h"
+#include "server/single_flight.h"
+#include "server/write_combiner.h"
+#include "storage/disk_engine.h"
 #include "storage/serializer.h"
+#include "storage/value_cache.h"
 #include "httplib.h"
 #include "storage/value.h"
 #include <algorithm>
+#include <future>
 #include <memory>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include "storage/base64.hpp"
-#include <boost/functional/hash.hpp>
 
 
 using json = nlohmann::json;
 
-template<typename Engine>
+template<typename Engine, typename HintStore = DiskEngine>
 class Server {
     public:
         explicit Server(std::shared_ptr<Engine> engine, 
                         std::shared_ptr<HashRing> ring, 
                         std::shared_ptr<Quorom> quorom, 
                         std::shared_ptr<Gossip> gossip,
-                        std::shared_ptr<Handoff> handoff) : 
+                        std::shared_ptr<Handoff<HintStore>> handoff,
+                        size_t value_cache_bytes = 32 << 20,
+                        AdmissionOptions admission = {},
+                        WriteCombinerOptions combiner = {},
+                        RoutingOptions routing = {}) : 
         engine_(engine), 
         ring_(ring), 
         quorom_(quorom) ,
         gossip_(gossip),
-        handoff_(handoff)
+        handoff_(handoff),
+        local_(engine, value_cache_bytes),
+        combiner_(local_, [quorom](const std::string &key, const ValueList &values) {
+            return quorom->put(key, values).has_value();
+        }, combiner),
+        admission_(admission),
+        routing_(routing),
+        forwards_(routing)
         {
+            // one worker per admission slot and a few more, see AdmissionOptions
+            svr_.new_task_queue = [threads = admission.workerThreads()] {
+                return new httplib::ThreadPool(threads);
+            };
 
             svr_.Options("/(.*)",
 			[&](const httplib::Request & /*req*/, httplib::Response &res) {
-                res.set_header("Access-Control-Allow-Methods", " POST, GET, OPTIONS");
+                res.set_header("Access-Control-Allow-Methods", " POST, GET, PUT, OPTIONS");
                 res.set_header("Content-Type", "application/json");
-                res.set_header("Access-Control-Allow-Headers", "X-Requested-With, Content-Type, Accept, Key");
+                res.set_header("Access-Control-Allow-Headers", "X-Requested-With, Content-Type, Accept, Key, X-Dynamo-Context");
                 res.set_header("Access-Control-Allow-Origin", "*");
             });
 
@@ -67,22 +97,84 @@ class Server {
             });
 
             svr_.Post("/get", [this](const httplib::Request & req, httplib::Response &res) {
+                auto ticket = admission_.admit(TrafficClass::CLIENT, false);
+                if(!ticket) return this -> reject(req, res, ticket);
                 this -> handleGet(req, res);
             });
 
             svr_.Post("/put", [this](const httplib::Request & req, httplib::Response &res) {
+                auto ticket = admission_.admit(TrafficClass::CLIENT, true);
+                if(!ticket) return this -> reject(req, res, ticket);
                 this -> handlePut(req, res);
             });
 
+            // same as /get and /put with the key in the path, raw values and a binary
+            // context header, see BinaryCodec
+            svr_.Get(R"(/bin/(.+))", [this](const httplib::Request & req, httplib::Response &res) {
+                auto ticket = admission_.admit(TrafficClass::CLIENT, false);
+                if(!ticket) return this -> reject(req, res, ticket);
+                this -> handleBinaryGet(req, res);
+            });
+
+            svr_.Put(R"(/bin/(.+))", [this](const httplib::Request & req, httplib::Response &res) {
+                auto ticket = admission_.admit(TrafficClass::CLIENT, true);
+                if(!ticket) return this -> reject(req, res, ticket);
+                this -> handleBinaryPut(req, res);
+            });
+
+            // many keys in one request, whichever node gets it coordinates them all
+            svr_.Post("/mget", [this](const httplib::Request & req, httplib::Response &res) {
+                auto ticket = admission_.admit(TrafficClass::CLIENT, false);
+                if(!ticket) return this -> reject(req, res, ticket);
+                this -> handleMultiGet(req, res);
+            });
+
+            svr_.Post("/mput", [this](const httplib::Request & req, httplib::Response &res) {
+                auto ticket = admission_.admit(TrafficClass::CLIENT, true);
+                if(!ticket) return this -> reject(req, res, ticket);
+                this -> handleMultiPut(req, res);
+            });
+
             svr_.Post("/replication/put", [this](const httplib::Request & req, httplib::Response &res) {
+                auto ticket = admission_.admit(TrafficClass::REPLICATION, true);
+                if(!ticket) return this -> reject(req, res, ticket);
                 this -> handleReplicationPut(req, res);
             });
 
             svr_.Post("/replication/get", [this](const httplib::Request & req, httplib::Response &res) {
+                auto ticket = admission_.admit(TrafficClass::REPLICATION, false);
+                if(!ticket) return this -> reject(req, res, ticket);
                 this->handleReplicationGet(req, res);
             });
 
+            svr_.Post("/replication/mget", [this](const httplib::Request & req, httplib::Response &res) {
+                auto ticket = admission_.admit(TrafficClass::REPLICATION, false);
+                if(!ticket) return this -> reject(req, res, ticket);
+                this -> handleReplicationMultiGet(req, res);
+            });
+
+            svr_.Post("/replication/batch", [this](const httplib::Request & req, httplib::Response &res) {
+                auto ticket = admission_.admit(TrafficClass::REPLICATION, true);
+                if(!ticket) return this -> reject(req, res, ticket);
+                BatchPutRpc body = Serializer::fromBinary<BatchPutRpc>(req.body);
+                Logger::instance().debug("Running replication batch of " + std::to_string(body.puts_.size()) + " puts");
+                // outdated entries are fine here, the replica already has something newer
+                // runs of the same key come from a combined write, merge them in one go
+                size_t i = 0;
+                while(i < body.puts_.size()) {
+                    const std::string &key = body.puts_[i].key_;
+                    ValueList run;
+                    for(; i < body.puts_.size() && body.puts_[i].key_ == key; i++) {
+                        run.push_back(std::move(body.puts_[i].data_));
+                    }
+                    local_.mergeBatch(key, run);
+                }
+                res.status = 200;
+            });
+
             svr_.Post("/replication/handoff", [this](const httplib::Request & req, httplib::Response &res) {
+                auto ticket = admission_.admit(TrafficClass::REPLICATION, true);
+                if(!ticket) return this -> reject(req, res, ticket);
                 Logger::instance().info("got handoff request!");
                 HandoffRpc body = Serializer::fromBinary<HandoffRpc>(req.body);
                 handoff_->append(body.key_, body.target_node_id_, body.data_);
@@ -90,9 +182,24 @@ class Server {
 
             // should be logically seperated?
             svr_.Post("/admin/gossip", [this](const httplib::Request & req, httplib::Response &res) {
-                auto serialized = Serializer::fromBinary<ClusterState>(req.body);
-                this -> gossip_ -> onRecieve(serialized);
+                auto message = Serializer::fromBinary<GossipMessage>(req.body);
+                this -> gossip_ -> onRecieve(message);
+                res.status = 200;
+            });
+
+            svr_.Get("/admin/vitals", [this](const httplib::Request & req, httplib::Response &res) {
+                this -> setCORS(req, res);
+                json j = gossip_->getVitals();
+                res.status = 200;
+                res.set_content(j.dump(), "application/json");
+            });
+
+            // a joining node sends its own state and gets the full cluster view back in one call
+            svr_.Post("/admin/join", [this](const httplib::Request & req, httplib::Response &res) {
+                auto joiner = Serializer::fromBinary<ClusterState>(req.body);
+                auto state = this -> gossip_ -> onJoin(joiner);
                 res.status = 200;
+                res.set_content(Serializer::toBinary<ClusterState>(state), "application/octet-stream");
             });
 
             svr_.Post("/admin/membership", [this](const httplib::Request & req, httplib::Response &res) {
@@ -102,6 +209,84 @@ class Server {
                 res.set_content(j.dump(), "application/json");
             });
 
+            svr_.Get("/admin/handoff", [this](const httplib::Request & req, httplib::Response &res) {
+                this -> setCORS(req, res);
+                json j{
+                    {"backlog", handoff_->backlog()},
+                    {"targets", handoff_->stats()},
+                };
+                res.status = 200;
+                res.set_content(j.dump(), "application/json");
+            });
+
+            svr_.Get("/admin/storage", [this](const httplib::Request & req, httplib::Response &res) {
+                this -> setCORS(req, res);
+                json j = json::object();
+                if constexpr (requires(Engine& e) { e.stats().disk_usage_bytes_; }) {
+                    j["disk"] = engine_->stats();
+                } else if constexpr (requires(Engine& e) { e.stats().cold_.disk_usage_bytes_; }) {
+                    auto stats = engine_->stats();
+                    j["disk"] = stats.cold_;
+                    j["memory"] = stats.hot_;
+                }
+                res.status = 200;
+                res.set_content(j.dump(), "application/json");
+            });
+
+            svr_.Get("/admin/admission", [this](const httplib::Request & req, httplib::Response &res) {
+                this -> setCORS(req, res);
+                json j = admission_.stats();
+                res.status = 200;
+                res.set_content(j.dump(), "application/json");
+            });
+
+            svr_.Get("/admin/combiner", [this](const httplib::Request & req, httplib::Response &res) {
+                this -> setCORS(req, res);
+                json j = combiner_.stats();
+                res.status = 200;
+                res.set_content(j.dump(), "application/json");
+            });
+
+            svr_.Get("/admin/forwarding", [this](const httplib::Request & req, httplib::Response &res) {
+                this -> setCORS(req, res);
+                json j = forwards_.stats();
+                j["mode"] = routingModeToStr(routing_.mode_);
+                res.status = 200;
+                res.set_content(j.dump(), "application/json");
+            });
+
+            svr_.Get("/admin/hotkeys", [this](const httplib::Request & req, httplib::Response &res) {
+                this -> setCORS(req, res);
+                json cluster = json::object();
+                for(auto &[id, vitals] : gossip_->getVitals()) {
+                    cluster[id] = {
+                        {"reads", vitals.hot_reads_},
+                        {"writes", vitals.hot_writes_},
+                    };
+                }
+                json j{
+                    {"reads", hot_reads_.top(HOT_KEYS_SHOWN)},
+                    {"writes", hot_writes_.top(HOT_KEYS_SHOWN)},
+                    {"cluster", cluster},
+                };
+                res.status = 200;
+                res.set_content(j.dump(), "application/json");
+            });
+
+            svr_.Get("/admin/reads", [this](const httplib::Request & req, httplib::Response &res) {
+                this -> setCORS(req, res);
+                json j = reads_.stats();
+                res.status = 200;
+                res.set_content(j.dump(), "application/json");
+            });
+
+            svr_.Get("/admin/cache", [this](const httplib::Request & req, httplib::Response &res) {
+                this -> setCORS(req, res);
+                json j = local_.cache().stats();
+                res.status = 200;
+                res.set_content(j.dump(), "application/json");
+            });
+
             svr_.Post("/admin/ring", [this](const httplib::Request & req, httplib::Response &res) {
                 this -> setCORS(req, res);
                 json j = ring_->getVirtualNodes();
@@ -117,6 +302,19 @@ class Server {
             Logger::instance().info(
                 "endpoints successfully registered!"
             );
+
+            gossip_->setVitalsProvider([this] {
+                return this -> collectVitals();
+            });
+
+            // once the value cache is full only keys that are read a lot displace others
+            local_.cache().setAdmission([this](const std::string &key) {
+                return hot_reads_.isHot(key);
+            });
+
+            admission_.setHealthProvider([this] {
+                return this -> engineHealth();
+            });
         }
     
     // start in new thread (?)
@@ -137,13 +335,112 @@ class Server {
         std::shared_ptr<HashRing> ring_;
         std::shared_ptr<Quorom> quorom_;
         std::shared_ptr<Gossip> gossip_;
-        std::shared_ptr<Handoff> handoff_;
+        std::shared_ptr<Handoff<HintStore>> handoff_;
         httplib::Server svr_;
+        // local versions and the serialized merge on top of the engine
+        LocalMerge<Engine> local_;
+        // concurrent puts to one key share a merge and a replication fan out
+        WriteCombiner<Engine> combiner_;
+        // concurrent gets of one key share a quorum read
+        SingleFlight<QuoromResult<std::shared_ptr<const ValueList>>> reads_;
+        AdmissionController admission_;
+        RoutingOptions routing_;
+        // connections for passing requests on to a replica in proxy mode
+        ForwardPool forwards_;
+        // commit latency at the previous health poll, only touched through engineHealth
+        HistogramSnapshot last_commit_latency_{};
+
+        // keys clients hit the most on this coordinator
+        HeavyHitters hot_reads_;
+        HeavyHitters hot_writes_;
+        static constexpr size_t HOT_KEYS_SHOWN = 16;
+        static constexpr size_t HOT_KEYS_GOSSIPED = 5;
+        // keys or puts in one /mget or /mput
+        static constexpr size_t MAX_BATCH_KEYS = 1024;
+
+        // client request latency in microseconds, feeds the gossiped vitals
+        Histogram latency_;
+        std::atomic<uint64_t> requests_{0};
+        // previous sample, only touched from the gossip thread through collectVitals
+        HistogramSnapshot last_latency_{};
+        uint64_t last_requests_{0};
+        std::chrono::steady_clock::time_point last_sample_{std::chrono::steady_clock::now()};
+
+        NodeVitals collectVitals() {
+            NodeVitals vitals{};
+            auto now = std::chrono::steady_clock::now();
+            double elapsed = std::chrono::duration<double>(now - last_sample_).count();
+
+            uint64_t requests = requests_.load(std::memory_order_relaxed);
+            vitals.request_rate_ = elapsed > 0 ? static_cast<double>(requests - last_requests_) / elapsed : 0;
+
+            // p99 over the window since the last sample, not since startup
+            HistogramSnapshot latency = latency_.snapshot();
+            vitals.p99_latency_us_ = (latency - last_latency_).percentile(0.99);
+
+            last_sample_ = now;
+            last_requests_ = requests;
+            last_latency_ = latency;
+
+            vitals.handoff_backlog_ = handoff_->backlog();
+
+            hot_reads_.decayIfDue();
+            hot_writes_.decayIfDue();
+            vitals.hot_reads_ = hot_reads_.top(HOT_KEYS_GOSSIPED);
+            vitals.hot_writes_ = hot_writes_.top(HOT_KEYS_GOSSIPED);
+
+            if(auto stats = diskStats()) {
+                vitals.disk_usage_bytes_ = stats->disk_usage_bytes_;
+                vitals.pending_compaction_bytes_ = stats->pending_compaction_bytes_;
+            }
+
+            return vitals;
+        }
+
+        // leveldb stats of the engine or of its cold tier, nothing for memory only engines
+        std::optional<DiskEngineStats> diskStats() {
+            if constexpr (requires(Engine& e) { e.stats().disk_usage_bytes_; }) {
+                return engine_->stats();
+            } else if constexpr (requires(Engine& e) { e.stats().cold_.disk_usage_bytes_; }) {
+                return engine_->stats().cold_;
+            } else {
+                return std::nullopt;
+            }
+        }
+
+        EngineHealth engineHealth() {
+            EngineHealth health{};
+            auto stats = diskStats();
+            if(!stats) {
+                return health;
+            }
+
+            health.pending_compaction_bytes_ = stats->pending_compaction_bytes_;
+            for(auto &level : stats->levels_) {
+                if(level.level_ == 0) {
+                    health.l0_files_ = level.files_;
+                }
+            }
+            health.stalled_ = stats->stalls_.stalled_;
+            health.stall_us_ = stats->stalls_.open_us_;
+            // only the commits since the last poll, an old spike shouldn't keep shedding load
+            health.put_p99_us_ = (stats->commit_.commit_latency_us_ - last_commit_latency_).percentile(0.99);
+            last_commit_latency_ = stats->commit_.commit_latency_us_;
+            return health;
+        }
+
+        void reject(const httplib::Request &req, httplib::Response &res, const AdmissionController::Ticket &ticket) {
+            setCORS(req, res);
+            res.status = ticket.status();
+            res.set_header("Retry-After", std::to_string(ticket.retryAfter().count()));
+            res.set_content(ticket.status() == 503 ? "Storage engine overloaded" : "Too many requests", "text/plain");
+        }
 
         void setCORS(const httplib::Request &req, httplib::Response &res) { 
             res.set_header("Access-Control-Allow-Origin", "*"); 
-            res.set_header("Access-Control-Allow-Methods", "GET, POST, OPTIONS");
-            res.set_header("Access-Control-Allow-Headers", "X-Requested-With, Content-Type, Accept, Key");
+            res.set_header("Access-Control-Allow-Methods", "GET, POST, PUT, OPTIONS");
+            res.set_header("Access-Control-Allow-Headers", "X-Requested-With, Content-Type, Accept, Key, X-Dynamo-Context");
+            res.set_header("Access-Control-Expose-Headers", "X-Dynamo-Context");
         }
 
         void handleHandoff(const httplib::Request &req, httplib::Response &res) { 
@@ -156,173 +453,539 @@ class Server {
             res.status = 200;
         }
 
-        void handleReplicationPut(const httplib::Request &req, httplib::Response &res) { 
-            PutRpc rpc = Serializer::fromBinary<PutRpc>(req.body);
-            Logger::instance().debug("Running replication put request for key: " + rpc.key_);
-
-            {
-                ValueList values = Serializer::fromBinary<ValueList>(engine_ -> get(rpc.key_));
+        // stored bytes as they are, the coordinator decodes them
+        void handleReplicationMultiGet(const httplib::Request &req, httplib::Response &res) {
+            BatchGetRpc rpc = Serializer::fromBinary<BatchGetRpc>(req.body);
+            Logger::instance().debug("Running replication get for " + std::to_string(rpc.keys_.size()) + " keys");
 
-                bool current_clock_lt = std::any_of(values.begin(), values.end(), [&rpc](Value &v) {
-                    return rpc.data_.clock_ < v.clock_;
-                });
+            std::vector<ByteString> stored;
+            stored.reserve(rpc.keys_.size());
+            for(auto &key : rpc.keys_) {
+                stored.push_back(engine_ -> get(key));
+            }
+            res.set_content(Serializer::toBinary(stored), "application/octet-stream");
+            res.status = 200;
+        }
 
-                if(current_clock_lt) {
-                    throw std::runtime_error("RPC PUT CLOCK OUTDATED FOR KEY: " + rpc.key_);
-                    return;
-                }
+        // returns false if we already hold a newer value for the key
+        bool applyReplicaPut(const PutRpc &rpc) {
+            return local_.merge(rpc.key_, rpc.data_) == MergeResult::APPLIED;
+        }
 
-                values.erase(
-                    std::remove_if(values.begin(), values.end(), [&rpc](auto &v) {
-                        return v.clock_ < rpc.data_.clock_;
-                    }),
-                    values.end()
-                );
+        void handleReplicationPut(const httplib::Request &req, httplib::Response &res) { 
+            PutRpc rpc = Serializer::fromBinary<PutRpc>(req.body);
+            Logger::instance().debug("Running replication put request for key: " + rpc.key_);
 
-                values.push_back(rpc.data_);
-                engine_ -> put(rpc.key_, Serializer::toBinary(values));
+            // the replica already has something newer, the coordinator counts a 400 as an ack
+            if(!applyReplicaPut(rpc)) {
+                Logger::instance().debug("RPC PUT CLOCK OUTDATED FOR KEY: " + rpc.key_);
+                res.set_content("Outdated clock", "text/plain");
+                res.status = 400;
+                return;
             }
 
             res.status = 200;
         }
 
         void handlePut(const httplib::Request &req, httplib::Response &res) { 
+            ScopedTimer timer{latency_};
+            requests_.fetch_add(1, std::memory_order_relaxed);
             setCORS(req, res);
-            if(handleRedirect(req, res, "/put")) {
+            auto request = parseClientRequest(req, res);
+            if(!request || routeElsewhere(request->key_, req, res, "/put", false)) {
                 return;
             }
+            const std::string &key = request->key_;
 
-            auto body = json::parse(req.body);
+            Logger::instance().debug("Running PUT for key: " + key);
 
-            std::string key{body["key"]};
-            std::string data_b64{body["data"]};
-            std::string context_b64{body["context"]};
+            auto data = base64::from_base64(request->data_);
 
-            Logger::instance().debug("Running PUT for key: " + key);
+            auto clock = BinaryCodec::parseContext(request->context_);
+            if(!clock) {
+                res.set_content("Malformed context", "text/plain");
+                res.status = 400;
+                return;
+            }
 
-            auto data = base64::from_base64(data_b64);
+            Value val{data, std::move(*clock)};
+            CombinedPut outcome = coordinatePut(key, val);
+            if(outcome.result_ == MergeResult::OUTDATED) {
+                res.set_content("Outdated clock specified. Re-run a get operation to get the updated clock.", "text/plain");
+                res.status = 400;
+                return;
+            }
 
-            VectorClock clock{};
-            if(context_b64.size() != 0) {
-                clock = Serializer::fromBinary<VectorClock>(base64::from_base64(context_b64));
+            if(outcome.replicated_) {
+                // the context of this client's own version, it may have been written alongside others
+                json j{{"context", base64::to_base64(Serializer::toBinary(val.clock_))}};
+                res.set_content(j.dump(), "application/json");
+                res.status = 200;
+            } else {
+                res.status = 500;
+                res.set_content("Failed to replicate to enough nodes", "text/plain");
             }
+        }
 
-            clock.increment(quorom_->getCurrNode()->getId());
+        void handleGet(const httplib::Request &req, httplib::Response &res) { 
+            ScopedTimer timer{latency_};
+            requests_.fetch_add(1, std::memory_order_relaxed);
+            setCORS(req, res);
+            auto request = parseClientRequest(req, res);
+            if(!request || routeElsewhere(request->key_, req, res, "/get", true)) {
+                return;
+            }
+            const std::string &key = request->key_;
 
-            Value val{data, clock};
+            Logger::instance().debug("Running GET for key: " + key);
 
-            // TODO put this into a function?
-            {
-                ValueList values = Serializer::fromBinary<ValueList>(engine_ -> get(key));
+            auto versions = coordinateGet(key);
+            if(!versions) {
+                Logger::instance().error("Error fetching key: " + key);
+                Logger::instance().error(versions.error().message_);
+                res.status = 500;
+                res.set_content(versions.error().message_, "text/plain");
+                return;
+            }
 
-                // if the clock is less than any, then we cannot put
-                bool current_clock_lt = std::any_of(values.begin(), values.end(), [&clock](Value &v) {
-                    return clock < v.clock_;
+            // encoded straight into the socket from the cached versions, the writer keeps
+            // both lists alive until the body is out
+            GetResponseWriter writer{std::move(versions->local_), std::move(versions->replicas_)};
+            size_t length = writer.size();
+            res.set_content_provider(length, "application/json",
+                [writer = std::move(writer)](size_t offset, size_t /*length*/, httplib::DataSink &sink) {
+                    // written whole on the first call, there are no ranges on /get
+                    if(offset != 0) {
+                        return false;
+                    }
+                    return writer.writeTo([&sink](const char *data, size_t n) {
+                        return sink.write(data, n);
+                    });
                 });
+            res.status = 200;
+        }
 
-                if(current_clock_lt) {
-                    res.set_content("Outdated clock specified. Re-run a get operation to get the updated clock.", "text/plain");
-                    res.status = 400;
-                    return;
+        // the key's versions on this node and on R-1 replicas
+        struct Versions {
+            ValueCache::Ptr local_;
+            std::shared_ptr<const ValueList> replicas_;
+        };
+
+        QuoromResult<Versions> coordinateGet(const std::string &key) {
+            hot_reads_.record(key);
+            auto local = local_.load(key);
+
+            // only the remote half is shared, local versions are always read fresh
+            auto replica_values = reads_.run(key, [&]() -> QuoromResult<std::shared_ptr<const ValueList>> {
+                auto values = quorom_ -> get(key);
+                if(!values) {
+                    return std::unexpected(std::move(values.error()));
                 }
+                return std::make_shared<const ValueList>(std::move(*values));
+            });
+            if(!replica_values) {
+                return std::unexpected(std::move(replica_values.error()));
+            }
+            return Versions{std::move(local), std::move(*replica_values)};
+        }
+
+        // ticks this node's entry in val's clock and writes it, val is the version as written
+        CombinedPut coordinatePut(const std::string &key, Value &val) {
+            hot_writes_.record(key);
+            val.clock_.increment(quorom_->getCurrNode()->getId());
 
-                // remove clock values less than ours
-                // anything remaining must be a sibling
-                values.erase(
-                    std::remove_if(values.begin(), values.end(), [&clock](auto &v) {
-                        return v.clock_ < clock;
-                    }),
-                    values.end()
-                );
+            CombinedPut outcome = combiner_.put(key, val);
+            // a read already in flight may have missed this write
+            reads_.forget(key);
+            return outcome;
+        }
 
-                values.push_back(val);
-                engine_ -> put(key, Serializer::toBinary(values));
+        // there's no one owner to redirect a batch to, so this node coordinates every key.
+        // keys it is a replica of are read locally as well, like /get, the rest only from
+        // their replicas. the body maps each key to what /get would answer or to an error
+        void handleMultiGet(const httplib::Request &req, httplib::Response &res) {
+            ScopedTimer timer{latency_};
+            requests_.fetch_add(1, std::memory_order_relaxed);
+            setCORS(req, res);
+            auto request = MultiGetRequest::parse(req.body);
+            if(!request) {
+                res.set_content("Malformed request body, expected a json object with an array of string keys", "text/plain");
+                res.status = 400;
+                return;
+            }
+            if(request->keys_.size() > MAX_BATCH_KEYS) {
+                res.set_content("Too many keys, at most " + std::to_string(MAX_BATCH_KEYS) + " per batch", "text/plain");
+                res.status = 400;
+                return;
             }
 
-            bool success = quorom_->put(key, val);
+            Logger::instance().debug("Running MGET for " + std::to_string(request->keys_.size()) + " keys");
 
-            if(success) {
-                res.status = 200;
-            } else {
-                res.status = 500;
-                res.set_content("Failed to replicate to enough nodes", "text/plain");
+            auto replicas = quorom_ -> getMany(request->keys_);
+
+            std::string body{"{"};
+            for(size_t i = 0; i < request->keys_.size(); i++) {
+                const std::string &key = request->keys_[i];
+                hot_reads_.record(key);
+                if(i > 0) {
+                    body += ',';
+                }
+                body += json(key).dump();
+                body += ':';
+
+                if(!replicas[i]) {
+                    body += json{{"error", replicas[i].error().message_}}.dump();
+                    continue;
+                }
+                ValueCache::Ptr local;
+                if(quorom_ -> isReplica(key)) {
+                    try {
+                        local = local_.load(key);
+                    } catch(const StorageError &e) {
+                        Logger::instance().error(std::string("STORAGE ERROR: ") + e.what());
+                        body += json{{"error", e.what()}}.dump();
+                        continue;
+                    }
+                }
+                GetResponseWriter writer{std::move(local), std::make_shared<const ValueList>(std::move(*replicas[i]))};
+                body += writer.str();
             }
+            body += '}';
+
+            res.set_content(body, "application/json");
+            res.status = 200;
         }
 
-        void handleGet(const httplib::Request &req, httplib::Response &res) { 
+        // puts are applied in order and answered in order, each with the context of its own
+        // version or an error. keys this node is a replica of are coordinated here, merged
+        // first and only replicated if that applied. the others are passed on to one of
+        // their replicas as a smaller /mput and coordinated there, only a node holding the
+        // key can check a context against it and tick its own entry
+        void handleMultiPut(const httplib::Request &req, httplib::Response &res) {
+            ScopedTimer timer{latency_};
+            requests_.fetch_add(1, std::memory_order_relaxed);
             setCORS(req, res);
-            if(handleRedirect(req, res, "/get")) {
+            auto request = MultiPutRequest::parse(req.body);
+            if(!request) {
+                res.set_content("Malformed request body, expected a json object with an array of puts", "text/plain");
+                res.status = 400;
+                return;
+            }
+            if(request->puts_.size() > MAX_BATCH_KEYS) {
+                res.set_content("Too many puts, at most " + std::to_string(MAX_BATCH_KEYS) + " per batch", "text/plain");
+                res.status = 400;
                 return;
             }
 
-            auto body = json::parse(req.body);
-            ValueList values{};
-            values = Serializer::fromBinary<ValueList>(engine_ -> get(body["key"]));
+            Logger::instance().debug("Running MPUT for " + std::to_string(request->puts_.size()) + " keys");
+
+            bool forwarded = req.has_header(ForwardPool::FORWARDED_HEADER);
+            std::vector<json> results(request->puts_.size());
+            std::vector<PutRpc> replicate;
+            // index into results of each put in replicate
+            std::vector<size_t> placed;
+            std::vector<size_t> remote;
+            for(size_t i = 0; i < request->puts_.size(); i++) {
+                const ClientRequest &put = request->puts_[i];
+                results[i]["key"] = put.key_;
+
+                if(!quorom_ -> isReplica(put.key_)) {
+                    // the sender took this node for a replica, the rings disagree until
+                    // gossip settles. same as routeFor, it isn't passed on a second time
+                    if(forwarded) {
+                        results[i]["error"] = "Not a replica of the key, retry once the cluster settles";
+                    } else {
+                        remote.push_back(i);
+                    }
+                    continue;
+                }
 
-            std::string key = body["key"];
-            Logger::instance().debug("Running GET for key: " + key);
+                Value val;
+                try {
+                    val.data_ = base64::from_base64(put.data_);
+                } catch(const std::exception &e) {
+                    results[i]["error"] = "Malformed data or context";
+                    continue;
+                }
+                auto clock = BinaryCodec::parseContext(put.context_);
+                if(!clock) {
+                    results[i]["error"] = "Malformed data or context";
+                    continue;
+                }
+                val.clock_ = std::move(*clock);
+
+                hot_writes_.record(put.key_);
+                val.clock_.increment(quorom_ -> getCurrNode() -> getId());
+                try {
+                    if(local_.merge(put.key_, val) == MergeResult::OUTDATED) {
+                        results[i]["error"] = "Outdated clock specified. Re-run a get operation to get the updated clock.";
+                        continue;
+                    }
+                } catch(const StorageError &e) {
+                    Logger::instance().error(std::string("STORAGE ERROR: ") + e.what());
+                    results[i]["error"] = e.what();
+                    continue;
+                }
+                results[i]["context"] = base64::to_base64(Serializer::toBinary(val.clock_));
+                replicate.emplace_back(put.key_, std::move(val));
+                placed.push_back(i);
+            }
 
-            try {
-                ValueList replica_values = quorom_ -> get(key);
+            // in flight while our own keys replicate, it only touches the results of remote
+            auto passed_on = std::async(std::launch::async, [&] {
+                forwardPuts(request->puts_, std::move(remote), results);
+            });
+            auto outcomes = quorom_ -> putMany(replicate);
+            for(size_t j = 0; j < replicate.size(); j++) {
+                reads_.forget(replicate[j].key_);
+                if(!outcomes[j]) {
+                    json &result = results[placed[j]];
+                    result.erase("context");
+                    result["error"] = "Failed to replicate to enough nodes";
+                }
+            }
+            passed_on.get();
 
-                for(auto &v : replica_values) {
-                    values.push_back(v);
+            json j{{"results", results}};
+            res.set_content(j.dump(), "application/json");
+            res.status = 200;
+        }
+
+        // puts passed on to one node, as indexes into the client's batch
+        struct ForwardBatch {
+            std::shared_ptr<Node> node_;
+            std::vector<size_t> puts_;
+        };
+
+        // each put goes to the first of its replicas that is up, one /mput per node. like
+        // routeElsewhere, a put only moves on to the next replica when the connection to
+        // the last one couldn't be made
+        void forwardPuts(const std::vector<ClientRequest> &puts, std::vector<size_t> pending, std::vector<json> &results) {
+            std::unordered_map<size_t, std::vector<std::shared_ptr<Node>>> candidates;
+            for(size_t i : pending) {
+                auto &nodes = candidates[i];
+                for(auto &node : ring_->getNextNodes(puts[i].key_, quorom_->getN())) {
+                    if(node->isActive()) {
+                        nodes.push_back(node);
+                    }
                 }
+            }
 
-                GetResponse resp{values.size()};
+            for(size_t attempt = 0; !pending.empty(); attempt++) {
+                std::unordered_map<std::string, ForwardBatch> batches;
+                for(size_t i : pending) {
+                    if(attempt >= candidates[i].size()) {
+                        results[i]["error"] = "No replica of the key could be reached";
+                        continue;
+                    }
+                    auto &node = candidates[i][attempt];
+                    auto &batch = batches[node->getId()];
+                    batch.node_ = node;
+                    batch.puts_.push_back(i);
+                }
 
-                for(int i = 0; i < values.size(); i++) {
-                    resp.values[i].context = base64::to_base64(Serializer::toBinary(values[i].clock_));
-                    resp.values[i].data = base64::to_base64(values[i].data_);
+                std::vector<std::future<std::vector<size_t>>> sends;
+                for(auto &[id, batch] : batches) {
+                    sends.push_back(std::async(std::launch::async, [&, &batch = batch] {
+                        return forwardBatch(puts, batch, results);
+                    }));
+                }
+                pending.clear();
+                for(auto &send : sends) {
+                    auto unreachable = send.get();
+                    pending.insert(pending.end(), unreachable.begin(), unreachable.end());
                 }
+            }
+        }
 
-                GetResponse uniqueResp = filterDuplicates(resp);
+        // returns the puts that were never sent
+        std::vector<size_t> forwardBatch(const std::vector<ClientRequest> &puts, const ForwardBatch &batch, std::vector<json> &results) {
+            json body = json::array();
+            for(size_t i : batch.puts_) {
+                body.push_back({{"key", puts[i].key_}, {"data", puts[i].data_}, {"context", puts[i].context_}});
+            }
+            httplib::Request sub;
+            sub.method = "POST";
+            sub.body = json{{"puts", body}}.dump();
+            sub.headers.emplace("Content-Type", "application/json");
+
+            Logger::instance().debug("Forwarding " + std::to_string(batch.puts_.size()) + " puts to node: " + batch.node_->getId());
+            httplib::Response answer;
+            switch(forwards_.forward(batch.node_->getAddr(), batch.node_->getPort(), "/mput", sub, answer)) {
+                case ForwardOutcome::UNREACHABLE:
+                    return batch.puts_;
+                case ForwardOutcome::NO_ANSWER:
+                    for(size_t i : batch.puts_) {
+                        results[i]["error"] = "Replica " + batch.node_->getId() + " did not answer in time, the put may have been applied";
+                    }
+                    return {};
+                case ForwardOutcome::ANSWERED:
+                    break;
+            }
 
-                json j = uniqueResp;
-                res.set_header("Content-Type", "application/json");
-                res.set_content(j.dump(), "application/json"); 
-                res.status = 200;
-            } catch(std::runtime_error e) {
+            json j = json::parse(answer.body, nullptr, false);
+            bool complete = answer.status == 200 && j.is_object() && j.contains("results") &&
+                            j["results"].is_array() && j["results"].size() == batch.puts_.size();
+            if(!complete) {
+                for(size_t i : batch.puts_) {
+                    results[i]["error"] = "Replica " + batch.node_->getId() + " answered " + std::to_string(answer.status);
+                }
+                return {};
+            }
+            for(size_t k = 0; k < batch.puts_.size(); k++) {
+                results[batch.puts_[k]] = std::move(j["results"][k]);
+            }
+            return {};
+        }
+
+        // one sibling is the raw value with its context in a header, several are a
+        // 300 with all of them in one frame, none is a 404
+        void handleBinaryGet(const httplib::Request &req, httplib::Response &res) {
+            ScopedTimer timer{latency_};
+            requests_.fetch_add(1, std::memory_order_relaxed);
+            setCORS(req, res);
+            std::string key = req.matches[1];
+            if(routeElsewhere(key, req, res, BinaryCodec::pathFor(key), true)) {
+                return;
+            }
+
+            Logger::instance().debug("Running binary GET for key: " + key);
+
+            auto versions = coordinateGet(key);
+            if(!versions) {
                 Logger::instance().error("Error fetching key: " + key);
-                Logger::instance().error(e.what());
+                Logger::instance().error(versions.error().message_);
                 res.status = 500;
-                res.set_content(e.what(), "text/plain");
+                res.set_content(versions.error().message_, "text/plain");
+                return;
+            }
+
+            std::vector<const Value*> all;
+            for(const ValueList *list : {versions->local_.get(), versions->replicas_.get()}) {
+                for(auto &v : *list) {
+                    all.push_back(&v);
+                }
+            }
+            auto siblings = BinaryCodec::unique(all);
+
+            if(siblings.empty()) {
+                res.status = 404;
                 return;
             }
+
+            if(siblings.size() == 1) {
+                const Value *only = siblings.front();
+                res.set_header(BinaryCodec::CONTEXT_HEADER, BinaryCodec::clockHeader(only->clock_));
+                res.set_content(only->data_, "application/octet-stream");
+                res.status = 200;
+                return;
+            }
+
+            res.set_content(BinaryCodec::encodeSiblings(siblings), BinaryCodec::SIBLINGS_CONTENT_TYPE);
+            res.status = 300;
         }
 
-        // returns true if we are in the wrong partition and need to redirect
-        bool handleRedirect(const httplib::Request &req, httplib::Response &res, std::string endpoint) { 
-            auto body = json::parse(req.body);
-            std::string key{body["key"]};
+        void handleBinaryPut(const httplib::Request &req, httplib::Response &res) {
+            ScopedTimer timer{latency_};
+            requests_.fetch_add(1, std::memory_order_relaxed);
+            setCORS(req, res);
+            std::string key = req.matches[1];
+            if(routeElsewhere(key, req, res, BinaryCodec::pathFor(key), false)) {
+                return;
+            }
 
-            auto current_node = quorom_->getCurrNode();
-            auto coordination_node = ring_->findNode(key);
+            Logger::instance().debug("Running binary PUT for key: " + key);
 
-            if(current_node->getId() != coordination_node->getId()) {
-                std::string node_url{"http://" + coordination_node -> getFullAddress() + endpoint};
-                Logger::instance().debug("Redirecting request for key: " + key + " to node: " + node_url);
-                res.status = 307; 
-                res.set_header("Location", node_url);
-                return true;
+            auto clock = BinaryCodec::parseContext(req.get_header_value(BinaryCodec::CONTEXT_HEADER));
+            if(!clock) {
+                res.set_content("Malformed context header", "text/plain");
+                res.status = 400;
+                return;
             }
 
-            return false;
+            Value val{req.body, std::move(*clock)};
+            CombinedPut outcome = coordinatePut(key, val);
+            if(outcome.result_ == MergeResult::OUTDATED) {
+                res.set_content("Outdated clock specified. Re-run a get operation to get the updated clock.", "text/plain");
+                res.status = 400;
+                return;
+            }
+
+            if(outcome.replicated_) {
+                res.set_header(BinaryCodec::CONTEXT_HEADER, BinaryCodec::clockHeader(val.clock_));
+                res.status = 204;
+            } else {
+                res.status = 500;
+                res.set_content("Failed to replicate to enough nodes", "text/plain");
+            }
         }
 
-        GetResponse filterDuplicates(const GetResponse& resp) {
-            GetResponse out{0};
-            std::unordered_set<std::pair<std::string, std::string>, 
-                            boost::hash<std::pair<std::string, std::string>>> seen;
+        // parsed once, routing and the handler both work off the result
+        // answers 400 itself if the body is malformed
+        std::optional<ClientRequest> parseClientRequest(const httplib::Request &req, httplib::Response &res) {
+            auto request = ClientRequest::parse(req.body);
+            if(!request) {
+                res.set_content("Malformed request body, expected a json object with a string key", "text/plain");
+                res.status = 400;
+            }
+            return request;
+        }
 
-            for (const auto& v : resp.values) {
-                auto key = std::make_pair(v.data, v.context);
-                if (seen.insert(key).second) { // true if not seen before
-                    out.values.push_back(v);
+        // returns true if another node answers the request, see routeFor. a forwarded
+        // write only moves on to the next replica when the connection couldn't be made,
+        // once it was sent the replica may have applied it and sending it again could
+        // write a second sibling, so the client gets a 504 and retries with its own context.
+        // a read is safe to repeat, it moves on either way and if no replica answers this
+        // node coordinates it itself
+        bool routeElsewhere(const std::string &key, const httplib::Request &req, httplib::Response &res, const std::string &endpoint, bool read) {
+            auto coordination_node = ring_->findNode(key);
+            bool coordinator = quorom_->getCurrNode()->getId() == coordination_node->getId();
+            // isReplica walks the ring, skip it where the answer doesn't matter
+            bool replica = !coordinator && routing_.mode_ == RoutingMode::PROXY && quorom_->isReplica(key);
+
+            switch(routeFor(routing_.mode_, coordinator, replica, req.has_header(ForwardPool::FORWARDED_HEADER))) {
+                case RouteAction::LOCAL:
+                    return false;
+                case RouteAction::REDIRECT:
+                    redirect(key, coordination_node, res, endpoint);
+                    return true;
+                case RouteAction::FORWARD:
+                    break;
+            }
+
+            for(auto &node : ring_->getNextNodes(key, quorom_->getN())) {
+                if(!node->isActive()) {
+                    continue;
                 }
+                Logger::instance().debug("Forwarding request for key: " + key + " to node: " + node->getId());
+                switch(forwards_.forward(node->getAddr(), node->getPort(), endpoint, req, res)) {
+                    case ForwardOutcome::ANSWERED:
+                        return true;
+                    case ForwardOutcome::UNREACHABLE:
+                        continue;
+                    case ForwardOutcome::NO_ANSWER:
+                        if(read) {
+                            continue;
+                        }
+                        res.status = 504;
+                        res.set_content("Replica " + node->getId() + " did not answer in time, the request may have been applied", "text/plain");
+                        return true;
+                }
+            }
+            if(read) {
+                Logger::instance().warn("No replica answered a read for key: " + key + ", coordinating it here");
+                return false;
             }
+            res.status = 503;
+            res.set_content("No replica of the key could be reached", "text/plain");
+            return true;
+        }
 
-            return out;
+        void redirect(const std::string &key, const std::shared_ptr<Node> &coordination_node, httplib::Response &res, const std::string &endpoint) {
+            std::string node_url{"http://" + coordination_node -> getFullAddress() + endpoint};
+            Logger::instance().debug("Redirecting request for key: " + key + " to node: " + node_url);
+            res.status = 307;
+            res.set_header("Location", node_url);
         }
 
 };
\ No newline at end of file
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+struct SingleFlightStats {
+    // calls that did the work
+    uint64_t leaders_{0};
+    // calls that waited on someone else's and got its result
+    uint64_t collapsed_{0};
+    // waiters that gave up on a slow leader and did the work themselves
+    uint64_t timeouts_{0};
+    // leader calls that threw, their waiters got the same error
+    uint64_t failures_{0};
+};
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(SingleFlightStats, leaders_, collapsed_, timeouts_, failures_)
+
+// concurrent calls for the same key share one execution
+// the first caller runs fn, anyone arriving while it is in flight waits for that result
+// instead of starting their own. results are never cached, a call arriving after the
+// flight landed starts a new one. T should be cheap to copy, every waiter gets one
+template<typename T>
+class SingleFlight {
+    public:
+        explicit SingleFlight(std::chrono::milliseconds max_wait = std::chrono::milliseconds(200), size_t shards = 16) :
+            max_wait_(max_wait),
+            shards_(shards) {}
+
+        template<typename Fn>
+        T run(const std::string& key, Fn&& fn) {
+            Shard& shard = shardFor(key);
+            std::shared_ptr<Flight> flight;
+            bool leader = false;
+            {
+                std::lock_guard<std::mutex> lk(shard.mu_);
+                auto it = shard.flights_.find(key);
+                if(it != shard.flights_.end()) {
+                    flight = it->second;
+                } else {
+                    flight = std::make_shared<Flight>();
+                    shard.flights_.emplace(key, flight);
+                    leader = true;
+                }
+            }
+
+            if(!leader) {
+                if(flight->result_.wait_for(max_wait_) == std::future_status::ready) {
+                    collapsed_.fetch_add(1, std::memory_order_relaxed);
+                    // rethrows the leader's error
+                    return flight->result_.get();
+                }
+                timeouts_.fetch_add(1, std::memory_order_relaxed);
+                return fn();
+            }
+
+            leaders_.fetch_add(1, std::memory_order_relaxed);
+            try {
+                T result = fn();
+                // off the map first so nobody joins a flight that already landed
+                land(shard, key, flight);
+                flight->promise_.set_value(result);
+                return result;
+            } catch(...) {
+                failures_.fetch_add(1, std::memory_order_relaxed);
+                land(shard, key, flight);
+                flight->promise_.set_exception(std::current_exception());
+                throw;
+            }
+        }
+
+        // callers from now on start a new flight, for when the key was just written
+        // and the one in flight may have read the old value
+        void forget(const std::string& key) {
+            Shard& shard = shardFor(key);
+            std::lock_guard<std::mutex> lk(shard.mu_);
+            shard.flights_.erase(key);
+        }
+
+        SingleFlightStats stats() const {
+            return SingleFlightStats{
+                leaders_.load(std::memory_order_relaxed),
+                collapsed_.load(std::memory_order_relaxed),
+                timeouts_.load(std::memory_order_relaxed),
+                failures_.load(std::memory_order_relaxed),
+            };
+        }
+
+    private:
+        struct Flight {
+            std::promise<T> promise_;
+            std::shared_future<T> result_{promise_.get_future().share()};
+        };
+
+        struct Shard {
+            std::mutex mu_;
+            std::unordered_map<std::string, std::shared_ptr<Flight>> flights_;
+        };
+
+        Shard& shardFor(const std::string& key) {
+            return shards_[std::hash<std::string>{}(key) % shards_.size()];
+        }
+
+        // a forget may already have replaced our flight with a newer one, leave that alone
+        void land(Shard& shard, const std::string& key, const std::shared_ptr<Flight>& flight) {
+            std::lock_guard<std::mutex> lk(shard.mu_);
+            auto it = shard.flights_.find(key);
+            if(it != shard.flights_.end() && it->second == flight) {
+                shard.flights_.erase(it);
+            }
+        }
+
+        std::chrono::milliseconds max_wait_;
+        std::vector<Shard> shards_;
+
+        std::atomic<uint64_t> leaders_{0};
+        std::atomic<uint64_t> collapsed_{0};
+        std::atomic<uint64_t> timeouts_{0};
+        std::atomic<uint64_t> failures_{0};
+};
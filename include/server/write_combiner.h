@@ -0,0 +1,187 @@
+#pragma once
+
+#include "metrics/histogram.h"
+#include "server/local_merge.h"
+#include "storage/value.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+struct WriteCombinerOptions {
+    // how long a lone writer waits for company before going ahead, 0 only combines
+    // writes that queued up behind a group already in flight
+    std::chrono::microseconds window_{0};
+    size_t max_group_{64};
+};
+
+struct CombinedPut {
+    MergeResult result_{MergeResult::APPLIED};
+    // reached the write quorum, only meaningful for applied puts
+    bool replicated_{false};
+    size_t group_size_{1};
+};
+
+struct WriteCombinerStats {
+    uint64_t puts_{0};
+    uint64_t groups_{0};
+    HistogramSnapshot group_size_;
+};
+
+inline void to_json(json& j, const WriteCombinerStats& s) {
+    j = json{
+        {"puts", s.puts_},
+        {"groups", s.groups_},
+        {"group_size", s.group_size_},
+    };
+}
+
+// coalesces concurrent coordinator puts to the same key
+// writers queue per key and the one at the front leads: it merges everything queued
+// behind it in arrival order with one engine write, replicates the versions that were
+// applied in one fan out, then hands every writer its own result. a group behaves
+// exactly like its puts applied one after another, a put whose clock is dominated by
+// an earlier one in the group is still reported outdated
+template<typename Engine>
+class WriteCombiner {
+    public:
+        // gets the versions applied by a group, returns whether the write quorum was met
+        using ReplicateFn = std::function<bool(const std::string&, const ValueList&)>;
+
+        WriteCombiner(LocalMerge<Engine>& local, ReplicateFn replicate, WriteCombinerOptions options = {}, size_t shards = 64) :
+            local_(local),
+            replicate_(std::move(replicate)),
+            options_(options),
+            shards_(shards) {}
+
+        // throws whatever the merge or the replication threw for the group
+        CombinedPut put(const std::string& key, const Value& value) {
+            puts_.fetch_add(1, std::memory_order_relaxed);
+            Shard& shard = shards_[std::hash<std::string>{}(key) % shards_.size()];
+            Writer w{&value};
+
+            std::unique_lock<std::mutex> lk(shard.mu_);
+            // node based map, the reference stays valid while other keys come and go
+            auto& queue = shard.keys_[key];
+            queue.push_back(&w);
+            w.cv_.wait(lk, [&] {
+                return w.done_ || &w == queue.front();
+            });
+            if(w.done_) {
+                return finish(w);
+            }
+
+            if(queue.size() == 1 && options_.window_.count() > 0) {
+                lk.unlock();
+                std::this_thread::sleep_for(options_.window_);
+                lk.lock();
+            }
+
+            // we lead, later arrivals queue behind the group and wait for us
+            size_t n = std::min(queue.size(), options_.max_group_);
+            std::vector<Writer*> group(queue.begin(), queue.begin() + n);
+            lk.unlock();
+
+            commit(key, group);
+
+            lk.lock();
+            for(size_t i = 0; i < n; i++) {
+                Writer* done = queue.front();
+                queue.pop_front();
+                done->done_ = true;
+                if(done != &w) {
+                    done->cv_.notify_one();
+                }
+            }
+            if(queue.empty()) {
+                shard.keys_.erase(key);
+            } else {
+                queue.front()->cv_.notify_one();
+            }
+            return finish(w);
+        }
+
+        WriteCombinerStats stats() {
+            return WriteCombinerStats{
+                puts_.load(std::memory_order_relaxed),
+                groups_.load(std::memory_order_relaxed),
+                group_size_.snapshot(),
+            };
+        }
+
+    private:
+        struct Writer {
+            const Value* value_;
+            CombinedPut out_{};
+            std::exception_ptr error_{};
+            bool done_{false};
+            std::condition_variable cv_;
+        };
+
+        struct Shard {
+            std::mutex mu_;
+            std::unordered_map<std::string, std::deque<Writer*>> keys_;
+        };
+
+        // runs without the shard lock, the group's writers are parked until we're done
+        void commit(const std::string& key, const std::vector<Writer*>& group) {
+            groups_.fetch_add(1, std::memory_order_relaxed);
+            group_size_.record(group.size());
+
+            ValueList batch;
+            batch.reserve(group.size());
+            for(auto *w : group) {
+                batch.push_back(*w->value_);
+            }
+
+            try {
+                auto results = local_.mergeBatch(key, batch);
+
+                ValueList applied;
+                for(size_t i = 0; i < group.size(); i++) {
+                    if(results[i] == MergeResult::APPLIED) {
+                        applied.push_back(batch[i]);
+                    }
+                }
+                bool replicated = applied.empty() || replicate_(key, applied);
+
+                for(size_t i = 0; i < group.size(); i++) {
+                    group[i]->out_ = CombinedPut{results[i], replicated, group.size()};
+                }
+            } catch(...) {
+                auto error = std::current_exception();
+                for(auto *w : group) {
+                    w->error_ = error;
+                }
+            }
+        }
+
+        CombinedPut finish(Writer& w) {
+            if(w.error_) {
+                std::rethrow_exception(w.error_);
+            }
+            return w.out_;
+        }
+
+        LocalMerge<Engine>& local_;
+        ReplicateFn replicate_;
+        WriteCombinerOptions options_;
+        std::vector<Shard> shards_;
+
+        std::atomic<uint64_t> puts_{0};
+        std::atomic<uint64_t> groups_{0};
+        Histogram group_size_;
+};
@@ -13,6 +13,8 @@
 #include <string_view>
 #include <type_traits>
 
+#include "storage/base64_simd.h"
+
 #if defined(__cpp_lib_bit_cast)
 #include <bit>  // For std::bit_cast.
 #endif
@@ -567,8 +569,9 @@ inline OutputBuffer encode_into(std::string_view data) {
   return encode_into<OutputBuffer>(std::begin(data), std::end(data));
 }
 
+// vectorized when the cpu allows, see base64_simd.h
 inline std::string to_base64(std::string_view data) {
-  return encode_into<std::string>(std::begin(data), std::end(data));
+  return encode_fast(data);
 }
 
 template <class OutputBuffer>
@@ -697,8 +700,9 @@ inline OutputBuffer decode_into(InputIterator begin, InputIterator end) {
   return decode_into<OutputBuffer>(data);
 }
 
+// vectorized when the cpu allows, see base64_simd.h
 inline std::string from_base64(std::string_view data) {
-  return decode_into<std::string>(data);
+  return decode_fast(data);
 }
 
 }  // namespace base64
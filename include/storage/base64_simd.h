@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// vectorized base64 for the client data path, to_base64 and from_base64 in base64.hpp go
+// through here. same alphabet, padding and errors as the scalar codec, which still does
+// the last few bytes and every input the vector loops reject.
+// the kernel is picked once from what the cpu supports, AVX2, then SSSE3 (pshufb is all
+// the 128 bit kernels need), then scalar. only x86-64 with gcc or clang has the vector
+// kernels, anything else is always scalar
+namespace base64 {
+
+enum class Isa {
+    SCALAR,
+    SSSE3,
+    AVX2
+};
+
+// best one this cpu supports, detected on first use
+Isa detected_isa();
+const char* isa_name(Isa isa);
+
+constexpr size_t encoded_size(size_t n) {
+    return (n + 2) / 3 * 4;
+}
+
+// writes exactly encoded_size(data.size()) chars to out and returns that
+size_t encode_to(std::string_view data, char* out);
+std::string encode_fast(std::string_view data);
+// throws std::runtime_error on malformed input
+std::string decode_fast(std::string_view text);
+
+// a given kernel, for tests and benchmarks. the cpu has to support it
+size_t encode_to(Isa isa, std::string_view data, char* out);
+std::string encode_with(Isa isa, std::string_view data);
+std::string decode_with(Isa isa, std::string_view text);
+
+}  // namespace base64
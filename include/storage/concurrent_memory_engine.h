@@ -0,0 +1,43 @@
+#pragma once
+
+#include "storage_engine.h"
+#include "storage/memory_engine.h"
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+// thread safe in memory engine, safe to hand to Server and the hot tier of TieredEngine
+// keys are spread over independently locked shards so readers of different keys
+// never contend and writers only block their own shard. each shard is a MemoryEngine
+// with an equal slice of the byte budget and its own S3-FIFO, so eviction is per shard
+// and a value larger than one slice is never cached
+class ConcurrentMemoryEngine : public StorageEngine<ConcurrentMemoryEngine> {
+    public:
+        // shards is rounded up to a power of two, 0 picks a default from the core count.
+        // capacity_bytes 0 is unbounded
+        explicit ConcurrentMemoryEngine(size_t shards = 0, size_t capacity_bytes = 0);
+
+        StorageResult<ByteString> lookup(const std::string &key);
+        // fn runs under the shard's shared lock
+        StorageResult<void> view(const std::string &key, const ViewFn &fn);
+        bool contains(const std::string &key);
+        void put(const std::string &key, ByteString value);
+        void remove(const std::string &key);
+        // copies out matching entries shard by shard then sorts, not a consistent snapshot
+        void scan(const std::string &from, const ScanFn &fn);
+
+        size_t size();
+        // summed over the shards, each read under its own lock
+        MemoryEngineStats stats();
+        size_t shardCount() const {
+            return shards_.size();
+        }
+
+    private:
+        MemoryEngine& shardFor(const std::string &key);
+
+        // separate allocations so neighbouring shard locks don't false share
+        std::vector<std::unique_ptr<MemoryEngine>> shards_;
+        int shift_;
+};
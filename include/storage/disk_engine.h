@@ -1,32 +1,109 @@
 #pragma once
 
 #include "storage_engine.h"
+#include "storage/disk_telemetry.h"
+#include "storage/group_commit.h"
+#include "storage/stall_detector.h"
+#include <chrono>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
 #include "leveldb/db.h"
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
 
 namespace leveldb {
     class DB;
+    class WriteBatch;
+    class Cache;
+    class FilterPolicy;
 }
 
+// how leveldb is opened, the defaults are leveldb's own
+struct DiskEngineOptions {
+    GroupCommitOptions commit_;
+
+    std::string profile_{"default"};
+    // 0 leaves leveldb's internal 8MB cache
+    size_t block_cache_bytes_{0};
+    // 0 means no bloom filter, 10 gives about 1% false positives
+    int bloom_bits_per_key_{0};
+    // memtable size, bigger means fewer level 0 files and fewer write stalls but slower recovery
+    size_t write_buffer_bytes_{4 << 20};
+    size_t max_file_bytes_{2 << 20};
+    size_t block_bytes_{4 << 10};
+    bool compression_{true};
+
+    // 0 samples leveldb's properties only when stats are read
+    std::chrono::milliseconds sample_interval_{1000};
+    // a group commit taking this long counts as stalled
+    std::chrono::milliseconds stall_threshold_{50};
+
+    // default, balanced, read-heavy or write-heavy, throws StorageError on anything else
+    // only touches the leveldb tuning, commit and sampling settings stay as they are
+    DiskEngineOptions& applyProfile(const std::string& name);
+};
+
+void to_json(json& j, const DiskEngineOptions& o);
+
+struct DiskEngineStats {
+    uint64_t sampled_at_ms_{0};
+    std::vector<LevelStats> levels_;
+    uint64_t disk_usage_bytes_{0};
+    // estimate of bytes leveldb still has to compact to get every level under its target size
+    uint64_t pending_compaction_bytes_{0};
+    uint64_t memory_usage_bytes_{0};
+    uint64_t largest_file_bytes_{0};
+    // level 0 file counts over all samples, and how many samples were at leveldb's
+    // slowdown and stop triggers
+    HistogramSnapshot l0_files_;
+    uint64_t slowdown_samples_{0};
+    uint64_t stop_samples_{0};
+    StallStats stalls_;
+    GroupCommitStats commit_;
+    DiskEngineOptions options_;
+};
+
+void to_json(json& j, const DiskEngineStats& s);
+
 class DiskEngine : public StorageEngine<DiskEngine> {
     public:
-        DiskEngine(std::string id, const std::string& postfix);
+        DiskEngine(std::string id, const std::string& postfix, DiskEngineOptions options = {});
         ~DiskEngine();
         DiskEngine(DiskEngine&& other) noexcept;
         DiskEngine& operator=(DiskEngine&& other) noexcept;
-        ByteString get(const std::string &key);
+        // NOT_FOUND on a miss, IO_ERROR or CORRUPTION if leveldb failed
+        StorageResult<ByteString> lookup(const std::string &key);
+        // leveldb can't pin a value outside an iterator, so this reads into a per thread
+        // buffer that keeps its capacity between calls, no allocation once it is warm
+        StorageResult<void> view(const std::string &key, const ViewFn &fn);
         // the caller must not delete this pointer
         leveldb::DB* getDB() {
             return db_;
         }
 
+        // both go through the group commit, concurrent callers share one WriteBatch
         void put(const std::string &key, const ByteString value);
         void remove(const std::string &key);
+        // several puts and removes applied atomically, also through the group commit
+        void write(leveldb::WriteBatch &batch);
 
-        // TODO
-        // this does two reads, make better later
+        // leveldb has no existence check, this is one lookup with the value thrown away
         bool contains(const std::string &key);
+        // iterates over an implicit snapshot, writes made during the scan are not seen
+        void scan(const std::string &from, const ScanFn &fn);
+
+        // leveldb properties as of the last sample
+        DiskEngineStats stats();
     
     private: 
         leveldb::DB* db_;
+        DiskEngineOptions options_;
+        // leveldb doesn't own these, they have to outlive db_
+        std::unique_ptr<leveldb::Cache> block_cache_;
+        std::unique_ptr<const leveldb::FilterPolicy> filter_policy_;
+        // behind pointers so the engine stays movable
+        std::unique_ptr<DiskTelemetry> telemetry_;
+        std::unique_ptr<GroupCommit> commit_;
 };
\ No newline at end of file
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "metrics/histogram.h"
+#include "storage/stall_detector.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "leveldb/db.h"
+
+// leveldb starts sleeping 1ms per write at this many level 0 files and blocks writes
+// entirely at the second one (db/dbformat.h)
+constexpr uint64_t L0_SLOWDOWN_WRITES_TRIGGER = 8;
+constexpr uint64_t L0_STOP_WRITES_TRIGGER = 12;
+
+struct LevelStats {
+    int level_;
+    uint64_t files_;
+    uint64_t bytes_;
+    // cumulative compaction work done into this level since open
+    double compaction_seconds_{0};
+    uint64_t compaction_read_bytes_{0};
+    uint64_t compaction_write_bytes_{0};
+};
+
+// what one pass over the leveldb properties found
+struct LevelDBSample {
+    // wall clock in ms, 0 if nothing was sampled yet
+    uint64_t sampled_at_ms_{0};
+    std::vector<LevelStats> levels_;
+    uint64_t disk_usage_bytes_{0};
+    // estimate of bytes leveldb still has to compact to get every level under its target size
+    uint64_t pending_compaction_bytes_{0};
+    // memtables plus block cache, leveldb.approximate-memory-usage
+    uint64_t memory_usage_bytes_{0};
+    uint64_t largest_file_bytes_{0};
+};
+
+// parse the leveldb.stats and leveldb.sstables property text
+std::vector<LevelStats> parseLevelStats(const std::string& raw);
+uint64_t parseLargestFile(const std::string& raw);
+
+// samples leveldb's properties on an interval so reading stats is cheap and the level 0
+// file count is tracked over time, and feeds it to the stall detector
+class DiskTelemetry {
+    public:
+        // an interval of 0 means no background thread, latest() samples on demand
+        DiskTelemetry(leveldb::DB* db, std::chrono::milliseconds interval, std::chrono::microseconds stall_threshold);
+        ~DiskTelemetry();
+
+        DiskTelemetry(const DiskTelemetry&) = delete;
+        DiskTelemetry& operator=(const DiskTelemetry&) = delete;
+
+        LevelDBSample sample();
+        LevelDBSample latest();
+
+        StallDetector& stalls() {
+            return stalls_;
+        }
+
+        // level 0 file count seen at each sample
+        HistogramSnapshot l0Files() const {
+            return l0_files_.snapshot();
+        }
+        uint64_t slowdownSamples() const {
+            return slowdown_samples_.load(std::memory_order_relaxed);
+        }
+        uint64_t stopSamples() const {
+            return stop_samples_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        void sampleLoop();
+
+        leveldb::DB* db_;
+        std::chrono::milliseconds interval_;
+        StallDetector stalls_;
+
+        std::mutex mu_;
+        LevelDBSample latest_;
+
+        Histogram l0_files_;
+        std::atomic<uint64_t> slowdown_samples_{0};
+        std::atomic<uint64_t> stop_samples_{0};
+
+        std::thread sampler_;
+        std::atomic<bool> running_{true};
+        std::mutex sample_mu_;
+        std::condition_variable sample_cv_;
+};
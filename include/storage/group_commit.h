@@ -0,0 +1,100 @@
+#pragma once
+
+#include "metrics/histogram.h"
+#include "storage/stall_detector.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "leveldb/db.h"
+#include "leveldb/write_batch.h"
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+enum class SyncPolicy {
+    // leave flushing to the os, a machine crash can lose recent writes
+    NONE,
+    // fsync every group before acknowledging any write in it
+    BATCH,
+    // fsync at most every sync interval, bounds what a machine crash can lose
+    INTERVAL
+};
+
+SyncPolicy syncPolicyFromStr(const std::string& policy);
+const char* syncPolicyToStr(SyncPolicy policy);
+
+struct GroupCommitOptions {
+    SyncPolicy sync_{SyncPolicy::NONE};
+    std::chrono::milliseconds sync_interval_{100};
+    // a leader stops pulling in followers once the group is this big
+    size_t max_batch_bytes_{1 << 20};
+};
+
+struct GroupCommitStats {
+    // writes per group
+    HistogramSnapshot batch_size_;
+    HistogramSnapshot batch_bytes_;
+    // time spent in leveldb::DB::Write per group, microseconds
+    HistogramSnapshot commit_latency_us_;
+    uint64_t syncs_{0};
+};
+
+void to_json(json& j, const GroupCommitStats& s);
+
+// collects concurrent writes into one leveldb WriteBatch
+// every writer queues up, the one at the front becomes the leader, merges everything
+// queued behind it into a single batch, commits it and wakes the writers it carried.
+// same scheme leveldb uses internally, done here so the sync policy applies per group
+// and group sizes and commit latency can be observed
+class GroupCommit {
+    public:
+        // every group's commit latency is reported to stalls if given
+        GroupCommit(leveldb::DB* db, GroupCommitOptions options, StallDetector* stalls = nullptr);
+        ~GroupCommit();
+
+        GroupCommit(const GroupCommit&) = delete;
+        GroupCommit& operator=(const GroupCommit&) = delete;
+
+        // blocks until the batch is committed, with its group's sync
+        leveldb::Status write(leveldb::WriteBatch* batch);
+
+        GroupCommitStats stats();
+
+    private:
+        struct Writer {
+            leveldb::WriteBatch* batch_;
+            bool sync_;
+            bool done_{false};
+            leveldb::Status status_;
+            std::condition_variable cv_;
+        };
+
+        leveldb::Status enqueue(Writer& w);
+        void syncLoop();
+
+        leveldb::DB* db_;
+        GroupCommitOptions options_;
+        StallDetector* stalls_;
+
+        std::mutex mu_;
+        std::deque<Writer*> writers_;
+        // only touched by the current leader
+        leveldb::WriteBatch group_;
+        std::chrono::steady_clock::time_point last_sync_;
+        // set when a group was committed without sync, cleared on the next sync
+        std::atomic<bool> dirty_{false};
+
+        std::thread syncer_;
+        std::atomic<bool> running_{true};
+        std::mutex sync_mu_;
+        std::condition_variable sync_cv_;
+
+        Histogram batch_size_;
+        Histogram batch_bytes_;
+        Histogram commit_latency_us_;
+        std::atomic<uint64_t> syncs_{0};
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "storage_engine.h"
+#include "storage/disk_engine.h"
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// storage for hinted handoff
+// most hints are delivered seconds after they are written, so they live in an ordered map
+// backed by an append-only log for crash recovery instead of going through leveldb.
+// once the in memory hints go over the budget they are all moved to the spill engine in
+// one write batch and the log starts over. a key is only ever in one of the two places.
+class HybridHintEngine : public StorageEngine<HybridHintEngine> {
+    public:
+        HybridHintEngine(std::string log_path, std::shared_ptr<DiskEngine> spill, size_t memory_budget);
+        ~HybridHintEngine();
+
+        HybridHintEngine(const HybridHintEngine&) = delete;
+        HybridHintEngine& operator=(const HybridHintEngine&) = delete;
+
+        StorageResult<ByteString> lookup(const std::string &key);
+        StorageResult<void> view(const std::string &key, const ViewFn &fn);
+        bool contains(const std::string &key);
+        void put(const std::string &key, const ByteString value);
+        void remove(const std::string &key);
+        // merges memory and spilled keys in order
+        // fn runs under the engine lock so it must not call back into the engine
+        void scan(const std::string &from, const ScanFn &fn);
+
+        size_t memoryBytes();
+        uint64_t spilledKeys();
+
+    private:
+        enum Op : char {
+            PUT = 'P',
+            REMOVE = 'D'
+        };
+
+        void replay();
+        void dropSpilled();
+        void appendLog(Op op, const std::string &key, const ByteString &value);
+        void openLog(bool truncate);
+        void rewriteLog();
+        void spill();
+        bool onDisk(const std::string &key);
+
+        std::mutex mu_;
+        std::map<std::string, ByteString> mem_;
+        size_t mem_bytes_{0};
+        size_t budget_;
+
+        std::string log_path_;
+        std::ofstream log_;
+        size_t log_bytes_{0};
+
+        std::shared_ptr<DiskEngine> spill_;
+        // keys currently on disk, lets us skip leveldb entirely while nothing is spilled
+        uint64_t spilled_keys_{0};
+};
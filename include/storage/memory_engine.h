@@ -1,20 +1,108 @@
 #pragma once
 
 #include "storage_engine.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <shared_mutex>
+#include <string>
 #include <boost/unordered_map.hpp>
 #include <boost/unordered/unordered_flat_map.hpp>
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
 
+struct MemoryEngineStats {
+    // bytes charged against the capacity, keys + values + per entry overhead
+    size_t bytes_{0};
+    // 0 means unbounded
+    size_t capacity_{0};
+    size_t entries_{0};
+    uint64_t hits_{0};
+    uint64_t misses_{0};
+    uint64_t evictions_{0};
+
+    double hitRatio() const {
+        uint64_t total = hits_ + misses_;
+        return total == 0 ? 0.0 : static_cast<double>(hits_) / static_cast<double>(total);
+    }
+};
+
+void to_json(json& j, const MemoryEngineStats& s);
+
+// in memory engine with an optional byte budget, safe to share between threads
+// eviction is S3-FIFO: new keys go into a small fifo and only move to the main fifo
+// if they are read again before falling out, so a one off scan can't flush the
+// working set. keys evicted from the small fifo are remembered in a ghost fifo and
+// go straight to main if they come back soon after.
+// hits only bump an atomic counter under the shared lock, all list moves happen on
+// the write path
 class MemoryEngine : public StorageEngine<MemoryEngine> {
     public:
+        // unbounded
         MemoryEngine() = default;
+        explicit MemoryEngine(size_t capacity_bytes);
 
-        ByteString get(const std::string &key);
+        // NOT_FOUND on a miss, get() is empty and tryGet() nullopt for those
+        StorageResult<ByteString> lookup(const std::string &key);
+        // fn runs under the shared lock
+        StorageResult<void> view(const std::string &key, const ViewFn &fn);
 
         bool contains(const std::string &key);
 
-        void put(const std::string &key, const ByteString value);
+        void put(const std::string &key, ByteString value);
         void remove(const std::string &key);
-    
-    private: 
-        boost::unordered_flat_map<std::string, ByteString>  map_;
-};
\ No newline at end of file
+        // the map is unordered so this sorts the matching keys first, fine for tests
+        void scan(const std::string &from, const ScanFn &fn);
+
+        MemoryEngineStats stats();
+
+    private:
+        enum class Queue : uint8_t {
+            SMALL,
+            MAIN
+        };
+
+        struct Entry {
+            Entry(std::string key, ByteString value, Queue queue) :
+                key_(std::move(key)),
+                value_(std::move(value)),
+                queue_(queue) {}
+
+            std::string key_;
+            ByteString value_;
+            Queue queue_;
+            // capped at MAX_FREQ, bumped on reads without the exclusive lock
+            std::atomic<uint8_t> freq_{0};
+        };
+
+        using Fifo = std::list<Entry>;
+
+        static size_t charge(const std::string &key, const ByteString &value);
+
+        // caller holds the exclusive lock
+        void touch(Entry &entry);
+        void evict();
+        void evictSmall();
+        void evictMain();
+        void drop(Fifo &fifo, Fifo::iterator it);
+        void rememberGhost(const std::string &key);
+        bool takeGhost(const std::string &key);
+
+        std::shared_mutex mu_;
+        // newest entries at the front, eviction from the back
+        Fifo small_;
+        Fifo main_;
+        boost::unordered_flat_map<std::string, Fifo::iterator> index_;
+        size_t small_bytes_{0};
+        size_t bytes_{0};
+        size_t capacity_{0};
+
+        // hashes of keys recently evicted from the small fifo, bounded by the cached entry count
+        std::list<size_t> ghost_;
+        boost::unordered_flat_map<size_t, uint32_t> ghost_counts_;
+
+        std::atomic<uint64_t> hits_{0};
+        std::atomic<uint64_t> misses_{0};
+        uint64_t evictions_{0};
+};
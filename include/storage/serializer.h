@@ -1,10 +1,45 @@
 #pragma once
 
 #include "storage/value.h"
+#include <istream>
+#include <ostream>
 #include <sstream>
+#include <streambuf>
+#include <string_view>
 #include <cereal/archives/json.hpp>
 #include <cereal/archives/binary.hpp>
 
+// read only streambuf over bytes we don't own, cereal decodes straight out of them
+class ViewStreamBuf : public std::streambuf {
+    public:
+        explicit ViewStreamBuf(std::string_view bytes) {
+            char* begin = const_cast<char*>(bytes.data());
+            setg(begin, begin, begin + bytes.size());
+        }
+};
+
+// streambuf that appends to a string the caller owns, so its capacity gets reused
+class AppendStreamBuf : public std::streambuf {
+    public:
+        explicit AppendStreamBuf(std::string& out) : out_(out) {}
+
+    protected:
+        int_type overflow(int_type c) override {
+            if(c != traits_type::eof()) {
+                out_.push_back(traits_type::to_char_type(c));
+            }
+            return c;
+        }
+
+        std::streamsize xsputn(const char* s, std::streamsize n) override {
+            out_.append(s, n);
+            return n;
+        }
+
+    private:
+        std::string& out_;
+};
+
 class Serializer {
     public:
         template <typename Serializable>
@@ -19,6 +54,18 @@ class Serializer {
             return ss.str();
         }
 
+        // same encoding as toBinary, appended to out
+        template <typename Serializable>
+        static void appendBinary(const Serializable& obj, ByteString& out) {
+            AppendStreamBuf buf(out);
+            std::ostream os(&buf);
+
+            {
+                cereal::BinaryOutputArchive oarchive(os);
+                oarchive(obj);
+            }
+        }
+
         template <typename Serializable>
         static Serializable fromJson(const std::string& json)  {
             Serializable input{};
@@ -32,8 +79,9 @@ class Serializer {
         }
 
         // if string is empty we just return the default constructed object
+        // decodes in place, binary is not copied
         template <typename Serializable>
-        static Serializable fromBinary(const std::string& binary) {
+        static Serializable fromBinary(std::string_view binary) {
             Serializable output{};
 
             if(binary.size() == 0) {
@@ -41,7 +89,8 @@ class Serializer {
             }
 
             {
-                std::istringstream ss(binary);
+                ViewStreamBuf buf(binary);
+                std::istream ss(&buf);
                 cereal::BinaryInputArchive iarchive(ss);
 
                 iarchive(output); 
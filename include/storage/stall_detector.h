@@ -0,0 +1,78 @@
+#pragma once
+
+#include "metrics/histogram.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+struct StallEpisode {
+    // wall clock in ms when the first slow commit started
+    uint64_t started_at_ms_{0};
+    // first slow commit start to last slow commit end
+    uint64_t duration_us_{0};
+    // group commits that were slow during the episode
+    uint64_t commits_{0};
+    uint64_t writes_{0};
+    // level 0 files at the last sample, leveldb slows writes at 8 and stops them at 12
+    uint64_t l0_files_{0};
+};
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(StallEpisode, started_at_ms_, duration_us_, commits_, writes_, l0_files_)
+
+struct StallStats {
+    uint64_t episodes_{0};
+    uint64_t stalled_us_{0};
+    bool stalled_{false};
+    // first slow commit start to last slow commit end of the open episode, 0 if none
+    uint64_t open_us_{0};
+    HistogramSnapshot episode_us_;
+    // newest last
+    std::vector<StallEpisode> recent_;
+};
+
+void to_json(json& j, const StallStats& s);
+
+// turns commit latencies into write stall episodes
+// leveldb doesn't report when it throttles or blocks writers, but it shows up as a run of
+// group commits that take far longer than usual. a commit over the threshold opens an
+// episode, the next commit under it closes the episode, and so does going quiet for a while
+class StallDetector {
+    public:
+        explicit StallDetector(
+            std::chrono::microseconds threshold,
+            std::chrono::milliseconds quiet = std::chrono::milliseconds(1000)
+        );
+
+        void onCommit(std::chrono::steady_clock::time_point start, std::chrono::microseconds latency, size_t writes);
+        // closes an episode nobody has committed through for the quiet period, called by the sampler
+        void tick(std::chrono::steady_clock::time_point now);
+        void setL0Files(uint64_t files);
+
+        StallStats stats();
+
+        static constexpr size_t RECENT_EPISODES = 16;
+
+    private:
+        void close();
+
+        std::chrono::microseconds threshold_;
+        std::chrono::milliseconds quiet_;
+        std::atomic<uint64_t> l0_files_{0};
+
+        std::mutex mu_;
+        bool stalled_{false};
+        StallEpisode current_;
+        std::chrono::steady_clock::time_point started_;
+        std::chrono::steady_clock::time_point last_slow_end_;
+
+        uint64_t episodes_{0};
+        uint64_t stalled_us_{0};
+        Histogram episode_us_;
+        std::deque<StallEpisode> recent_;
+};
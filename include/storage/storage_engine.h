@@ -1,18 +1,63 @@
 #pragma once
 
+#include "error/storage_error.h"
+#include <functional>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <utility>
 
 using ByteString = std::string;
 
+// visitor for scan, return false to stop early
+using ScanFn = std::function<bool(const std::string &key, const ByteString &value)>;
+// sees a stored value in place, see view()
+using ViewFn = std::function<void(std::string_view value)>;
+
 template <typename EngineImpl>
 class StorageEngine {
     public:
+        // the one read every engine implements
+        // a miss is StorageCode::NOT_FOUND, never an exception, misses are most of the
+        // traffic for a fresh key and unwinding for each of them is not free
+        StorageResult<ByteString> lookup(const std::string &key) {
+            return static_cast<EngineImpl*>(this) -> lookup(key);
+        }
+
+        // runs fn on the stored bytes without copying them out where the engine can
+        // manage it. the view is only valid inside fn, and fn runs under whatever lock
+        // keeps it pinned so it must not call back into the engine. NOT_FOUND on a miss
+        StorageResult<void> view(const std::string &key, const ViewFn &fn) {
+            return static_cast<EngineImpl*>(this) -> view(key, fn);
+        }
+
+        // empty string on a miss, throws StorageError only if the engine itself failed
         ByteString get(const std::string &key) {
-            return static_cast<EngineImpl*>(this) -> get(key);
+            auto value = lookup(key);
+            if(value) {
+                return std::move(*value);
+            }
+            if(value.error().notFound()) {
+                return {};
+            }
+            throw StorageError(value.error().message_);
         }
 
-        void put(const std::string &key, const ByteString value) {
-            static_cast<EngineImpl*>(this) -> put(key, value);
+        // nullopt on a miss, for callers that need to tell a miss from an empty value
+        std::optional<ByteString> tryGet(const std::string &key) {
+            auto value = lookup(key);
+            if(value) {
+                return std::move(*value);
+            }
+            if(value.error().notFound()) {
+                return std::nullopt;
+            }
+            throw StorageError(value.error().message_);
+        }
+
+        // by value so engines that keep the bytes can move them in
+        void put(const std::string &key, ByteString value) {
+            static_cast<EngineImpl*>(this) -> put(key, std::move(value));
         }
 
         bool contains(const std::string &key) {
@@ -22,4 +67,9 @@ class StorageEngine {
         void remove(const std::string &key) {
             return static_cast<EngineImpl*>(this) -> remove(key);
         }
-};
\ No newline at end of file
+
+        // visits keys >= from in key order until fn returns false
+        void scan(const std::string &from, const ScanFn &fn) {
+            static_cast<EngineImpl*>(this) -> scan(from, fn);
+        }
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// fixed pool of mutexes that keys hash onto, for per key critical sections
+// without a mutex per key. two keys can share a stripe, so never hold two
+// stripes at once
+class StripedMutex {
+    public:
+        explicit StripedMutex(size_t stripes = 1024) :
+            stripes_(std::make_unique<Stripe[]>(std::bit_ceil(stripes))),
+            mask_(std::bit_ceil(stripes) - 1) {}
+
+        std::mutex& forKey(const std::string& key) {
+            return stripes_[std::hash<std::string>{}(key) & mask_].mu_;
+        }
+
+    private:
+        struct alignas(64) Stripe {
+            std::mutex mu_;
+        };
+
+        std::unique_ptr<Stripe[]> stripes_;
+        size_t mask_;
+};
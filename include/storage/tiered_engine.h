@@ -0,0 +1,99 @@
+#pragma once
+
+#include "storage_engine.h"
+#include "storage/striped_mutex.h"
+#include <memory>
+#include <mutex>
+#include <string>
+
+template <typename HotStats, typename ColdStats>
+struct TieredEngineStats {
+    HotStats hot_;
+    ColdStats cold_;
+};
+
+// bounded memory tier in front of a durable engine
+// reads are served from Hot when possible and filled from Cold on a miss, writes go
+// through to Cold and then update Hot. a miss fill and every write for a key happen
+// under the same key stripe, so a fill can never put back a value a concurrent put
+// already replaced. hits only touch Hot and take no stripe.
+// Hot must be thread safe, e.g. a bounded ConcurrentMemoryEngine
+template <typename Hot, typename Cold>
+class TieredEngine : public StorageEngine<TieredEngine<Hot, Cold>> {
+    public:
+        TieredEngine(std::shared_ptr<Hot> hot, std::shared_ptr<Cold> cold) :
+            hot_(hot),
+            cold_(cold) {}
+
+        StorageResult<ByteString> lookup(const std::string &key) {
+            if (auto value = hot_->lookup(key)) {
+                return value;
+            }
+            return fill(key);
+        }
+
+        // a hit is viewed in place in Hot, a miss is filled from Cold first
+        StorageResult<void> view(const std::string &key, const ViewFn &fn) {
+            if (hot_->view(key, fn)) {
+                return {};
+            }
+
+            auto value = fill(key);
+            if (!value) {
+                return std::unexpected(std::move(value.error()));
+            }
+            fn(*value);
+            return {};
+        }
+
+        bool contains(const std::string &key) {
+            return hot_->contains(key) || cold_->contains(key);
+        }
+
+        void put(const std::string &key, ByteString value) {
+            std::lock_guard<std::mutex> lk(stripes_.forKey(key));
+            cold_->put(key, value);
+            hot_->put(key, std::move(value));
+        }
+
+        void remove(const std::string &key) {
+            std::lock_guard<std::mutex> lk(stripes_.forKey(key));
+            cold_->remove(key);
+            hot_->remove(key);
+        }
+
+        // Cold holds everything so it is the one to scan
+        void scan(const std::string &from, const ScanFn &fn) {
+            cold_->scan(from, fn);
+        }
+
+        auto stats() requires requires(Hot& h, Cold& c) { h.stats(); c.stats(); } {
+            return TieredEngineStats<decltype(hot_->stats()), decltype(cold_->stats())>{
+                hot_->stats(),
+                cold_->stats()
+            };
+        }
+
+        std::shared_ptr<Hot> hot() {
+            return hot_;
+        }
+
+        std::shared_ptr<Cold> cold() {
+            return cold_;
+        }
+
+    private:
+        StorageResult<ByteString> fill(const std::string &key) {
+            std::lock_guard<std::mutex> lk(stripes_.forKey(key));
+            auto value = cold_->lookup(key);
+            // misses and failures are not cached
+            if (value) {
+                hot_->put(key, *value);
+            }
+            return value;
+        }
+
+        std::shared_ptr<Hot> hot_;
+        std::shared_ptr<Cold> cold_;
+        StripedMutex stripes_;
+};
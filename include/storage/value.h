@@ -37,7 +37,7 @@ class VectorClock  {
             return it != times_.end() ? it->second : 0;
         }
 
-        std::unordered_map<std::string, uint64_t> getTimes() {
+        const std::unordered_map<std::string, uint64_t>& getTimes() const {
             return times_;
         }
 
@@ -58,6 +58,10 @@ class VectorClock  {
             times_[key]++;
         }
 
+        void set(const std::string& key, uint64_t time) {
+            times_[key] = time;
+        }
+
         std::string toString() const {
             std::ostringstream oss;
             oss << "{";
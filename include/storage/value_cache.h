@@ -0,0 +1,98 @@
+#pragma once
+
+#include "storage/value.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <boost/unordered/unordered_flat_map.hpp>
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+struct ValueCacheStats {
+    size_t bytes_{0};
+    size_t capacity_{0};
+    size_t entries_{0};
+    uint64_t hits_{0};
+    uint64_t misses_{0};
+    // fills dropped because the key was written while it was being decoded
+    uint64_t stale_fills_{0};
+    // fills turned away by the admission check on a full shard
+    uint64_t rejected_fills_{0};
+    uint64_t evictions_{0};
+};
+
+void to_json(json& j, const ValueCacheStats& s);
+
+// cache of decoded ValueLists so hot keys skip the cereal parse
+// entries are immutable and handed out as shared_ptr<const>, writers never modify
+// one in place, they write the engine and invalidate.
+// a reader that misses takes a ticket before reading the engine and the fill is
+// dropped if the key was invalidated in between, so a slow fill can't put back a
+// value that a concurrent put already replaced
+class ValueCache {
+    public:
+        using Ptr = std::shared_ptr<const ValueList>;
+
+        // capacity 0 disables the cache, every get misses and fills are dropped
+        explicit ValueCache(size_t capacity_bytes, size_t shards = 16);
+
+        // nullptr on a miss
+        Ptr get(const std::string &key);
+        // take before reading the engine, pass to fill
+        uint64_t ticket(const std::string &key);
+        void fill(const std::string &key, Ptr values, uint64_t ticket);
+        // call after the engine write, not before
+        void invalidate(const std::string &key);
+
+        // asked before a fill would evict something, a key it refuses isn't cached
+        // set before the cache is shared, it's called under a shard lock
+        void setAdmission(std::function<bool(const std::string&)> admit) {
+            admit_ = std::move(admit);
+        }
+
+        ValueCacheStats stats();
+
+        // rough heap footprint of a decoded list
+        static size_t charge(const std::string &key, const ValueList &values);
+
+    private:
+        struct Entry {
+            Ptr values_;
+            size_t bytes_;
+            std::list<std::string>::iterator lru_;
+        };
+
+        struct alignas(64) Shard {
+            std::mutex mu_;
+            boost::unordered_flat_map<std::string, Entry> map_;
+            // most recently used at the front
+            std::list<std::string> lru_;
+            size_t bytes_{0};
+        };
+
+        // generations are striped too, a write to a neighbour only costs a dropped fill
+        static constexpr size_t GENERATIONS = 4096;
+
+        Shard& shardFor(size_t hash);
+        std::atomic<uint64_t>& generationFor(size_t hash);
+        void erase(Shard &shard, boost::unordered_flat_map<std::string, Entry>::iterator it);
+
+        std::vector<std::unique_ptr<Shard>> shards_;
+        std::unique_ptr<std::array<std::atomic<uint64_t>, GENERATIONS>> generations_;
+        size_t capacity_;
+        size_t shard_capacity_;
+        std::function<bool(const std::string&)> admit_;
+
+        std::atomic<uint64_t> hits_{0};
+        std::atomic<uint64_t> misses_{0};
+        std::atomic<uint64_t> stale_fills_{0};
+        std::atomic<uint64_t> rejected_fills_{0};
+        std::atomic<uint64_t> evictions_{0};
+};
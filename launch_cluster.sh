@@ -14,6 +14,13 @@ cd ..
 
 EXECUTABLE="./build/app"
 
+# MEMBERSHIP=swim ./launch_cluster.sh to use swim over udp instead of http gossip
+# NODES=50 ./launch_cluster.sh to run a larger cluster
+# ROUTING=redirect ./launch_cluster.sh to answer requests for other nodes' keys with a 307
+MEMBERSHIP=${MEMBERSHIP:-gossip}
+NODES=${NODES:-10}
+ROUTING=${ROUTING:-proxy}
+
 if [ ! -f "$EXECUTABLE" ]; then
     echo "Error: $EXECUTABLE not found. Build failed?"
     exit 1
@@ -22,13 +29,13 @@ fi
 echo "=================================================="
 echo "Starting bootstrap node on port 8080..."
 echo "=================================================="
-$EXECUTABLE --port 8080 --address localhost 2>&1 | sed "s/^/[Node 8080] /" &
-sleep 2 # Give it a moment to start
+$EXECUTABLE --port 8080 --address localhost --membership $MEMBERSHIP --routing $ROUTING 2>&1 | sed "s/^/[Node 8080] /" &
+# no need to wait, joining nodes retry the bootstrap server with backoff
 
-for i in {1..9}; do
+for ((i = 1; i < NODES; i++)); do
     PORT=$((8080 + i))
     echo "Starting node on port $PORT..."
-    $EXECUTABLE --port $PORT --address localhost --bootstrap-servers localhost:8080 2>&1 | sed "s/^/[Node $PORT] /" &
+    $EXECUTABLE --port $PORT --address localhost --bootstrap-servers localhost:8080 --membership $MEMBERSHIP --routing $ROUTING 2>&1 | sed "s/^/[Node $PORT] /" &
 done
 
 echo "Cluster running. Press Ctrl+C to stop all nodes."
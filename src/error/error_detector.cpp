@@ -23,6 +23,8 @@ void ErrorDetector::markError(const std::string& nodeId) {
             std::lock_guard<std::mutex> lk(mu_);
             if (processing_.contains(nodeId)) return;
             node = ring_->getNode(nodeId);
+            // node may have left the ring since the request was made
+            if (!node) return;
             node->setInactive();
             q_.push(node);
             processing_.insert(nodeId);
@@ -64,6 +66,12 @@ void ErrorDetector::start() {
             }
             lk.unlock();
 
+            if (healthy) {
+                for (auto& listener : recovery_listeners_) {
+                    listener(node->getId());
+                }
+            }
+
             // do we even need this sleep?
             std::this_thread::sleep_for(std::chrono::seconds(1));
             lk.lock();
@@ -126,5 +126,8 @@ std::shared_ptr<Node> HashRing::getNode(const std::string &id) {
     auto it = std::find_if(nodes_.begin(), nodes_.end(), [&](auto node) {
         return node -> getId() == id;
     });
+    if(it == nodes_.end()) {
+        return nullptr;
+    }
     return *(it);
 }
\ No newline at end of file
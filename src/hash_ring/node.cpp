@@ -18,11 +18,15 @@ Node::Node(std::string addr, int port, size_t tokens) :
     addr_(addr), 
     port_(port), 
     client_(std::make_unique<httplib::Client>(addr, port)),
+    bulk_client_(std::make_unique<httplib::Client>(addr, port)),
     tokens_(tokens),
     active_(true) {
         client_->set_connection_timeout(std::chrono::milliseconds(50));
         client_->set_read_timeout(std::chrono::milliseconds(50));
         client_->set_write_timeout(std::chrono::milliseconds(50));
+        bulk_client_->set_connection_timeout(std::chrono::milliseconds(200));
+        bulk_client_->set_read_timeout(std::chrono::seconds(2));
+        bulk_client_->set_write_timeout(std::chrono::seconds(2));
     }
 
 bool Node::checkHealth() {
@@ -62,6 +66,45 @@ bool Node::replicatePut(const std::string& key, const Value& value) {
     }
 }
 
+bool Node::replicatePut(const std::string& key, const ValueList& values) {
+    if(values.size() == 1) {
+        return replicatePut(key, values.front());
+    }
+    if(!this->isActive()) {
+        return false;
+    }
+
+    BatchPutRpc data;
+    data.puts_.reserve(values.size());
+    for(auto &v : values) {
+        data.puts_.push_back(PutRpc{key, v});
+    }
+    auto serialized = Serializer::toBinary(data);
+    auto res = client_ -> Post("/replication/batch", serialized, "application/octet-stream");
+
+    if(res) {
+        return res->status == httplib::StatusCode::OK_200;
+    } else {
+        return false;
+    }
+}
+
+bool Node::replicateBatch(const std::vector<PutRpc>& puts) {
+    if(!this->isActive()) {
+        return false;
+    }
+
+    BatchPutRpc data{puts};
+    auto serialized = Serializer::toBinary(data);
+    auto res = bulk_client_ -> Post("/replication/batch", serialized, "application/octet-stream");
+
+    if(res) {
+        return res->status == httplib::StatusCode::OK_200;
+    } else {
+        return false;
+    }
+}
+
 bool Node::replicateHandoff(const std::string& key, const Value& value, const std::string& node_id) {
     Logger::instance().debug("Hinted handoff for key: " + key + " to node " + getId());
 
@@ -85,11 +128,35 @@ std::optional<ValueList> Node::replicateGet(const std::string& key) {
         {"Content-Type", "application/octet-stream"}
     };
     auto res = client_ -> Post("/replication/get", key, "application/octet-stream");
-    if(res) {
-        return Serializer::fromBinary<ValueList>(res->body);
-    } else {
+    // a replica shedding load answers 429 or 503 with a text body, that's no answer
+    if(!res || res->status != httplib::StatusCode::OK_200) {
         return std::nullopt;
     }
+    return Serializer::fromBinary<ValueList>(res->body);
+}
+
+std::optional<std::vector<ValueList>> Node::replicateGetMany(const std::vector<std::string>& keys) {
+    if(!this->isActive()) {
+        return std::nullopt;
+    }
+
+    BatchGetRpc data{keys};
+    auto serialized = Serializer::toBinary(data);
+    auto res = bulk_client_ -> Post("/replication/mget", serialized, "application/octet-stream");
+    if(!res || res->status != httplib::StatusCode::OK_200) {
+        return std::nullopt;
+    }
+
+    auto stored = Serializer::fromBinary<std::vector<ByteString>>(res->body);
+    if(stored.size() != keys.size()) {
+        return std::nullopt;
+    }
+    std::vector<ValueList> values;
+    values.reserve(stored.size());
+    for(auto &bytes : stored) {
+        values.push_back(Serializer::fromBinary<ValueList>(bytes));
+    }
+    return values;
 }
 
 std::string Node::getFullAddress() {
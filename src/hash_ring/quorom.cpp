@@ -3,16 +3,18 @@
 #include "logging/logger.h"
 #include "storage/value.h"
 #include "error/quorom_error.h"
+#include <algorithm>
 #include <future>
 #include <thread>
 #include <atomic>
 #include <mutex>
+#include <unordered_map>
 
-ValueList Quorom::get(const std::string& key) {
+QuoromResult<ValueList> Quorom::get(const std::string& key) {
     auto nodes = ring_->getNextNodes(key, N_ * 2);
 
     if(nodes.size() < N_) {
-        throw QuoromError("Replica size larger than current cluster size!");
+        return std::unexpected(QuoromFailure{QuoromCode::TOO_FEW_NODES, "Replica size larger than current cluster size!"});
     }
 
     ValueList values;
@@ -22,11 +24,15 @@ ValueList Quorom::get(const std::string& key) {
     std::mutex m;
 
     std::vector<std::future<void>> futures;
+    // a replica that fails is stood in for by the next node past the first N, this node
+    // can be anywhere among the first N so it isn't counted by position
+    int next_spare = N_;
 
     for(int i = 0; i < N_; i++) {
 
         std::shared_ptr<Node> node = nodes.at(i);
         if (node->getId() == curr_node_->getId()) continue;
+        int idx = next_spare++;
 
         auto f = [&](std::shared_ptr<Node> node){
             std::optional<ValueList> result = node->replicateGet(key);
@@ -46,10 +52,10 @@ ValueList Quorom::get(const std::string& key) {
             return result.has_value();
         };
 
+        // f is per iteration, the task has to own its copy
         futures.push_back(std::async(std::launch::async,
-            [&, i, node] {
+            [&, f, idx, node] {
                 bool success = f(node);
-                int idx = N_ + i - 1;
                 if(!success && idx < nodes.size()) {
                     std::shared_ptr<Node> next_node = nodes.at(idx);
                     f(next_node);
@@ -67,22 +73,30 @@ ValueList Quorom::get(const std::string& key) {
     }
 
     if (received.load() < R_ - 1) {
-        throw std::runtime_error("Not enough read responses");
+        return std::unexpected(QuoromFailure{QuoromCode::NOT_ENOUGH_RESPONSES, "Not enough read responses"});
     }
 
-    return values;
+    // stragglers still append under m until the futures are joined on the way out
+    std::lock_guard lk(m);
+    return std::move(values);
 }
 
 
-bool Quorom::put(const std::string& key, const Value& value) {
+QuoromResult<void> Quorom::put(const std::string& key, const Value& value) {
+        return put(key, ValueList{value});
+}
+
+QuoromResult<void> Quorom::put(const std::string& key, const ValueList& values) {
         auto preference_list = ring_->getNextNodes(key, N_ * 2);
 
         if(preference_list.size() < N_) {
-            throw QuoromError("Replica size larger than current cluster size!");
+            return std::unexpected(QuoromFailure{QuoromCode::TOO_FEW_NODES, "Replica size larger than current cluster size!"});
         }
 
         std::atomic<int> received{0};
         std::vector<std::future<void>> futures;
+        // same stand in order as get
+        int next_spare = N_;
 
         // this may need to be rewritten
         // this does not seem like it works well
@@ -93,13 +107,16 @@ bool Quorom::put(const std::string& key, const Value& value) {
             if(node->getId() == curr_node_->getId()) {
                 continue;
             }
+            int idx = next_spare++;
 
             auto f = [&](std::shared_ptr<Node> node, bool handoff=false, const std::string node_id = ""){
-                bool success;
+                bool success = true;
                 if(handoff) {
-                    success = node->replicateHandoff(key, value, node_id);
+                    for(auto &value : values) {
+                        success = node->replicateHandoff(key, value, node_id) && success;
+                    }
                 } else {
-                    success = node->replicatePut(key, value);
+                    success = node->replicatePut(key, values);
                 }
 
                 if (success) {
@@ -112,10 +129,8 @@ bool Quorom::put(const std::string& key, const Value& value) {
                 return success;
             };
 
-            futures.push_back(std::async(std::launch::async, [&, node, i] {
+            futures.push_back(std::async(std::launch::async, [&, f, node, idx] {
                 bool success = f(node);
-                // -1 necesscary ?
-                int idx = N_ + i - 1;
                 if(!success && idx < preference_list.size()) {
                     std::shared_ptr<Node> next_node = preference_list.at(idx);
                     f(next_node, true, node->getId());
@@ -133,10 +148,217 @@ bool Quorom::put(const std::string& key, const Value& value) {
         }
 
         if (received.load() < W_ - 1) {
-            throw std::runtime_error("Not enough responses for put requet");
+            return std::unexpected(QuoromFailure{QuoromCode::NOT_ENOUGH_RESPONSES, "Not enough responses for put requet"});
+        }
+
+        return {};
+}
+
+// send returns whether the node answered
+template <typename Send>
+std::vector<Quorom::NodeBatch> Quorom::runBatches(std::vector<NodeBatch> batches, Send send) {
+    std::vector<std::future<bool>> futures;
+    futures.reserve(batches.size());
+    for(auto &batch : batches) {
+        futures.push_back(std::async(std::launch::async, [&send, &batch] {
+            return send(batch);
+        }));
+    }
+
+    std::vector<NodeBatch> failed;
+    for(size_t i = 0; i < batches.size(); i++) {
+        if(!futures[i].get()) {
+            failed.push_back(std::move(batches[i]));
+        }
+    }
+    return failed;
+}
+
+bool Quorom::isReplica(const std::string& key) {
+    auto nodes = ring_->getNextNodes(key, N_);
+    return std::any_of(nodes.begin(), nodes.end(), [this](const std::shared_ptr<Node>& node) {
+        return node->getId() == curr_node_->getId();
+    });
+}
+
+std::vector<Quorom::Placement> Quorom::place(const std::vector<std::string>& keys) {
+    std::vector<Placement> placements(keys.size());
+    for(size_t i = 0; i < keys.size(); i++) {
+        auto nodes = ring_->getNextNodes(keys[i], N_ * 2);
+        Placement& p = placements[i];
+        if(nodes.size() < N_) {
+            continue;
+        }
+        p.enough_nodes_ = true;
+        for(size_t j = 0; j < nodes.size(); j++) {
+            if(j >= N_) {
+                p.spares_.push_back(nodes[j]);
+            } else if(nodes[j]->getId() == curr_node_->getId()) {
+                p.local_ = true;
+            } else {
+                p.replicas_.push_back(nodes[j]);
+            }
+        }
+    }
+    return placements;
+}
+
+std::vector<Quorom::NodeBatch> Quorom::replicaBatches(const std::vector<Placement>& placements) {
+    std::vector<NodeBatch> batches;
+    std::unordered_map<std::string, size_t> index;
+    for(size_t i = 0; i < placements.size(); i++) {
+        for(auto &node : placements[i].replicas_) {
+            auto [it, added] = index.try_emplace(node->getId(), batches.size());
+            if(added) {
+                batches.push_back(NodeBatch{node, "", {}});
+            }
+            batches[it->second].keys_.push_back(i);
+        }
+    }
+    return batches;
+}
+
+std::vector<Quorom::NodeBatch> Quorom::spareBatches(const std::vector<Placement>& placements, const std::vector<NodeBatch>& failed) {
+    std::vector<NodeBatch> batches;
+    // by spare and the replica it stands in for, a hint names exactly one target
+    std::unordered_map<std::string, size_t> index;
+    for(auto &batch : failed) {
+        for(size_t i : batch.keys_) {
+            const Placement& p = placements[i];
+            size_t pos = std::find(p.replicas_.begin(), p.replicas_.end(), batch.node_) - p.replicas_.begin();
+            if(pos >= p.spares_.size()) {
+                continue;
+            }
+            auto& spare = p.spares_[pos];
+            auto [it, added] = index.try_emplace(spare->getId() + "/" + batch.node_->getId(), batches.size());
+            if(added) {
+                batches.push_back(NodeBatch{spare, batch.node_->getId(), {}});
+            }
+            batches[it->second].keys_.push_back(i);
         }
+    }
+    return batches;
+}
 
-        return received >= W_ - 1;
+// unlike get and put this waits for every node rather than polling towards a deadline,
+// each batch is bounded by the node's bulk timeouts instead
+std::vector<QuoromResult<ValueList>> Quorom::getMany(const std::vector<std::string>& keys) {
+    auto placements = place(keys);
+    std::vector<ValueList> values(keys.size());
+    std::vector<int> received(keys.size(), 0);
+    std::mutex m;
+
+    auto fetch = [&](const NodeBatch& batch) {
+        std::vector<std::string> batch_keys;
+        batch_keys.reserve(batch.keys_.size());
+        for(size_t i : batch.keys_) {
+            batch_keys.push_back(keys[i]);
+        }
+
+        auto result = batch.node_->replicateGetMany(batch_keys);
+        if(!result) {
+            err_detector_->markError(batch.node_->getId());
+            Logger::instance().error("Batched get of " + std::to_string(batch_keys.size()) + " keys to node " + batch.node_->getId() + " failed!");
+            return false;
+        }
+        err_detector_->markSuccess(batch.node_->getId());
+
+        std::lock_guard lk(m);
+        for(size_t j = 0; j < batch.keys_.size(); j++) {
+            size_t i = batch.keys_[j];
+            received[i]++;
+            for(auto &v : (*result)[j]) {
+                values[i].push_back(std::move(v));
+            }
+        }
+        return true;
+    };
+
+    auto failed = runBatches(replicaBatches(placements), fetch);
+    runBatches(spareBatches(placements, failed), fetch);
+
+    std::vector<QuoromResult<ValueList>> results;
+    results.reserve(keys.size());
+    for(size_t i = 0; i < keys.size(); i++) {
+        const Placement& p = placements[i];
+        if(!p.enough_nodes_) {
+            results.push_back(std::unexpected(QuoromFailure{QuoromCode::TOO_FEW_NODES, "Replica size larger than current cluster size!"}));
+        } else if(received[i] < R_ - p.local_) {
+            results.push_back(std::unexpected(QuoromFailure{QuoromCode::NOT_ENOUGH_RESPONSES, "Not enough read responses"}));
+        } else {
+            results.push_back(std::move(values[i]));
+        }
+    }
+    return results;
+}
+
+// replicas get their keys as one /replication/batch, a replica that fails it has its
+// keys handed off to the spares one hint at a time like put does
+std::vector<QuoromResult<void>> Quorom::putMany(const std::vector<PutRpc>& puts) {
+    std::vector<std::string> keys;
+    keys.reserve(puts.size());
+    for(auto &put : puts) {
+        keys.push_back(put.key_);
+    }
+    auto placements = place(keys);
+    std::vector<int> received(puts.size(), 0);
+    std::mutex m;
+
+    auto replicate = [&](const NodeBatch& batch) {
+        std::vector<PutRpc> batch_puts;
+        batch_puts.reserve(batch.keys_.size());
+        for(size_t i : batch.keys_) {
+            batch_puts.push_back(puts[i]);
+        }
+
+        if(!batch.node_->replicateBatch(batch_puts)) {
+            err_detector_->markError(batch.node_->getId());
+            Logger::instance().error("Batched put of " + std::to_string(batch_puts.size()) + " keys to node " + batch.node_->getId() + " failed!");
+            return false;
+        }
+        err_detector_->markSuccess(batch.node_->getId());
+
+        std::lock_guard lk(m);
+        for(size_t i : batch.keys_) {
+            received[i]++;
+        }
+        return true;
+    };
+
+    auto handoff = [&](const NodeBatch& batch) {
+        bool all = true;
+        for(size_t i : batch.keys_) {
+            if(!batch.node_->replicateHandoff(puts[i].key_, puts[i].data_, batch.hint_for_)) {
+                all = false;
+                continue;
+            }
+            std::lock_guard lk(m);
+            received[i]++;
+        }
+        if(all) {
+            err_detector_->markSuccess(batch.node_->getId());
+        } else {
+            err_detector_->markError(batch.node_->getId());
+        }
+        return all;
+    };
+
+    auto failed = runBatches(replicaBatches(placements), replicate);
+    runBatches(spareBatches(placements, failed), handoff);
+
+    std::vector<QuoromResult<void>> results;
+    results.reserve(puts.size());
+    for(size_t i = 0; i < puts.size(); i++) {
+        const Placement& p = placements[i];
+        if(!p.enough_nodes_) {
+            results.push_back(std::unexpected(QuoromFailure{QuoromCode::TOO_FEW_NODES, "Replica size larger than current cluster size!"}));
+        } else if(received[i] < W_ - p.local_) {
+            results.push_back(std::unexpected(QuoromFailure{QuoromCode::NOT_ENOUGH_RESPONSES, "Not enough responses for put request"}));
+        } else {
+            results.push_back({});
+        }
+    }
+    return results;
 }
 
 int Quorom::getN() {
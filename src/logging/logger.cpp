@@ -26,7 +26,10 @@ std::string Logger::timestamp() {
     auto ms = duration_cast<milliseconds>(now.time_since_epoch()) % 1000;
     std::time_t t = system_clock::to_time_t(now);
     char buf[32];
-    std::strftime(buf, sizeof(buf), "%H:%M:%S", std::localtime(&t));
+    // localtime shares a static buffer between threads
+    std::tm tm{};
+    localtime_r(&t, &tm);
+    std::strftime(buf, sizeof(buf), "%H:%M:%S", &tm);
     char out[64];
     std::snprintf(out, sizeof(out), "%s.%03lld", buf, (long long)ms.count());
     return out;
@@ -3,7 +3,10 @@
 #include "hash_ring/hash_ring.h"
 #include "hash_ring/quorom.h"
 #include "membership/gossip.h"
+#include "storage/concurrent_memory_engine.h"
 #include "storage/disk_engine.h"
+#include "storage/hybrid_hint_engine.h"
+#include "storage/tiered_engine.h"
 #include "server/server.h"
 #include <CLI/CLI.hpp>
 #include <memory>
@@ -18,11 +21,29 @@ void on_sigint(int) {
 }
 
 int main(int argc, char* argv[]) {
+    auto process_start = std::chrono::steady_clock::now();
 
     CLI::App app{"Dynamo"};
 
     int port = 8080;
     int tokens = 1000;
+    int gossip_interval_ms = 1000;
+    size_t hint_memory_mb = 64;
+    size_t cache_mb = 0;
+    size_t value_cache_mb = 32;
+    std::string sync_policy = "none";
+    int sync_interval_ms = 100;
+    std::string leveldb_profile = "balanced";
+    size_t block_cache_mb = 0;
+    int bloom_bits = 0;
+    size_t write_buffer_mb = 0;
+    size_t max_file_mb = 0;
+    std::string compression = "snappy";
+    int stall_threshold_ms = 50;
+    AdmissionOptions admission;
+    int combine_window_us = 0;
+    std::string routing_mode = "proxy";
+    std::string membership_mode = "gossip";
     std::string address = "localhost";
     std::vector<std::string> bootstrap_servers_raw{};
 
@@ -30,6 +51,29 @@ int main(int argc, char* argv[]) {
     app.add_option("-a,--address", address, "Address to bind to");
     app.add_option("-b,--bootstrap-servers", bootstrap_servers_raw, "List of bootstrap servers (addr:port)");
     app.add_option("-t,--tokens", tokens, "Number of tokens to allocate for node");
+    app.add_option("--gossip-interval-ms", gossip_interval_ms, "Milliseconds between gossip rounds");
+    app.add_option("--cache-mb", cache_mb, "Size of the in memory tier in front of leveldb, 0 to disable");
+    app.add_option("--value-cache-mb", value_cache_mb, "Decoded value cache size, 0 to disable");
+    app.add_option("--sync", sync_policy, "When leveldb writes are fsynced: never, every group commit, or on an interval")
+        ->check(CLI::IsMember({"none", "batch", "interval"}));
+    app.add_option("--sync-interval-ms", sync_interval_ms, "Milliseconds between fsyncs with --sync interval");
+    app.add_option("--leveldb-profile", leveldb_profile, "Leveldb tuning preset, the flags below override single settings")
+        ->check(CLI::IsMember({"default", "balanced", "read-heavy", "write-heavy"}));
+    auto block_cache_opt = app.add_option("--block-cache-mb", block_cache_mb, "Leveldb block cache size");
+    auto bloom_bits_opt = app.add_option("--bloom-bits", bloom_bits, "Leveldb bloom filter bits per key, 0 to disable");
+    auto write_buffer_opt = app.add_option("--write-buffer-mb", write_buffer_mb, "Leveldb memtable size");
+    auto max_file_opt = app.add_option("--max-file-mb", max_file_mb, "Leveldb table file size");
+    auto compression_opt = app.add_option("--compression", compression, "Leveldb block compression")
+        ->check(CLI::IsMember({"none", "snappy"}));
+    app.add_option("--stall-threshold-ms", stall_threshold_ms, "Group commits slower than this count as a write stall");
+    app.add_option("--client-inflight", admission.client_inflight_, "Concurrent client requests before answering 429");
+    app.add_option("--replication-inflight", admission.replication_inflight_, "Concurrent replication requests before answering 429");
+    app.add_option("--combine-window-us", combine_window_us, "How long a lone put waits for concurrent puts to the same key to combine with");
+    app.add_option("--routing", routing_mode, "Requests for keys this node doesn't hold: redirect the client, or proxy to a replica")
+        ->check(CLI::IsMember({"redirect", "proxy"}));
+    app.add_option("--hint-memory-mb", hint_memory_mb, "Hinted handoff backlog kept in memory before spilling to disk");
+    app.add_option("--membership", membership_mode, "Membership protocol, http gossip or swim over udp")
+        ->check(CLI::IsMember({"gossip", "swim"}));
 
     CLI11_PARSE(app, argc, argv);
 
@@ -52,30 +96,83 @@ int main(int argc, char* argv[]) {
     auto ring = std::make_shared<HashRing>();
     auto err_detector = std::make_shared<ErrorDetector>(ring, 3);
     auto quorom = std::make_shared<Quorom>(2, 2, 2, parent, ring, err_detector);
-    auto gossip = std::make_shared<Gossip>(ring, 2, parent, bootstrap_servers, err_detector);
-    auto db = std::make_shared<DiskEngine>(std::to_string(port), "");
+    auto gossip = std::make_shared<Gossip>(
+        ring, 2, parent, bootstrap_servers, err_detector, std::chrono::milliseconds(gossip_interval_ms)
+    );
+    if(membership_mode == "swim") {
+        gossip->setSwim(std::make_shared<Swim>(gossip->getMembership(), parent));
+    }
 
-    auto handoff_db = std::make_shared<DiskEngine>(std::to_string(port), "-handoff");
-    auto handoff = std::make_shared<Handoff>(handoff_db, ring);
+    DiskEngineOptions db_options;
+    db_options.applyProfile(leveldb_profile);
+    if(block_cache_opt->count()) db_options.block_cache_bytes_ = block_cache_mb << 20;
+    if(bloom_bits_opt->count()) db_options.bloom_bits_per_key_ = bloom_bits;
+    if(write_buffer_opt->count()) db_options.write_buffer_bytes_ = write_buffer_mb << 20;
+    if(max_file_opt->count()) db_options.max_file_bytes_ = max_file_mb << 20;
+    if(compression_opt->count()) db_options.compression_ = compression == "snappy";
+    db_options.stall_threshold_ = std::chrono::milliseconds(stall_threshold_ms);
+    db_options.commit_.sync_ = syncPolicyFromStr(sync_policy);
+    db_options.commit_.sync_interval_ = std::chrono::milliseconds(sync_interval_ms);
+    auto db = std::make_shared<DiskEngine>(std::to_string(port), "", db_options);
 
-    Server service{db, ring, quorom, gossip, handoff};
+    auto handoff_db = std::make_shared<DiskEngine>(std::to_string(port), "-handoff");
+    auto hint_store = std::make_shared<HybridHintEngine>(
+        "/tmp/dynamo" + std::to_string(port) + "-handoff.log", handoff_db, hint_memory_mb << 20
+    );
+    auto handoff = std::make_shared<Handoff<HybridHintEngine>>(hint_store, ring);
 
-    std::thread killer([&] {
-        while (!stop.load(std::memory_order_relaxed)) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    // drain hints as soon as a target is seen coming back instead of waiting on the sweep
+    err_detector->onRecovered([handoff](const std::string& id) {
+        handoff->notifyRecovered(id);
+    });
+    gossip->getMembership()->subscribe([handoff](const NodeState& state) {
+        if(state.status_ == NodeState::ACTIVE) {
+            handoff->notifyRecovered(state.id_);
         }
-        service.stop();
-        gossip->stop();
-        handoff->stop();
     });
 
-    std::signal(SIGINT, on_sigint);
+    // the engine type is a template parameter of Server, so everything from here on
+    // is written once and instantiated per engine
+    auto serve = [&](auto engine) {
+        WriteCombinerOptions combiner{std::chrono::microseconds(combine_window_us)};
+        RoutingOptions routing;
+        routing.mode_ = routingModeFromStr(routing_mode);
+        Server service{engine, ring, quorom, gossip, handoff, value_cache_mb << 20, admission, combiner, routing};
+
+        std::thread killer([&] {
+            while (!stop.load(std::memory_order_relaxed)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+            service.stop();
+            gossip->stop();
+            handoff->stop();
+        });
+
+        std::signal(SIGINT, on_sigint);
 
-    gossip->start();
-    err_detector->start();
-    handoff->start();
-    service.start("0.0.0.0", port);
+        gossip->start();
+        err_detector->start();
+        handoff->start();
+
+        // interrupted while still joining
+        if(!stop.load(std::memory_order_relaxed)) {
+            auto startup_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - process_start
+            ).count();
+            Logger::instance().info("Ring warm, serving after " + std::to_string(startup_ms) + "ms");
+            service.start("0.0.0.0", port);
+        }
+
+        killer.join();
+    };
+
+    if(cache_mb > 0) {
+        Logger::instance().info("Serving through a " + std::to_string(cache_mb) + "MB memory tier");
+        auto hot = std::make_shared<ConcurrentMemoryEngine>(0, cache_mb << 20);
+        serve(std::make_shared<TieredEngine<ConcurrentMemoryEngine, DiskEngine>>(hot, db));
+    } else {
+        serve(db);
+    }
 
-    killer.join();
     return 0;
 }
\ No newline at end of file
@@ -1,24 +1,125 @@
 #include "membership/gossip.h"
 #include <algorithm>
 #include <memory>
+#include <numeric>
 #include <random>
 #include <stdexcept>
 #include <string>
 #include <thread>
 #include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <optional>
 #include <vector>
 #include "hash_ring/node.h"
 #include "storage/serializer.h"
 #include "logging/logger.h"
+#include <httplib.h>
+
+const std::chrono::milliseconds JOIN_BACKOFF_BASE{50};
+const std::chrono::milliseconds JOIN_BACKOFF_CAP{2000};
+// with a restored snapshot we can route on our own, so don't wait forever on peers
+const std::chrono::milliseconds RESTORED_JOIN_TIMEOUT{3000};
+const std::chrono::seconds SNAPSHOT_INTERVAL{5};
+// after a membership change it rides along for this many rounds
+const int MEMBERSHIP_PUSH_ROUNDS = 3;
+// and every this many rounds regardless, as anti entropy
+const uint64_t FULL_STATE_ROUNDS = 10;
+// a live node refreshes its vitals every round, anything this old is from a node that
+// stopped talking. generous so clock skew between nodes doesn't drop live entries
+const std::chrono::milliseconds VITALS_TTL{60000};
+
+namespace {
+
+uint64_t wallMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+}
+
+// vitals are only kept for nodes still in the cluster
+VitalsTable::MemberFn memberOf(std::shared_ptr<const MembershipSnapshot> snapshot) {
+    return [snapshot = std::move(snapshot)](const std::string& id) {
+        auto it = snapshot->nodes_.find(id);
+        return it != snapshot->nodes_.end() && it->second.status_ != NodeState::Status::KILLED;
+    };
+}
+
+}  // namespace
+
+void Gossip::restore() {
+    const std::string self = curr_node_->getId();
+    uint64_t incarnation = 1;
+
+    auto persisted = store_.load();
+    if(persisted && persisted->self_id_ == self) {
+        auto it = persisted->nodes_.find(self);
+        if(it != persisted->nodes_.end()) {
+            incarnation = it->second.incarnation_;
+        }
+
+        // peers go straight onto the ring, live gossip corrects anything that changed while we were down
+        ClusterState peers = persisted->nodes_;
+        peers.erase(self);
+        membership_->merge(peers);
+        restored_ = !peers.empty();
+
+        Logger::instance().info(
+            "Restored " + std::to_string(peers.size()) + " peers from membership snapshot: " + store_.path()
+        );
+    } else {
+        // nodes from before snapshots only wrote their incarnation number
+        std::string path{
+            "/tmp/" + curr_node_->getAddr() + ":" + std::to_string(curr_node_->getPort()) + "-gossip"
+        };
+
+        std::ifstream in(path);
+        if (in && !(in >> incarnation)) {
+            incarnation = 1;
+            Logger::instance().debug("Could not read gossip number from path: " + path + ". settning default instead");
+        }
+    }
+
+    Logger::instance().info("gossip number: " + std::to_string(incarnation));
+
+    NodeState initial{
+        self,
+        curr_node_->getAddr(),
+        curr_node_->getPort(),
+        NodeState::Status::ACTIVE,
+        incarnation + 1,
+        curr_node_->getTokens()
+    };
+    membership_->merge({{initial.id_, initial}});
+}
+
+void Gossip::persist() {
+    auto snapshot = membership_->snapshot();
+    if(store_.save(*snapshot, curr_node_->getId())) {
+        persisted_version_ = snapshot->version_;
+        Logger::instance().debug("Persisted membership snapshot version: " + std::to_string(snapshot->version_));
+    }
+}
 
 void Gossip::transmitRandom(std::mt19937 &gen) {
     std::uniform_real_distribution<float> dist(0.0f, 1.0f); 
+
+    if(vitals_provider_) {
+        NodeVitals own = vitals_provider_();
+        own.version_ = wallMs();
+        vitals_.set(curr_node_->getId(), own);
+    }
+
     auto nodes = this->ring_->getNodes();
+    auto snapshot = membership_->snapshot();
+    vitals_.prune(memberOf(snapshot), wallMs(), VITALS_TTL.count());
 
     nodes.erase(
         std::remove_if(
             nodes.begin(), nodes.end(), [&](auto &n) {
-                return state_[n -> getId()].status_ == NodeState::Status::KILLED ||
+                auto it = snapshot->nodes_.find(n -> getId());
+                return (it != snapshot->nodes_.end() && it->second.status_ == NodeState::Status::KILLED) ||
                        n -> getId() == curr_node_ -> getId() ||
                        !(n -> isActive());
             }
@@ -34,12 +135,25 @@ void Gossip::transmitRandom(std::mt19937 &gen) {
     std::iota(pool.begin(), pool.end(), 0);
 
     std::shuffle(pool.begin(), pool.end(), gen);
-    std::vector<int> selected(pool.begin(), pool.begin() + fanout_);
+    size_t fanout = std::min(pool.size(), static_cast<size_t>(fanout_));
+    std::vector<int> selected(pool.begin(), pool.begin() + fanout);
 
     float r = dist(gen);
 
+    if(snapshot->version_ != sent_version_) {
+        sent_version_ = snapshot->version_;
+        membership_rounds_left_ = MEMBERSHIP_PUSH_ROUNDS;
+    }
+
+    // with swim membership travels over udp, only vitals go over http
+    GossipMessage message{std::nullopt, vitals_.getAll()};
+    if(!swim_ && (membership_rounds_left_ > 0 || rounds_ % FULL_STATE_ROUNDS == 0)) {
+        message.membership_ = snapshot->nodes_;
+        membership_rounds_left_ = std::max(0, membership_rounds_left_ - 1);
+    }
+    rounds_++;
 
-    ByteString serialized = Serializer::toBinary<ClusterState>(state_);
+    ByteString serialized = Serializer::toBinary(message);
     for(auto idx : selected) {
         std::shared_ptr<Node> other = nodes.at(idx);
         if(other->getId() == curr_node_->getId()) {
@@ -55,6 +169,9 @@ void Gossip::transmitRandom(std::mt19937 &gen) {
     // randomly send with low probability to seed server
     // this may be bad but fixes a scenario in which one one is killed then restarted
     if(r < 0.05) {
+        // seeds always get the full state, that is the point of sending to them
+        message.membership_ = snapshot->nodes_;
+        serialized = Serializer::toBinary(message);
         for(auto &[ip, port] : bootstrap_servers_) {
             // we are setting tokens to one, but does not matter since we only use this node as a handle
             Node node{ip, port, 1};
@@ -63,21 +180,137 @@ void Gossip::transmitRandom(std::mt19937 &gen) {
     }
 }
 
+// contacts every bootstrap server in parallel, each one retrying with exponential backoff
+// and jitter so a cluster brought up all at once doesn't hammer the seeds.
+// the first server to answer hands back its whole cluster state, and since the ring is a
+// pure function of (node id, tokens) merging it warms the ring in the same step
+bool Gossip::join(std::optional<std::chrono::steady_clock::time_point> deadline) {
+    // restored peers are just as good a way in as the bootstrap servers
+    std::vector<std::pair<std::string, int>> candidates = bootstrap_servers_;
+    for(auto &[id, state] : getState()) {
+        if(id == curr_node_->getId() || state.status_ != NodeState::Status::ACTIVE) continue;
+
+        bool known = std::any_of(candidates.begin(), candidates.end(), [&](auto &c) {
+            return c.first == state.address_ && c.second == state.port_;
+        });
+        if(!known) {
+            candidates.emplace_back(state.address_, state.port_);
+        }
+    }
+
+    if(candidates.empty()) {
+        return true;
+    }
+
+    struct JoinState {
+        std::mutex mu;
+        std::condition_variable cv;
+        bool done = false;
+        std::optional<ClusterState> state;
+        std::string from;
+    };
+
+    auto js = std::make_shared<JoinState>();
+    ByteString serialized = Serializer::toBinary<ClusterState>(getState());
+
+    std::vector<std::thread> workers;
+    for(auto &[ip, port] : candidates) {
+        std::string host = ip;
+        int host_port = port;
+
+        workers.emplace_back([this, js, serialized, host, host_port] {
+            httplib::Client client(host, host_port);
+            client.set_connection_timeout(std::chrono::milliseconds(200));
+            client.set_read_timeout(std::chrono::seconds(1));
+            client.set_write_timeout(std::chrono::seconds(1));
+
+            std::mt19937 gen(std::random_device{}());
+            auto backoff = JOIN_BACKOFF_BASE;
+            std::string addr = host + ":" + std::to_string(host_port);
+
+            while(running) {
+                auto res = client.Post("/admin/join", serialized, "application/octet-stream");
+                if(res && res->status == httplib::StatusCode::OK_200) {
+                    try {
+                        auto state = Serializer::fromBinary<ClusterState>(res->body);
+                        std::lock_guard<std::mutex> lk(js->mu);
+                        if(!js->done) {
+                            js->done = true;
+                            js->state = std::move(state);
+                            js->from = addr;
+                        }
+                        js->cv.notify_all();
+                        return;
+                    } catch(const cereal::Exception& e) {
+                        Logger::instance().error("Malformed join response from: " + addr + ". " + e.what());
+                    }
+                }
+
+                // equal jitter: wait between half and all of the current backoff
+                std::uniform_int_distribution<long> jitter(backoff.count() / 2, backoff.count());
+                auto wait = std::chrono::milliseconds(jitter(gen));
+                Logger::instance().debug("Join through " + addr + " failed, retrying in " + std::to_string(wait.count()) + "ms");
+
+                std::unique_lock<std::mutex> lk(js->mu);
+                if(js->cv.wait_for(lk, wait, [&] { return js->done; })) {
+                    return;
+                }
+                backoff = std::min(backoff * 2, JOIN_BACKOFF_CAP);
+            }
+        });
+    }
+
+    {
+        // poll so a shutdown during join is noticed too
+        std::unique_lock<std::mutex> lk(js->mu);
+        while(!js->done && running && (!deadline || std::chrono::steady_clock::now() < *deadline)) {
+            js->cv.wait_for(lk, std::chrono::milliseconds(100));
+        }
+        js->done = true;
+    }
+    js->cv.notify_all();
+
+    for(auto &w : workers) {
+        w.join();
+    }
+
+    if(!js->state) {
+        return false;
+    }
+
+    membership_->merge(*js->state);
+    Logger::instance().info("Joined cluster through: " + js->from);
+    return true;
+}
+
 void Gossip::start() {
     if (t_.joinable()) return;
     running = true;
 
-    // bootstrap first before starting thread
-    ByteString serialized = Serializer::toBinary<ClusterState>(state_);
+    // bootstrap first before starting thread, so the ring is warm before we serve
+    auto join_start = std::chrono::steady_clock::now();
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+    if(restored_) {
+        deadline = join_start + RESTORED_JOIN_TIMEOUT;
+    }
 
-    // fire requests to bootstrap nodes until one is good
-    // can maybe be more robust
-    bool success = false;
-    while(!success && bootstrap_servers_.size() > 0) {
-        for(auto &[ip, port] : bootstrap_servers_) {
-            Node node{ip, port, 1};
-            success = success | node.send("/admin/gossip", serialized);
+    if(!join(deadline)) {
+        if(!running) {
+            Logger::instance().warn("Stopped before joining the cluster");
+            return;
         }
+        Logger::instance().warn("Could not reach any peer, serving from the restored membership snapshot");
+    }
+    auto join_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - join_start
+    ).count();
+    Logger::instance().info(
+        "Cluster join finished in " + std::to_string(join_ms) + "ms with " +
+        std::to_string(getState().size()) + " known members"
+    );
+
+    if(swim_) {
+        swim_->start();
     }
 
     t_ = std::thread([this]() {
@@ -86,68 +319,56 @@ void Gossip::start() {
 
         while (running) {
             transmitRandom(gen);
-            std::this_thread::sleep_for(std::chrono::seconds(1));
+
+            auto now = std::chrono::steady_clock::now();
+            if(now - last_persist_ >= SNAPSHOT_INTERVAL && membership_->version() != persisted_version_) {
+                persist();
+                last_persist_ = now;
+            }
+
+            std::this_thread::sleep_for(interval_);
         }
     });
     Logger::instance().info("starting gossip background process...");
 }
 
 
-// theres an edge case where number of tokens is changed and is not synchronized
-// should not happen though unless there is a shutdown, which will mean our changes are reflected
-void Gossip::onRecieve(std::unordered_map<std::string, NodeState> &other_state) {
-    for(auto &[k, v] : other_state) {
-        auto it = state_.find(k);
-        if(it == state_.end()) {
-            addState(v);
-        }  else if(v.incarnation_ > state_[k].incarnation_) {
-            // we do a kill here
-            if(v.status_ == NodeState::Status::KILLED && state_[k].status_ == NodeState::Status::ACTIVE) {
-                Logger::instance().debug("Recieved node shutdown for: " + v.id_);
-                ring_ -> removeNode(v.id_);
-            } else if (v.status_ == NodeState::Status::ACTIVE && state_[k].status_ == NodeState::Status::KILLED) {
-                // we have to make the new node and re-insert it again
-                std::shared_ptr<Node> new_node = std::make_shared<Node>(
-                    v.address_, v.port_, v.tokens_
-                );
-
-                ring_->addNode(new_node);
-            }
-            state_[k] = v;
-        }
+// safe to call concurrently from the http worker pool, merging is lock free
+void Gossip::onRecieve(const GossipMessage &message) {
+    if(message.membership_) {
+        membership_->merge(*message.membership_);
     }
+    vitals_.merge(message.vitals_, memberOf(membership_->snapshot()));
 }
 
-void Gossip::addState(NodeState state) {
-    Logger::instance().debug("Discovered new node: " + state.id_);
-
-    state_[state.id_] = state;
-    
-    std::shared_ptr<Node> new_node = std::make_shared<Node>(
-        state.address_, state.port_, state.tokens_
-    );
-
-    ring_->addNode(new_node);
+ClusterState Gossip::onJoin(const ClusterState &joiner_state) {
+    membership_->merge(joiner_state);
+    return getState();
 }
 
-// there is a race condition here but i don think it matters right now
-// TODO: FIX
 void Gossip::stop() {
     Logger::instance().info("Changing node status and killing gossip...");
+
+    // stop the background loop first so it cannot gossip us as alive after the kill
+    running = false;
+    if (t_.joinable()) t_.join();
+
     std::string node_id = curr_node_->getId();
-    state_[node_id].incarnation_ += 1;
-    state_[node_id].status_ = NodeState::KILLED;
+    membership_->update(node_id, [](NodeState &s) {
+        s.incarnation_ += 1;
+        s.status_ = NodeState::KILLED;
+    });
+
+    // the kill is queued for piggybacking by the membership listener, stop() flushes it
+    if(swim_) {
+        swim_->stop();
+    }
 
     std::random_device rd;
     std::mt19937 gen(rd());  
     Logger::instance().info("Sending out kill requests over gossip...");
     transmitRandom(gen);
 
-    Logger::instance().info("Writing gossip number to disk...");
-    std::string path{
-        "/tmp/" + curr_node_->getAddr() + ":" + std::to_string(curr_node_->getPort()) + "-gossip"
-    };
-    std::ofstream out(path, std::ios::trunc);
-    if (!out) throw std::runtime_error("Failed to open file for gossip number!");
-    out << state_[node_id].incarnation_;
+    Logger::instance().info("Writing membership snapshot to disk...");
+    persist();
 }
\ No newline at end of file
@@ -0,0 +1,142 @@
+#include "membership/membership.h"
+#include "hash_ring/node.h"
+#include "logging/logger.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+Membership::Membership(std::shared_ptr<HashRing> ring) :
+    ring_(ring),
+    current_(std::make_shared<const MembershipSnapshot>()) {}
+
+std::shared_ptr<const MembershipSnapshot> Membership::snapshot() const {
+    return std::atomic_load_explicit(&current_, std::memory_order_acquire);
+}
+
+uint64_t Membership::version() const {
+    return snapshot()->version_;
+}
+
+std::optional<NodeState> Membership::get(const std::string& id) const {
+    auto snap = snapshot();
+    auto it = snap->nodes_.find(id);
+    if(it == snap->nodes_.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+bool Membership::publish(std::shared_ptr<const MembershipSnapshot>& expected,
+                         std::shared_ptr<const MembershipSnapshot> next) {
+    return std::atomic_compare_exchange_strong_explicit(
+        &current_, &expected, next,
+        std::memory_order_acq_rel, std::memory_order_acquire
+    );
+}
+
+// theres an edge case where number of tokens is changed and is not synchronized
+// should not happen though unless there is a shutdown, which will mean our changes are reflected
+bool Membership::merge(const ClusterState& other) {
+    auto cur = snapshot();
+
+    while(true) {
+        std::vector<const NodeState*> changed;
+        for(auto &[k, v] : other) {
+            auto it = cur->nodes_.find(k);
+            if(it == cur->nodes_.end() || v.supersedes(it->second)) {
+                changed.push_back(&v);
+            }
+        }
+
+        if(changed.empty()) {
+            return false;
+        }
+
+        auto next = std::make_shared<MembershipSnapshot>(*cur);
+        next->version_++;
+        std::vector<std::string> ids;
+        ids.reserve(changed.size());
+        for(auto *v : changed) {
+            next->nodes_[v->id_] = *v;
+            ids.push_back(v->id_);
+        }
+
+        // on failure cur is reloaded with the winner's snapshot and we diff again
+        std::shared_ptr<const MembershipSnapshot> published = next;
+        if(publish(cur, std::move(next))) {
+            onPublished(*published, ids);
+            return true;
+        }
+    }
+}
+
+bool Membership::update(const std::string& id, const std::function<void(NodeState&)>& fn) {
+    auto cur = snapshot();
+
+    while(true) {
+        auto it = cur->nodes_.find(id);
+        if(it == cur->nodes_.end()) {
+            return false;
+        }
+
+        auto next = std::make_shared<MembershipSnapshot>(*cur);
+        next->version_++;
+        fn(next->nodes_[id]);
+
+        std::shared_ptr<const MembershipSnapshot> published = next;
+        if(publish(cur, std::move(next))) {
+            onPublished(*published, {id});
+            return true;
+        }
+    }
+}
+
+void Membership::subscribe(Listener listener) {
+    std::lock_guard<std::mutex> lk(listeners_mu_);
+    listeners_.push_back(std::move(listener));
+}
+
+void Membership::onPublished(const MembershipSnapshot& published, const std::vector<std::string>& ids) {
+    reconcileRing(ids);
+
+    std::vector<Listener> listeners;
+    {
+        std::lock_guard<std::mutex> lk(listeners_mu_);
+        listeners = listeners_;
+    }
+
+    for(auto &id : ids) {
+        const NodeState& state = published.nodes_.at(id);
+        for(auto &listener : listeners) {
+            listener(state);
+        }
+    }
+}
+
+// make the ring agree with the latest snapshot for the given nodes
+// looking at the latest state rather than the transition we made keeps this
+// idempotent, so a slow writer can never undo a newer writer's change
+void Membership::reconcileRing(const std::vector<std::string>& ids) {
+    std::lock_guard<std::mutex> lk(ring_mu_);
+    auto snap = snapshot();
+
+    for(auto &id : ids) {
+        auto it = snap->nodes_.find(id);
+        if(it == snap->nodes_.end()) {
+            continue;
+        }
+
+        const NodeState& state = it->second;
+        bool on_ring = ring_->getNode(id) != nullptr;
+
+        // suspects stay on the ring until they are confirmed dead
+        if(state.status_ != NodeState::Status::KILLED && !on_ring) {
+            Logger::instance().debug("Adding node to ring: " + state.id_);
+            ring_->addNode(std::make_shared<Node>(state.address_, state.port_, state.tokens_));
+        } else if(state.status_ == NodeState::Status::KILLED && on_ring) {
+            Logger::instance().debug("Recieved node shutdown for: " + state.id_);
+            ring_->removeNode(state.id_);
+        }
+    }
+}
@@ -0,0 +1,63 @@
+#include "membership/snapshot.h"
+#include "logging/logger.h"
+#include "storage/serializer.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+bool MembershipStore::save(const MembershipSnapshot& snapshot, const std::string& self_id) {
+    PersistedMembership persisted;
+    persisted.self_id_ = self_id;
+    persisted.saved_at_ms_ = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+    persisted.membership_version_ = snapshot.version_;
+    persisted.nodes_ = snapshot.nodes_;
+
+    std::string tmp = path_ + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if(!out) {
+            Logger::instance().error("Failed to open membership snapshot for writing: " + tmp);
+            return false;
+        }
+        ByteString serialized = Serializer::toBinary(persisted);
+        out.write(serialized.data(), serialized.size());
+        if(!out) {
+            Logger::instance().error("Failed to write membership snapshot: " + tmp);
+            return false;
+        }
+    }
+
+    if(std::rename(tmp.c_str(), path_.c_str()) != 0) {
+        Logger::instance().error("Failed to move membership snapshot into place: " + path_);
+        return false;
+    }
+    return true;
+}
+
+std::optional<PersistedMembership> MembershipStore::load() {
+    std::ifstream in(path_, std::ios::binary);
+    if(!in) {
+        return std::nullopt;
+    }
+
+    std::string data{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    if(data.empty()) {
+        return std::nullopt;
+    }
+
+    try {
+        auto persisted = Serializer::fromBinary<PersistedMembership>(data);
+        if(persisted.format_version_ != PersistedMembership::FORMAT_VERSION) {
+            Logger::instance().warn("Ignoring membership snapshot with unknown format version: " + std::to_string(persisted.format_version_));
+            return std::nullopt;
+        }
+        return persisted;
+    } catch(const std::exception& e) {
+        Logger::instance().warn("Ignoring unreadable membership snapshot " + path_ + ": " + e.what());
+        return std::nullopt;
+    }
+}
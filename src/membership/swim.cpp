@@ -0,0 +1,387 @@
+#include "membership/swim.h"
+#include "logging/logger.h"
+#include "storage/serializer.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+Swim::Swim(std::shared_ptr<Membership> membership, std::shared_ptr<Node> curr, SwimConfig config) :
+    membership_(membership),
+    curr_node_(curr),
+    config_(config),
+    gen_(std::random_device{}()),
+    updates_(std::make_shared<Dissemination>()) {
+
+    fd_ = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if(fd_ < 0) {
+        throw std::runtime_error("Failed to create swim udp socket");
+    }
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(curr->getPort());
+
+    if(::bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        ::close(fd_);
+        throw std::runtime_error("Failed to bind swim udp socket on port: " + std::to_string(curr->getPort()));
+    }
+
+    // lets the receive thread notice shutdown
+    timeval tv{0, 100 * 1000};
+    ::setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    // every membership change, wherever it came from, gets piggybacked
+    std::weak_ptr<Dissemination> weak = updates_;
+    membership_->subscribe([weak](const NodeState& state) {
+        if(auto updates = weak.lock()) {
+            std::lock_guard<std::mutex> lk(updates->mu_);
+            updates->pending_[state.id_] = PendingUpdate{state, 0};
+        }
+    });
+}
+
+Swim::~Swim() {
+    stop();
+    if(fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+void Swim::start() {
+    if(running_.exchange(true)) return;
+
+    receive_t_ = std::thread([this] { receiveLoop(); });
+    probe_t_ = std::thread([this] { probeLoop(); });
+    Logger::instance().info("starting swim failure detector on udp port: " + std::to_string(curr_node_->getPort()));
+}
+
+void Swim::stop() {
+    if(!running_.load()) return;
+
+    Logger::instance().info("Flushing swim updates and stopping...");
+
+    // push whatever is pending, usually our own leave, to a handful of members
+    auto candidates = probeCandidates();
+    std::mt19937 gen(std::random_device{}());
+    std::shuffle(candidates.begin(), candidates.end(), gen);
+    size_t n = std::min(candidates.size(), static_cast<size_t>(retransmitLimit()));
+    for(size_t i = 0; i < n; i++) {
+        send(candidates[i], SwimMessage{SwimMessage::PING, ++seq_, "", "", {}});
+    }
+
+    running_.store(false);
+    ack_cv_.notify_all();
+    if(probe_t_.joinable()) probe_t_.join();
+    if(receive_t_.joinable()) receive_t_.join();
+}
+
+int Swim::retransmitLimit() {
+    size_t n = membership_->snapshot()->nodes_.size();
+    return config_.retransmit_mult_ * std::max(1, static_cast<int>(std::ceil(std::log2(n + 1))));
+}
+
+std::vector<NodeState> Swim::probeCandidates() {
+    auto snapshot = membership_->snapshot();
+    std::vector<NodeState> out;
+    out.reserve(snapshot->nodes_.size());
+    for(auto &[id, state] : snapshot->nodes_) {
+        if(id != curr_node_->getId() && state.status_ != NodeState::Status::KILLED) {
+            out.push_back(state);
+        }
+    }
+    return out;
+}
+
+void Swim::probeLoop() {
+    while(running_.load()) {
+        auto period_start = std::chrono::steady_clock::now();
+
+        checkSuspects();
+
+        // round robin over a shuffled member list, reshuffled once per pass
+        if(probe_idx_ >= probe_order_.size()) {
+            probe_order_.clear();
+            for(auto &state : probeCandidates()) {
+                probe_order_.push_back(state.id_);
+            }
+            std::shuffle(probe_order_.begin(), probe_order_.end(), gen_);
+            probe_idx_ = 0;
+        }
+
+        while(probe_idx_ < probe_order_.size()) {
+            auto target = membership_->get(probe_order_[probe_idx_++]);
+            if(target && target->status_ != NodeState::Status::KILLED) {
+                probe(*target);
+                break;
+            }
+        }
+
+        std::this_thread::sleep_until(period_start + config_.protocol_period_);
+    }
+}
+
+void Swim::probe(const NodeState& target) {
+    auto start = std::chrono::steady_clock::now();
+    uint64_t seq = ++seq_;
+
+    {
+        std::lock_guard<std::mutex> lk(ack_mu_);
+        acks_[seq] = false;
+    }
+
+    send(target, SwimMessage{SwimMessage::PING, seq, "", "", {}});
+    bool acked = waitForAck(seq, start + config_.ack_timeout_);
+
+    if(!acked) {
+        auto helpers = probeCandidates();
+        helpers.erase(
+            std::remove_if(helpers.begin(), helpers.end(), [&](auto &s) {
+                return s.id_ == target.id_;
+            }),
+            helpers.end()
+        );
+        std::shuffle(helpers.begin(), helpers.end(), gen_);
+
+        size_t k = std::min(helpers.size(), static_cast<size_t>(config_.indirect_probes_));
+        for(size_t i = 0; i < k; i++) {
+            send(helpers[i], SwimMessage{SwimMessage::PING_REQ, seq, "", target.id_, {}});
+        }
+
+        acked = waitForAck(seq, start + config_.protocol_period_);
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(ack_mu_);
+        acks_.erase(seq);
+    }
+
+    if(!acked && target.status_ == NodeState::Status::ACTIVE) {
+        Logger::instance().info("swim: no ack from " + target.id_ + ", marking as suspect");
+        NodeState suspect = target;
+        suspect.status_ = NodeState::Status::SUSPECT;
+        membership_->merge({{suspect.id_, suspect}});
+        suspects_[suspect.id_] = std::chrono::steady_clock::now();
+    }
+}
+
+bool Swim::waitForAck(uint64_t seq, std::chrono::steady_clock::time_point deadline) {
+    std::unique_lock<std::mutex> lk(ack_mu_);
+    return ack_cv_.wait_until(lk, deadline, [&] {
+        return !running_.load() || acks_[seq];
+    }) && acks_[seq];
+}
+
+// suspicion can also arrive from other members, so timers start when we first see it
+void Swim::checkSuspects() {
+    auto snapshot = membership_->snapshot();
+    auto now = std::chrono::steady_clock::now();
+
+    int rounds = std::max(1, static_cast<int>(std::ceil(std::log2(snapshot->nodes_.size() + 1))));
+    auto timeout = config_.protocol_period_ * (config_.suspicion_mult_ * rounds);
+
+    for(auto it = suspects_.begin(); it != suspects_.end();) {
+        auto state = snapshot->nodes_.find(it->first);
+        if(state == snapshot->nodes_.end() || state->second.status_ != NodeState::Status::SUSPECT) {
+            it = suspects_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    for(auto &[id, state] : snapshot->nodes_) {
+        if(state.status_ != NodeState::Status::SUSPECT) continue;
+
+        auto [it, inserted] = suspects_.try_emplace(id, now);
+        if(!inserted && now - it->second > timeout) {
+            Logger::instance().info("swim: suspect " + id + " did not refute, marking as dead");
+            NodeState dead = state;
+            dead.status_ = NodeState::Status::KILLED;
+            membership_->merge({{dead.id_, dead}});
+            suspects_.erase(it);
+        }
+    }
+}
+
+void Swim::receiveLoop() {
+    std::vector<char> buf(64 * 1024);
+
+    while(running_.load()) {
+        sockaddr_in from{};
+        socklen_t len = sizeof(from);
+        ssize_t n = ::recvfrom(fd_, buf.data(), buf.size(), 0, reinterpret_cast<sockaddr*>(&from), &len);
+        if(n <= 0) {
+            continue;
+        }
+
+        SwimMessage msg;
+        try {
+            msg = Serializer::fromBinary<SwimMessage>(std::string(buf.data(), n));
+        } catch(const std::exception& e) {
+            Logger::instance().debug(std::string("swim: dropping malformed datagram: ") + e.what());
+            continue;
+        }
+
+        handle(msg, from);
+    }
+}
+
+void Swim::handle(const SwimMessage& msg, const sockaddr_in& from) {
+    applyUpdates(msg.updates_);
+
+    switch(msg.type_) {
+        case SwimMessage::PING: {
+            sendTo(from, SwimMessage{SwimMessage::ACK, msg.seq_, "", curr_node_->getId(), {}});
+            break;
+        }
+        case SwimMessage::PING_REQ: {
+            auto target = membership_->get(msg.target_);
+            if(!target) break;
+
+            uint64_t seq = ++seq_;
+            {
+                std::lock_guard<std::mutex> lk(ack_mu_);
+                auto now = std::chrono::steady_clock::now();
+                for(auto it = relays_.begin(); it != relays_.end();) {
+                    if(now - it->second.created_ > config_.protocol_period_ * 2) {
+                        it = relays_.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+                relays_[seq] = Relay{from, msg.seq_, now};
+            }
+            send(*target, SwimMessage{SwimMessage::PING, seq, "", "", {}});
+            break;
+        }
+        case SwimMessage::ACK: {
+            std::unique_lock<std::mutex> lk(ack_mu_);
+            if(auto it = acks_.find(msg.seq_); it != acks_.end()) {
+                it->second = true;
+                lk.unlock();
+                ack_cv_.notify_all();
+            } else if(auto relay = relays_.find(msg.seq_); relay != relays_.end()) {
+                Relay r = relay->second;
+                relays_.erase(relay);
+                lk.unlock();
+                sendTo(r.requester_, SwimMessage{SwimMessage::ACK, r.seq_, "", msg.target_, {}});
+            }
+            break;
+        }
+    }
+}
+
+void Swim::applyUpdates(const std::vector<NodeState>& updates) {
+    if(updates.empty()) return;
+
+    const std::string self = curr_node_->getId();
+    ClusterState others;
+
+    for(auto &u : updates) {
+        if(u.id_ != self) {
+            others[u.id_] = u;
+            continue;
+        }
+
+        // someone thinks we are suspect or dead, refute with a newer incarnation
+        // unless we are actually leaving
+        auto own = membership_->get(self);
+        if(own && own->status_ == NodeState::Status::ACTIVE &&
+           u.status_ != NodeState::Status::ACTIVE && u.incarnation_ >= own->incarnation_) {
+            Logger::instance().info("swim: refuting " + std::string(NodeState::statusToStr(u.status_)) + " about ourselves");
+            membership_->update(self, [&u](NodeState &s) {
+                s.incarnation_ = u.incarnation_ + 1;
+                s.status_ = NodeState::Status::ACTIVE;
+            });
+        }
+    }
+
+    if(!others.empty()) {
+        membership_->merge(others);
+    }
+}
+
+std::vector<NodeState> Swim::takePiggyback() {
+    int limit = retransmitLimit();
+    std::vector<NodeState> out;
+
+    std::lock_guard<std::mutex> lk(updates_->mu_);
+    std::vector<PendingUpdate*> pending;
+    pending.reserve(updates_->pending_.size());
+    for(auto &[id, p] : updates_->pending_) {
+        pending.push_back(&p);
+    }
+
+    // least transmitted first so fresh news spreads fastest
+    size_t n = std::min(pending.size(), config_.max_piggyback_);
+    std::partial_sort(pending.begin(), pending.begin() + n, pending.end(), [](auto *a, auto *b) {
+        return a->sent_ < b->sent_;
+    });
+
+    std::vector<std::string> done;
+    for(size_t i = 0; i < n; i++) {
+        out.push_back(pending[i]->state_);
+        if(++pending[i]->sent_ >= limit) {
+            done.push_back(pending[i]->state_.id_);
+        }
+    }
+
+    for(auto &id : done) {
+        updates_->pending_.erase(id);
+    }
+
+    return out;
+}
+
+bool Swim::resolve(const NodeState& node, sockaddr_in& out) {
+    {
+        std::lock_guard<std::mutex> lk(addr_mu_);
+        auto it = addrs_.find(node.id_);
+        if(it != addrs_.end()) {
+            out = it->second;
+            return true;
+        }
+    }
+
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo *res = nullptr;
+
+    if(::getaddrinfo(node.address_.c_str(), std::to_string(node.port_).c_str(), &hints, &res) != 0 || !res) {
+        Logger::instance().error("swim: could not resolve address for node: " + node.id_);
+        return false;
+    }
+
+    out = *reinterpret_cast<sockaddr_in*>(res->ai_addr);
+    ::freeaddrinfo(res);
+
+    std::lock_guard<std::mutex> lk(addr_mu_);
+    addrs_[node.id_] = out;
+    return true;
+}
+
+bool Swim::send(const NodeState& to, SwimMessage msg) {
+    sockaddr_in addr{};
+    if(!resolve(to, addr)) {
+        return false;
+    }
+    sendTo(addr, std::move(msg));
+    return true;
+}
+
+void Swim::sendTo(const sockaddr_in& addr, SwimMessage msg) {
+    msg.from_ = curr_node_->getId();
+    msg.updates_ = takePiggyback();
+
+    ByteString serialized = Serializer::toBinary(msg);
+    ::sendto(fd_, serialized.data(), serialized.size(), 0,
+             reinterpret_cast<const sockaddr*>(&addr), sizeof(addr));
+}
@@ -0,0 +1,139 @@
+#include "metrics/heavy_hitters.h"
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <limits>
+
+// splitmix64 finalizer, gives the second hash for double hashing the rows
+static uint64_t mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+HeavyHitters::HeavyHitters(size_t k, size_t width, size_t depth, uint64_t min_hot, std::chrono::milliseconds decay_interval) :
+    k_(std::max<size_t>(1, k)),
+    width_(std::bit_ceil(std::max<size_t>(1, width))),
+    depth_(std::max<size_t>(1, depth)),
+    min_hot_(min_hot),
+    decay_interval_(decay_interval),
+    counters_(std::make_unique<std::atomic<uint32_t>[]>(width_ * depth_)),
+    last_decay_(std::chrono::steady_clock::now()) {
+        top_.reserve(k_);
+    }
+
+size_t HeavyHitters::index(uint64_t hash, size_t row) const {
+    uint64_t h2 = mix(hash) | 1;
+    return row * width_ + ((hash + row * h2) & (width_ - 1));
+}
+
+void HeavyHitters::record(const std::string& key) {
+    uint64_t hash = std::hash<std::string>{}(key);
+    uint64_t estimate = std::numeric_limits<uint64_t>::max();
+    for(size_t row = 0; row < depth_; row++) {
+        auto& counter = counters_[index(hash, row)];
+        uint32_t seen = counter.fetch_add(1, std::memory_order_relaxed) + 1;
+        estimate = std::min<uint64_t>(estimate, seen);
+    }
+    total_.fetch_add(1, std::memory_order_relaxed);
+
+    if(estimate >= min_hot_ && estimate > threshold_.load(std::memory_order_relaxed)) {
+        admit(key, estimate);
+    }
+}
+
+uint64_t HeavyHitters::estimate(const std::string& key) const {
+    uint64_t hash = std::hash<std::string>{}(key);
+    uint64_t estimate = std::numeric_limits<uint64_t>::max();
+    for(size_t row = 0; row < depth_; row++) {
+        estimate = std::min<uint64_t>(estimate, counters_[index(hash, row)].load(std::memory_order_relaxed));
+    }
+    return estimate;
+}
+
+bool HeavyHitters::isHot(const std::string& key) const {
+    uint64_t bar = std::max(min_hot_, threshold_.load(std::memory_order_relaxed));
+    return estimate(key) >= bar;
+}
+
+void HeavyHitters::admit(const std::string& key, uint64_t estimate) {
+    std::unique_lock<std::mutex> lk(top_mu_, std::try_to_lock);
+    if(!lk.owns_lock()) {
+        return;
+    }
+
+    auto it = std::find_if(top_.begin(), top_.end(), [&key](const HotKey& h) {
+        return h.key_ == key;
+    });
+    if(it != top_.end()) {
+        it->count_ = std::max(it->count_, estimate);
+    } else if(top_.size() < k_) {
+        top_.push_back(HotKey{key, estimate});
+    } else {
+        auto coldest = std::min_element(top_.begin(), top_.end(), [](const HotKey& a, const HotKey& b) {
+            return a.count_ < b.count_;
+        });
+        if(coldest->count_ >= estimate) {
+            return;
+        }
+        *coldest = HotKey{key, estimate};
+    }
+    updateThreshold();
+}
+
+// top_mu_ held
+void HeavyHitters::updateThreshold() {
+    if(top_.size() < k_) {
+        threshold_.store(0, std::memory_order_relaxed);
+        return;
+    }
+    auto coldest = std::min_element(top_.begin(), top_.end(), [](const HotKey& a, const HotKey& b) {
+        return a.count_ < b.count_;
+    });
+    threshold_.store(coldest->count_, std::memory_order_relaxed);
+}
+
+std::vector<HotKey> HeavyHitters::top(size_t n) const {
+    std::vector<HotKey> out;
+    {
+        std::lock_guard<std::mutex> lk(top_mu_);
+        out = top_;
+    }
+    std::sort(out.begin(), out.end(), [](const HotKey& a, const HotKey& b) {
+        return a.count_ > b.count_;
+    });
+    if(out.size() > n) {
+        out.resize(n);
+    }
+    return out;
+}
+
+void HeavyHitters::decay() {
+    for(size_t i = 0; i < width_ * depth_; i++) {
+        auto& counter = counters_[i];
+        counter.store(counter.load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+    }
+
+    std::lock_guard<std::mutex> lk(top_mu_);
+    for(auto& h : top_) {
+        h.count_ /= 2;
+    }
+    // keys that have gone cold leave the table
+    std::erase_if(top_, [this](const HotKey& h) {
+        return h.count_ < min_hot_ / 2;
+    });
+    updateThreshold();
+}
+
+void HeavyHitters::decayIfDue() {
+    std::lock_guard<std::mutex> lk(decay_mu_);
+    auto now = std::chrono::steady_clock::now();
+    if(now - last_decay_ < decay_interval_) {
+        return;
+    }
+    last_decay_ = now;
+    decay();
+}
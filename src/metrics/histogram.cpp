@@ -0,0 +1,87 @@
+#include "metrics/histogram.h"
+#include <bit>
+#include <limits>
+
+size_t Histogram::bucketFor(uint64_t value) {
+    if(value < 4) {
+        return value;
+    }
+    int msb = 63 - std::countl_zero(value);
+    uint64_t sub = (value >> (msb - 2)) & 3;
+    return 4 + (msb - 2) * 4 + sub;
+}
+
+uint64_t Histogram::bucketUpperBound(size_t bucket) {
+    if(bucket < 4) {
+        return bucket;
+    }
+    size_t msb = (bucket - 4) / 4 + 2;
+    uint64_t sub = (bucket - 4) % 4;
+    uint64_t width = uint64_t{1} << (msb - 2);
+    uint64_t lower = (4 + sub) << (msb - 2);
+    // the last bucket would overflow
+    if(lower > std::numeric_limits<uint64_t>::max() - width) {
+        return std::numeric_limits<uint64_t>::max();
+    }
+    return lower + width - 1;
+}
+
+void Histogram::record(uint64_t value) {
+    counts_[bucketFor(value)].fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+}
+
+HistogramSnapshot Histogram::snapshot() const {
+    HistogramSnapshot out;
+    for(size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        out.counts_[i] = counts_[i].load(std::memory_order_relaxed);
+        out.count_ += out.counts_[i];
+    }
+    out.sum_ = sum_.load(std::memory_order_relaxed);
+    return out;
+}
+
+uint64_t HistogramSnapshot::percentile(double p) const {
+    if(count_ == 0) {
+        return 0;
+    }
+
+    uint64_t rank = static_cast<uint64_t>(p * static_cast<double>(count_));
+    if(rank >= count_) {
+        rank = count_ - 1;
+    }
+
+    uint64_t seen = 0;
+    for(size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += counts_[i];
+        if(seen > rank) {
+            return Histogram::bucketUpperBound(i);
+        }
+    }
+    return Histogram::bucketUpperBound(HISTOGRAM_BUCKETS - 1);
+}
+
+double HistogramSnapshot::mean() const {
+    return count_ == 0 ? 0.0 : static_cast<double>(sum_) / static_cast<double>(count_);
+}
+
+HistogramSnapshot HistogramSnapshot::operator-(const HistogramSnapshot& older) const {
+    HistogramSnapshot out;
+    for(size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        out.counts_[i] = counts_[i] - older.counts_[i];
+        out.count_ += out.counts_[i];
+    }
+    out.sum_ = sum_ - older.sum_;
+    return out;
+}
+
+void to_json(json& j, const HistogramSnapshot& h) {
+    j = json{
+        {"count", h.count_},
+        {"mean", h.mean()},
+        {"p50", h.percentile(0.50)},
+        {"p90", h.percentile(0.90)},
+        {"p99", h.percentile(0.99)},
+        {"p999", h.percentile(0.999)},
+    };
+}
@@ -0,0 +1,184 @@
+#include "server/admission.h"
+#include "logging/logger.h"
+#include <algorithm>
+
+const char* pressureToStr(Pressure pressure) {
+    switch(pressure) {
+        case Pressure::NONE: return "none";
+        case Pressure::SOFT: return "soft";
+        case Pressure::HARD: return "hard";
+    }
+    return "?";
+}
+
+void to_json(json& j, const AdmissionStats& s) {
+    j = json{
+        {"pressure", pressureToStr(s.pressure_)},
+        {"health", s.health_},
+        {"client", s.client_},
+        {"replication", s.replication_},
+    };
+}
+
+AdmissionController::Ticket::Ticket(Ticket&& other) noexcept :
+    owner_(other.owner_),
+    cls_(other.cls_),
+    status_(other.status_),
+    retry_after_(other.retry_after_) {
+        other.owner_ = nullptr;
+    }
+
+AdmissionController::Ticket& AdmissionController::Ticket::operator=(Ticket&& other) noexcept {
+    if(this != &other) {
+        if(owner_) {
+            owner_->release(cls_);
+        }
+        owner_ = other.owner_;
+        cls_ = other.cls_;
+        status_ = other.status_;
+        retry_after_ = other.retry_after_;
+        other.owner_ = nullptr;
+    }
+    return *this;
+}
+
+AdmissionController::Ticket::~Ticket() {
+    if(owner_) {
+        owner_->release(cls_);
+    }
+}
+
+AdmissionController::AdmissionController(AdmissionOptions options) : options_(options) {}
+
+void AdmissionController::setHealthProvider(std::function<EngineHealth()> provider) {
+    std::lock_guard<std::mutex> lk(health_mu_);
+    provider_ = std::move(provider);
+}
+
+Pressure AdmissionController::classify(const EngineHealth& health) const {
+    if((health.stalled_ && health.stall_us_ >= options_.hard_stall_us_)
+        || health.l0_files_ >= options_.hard_l0_files_
+        || health.pending_compaction_bytes_ >= options_.hard_pending_compaction_bytes_
+        || health.put_p99_us_ >= options_.hard_put_p99_us_) {
+        return Pressure::HARD;
+    }
+    if(health.stalled_
+        || health.l0_files_ >= options_.soft_l0_files_
+        || health.pending_compaction_bytes_ >= options_.soft_pending_compaction_bytes_
+        || health.put_p99_us_ >= options_.soft_put_p99_us_) {
+        return Pressure::SOFT;
+    }
+    return Pressure::NONE;
+}
+
+// replication keeps its full budget until leveldb is in real trouble, a replica that
+// turns writes away just moves them into some coordinator's hint backlog
+size_t AdmissionController::limitFor(TrafficClass cls, Pressure pressure) const {
+    if(cls == TrafficClass::REPLICATION) {
+        size_t limit = options_.replication_inflight_;
+        return pressure == Pressure::HARD ? std::max<size_t>(1, limit / 2) : limit;
+    }
+
+    size_t limit = options_.client_inflight_;
+    switch(pressure) {
+        case Pressure::NONE: return limit;
+        case Pressure::SOFT: return std::max<size_t>(1, limit / 2);
+        case Pressure::HARD: return std::max<size_t>(1, limit / 4);
+    }
+    return limit;
+}
+
+AdmissionController::Ticket AdmissionController::admit(TrafficClass cls, bool write) {
+    maybeRefreshHealth();
+    Pressure pressure = this->pressure();
+    Budget& b = budget(cls);
+
+    if(cls == TrafficClass::CLIENT && write && pressure == Pressure::HARD) {
+        b.rejected_pressure_.fetch_add(1, std::memory_order_relaxed);
+        return Ticket(503, options_.pressure_retry_after_);
+    }
+
+    size_t limit = limitFor(cls, pressure);
+    std::unique_lock<std::mutex> lk(mu_);
+    if(b.inflight_ >= limit) {
+        bool freed = b.cv_.wait_for(lk, options_.max_wait_, [&] {
+            return b.inflight_ < limit;
+        });
+        if(!freed) {
+            b.rejected_busy_.fetch_add(1, std::memory_order_relaxed);
+            return Ticket(429, options_.retry_after_);
+        }
+        b.delayed_.fetch_add(1, std::memory_order_relaxed);
+    }
+    b.inflight_++;
+    b.admitted_.fetch_add(1, std::memory_order_relaxed);
+    return Ticket(this, cls);
+}
+
+void AdmissionController::release(TrafficClass cls) {
+    Budget& b = budget(cls);
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        b.inflight_--;
+    }
+    b.cv_.notify_one();
+}
+
+void AdmissionController::maybeRefreshHealth() {
+    int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+    int64_t interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(options_.health_interval_).count();
+    if(now - last_refresh_ns_.load(std::memory_order_relaxed) < interval) {
+        return;
+    }
+    // one request pays for the poll, everyone else goes on with the old pressure
+    if(refreshing_.exchange(true)) {
+        return;
+    }
+    refreshHealth();
+    refreshing_.store(false);
+}
+
+void AdmissionController::refreshHealth() {
+    std::lock_guard<std::mutex> lk(health_mu_);
+    last_refresh_ns_.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    if(!provider_) {
+        return;
+    }
+
+    health_ = provider_();
+    Pressure next = classify(health_);
+    Pressure prev = pressure_.exchange(next);
+    if(next != prev) {
+        std::string msg = std::string("Admission pressure ") + pressureToStr(prev) + " -> " + pressureToStr(next)
+            + " (l0 files: " + std::to_string(health_.l0_files_)
+            + ", pending compaction: " + std::to_string(health_.pending_compaction_bytes_ >> 20) + "MB"
+            + ", put p99: " + std::to_string(health_.put_p99_us_) + "us)";
+        if(next == Pressure::NONE) {
+            Logger::instance().info(msg);
+        } else {
+            Logger::instance().warn(msg);
+        }
+    }
+}
+
+AdmissionStats AdmissionController::stats() {
+    AdmissionStats out;
+    out.pressure_ = pressure();
+    {
+        std::lock_guard<std::mutex> lk(health_mu_);
+        out.health_ = health_;
+    }
+
+    std::lock_guard<std::mutex> lk(mu_);
+    for(auto cls : {TrafficClass::CLIENT, TrafficClass::REPLICATION}) {
+        Budget& b = budget(cls);
+        AdmissionClassStats& s = cls == TrafficClass::CLIENT ? out.client_ : out.replication_;
+        s.inflight_ = b.inflight_;
+        s.limit_ = limitFor(cls, out.pressure_);
+        s.admitted_ = b.admitted_.load(std::memory_order_relaxed);
+        s.rejected_busy_ = b.rejected_busy_.load(std::memory_order_relaxed);
+        s.rejected_pressure_ = b.rejected_pressure_.load(std::memory_order_relaxed);
+        s.delayed_ = b.delayed_.load(std::memory_order_relaxed);
+    }
+    return out;
+}
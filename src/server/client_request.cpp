@@ -0,0 +1,207 @@
+#include "server/client_request.h"
+#include <cstdint>
+#include <unordered_set>
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+namespace {
+
+enum class Field {
+    KEY,
+    DATA,
+    CONTEXT,
+    OTHER
+};
+
+Field fieldFor(std::string_view name) {
+    if(name == "key") return Field::KEY;
+    if(name == "data") return Field::DATA;
+    if(name == "context") return Field::CONTEXT;
+    return Field::OTHER;
+}
+
+// cursor over a body, only understands a flat object whose members are all ascii strings
+// without escapes, anything it returns false on is left to the full parser
+class Scanner {
+    public:
+        explicit Scanner(std::string_view in) : in_(in) {}
+
+        bool consume(char c) {
+            skipSpace();
+            if(pos_ < in_.size() && in_[pos_] == c) {
+                pos_++;
+                return true;
+            }
+            return false;
+        }
+
+        // viewed in place
+        bool plainString(std::string_view &out) {
+            skipSpace();
+            if(pos_ >= in_.size() || in_[pos_] != '"') {
+                return false;
+            }
+            size_t start = ++pos_;
+            for(; pos_ < in_.size(); pos_++) {
+                char c = in_[pos_];
+                if(c == '"') {
+                    out = in_.substr(start, pos_ - start);
+                    pos_++;
+                    return true;
+                }
+                // escapes need decoding and raw control characters are invalid json.
+                // non ascii is left to nlohmann so invalid utf-8 is rejected the same way
+                uint8_t b = static_cast<uint8_t>(c);
+                if(c == '\\' || b < 0x20 || b >= 0x80) {
+                    return false;
+                }
+            }
+            return false;
+        }
+
+        bool atEnd() {
+            skipSpace();
+            return pos_ == in_.size();
+        }
+
+    private:
+        void skipSpace() {
+            while(pos_ < in_.size() && (in_[pos_] == ' ' || in_[pos_] == '\n' || in_[pos_] == '\r' || in_[pos_] == '\t')) {
+                pos_++;
+            }
+        }
+
+        std::string_view in_;
+        size_t pos_{0};
+};
+
+bool scan(std::string_view body, ClientRequest &out) {
+    Scanner s{body};
+    if(!s.consume('{')) {
+        return false;
+    }
+
+    bool has_key = false;
+    if(!s.consume('}')) {
+        do {
+            std::string_view name;
+            std::string_view value;
+            if(!s.plainString(name) || !s.consume(':') || !s.plainString(value)) {
+                return false;
+            }
+            // a repeated member overwrites, same as nlohmann
+            switch(fieldFor(name)) {
+                case Field::KEY:
+                    out.key_.assign(value);
+                    has_key = true;
+                    break;
+                case Field::DATA:
+                    out.data_.assign(value);
+                    break;
+                case Field::CONTEXT:
+                    out.context_.assign(value);
+                    break;
+                case Field::OTHER:
+                    break;
+            }
+        } while(s.consume(','));
+
+        if(!s.consume('}')) {
+            return false;
+        }
+    }
+    return has_key && s.atEnd();
+}
+
+std::optional<ClientRequest> fromObject(const json &j) {
+    if(!j.is_object()) {
+        return std::nullopt;
+    }
+
+    ClientRequest out;
+    // missing and null are both empty, anything but a string is malformed
+    auto field = [&j](const char *name, std::string &into) {
+        auto it = j.find(name);
+        if(it == j.end() || it->is_null()) {
+            return true;
+        }
+        if(!it->is_string()) {
+            return false;
+        }
+        into = it->get<std::string>();
+        return true;
+    };
+
+    auto key = j.find("key");
+    if(key == j.end() || !key->is_string()) {
+        return std::nullopt;
+    }
+    out.key_ = key->get<std::string>();
+    if(!field("data", out.data_) || !field("context", out.context_)) {
+        return std::nullopt;
+    }
+    return out;
+}
+
+}
+
+std::optional<ClientRequest> ClientRequest::parse(std::string_view body) {
+    ClientRequest out;
+    if(scan(body, out)) {
+        return out;
+    }
+    return parseJson(body);
+}
+
+std::optional<ClientRequest> ClientRequest::parseJson(std::string_view body) {
+    json j = json::parse(body, nullptr, false);
+    if(j.is_discarded()) {
+        return std::nullopt;
+    }
+    return fromObject(j);
+}
+
+std::optional<MultiGetRequest> MultiGetRequest::parse(std::string_view body) {
+    json j = json::parse(body, nullptr, false);
+    if(j.is_discarded() || !j.is_object()) {
+        return std::nullopt;
+    }
+    auto keys = j.find("keys");
+    if(keys == j.end() || !keys->is_array()) {
+        return std::nullopt;
+    }
+
+    MultiGetRequest out;
+    std::unordered_set<std::string> seen;
+    for(auto &key : *keys) {
+        if(!key.is_string()) {
+            return std::nullopt;
+        }
+        if(seen.insert(key.get<std::string>()).second) {
+            out.keys_.push_back(key.get<std::string>());
+        }
+    }
+    return out;
+}
+
+std::optional<MultiPutRequest> MultiPutRequest::parse(std::string_view body) {
+    json j = json::parse(body, nullptr, false);
+    if(j.is_discarded() || !j.is_object()) {
+        return std::nullopt;
+    }
+    auto puts = j.find("puts");
+    if(puts == j.end() || !puts->is_array()) {
+        return std::nullopt;
+    }
+
+    MultiPutRequest out;
+    out.puts_.reserve(puts->size());
+    for(auto &put : *puts) {
+        auto request = fromObject(put);
+        if(!request) {
+            return std::nullopt;
+        }
+        out.puts_.push_back(std::move(*request));
+    }
+    return out;
+}
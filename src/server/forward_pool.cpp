@@ -0,0 +1,125 @@
+#include "server/forward_pool.h"
+#include <stdexcept>
+
+RoutingMode routingModeFromStr(const std::string& mode) {
+    if(mode == "redirect") return RoutingMode::REDIRECT;
+    if(mode == "proxy") return RoutingMode::PROXY;
+    throw std::invalid_argument("Unknown routing mode: " + mode);
+}
+
+const char* routingModeToStr(RoutingMode mode) {
+    switch(mode) {
+        case RoutingMode::REDIRECT: return "redirect";
+        case RoutingMode::PROXY: return "proxy";
+    }
+    return "?";
+}
+
+RouteAction routeFor(RoutingMode mode, bool coordinator, bool replica, bool forwarded) {
+    if(coordinator) {
+        return RouteAction::LOCAL;
+    }
+    if(mode == RoutingMode::REDIRECT) {
+        return RouteAction::REDIRECT;
+    }
+    if(replica) {
+        return RouteAction::LOCAL;
+    }
+    return forwarded ? RouteAction::REDIRECT : RouteAction::FORWARD;
+}
+
+ForwardPool::ForwardPool(RoutingOptions options) :
+    options_(options) {}
+
+std::unique_ptr<httplib::Client> ForwardPool::acquire(const std::string& id, const std::string& host, int port) {
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        auto it = idle_.find(id);
+        if(it != idle_.end() && !it->second.empty()) {
+            auto client = std::move(it->second.back());
+            it->second.pop_back();
+            return client;
+        }
+    }
+
+    opened_.fetch_add(1, std::memory_order_relaxed);
+    auto client = std::make_unique<httplib::Client>(host, port);
+    client->set_keep_alive(true);
+    client->set_connection_timeout(options_.connect_timeout_);
+    client->set_read_timeout(options_.read_timeout_);
+    client->set_write_timeout(options_.read_timeout_);
+    return client;
+}
+
+void ForwardPool::release(const std::string& id, std::unique_ptr<httplib::Client> client) {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto& idle = idle_[id];
+    if(idle.size() < options_.idle_per_node_) {
+        idle.push_back(std::move(client));
+    }
+}
+
+ForwardOutcome ForwardPool::outcomeOf(httplib::Error error) {
+    switch(error) {
+        case httplib::Error::Success:
+            return ForwardOutcome::ANSWERED;
+        case httplib::Error::Connection:
+        case httplib::Error::ConnectionTimeout:
+        case httplib::Error::BindIPAddress:
+        case httplib::Error::ProxyConnection:
+            return ForwardOutcome::UNREACHABLE;
+        default:
+            return ForwardOutcome::NO_ANSWER;
+    }
+}
+
+ForwardOutcome ForwardPool::forward(const std::string& host, int port, const std::string& path, const httplib::Request& req, httplib::Response& res) {
+    std::string id = host + ":" + std::to_string(port);
+    auto client = acquire(id, host, port);
+
+    httplib::Headers headers{{FORWARDED_HEADER, "1"}};
+    // the binary endpoints carry the context in a header
+    if(req.has_header("X-Dynamo-Context")) {
+        headers.emplace("X-Dynamo-Context", req.get_header_value("X-Dynamo-Context"));
+    }
+    std::string content_type = req.has_header("Content-Type") ? req.get_header_value("Content-Type") : "application/json";
+
+    httplib::Result result = req.method == "GET" ? client->Get(path, headers)
+        : req.method == "PUT" ? client->Put(path, headers, req.body, content_type)
+        : client->Post(path, headers, req.body, content_type);
+    if(!result) {
+        ForwardOutcome outcome = outcomeOf(result.error());
+        // a failed client isn't kept, its connection may be half broken
+        if(outcome == ForwardOutcome::UNREACHABLE) {
+            unreachable_.fetch_add(1, std::memory_order_relaxed);
+            return outcome;
+        }
+        unanswered_.fetch_add(1, std::memory_order_relaxed);
+        return ForwardOutcome::NO_ANSWER;
+    }
+    release(id, std::move(client));
+    forwarded_.fetch_add(1, std::memory_order_relaxed);
+
+    res.status = result->status;
+    for(const char* name : {"X-Dynamo-Context", "Location", "Retry-After"}) {
+        if(result->has_header(name)) {
+            res.set_header(name, result->get_header_value(name));
+        }
+    }
+    res.set_content(result->body, result->get_header_value("Content-Type"));
+    return ForwardOutcome::ANSWERED;
+}
+
+ForwardStats ForwardPool::stats() {
+    ForwardStats stats{};
+    stats.forwarded_ = forwarded_.load(std::memory_order_relaxed);
+    stats.unreachable_ = unreachable_.load(std::memory_order_relaxed);
+    stats.unanswered_ = unanswered_.load(std::memory_order_relaxed);
+    stats.connections_opened_ = opened_.load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lk(mu_);
+    for(auto& [id, idle] : idle_) {
+        stats.idle_connections_ += idle.size();
+    }
+    return stats;
+}
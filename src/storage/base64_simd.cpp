@@ -0,0 +1,298 @@
+#include "storage/base64_simd.h"
+#include "storage/base64.hpp"
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define BASE64_X86 1
+#include <immintrin.h>
+#endif
+
+// the vector kernels follow Mula and Lemire, "Faster Base64 Encoding and Decoding using
+// AVX2 Instructions". each one stops early enough that its wide loads and stores stay
+// inside the buffers and never reach the padded last quantum, and returns how much input
+// it consumed, always whole groups. the rest goes to the next narrower kernel and then
+// to the scalar code
+
+namespace base64 {
+
+namespace {
+
+size_t encodeScalar(const uint8_t* in, size_t n, char* out) {
+    const char* table = detail::encode_table_1.data();
+    char* start = out;
+    size_t i = 0;
+    for(; i + 3 <= n; i += 3) {
+        uint32_t v = (in[i] << 16) | (in[i + 1] << 8) | in[i + 2];
+        *out++ = table[(v >> 18) & 0x3F];
+        *out++ = table[(v >> 12) & 0x3F];
+        *out++ = table[(v >> 6) & 0x3F];
+        *out++ = table[v & 0x3F];
+    }
+    size_t rest = n - i;
+    if(rest > 0) {
+        uint32_t v = in[i] << 16;
+        if(rest == 2) {
+            v |= in[i + 1] << 8;
+        }
+        *out++ = table[(v >> 18) & 0x3F];
+        *out++ = table[(v >> 12) & 0x3F];
+        *out++ = rest == 2 ? table[(v >> 6) & 0x3F] : detail::padding_char;
+        *out++ = detail::padding_char;
+    }
+    return out - start;
+}
+
+#ifdef BASE64_X86
+
+// spreads 12 bytes over 16 lanes, one 6 bit index per byte
+__attribute__((target("ssse3")))
+inline __m128i encReshuffle(__m128i in) {
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003F03F0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t1, t3);
+}
+
+// index to ascii, adds the offset of the alphabet range each index falls in
+__attribute__((target("ssse3")))
+inline __m128i encTranslate(__m128i in) {
+    const __m128i lut = _mm_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+    __m128i indices = _mm_subs_epu8(in, _mm_set1_epi8(51));
+    indices = _mm_sub_epi8(indices, _mm_cmpgt_epi8(in, _mm_set1_epi8(25)));
+    return _mm_add_epi8(in, _mm_shuffle_epi8(lut, indices));
+}
+
+__attribute__((target("ssse3")))
+size_t encodeSsse3(const uint8_t* in, size_t n, char* out) {
+    size_t i = 0;
+    // 12 bytes in, 16 chars out, the load reads 16
+    for(; n - i >= 16; i += 12, out += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), encTranslate(encReshuffle(v)));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+size_t encodeAvx2(const uint8_t* in, size_t n, char* out) {
+    const __m256i shuffle = _mm256_setr_epi8(
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const __m256i lut = _mm256_setr_epi8(
+        65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0,
+        65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+
+    size_t i = 0;
+    // 24 bytes in as two lanes of 12, 32 chars out, the second load reads up to i + 28
+    for(; n - i >= 28; i += 24, out += 32) {
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 12));
+        __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+
+        v = _mm256_shuffle_epi8(v, shuffle);
+        const __m256i t0 = _mm256_and_si256(v, _mm256_set1_epi32(0x0FC0FC00));
+        const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        const __m256i t2 = _mm256_and_si256(v, _mm256_set1_epi32(0x003F03F0));
+        const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        v = _mm256_or_si256(t1, t3);
+
+        __m256i indices = _mm256_subs_epu8(v, _mm256_set1_epi8(51));
+        indices = _mm256_sub_epi8(indices, _mm256_cmpgt_epi8(v, _mm256_set1_epi8(25)));
+        v = _mm256_add_epi8(v, _mm256_shuffle_epi8(lut, indices));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), v);
+    }
+    return i;
+}
+
+// the lookups double as validation, lo & hi is non zero for anything outside the
+// alphabet, including '=' and bytes >= 0x80
+__attribute__((target("ssse3")))
+size_t decodeSsse3(const uint8_t* in, size_t n, uint8_t* out) {
+    const __m128i lut_lo = _mm_setr_epi8(
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lut_hi = _mm_setr_epi8(
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask_2f = _mm_set1_epi8(0x2F);
+
+    size_t i = 0;
+    // 16 chars in, 12 bytes out but the store writes 16. leaving 8 chars keeps room for
+    // that and the padded quantum for the scalar tail
+    for(; n - i >= 24; i += 16, out += 12) {
+        __m128i str = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        const __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(str, 4), mask_2f);
+        const __m128i lo_nibbles = _mm_and_si128(str, mask_2f);
+        const __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+        const __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+        if(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())) != 0) {
+            break;
+        }
+
+        const __m128i eq_2f = _mm_cmpeq_epi8(str, mask_2f);
+        str = _mm_add_epi8(str, _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles)));
+
+        // four 6 bit values to three bytes per 32 bit lane, then pack the lanes
+        const __m128i merged = _mm_maddubs_epi16(str, _mm_set1_epi32(0x01400140));
+        __m128i packed = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+        packed = _mm_shuffle_epi8(packed, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), packed);
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+size_t decodeAvx2(const uint8_t* in, size_t n, uint8_t* out) {
+    const __m256i lut_lo = _mm256_setr_epi8(
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m256i lut_hi = _mm256_setr_epi8(
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lut_roll = _mm256_setr_epi8(
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i mask_2f = _mm256_set1_epi8(0x2F);
+    const __m256i pack = _mm256_setr_epi8(
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+    size_t i = 0;
+    // 32 chars in, 24 bytes out, the store writes 32
+    for(; n - i >= 48; i += 32, out += 24) {
+        __m256i str = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        const __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(str, 4), mask_2f);
+        const __m256i lo_nibbles = _mm256_and_si256(str, mask_2f);
+        const __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+        const __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+        if(!_mm256_testz_si256(lo, hi)) {
+            break;
+        }
+
+        const __m256i eq_2f = _mm256_cmpeq_epi8(str, mask_2f);
+        str = _mm256_add_epi8(str, _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles)));
+
+        const __m256i merged = _mm256_maddubs_epi16(str, _mm256_set1_epi32(0x01400140));
+        __m256i packed = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+        packed = _mm256_shuffle_epi8(packed, pack);
+        // 12 bytes per lane, close the gap between them
+        packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), packed);
+    }
+    return i;
+}
+
+#endif
+
+Isa detect() {
+#ifdef BASE64_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) {
+        return Isa::AVX2;
+    }
+    if(__builtin_cpu_supports("ssse3")) {
+        return Isa::SSSE3;
+    }
+#endif
+    return Isa::SCALAR;
+}
+
+// chars of text the vector kernels decoded into out, a multiple of 4
+size_t decodeVector(Isa isa, std::string_view text, uint8_t* out) {
+    size_t done = 0;
+#ifdef BASE64_X86
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(text.data());
+    if(isa == Isa::AVX2) {
+        done = decodeAvx2(in, text.size(), out);
+        // stopped early on a bad block, let the scalar code find and report it
+        if(text.size() - done >= 48) {
+            return done;
+        }
+    }
+    if(isa >= Isa::SSSE3) {
+        done += decodeSsse3(in + done, text.size() - done, out + done / 4 * 3);
+    }
+#endif
+    return done;
+}
+
+}  // namespace
+
+Isa detected_isa() {
+    static const Isa isa = detect();
+    return isa;
+}
+
+const char* isa_name(Isa isa) {
+    switch(isa) {
+        case Isa::AVX2:
+            return "avx2";
+        case Isa::SSSE3:
+            return "ssse3";
+        case Isa::SCALAR:
+            break;
+    }
+    return "scalar";
+}
+
+size_t encode_to(Isa isa, std::string_view data, char* out) {
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(data.data());
+    size_t n = data.size();
+    size_t done = 0;
+    char* dst = out;
+#ifdef BASE64_X86
+    if(isa == Isa::AVX2) {
+        done = encodeAvx2(in, n, dst);
+        dst += done / 3 * 4;
+    }
+    if(isa >= Isa::SSSE3) {
+        size_t more = encodeSsse3(in + done, n - done, dst);
+        done += more;
+        dst += more / 3 * 4;
+    }
+#endif
+    dst += encodeScalar(in + done, n - done, dst);
+    return dst - out;
+}
+
+size_t encode_to(std::string_view data, char* out) {
+    return encode_to(detected_isa(), data, out);
+}
+
+std::string encode_with(Isa isa, std::string_view data) {
+    std::string out(encoded_size(data.size()), '\0');
+    encode_to(isa, data, out.data());
+    return out;
+}
+
+std::string encode_fast(std::string_view data) {
+    return encode_with(detected_isa(), data);
+}
+
+std::string decode_with(Isa isa, std::string_view text) {
+    // sizes, padding and short inputs are all the scalar decoder's, so are its errors
+    if(isa == Isa::SCALAR || text.size() < 24 || text.size() % 4 != 0) {
+        return decode_into<std::string>(text);
+    }
+    size_t padding = (text[text.size() - 1] == '=') + (text[text.size() - 2] == '=');
+    std::string out(text.size() / 4 * 3 - padding, '\0');
+
+    size_t done = decodeVector(isa, text, reinterpret_cast<uint8_t*>(out.data()));
+    std::string tail = decode_into<std::string>(text.substr(done));
+    // only a valid tail decodes, and a valid tail has exactly the padding counted above
+    if(tail.size() != out.size() - done / 4 * 3) {
+        return decode_into<std::string>(text);
+    }
+    std::memcpy(out.data() + done / 4 * 3, tail.data(), tail.size());
+    return out;
+}
+
+std::string decode_fast(std::string_view text) {
+    return decode_with(detected_isa(), text);
+}
+
+}  // namespace base64
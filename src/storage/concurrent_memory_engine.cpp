@@ -0,0 +1,86 @@
+#include "storage/concurrent_memory_engine.h"
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <thread>
+#include <utility>
+
+ConcurrentMemoryEngine::ConcurrentMemoryEngine(size_t shards, size_t capacity_bytes) {
+    if(shards == 0) {
+        shards = std::max(1u, std::thread::hardware_concurrency()) * 4;
+    }
+    shards = std::bit_ceil(shards);
+
+    // a budget that doesn't split evenly loses the remainder, never more than shards bytes
+    size_t slice = capacity_bytes == 0 ? 0 : std::max<size_t>(capacity_bytes / shards, 1);
+    shards_.reserve(shards);
+    for(size_t i = 0; i < shards; i++) {
+        shards_.push_back(std::make_unique<MemoryEngine>(slice));
+    }
+    shift_ = 64 - std::countr_zero(shards);
+}
+
+MemoryEngine& ConcurrentMemoryEngine::shardFor(const std::string &key) {
+    // the flat map inside the shard uses the low bits of the same hash,
+    // so pick the shard from the top bits after a multiplicative mix
+    uint64_t h = std::hash<std::string>{}(key) * 0x9E3779B97F4A7C15ull;
+    size_t idx = shift_ == 64 ? 0 : h >> shift_;
+    return *shards_[idx];
+}
+
+StorageResult<ByteString> ConcurrentMemoryEngine::lookup(const std::string &key) {
+    return shardFor(key).lookup(key);
+}
+
+StorageResult<void> ConcurrentMemoryEngine::view(const std::string &key, const ViewFn &fn) {
+    return shardFor(key).view(key, fn);
+}
+
+bool ConcurrentMemoryEngine::contains(const std::string &key) {
+    return shardFor(key).contains(key);
+}
+
+void ConcurrentMemoryEngine::put(const std::string &key, ByteString value) {
+    shardFor(key).put(key, std::move(value));
+}
+
+void ConcurrentMemoryEngine::remove(const std::string &key) {
+    shardFor(key).remove(key);
+}
+
+void ConcurrentMemoryEngine::scan(const std::string &from, const ScanFn &fn) {
+    std::vector<std::pair<std::string, ByteString>> entries;
+    for(auto &shard : shards_) {
+        shard->scan(from, [&entries](const std::string &key, const ByteString &value) {
+            entries.emplace_back(key, value);
+            return true;
+        });
+    }
+    std::sort(entries.begin(), entries.end(), [](const auto &a, const auto &b) {
+        return a.first < b.first;
+    });
+
+    for(auto &[key, value] : entries) {
+        if(!fn(key, value)) {
+            break;
+        }
+    }
+}
+
+size_t ConcurrentMemoryEngine::size() {
+    return stats().entries_;
+}
+
+MemoryEngineStats ConcurrentMemoryEngine::stats() {
+    MemoryEngineStats total;
+    for(auto &shard : shards_) {
+        auto stats = shard->stats();
+        total.bytes_ += stats.bytes_;
+        total.capacity_ += stats.capacity_;
+        total.entries_ += stats.entries_;
+        total.hits_ += stats.hits_;
+        total.misses_ += stats.misses_;
+        total.evictions_ += stats.evictions_;
+    }
+    return total;
+}
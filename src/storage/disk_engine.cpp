@@ -1,66 +1,239 @@
 #include "storage/disk_engine.h"
 #include "leveldb/db.h"
+#include "leveldb/write_batch.h"
+#include "leveldb/cache.h"
+#include "leveldb/filter_policy.h"
 #include "logging/logger.h"
 #include "error/storage_error.h"
+#include <memory>
 
 const std::string DB_PATH{"/tmp/dynamo"};
 
-DiskEngine::DiskEngine(std::string id, const std::string& postfix) {
-    leveldb::Options options;
-    options.create_if_missing = true;
-    leveldb::Status status = leveldb::DB::Open(options,  DB_PATH + id + postfix, &db_);
-    if(!status.ok()) {
-        Logger::instance().error(status.ToString());
-        throw StorageError("Error instantiating leveldb engine...");
+DiskEngineOptions& DiskEngineOptions::applyProfile(const std::string& name) {
+    if(name == "default") {
+        block_cache_bytes_ = 0;
+        bloom_bits_per_key_ = 0;
+        write_buffer_bytes_ = 4 << 20;
+        max_file_bytes_ = 2 << 20;
+    } else if(name == "balanced") {
+        block_cache_bytes_ = 64 << 20;
+        bloom_bits_per_key_ = 10;
+        write_buffer_bytes_ = 16 << 20;
+        max_file_bytes_ = 8 << 20;
+    } else if(name == "read-heavy") {
+        // misses on a get are the common case for a replica, the filter saves a disk read each
+        block_cache_bytes_ = 256 << 20;
+        bloom_bits_per_key_ = 10;
+        write_buffer_bytes_ = 4 << 20;
+        max_file_bytes_ = 2 << 20;
+    } else if(name == "write-heavy") {
+        // a big memtable flushes less often, so level 0 fills up slower and compaction keeps up
+        block_cache_bytes_ = 32 << 20;
+        bloom_bits_per_key_ = 10;
+        write_buffer_bytes_ = 64 << 20;
+        max_file_bytes_ = 32 << 20;
+    } else {
+        throw StorageError("Unknown leveldb profile: " + name);
     }
+    block_bytes_ = 4 << 10;
+    compression_ = true;
+    profile_ = name;
+    return *this;
+}
+
+void to_json(json& j, const DiskEngineOptions& o) {
+    j = json{
+        {"profile", o.profile_},
+        {"block_cache_bytes", o.block_cache_bytes_},
+        {"bloom_bits_per_key", o.bloom_bits_per_key_},
+        {"write_buffer_bytes", o.write_buffer_bytes_},
+        {"max_file_bytes", o.max_file_bytes_},
+        {"block_bytes", o.block_bytes_},
+        {"compression", o.compression_ ? "snappy" : "none"},
+        {"sync", syncPolicyToStr(o.commit_.sync_)},
+        {"sample_interval_ms", o.sample_interval_.count()},
+        {"stall_threshold_ms", o.stall_threshold_.count()},
+    };
 }
 
+DiskEngine::DiskEngine(std::string id, const std::string& postfix, DiskEngineOptions engine_options) :
+    options_(engine_options) {
+        leveldb::Options options;
+        options.create_if_missing = true;
+        options.write_buffer_size = options_.write_buffer_bytes_;
+        options.max_file_size = options_.max_file_bytes_;
+        options.block_size = options_.block_bytes_;
+        options.compression = options_.compression_ ? leveldb::kSnappyCompression : leveldb::kNoCompression;
+        if(options_.block_cache_bytes_ > 0) {
+            block_cache_.reset(leveldb::NewLRUCache(options_.block_cache_bytes_));
+            options.block_cache = block_cache_.get();
+        }
+        if(options_.bloom_bits_per_key_ > 0) {
+            filter_policy_.reset(leveldb::NewBloomFilterPolicy(options_.bloom_bits_per_key_));
+            options.filter_policy = filter_policy_.get();
+        }
+
+        leveldb::Status status = leveldb::DB::Open(options,  DB_PATH + id + postfix, &db_);
+        if(!status.ok()) {
+            Logger::instance().error(status.ToString());
+            throw StorageError("Error instantiating leveldb engine...");
+        }
+        telemetry_ = std::make_unique<DiskTelemetry>(
+            db_, options_.sample_interval_,
+            std::chrono::duration_cast<std::chrono::microseconds>(options_.stall_threshold_)
+        );
+        commit_ = std::make_unique<GroupCommit>(db_, options_.commit_, &telemetry_->stalls());
+    }
+
 DiskEngine::~DiskEngine() {
     Logger::instance().debug("Killing disk engine...");
+    // the committer and the sampler still use the db, stop them before it goes away
+    commit_.reset();
+    telemetry_.reset();
     delete db_;
 }
 
-DiskEngine::DiskEngine(DiskEngine&& other) noexcept : db_(other.db_) {
-    other.db_ = nullptr;
-}
+DiskEngine::DiskEngine(DiskEngine&& other) noexcept :
+    db_(other.db_),
+    options_(std::move(other.options_)),
+    block_cache_(std::move(other.block_cache_)),
+    filter_policy_(std::move(other.filter_policy_)),
+    telemetry_(std::move(other.telemetry_)),
+    commit_(std::move(other.commit_)) {
+        other.db_ = nullptr;
+    }
 
 DiskEngine& DiskEngine::operator=(DiskEngine&& other) noexcept {
     if(this != &other) {
+        commit_.reset();
+        telemetry_.reset();
         delete db_;
         this->db_ = other.db_;
+        this->options_ = std::move(other.options_);
+        this->block_cache_ = std::move(other.block_cache_);
+        this->filter_policy_ = std::move(other.filter_policy_);
+        this->telemetry_ = std::move(other.telemetry_);
+        this->commit_ = std::move(other.commit_);
         other.db_ = nullptr;
     }
     return *this;
 }
 
-ByteString DiskEngine::get(const std::string &key) {
+static StorageFailure readFailure(const leveldb::Status &s) {
+    if(s.IsNotFound()) {
+        return StorageFailure{StorageCode::NOT_FOUND, "Key not found"};
+    }
+    StorageCode code = s.IsCorruption() ? StorageCode::CORRUPTION : StorageCode::IO_ERROR;
+    return StorageFailure{code, "Error fetching key: " + s.ToString()};
+}
+
+StorageResult<ByteString> DiskEngine::lookup(const std::string &key) {
     std::string data{};
     leveldb::Status s = db_ -> Get(leveldb::ReadOptions(), key, &data);
-    // we do not consider not found to be an error
-    if(!s.ok() && !s.IsNotFound()) {
-        throw StorageError("Error fetching key: " + s.ToString());
+    if(s.ok()) {
+        return data;
+    }
+    return std::unexpected(readFailure(s));
+}
+
+StorageResult<void> DiskEngine::view(const std::string &key, const ViewFn &fn) {
+    // leveldb assigns into it, so the capacity from earlier reads is kept
+    thread_local std::string buffer;
+    leveldb::Status s = db_ -> Get(leveldb::ReadOptions(), key, &buffer);
+    if(!s.ok()) {
+        return std::unexpected(readFailure(s));
     }
-    return data;
+    fn(buffer);
+    return {};
 }
 
 void DiskEngine::put(const std::string &key, const ByteString value) {
-    leveldb::Status s = db_ -> Put(leveldb::WriteOptions(), key, value);
+    leveldb::WriteBatch batch;
+    batch.Put(key, value);
+    leveldb::Status s = commit_ -> write(&batch);
     if(!s.ok()) {
         throw StorageError("Error writing key: " + s.ToString());
     }
 }
 
-// TODO
-// this does two reads, make better later
+void DiskEngine::write(leveldb::WriteBatch &batch) {
+    leveldb::Status s = commit_->write(&batch);
+    if(!s.ok()) {
+        throw StorageError("Error writing batch: " + s.ToString());
+    }
+}
+
 bool DiskEngine::contains(const std::string &key) {
-    std::string data{};
-    leveldb::Status s = db_ -> Get(leveldb::ReadOptions(), key, &data);
-    return !s.IsNotFound();
+    auto value = lookup(key);
+    // a failed read counts as present, get() is where that error surfaces
+    return value || !value.error().notFound();
+}
+
+void DiskEngine::scan(const std::string &from, const ScanFn &fn) {
+    std::unique_ptr<leveldb::Iterator> it{db_->NewIterator(leveldb::ReadOptions())};
+    for(it->Seek(from); it->Valid(); it->Next()) {
+        std::string key{it->key().data(), it->key().size()};
+        ByteString value{it->value().data(), it->value().size()};
+        if(!fn(key, value)) {
+            break;
+        }
+    }
+    if(!it->status().ok()) {
+        throw StorageError("Error scanning from key: " + from + ". " + it->status().ToString());
+    }
 }
 
 void DiskEngine::remove(const std::string &key) {
-    leveldb::Status s = db_->Delete(leveldb::WriteOptions(), key);
+    leveldb::WriteBatch batch;
+    batch.Delete(key);
+    leveldb::Status s = commit_->write(&batch);
     if(!s.ok()) {
         throw StorageError("Error remove key key: " + key + ". " + s.ToString());
     }
-}
\ No newline at end of file
+}
+
+void to_json(json& j, const DiskEngineStats& s) {
+    json levels = json::array();
+    for(auto &level : s.levels_) {
+        levels.push_back({
+            {"level", level.level_},
+            {"files", level.files_},
+            {"bytes", level.bytes_},
+            {"compaction_seconds", level.compaction_seconds_},
+            {"compaction_read_bytes", level.compaction_read_bytes_},
+            {"compaction_write_bytes", level.compaction_write_bytes_},
+        });
+    }
+    j = json{
+        {"sampled_at_ms", s.sampled_at_ms_},
+        {"levels", levels},
+        {"disk_usage_bytes", s.disk_usage_bytes_},
+        {"pending_compaction_bytes", s.pending_compaction_bytes_},
+        {"memory_usage_bytes", s.memory_usage_bytes_},
+        {"largest_file_bytes", s.largest_file_bytes_},
+        {"l0_files", s.l0_files_},
+        {"slowdown_samples", s.slowdown_samples_},
+        {"stop_samples", s.stop_samples_},
+        {"stalls", s.stalls_},
+        {"commit", s.commit_},
+        {"options", s.options_},
+    };
+}
+
+DiskEngineStats DiskEngine::stats() {
+    LevelDBSample sample = telemetry_->latest();
+    DiskEngineStats out{};
+    out.sampled_at_ms_ = sample.sampled_at_ms_;
+    out.levels_ = std::move(sample.levels_);
+    out.disk_usage_bytes_ = sample.disk_usage_bytes_;
+    out.pending_compaction_bytes_ = sample.pending_compaction_bytes_;
+    out.memory_usage_bytes_ = sample.memory_usage_bytes_;
+    out.largest_file_bytes_ = sample.largest_file_bytes_;
+    out.l0_files_ = telemetry_->l0Files();
+    out.slowdown_samples_ = telemetry_->slowdownSamples();
+    out.stop_samples_ = telemetry_->stopSamples();
+    out.stalls_ = telemetry_->stalls().stats();
+    out.commit_ = commit_->stats();
+    out.options_ = options_;
+    return out;
+}
@@ -0,0 +1,160 @@
+#include "storage/disk_telemetry.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+// mirrors leveldb's own compaction triggers (db/dbformat.h, db/version_set.cc)
+const uint64_t L0_COMPACTION_TRIGGER = 4;
+const double LEVEL1_MAX_BYTES = 10.0 * 1048576.0;
+
+std::vector<LevelStats> parseLevelStats(const std::string& raw) {
+    //                                Compactions
+    // Level  Files Size(MB) Time(sec) Read(MB) Write(MB)
+    // --------------------------------------------------
+    //   0        2        1         0        0         1
+    std::vector<LevelStats> out;
+    std::istringstream in(raw);
+    std::string line;
+    bool table = false;
+    while(std::getline(in, line)) {
+        if(line.starts_with("---")) {
+            table = true;
+            continue;
+        }
+        if(!table) continue;
+
+        std::istringstream row(line);
+        LevelStats level{};
+        double size_mb = 0;
+        double read_mb = 0;
+        double write_mb = 0;
+        if(row >> level.level_ >> level.files_ >> size_mb) {
+            level.bytes_ = static_cast<uint64_t>(size_mb * 1048576.0);
+            if(row >> level.compaction_seconds_ >> read_mb >> write_mb) {
+                level.compaction_read_bytes_ = static_cast<uint64_t>(read_mb * 1048576.0);
+                level.compaction_write_bytes_ = static_cast<uint64_t>(write_mb * 1048576.0);
+            }
+            out.push_back(level);
+        }
+    }
+    return out;
+}
+
+uint64_t parseLargestFile(const std::string& raw) {
+    // --- level 0 ---
+    //  12:4321['a' @ 5 : 1 .. 'z' @ 9 : 1]
+    // file number, then size in bytes, then the key range
+    uint64_t largest = 0;
+    std::istringstream in(raw);
+    std::string line;
+    while(std::getline(in, line)) {
+        if(line.starts_with("---")) continue;
+        auto colon = line.find(':');
+        auto bracket = line.find('[', colon);
+        if(colon == std::string::npos || bracket == std::string::npos) continue;
+        try {
+            largest = std::max<uint64_t>(largest, std::stoull(line.substr(colon + 1, bracket - colon - 1)));
+        } catch(const std::exception&) {
+            continue;
+        }
+    }
+    return largest;
+}
+
+DiskTelemetry::DiskTelemetry(leveldb::DB* db, std::chrono::milliseconds interval, std::chrono::microseconds stall_threshold) :
+    db_(db),
+    interval_(interval),
+    stalls_(stall_threshold) {
+        if(interval_.count() > 0) {
+            sampler_ = std::thread([this] { sampleLoop(); });
+        }
+    }
+
+DiskTelemetry::~DiskTelemetry() {
+    {
+        std::lock_guard<std::mutex> lk(sample_mu_);
+        running_.store(false);
+    }
+    sample_cv_.notify_all();
+    if(sampler_.joinable()) {
+        sampler_.join();
+    }
+}
+
+void DiskTelemetry::sampleLoop() {
+    std::unique_lock<std::mutex> lk(sample_mu_);
+    while(running_.load()) {
+        lk.unlock();
+        sample();
+        stalls_.tick(std::chrono::steady_clock::now());
+        lk.lock();
+
+        sample_cv_.wait_for(lk, interval_, [this] {
+            return !running_.load();
+        });
+    }
+}
+
+LevelDBSample DiskTelemetry::sample() {
+    LevelDBSample out;
+    out.sampled_at_ms_ = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+
+    std::string raw;
+    if(db_->GetProperty("leveldb.stats", &raw)) {
+        out.levels_ = parseLevelStats(raw);
+    }
+    if(db_->GetProperty("leveldb.sstables", &raw)) {
+        out.largest_file_bytes_ = parseLargestFile(raw);
+    }
+    if(db_->GetProperty("leveldb.approximate-memory-usage", &raw)) {
+        try {
+            out.memory_usage_bytes_ = std::stoull(raw);
+        } catch(const std::exception&) {}
+    }
+
+    uint64_t l0_files = 0;
+    for(auto &level : out.levels_) {
+        out.disk_usage_bytes_ += level.bytes_;
+
+        if(level.level_ == 0) {
+            l0_files = level.files_;
+            if(level.files_ >= L0_COMPACTION_TRIGGER) {
+                out.pending_compaction_bytes_ += level.bytes_;
+            }
+            continue;
+        }
+
+        double target = LEVEL1_MAX_BYTES * std::pow(10.0, level.level_ - 1);
+        if(level.bytes_ > target) {
+            out.pending_compaction_bytes_ += level.bytes_ - static_cast<uint64_t>(target);
+        }
+    }
+
+    l0_files_.record(l0_files);
+    stalls_.setL0Files(l0_files);
+    if(l0_files >= L0_STOP_WRITES_TRIGGER) {
+        stop_samples_.fetch_add(1, std::memory_order_relaxed);
+    } else if(l0_files >= L0_SLOWDOWN_WRITES_TRIGGER) {
+        slowdown_samples_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::lock_guard<std::mutex> lk(mu_);
+    latest_ = out;
+    return out;
+}
+
+LevelDBSample DiskTelemetry::latest() {
+    if(interval_.count() == 0) {
+        stalls_.tick(std::chrono::steady_clock::now());
+        return sample();
+    }
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        if(latest_.sampled_at_ms_ != 0) {
+            return latest_;
+        }
+    }
+    return sample();
+}
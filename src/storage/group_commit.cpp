@@ -0,0 +1,165 @@
+#include "storage/group_commit.h"
+#include "error/storage_error.h"
+#include "logging/logger.h"
+
+SyncPolicy syncPolicyFromStr(const std::string& policy) {
+    if(policy == "none") return SyncPolicy::NONE;
+    if(policy == "batch") return SyncPolicy::BATCH;
+    if(policy == "interval") return SyncPolicy::INTERVAL;
+    throw StorageError("Unknown sync policy: " + policy);
+}
+
+const char* syncPolicyToStr(SyncPolicy policy) {
+    switch(policy) {
+        case SyncPolicy::NONE: return "none";
+        case SyncPolicy::BATCH: return "batch";
+        case SyncPolicy::INTERVAL: return "interval";
+    }
+    return "?";
+}
+
+void to_json(json& j, const GroupCommitStats& s) {
+    j = json{
+        {"batch_size", s.batch_size_},
+        {"batch_bytes", s.batch_bytes_},
+        {"commit_latency_us", s.commit_latency_us_},
+        {"syncs", s.syncs_},
+    };
+}
+
+GroupCommit::GroupCommit(leveldb::DB* db, GroupCommitOptions options, StallDetector* stalls) :
+    db_(db),
+    options_(options),
+    stalls_(stalls),
+    last_sync_(std::chrono::steady_clock::now()) {
+        if(options_.sync_ == SyncPolicy::INTERVAL) {
+            syncer_ = std::thread([this] { syncLoop(); });
+        }
+    }
+
+GroupCommit::~GroupCommit() {
+    {
+        std::lock_guard<std::mutex> lk(sync_mu_);
+        running_.store(false);
+    }
+    sync_cv_.notify_all();
+    if(syncer_.joinable()) {
+        syncer_.join();
+    }
+}
+
+leveldb::Status GroupCommit::write(leveldb::WriteBatch* batch) {
+    Writer w{batch, options_.sync_ == SyncPolicy::BATCH};
+    return enqueue(w);
+}
+
+// an idle node would otherwise sit on unsynced writes until the next put
+void GroupCommit::syncLoop() {
+    std::unique_lock<std::mutex> lk(sync_mu_);
+    while(running_.load()) {
+        sync_cv_.wait_for(lk, options_.sync_interval_, [this] {
+            return !running_.load();
+        });
+        if(!running_.load()) {
+            break;
+        }
+        if(!dirty_.load()) {
+            continue;
+        }
+
+        lk.unlock();
+        leveldb::WriteBatch empty;
+        Writer w{&empty, true};
+        leveldb::Status s = enqueue(w);
+        if(!s.ok()) {
+            Logger::instance().error("Periodic sync failed: " + s.ToString());
+        }
+        lk.lock();
+    }
+}
+
+leveldb::Status GroupCommit::enqueue(Writer& w) {
+    std::unique_lock<std::mutex> lk(mu_);
+    writers_.push_back(&w);
+    w.cv_.wait(lk, [&] {
+        return w.done_ || &w == writers_.front();
+    });
+    if(w.done_) {
+        return w.status_;
+    }
+
+    // we are the leader, take everything queued behind us that fits
+    bool sync = w.sync_;
+    group_.Clear();
+    size_t count = 0;
+    Writer* last = nullptr;
+    for(Writer* other : writers_) {
+        if(count > 0 && group_.ApproximateSize() + other->batch_->ApproximateSize() > options_.max_batch_bytes_) {
+            break;
+        }
+        group_.Append(*other->batch_);
+        sync = sync || other->sync_;
+        last = other;
+        count++;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if(options_.sync_ == SyncPolicy::INTERVAL && now - last_sync_ >= options_.sync_interval_) {
+        sync = true;
+    }
+    size_t bytes = group_.ApproximateSize();
+
+    // followers keep queueing up while we are in leveldb
+    lk.unlock();
+
+    leveldb::WriteOptions write_options;
+    write_options.sync = sync;
+    auto start = std::chrono::steady_clock::now();
+    leveldb::Status status = db_->Write(write_options, &group_);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    auto latency = std::chrono::duration_cast<std::chrono::microseconds>(elapsed);
+    commit_latency_us_.record(latency.count());
+    if(stalls_) {
+        stalls_->onCommit(start, latency, count);
+    }
+    batch_size_.record(count);
+    batch_bytes_.record(bytes);
+
+    lk.lock();
+    if(sync && status.ok()) {
+        last_sync_ = start;
+        dirty_.store(false);
+        syncs_.fetch_add(1, std::memory_order_relaxed);
+    } else if(!sync) {
+        dirty_.store(true);
+    }
+
+    while(true) {
+        Writer* done = writers_.front();
+        writers_.pop_front();
+        if(done != &w) {
+            done->status_ = status;
+            done->done_ = true;
+            done->cv_.notify_one();
+        }
+        if(done == last) {
+            break;
+        }
+    }
+
+    // hand leadership to whoever queued up meanwhile
+    if(!writers_.empty()) {
+        writers_.front()->cv_.notify_one();
+    }
+    return status;
+}
+
+GroupCommitStats GroupCommit::stats() {
+    GroupCommitStats out;
+    out.batch_size_ = batch_size_.snapshot();
+    out.batch_bytes_ = batch_bytes_.snapshot();
+    out.commit_latency_us_ = commit_latency_us_.snapshot();
+    out.syncs_ = syncs_.load(std::memory_order_relaxed);
+    return out;
+}
@@ -0,0 +1,323 @@
+#include "storage/hybrid_hint_engine.h"
+#include "error/storage_error.h"
+#include "logging/logger.h"
+#include "leveldb/db.h"
+#include "leveldb/write_batch.h"
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+
+// record layout: op (1 byte) | key length (u32) | value length (u32) | key | value
+const size_t RECORD_HEADER = 1 + 2 * sizeof(uint32_t);
+// the log is rewritten from memory once dead records make it this much bigger than the live set
+const size_t LOG_REWRITE_FACTOR = 4;
+const size_t LOG_REWRITE_MIN_BYTES = 1 << 20;
+
+static size_t entrySize(const std::string &key, const ByteString &value) {
+    return key.size() + value.size();
+}
+
+HybridHintEngine::HybridHintEngine(std::string log_path, std::shared_ptr<DiskEngine> spill, size_t memory_budget) :
+    budget_(memory_budget),
+    log_path_(std::move(log_path)),
+    spill_(spill) {
+        spill_->scan("", [this](const std::string&, const ByteString&) {
+            spilled_keys_++;
+            return true;
+        });
+        replay();
+        dropSpilled();
+        openLog(false);
+
+        Logger::instance().info(
+            "Hint store loaded " + std::to_string(mem_.size()) + " hints from " + log_path_ +
+            ", " + std::to_string(spilled_keys_) + " spilled"
+        );
+    }
+
+HybridHintEngine::~HybridHintEngine() {
+    if(log_.is_open()) {
+        log_.flush();
+    }
+}
+
+void HybridHintEngine::replay() {
+    std::ifstream in(log_path_, std::ios::binary);
+    if(!in) {
+        return;
+    }
+
+    size_t good = 0;
+    while(true) {
+        char op;
+        uint32_t key_len, value_len;
+        if(!in.read(&op, 1) ||
+           !in.read(reinterpret_cast<char*>(&key_len), sizeof(key_len)) ||
+           !in.read(reinterpret_cast<char*>(&value_len), sizeof(value_len))) {
+            break;
+        }
+
+        std::string key(key_len, '\0');
+        ByteString value(value_len, '\0');
+        if(!in.read(key.data(), key_len) || !in.read(value.data(), value_len)) {
+            break;
+        }
+
+        if(op == PUT) {
+            auto it = mem_.find(key);
+            if(it != mem_.end()) {
+                mem_bytes_ -= entrySize(key, it->second);
+            }
+            mem_bytes_ += entrySize(key, value);
+            mem_[std::move(key)] = std::move(value);
+        } else if(op == REMOVE) {
+            auto it = mem_.find(key);
+            if(it != mem_.end()) {
+                mem_bytes_ -= entrySize(key, it->second);
+                mem_.erase(it);
+            }
+        } else {
+            Logger::instance().warn("Unknown record in hint log " + log_path_ + ", ignoring the rest");
+            break;
+        }
+        good += RECORD_HEADER + key_len + value_len;
+    }
+    in.close();
+
+    // a crash mid append leaves a torn record at the end, cut it off so new records line up
+    std::error_code ec;
+    if(std::filesystem::file_size(log_path_, ec) != good && !ec) {
+        Logger::instance().warn("Truncating torn tail of hint log " + log_path_);
+        std::filesystem::resize_file(log_path_, good, ec);
+    }
+    log_bytes_ = good;
+}
+
+// a crash between a spill's write and the log truncate leaves the spilled hints in both
+// places. the disk copy is at least as new, nothing is logged for a key once it is on disk
+void HybridHintEngine::dropSpilled() {
+    if(spilled_keys_ == 0) {
+        return;
+    }
+
+    size_t dropped = 0;
+    for(auto it = mem_.begin(); it != mem_.end();) {
+        if(spill_->contains(it->first)) {
+            mem_bytes_ -= entrySize(it->first, it->second);
+            it = mem_.erase(it);
+            dropped++;
+        } else {
+            ++it;
+        }
+    }
+
+    if(dropped > 0) {
+        Logger::instance().warn(
+            "Dropped " + std::to_string(dropped) + " hints from " + log_path_ +
+            " that were already spilled, last spill was interrupted"
+        );
+        rewriteLog();
+    }
+}
+
+void HybridHintEngine::openLog(bool truncate) {
+    if(log_.is_open()) {
+        log_.close();
+    }
+    auto mode = std::ios::binary | (truncate ? std::ios::trunc : std::ios::app);
+    log_.open(log_path_, mode);
+    if(!log_) {
+        throw StorageError("Error opening hint log: " + log_path_);
+    }
+    if(truncate) {
+        log_bytes_ = 0;
+    }
+}
+
+// returns the number of bytes written
+static size_t writeRecord(std::ofstream &out, char op, const std::string &key, const ByteString &value) {
+    uint32_t key_len = key.size();
+    uint32_t value_len = value.size();
+
+    out.write(&op, 1);
+    out.write(reinterpret_cast<const char*>(&key_len), sizeof(key_len));
+    out.write(reinterpret_cast<const char*>(&value_len), sizeof(value_len));
+    out.write(key.data(), key_len);
+    out.write(value.data(), value_len);
+    return RECORD_HEADER + key_len + value_len;
+}
+
+void HybridHintEngine::appendLog(Op op, const std::string &key, const ByteString &value) {
+    size_t written = writeRecord(log_, op, key, value);
+    // same durability as a leveldb write without sync, survives a process crash
+    log_.flush();
+    if(!log_) {
+        throw StorageError("Error appending to hint log: " + log_path_);
+    }
+    log_bytes_ += written;
+}
+
+void HybridHintEngine::rewriteLog() {
+    std::string tmp = log_path_ + ".tmp";
+    size_t written = 0;
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        for(auto &[key, value] : mem_) {
+            written += writeRecord(out, PUT, key, value);
+        }
+        out.flush();
+        if(!out) {
+            throw StorageError("Error rewriting hint log: " + tmp);
+        }
+    }
+
+    if(std::rename(tmp.c_str(), log_path_.c_str()) != 0) {
+        throw StorageError("Error replacing hint log: " + log_path_);
+    }
+    openLog(false);
+    log_bytes_ = written;
+}
+
+void HybridHintEngine::spill() {
+    leveldb::WriteBatch batch;
+    for(auto &[key, value] : mem_) {
+        batch.Put(key, value);
+    }
+    spill_->write(batch);
+
+    Logger::instance().info(
+        "Hint backlog over " + std::to_string(budget_) + " bytes, spilled " +
+        std::to_string(mem_.size()) + " hints to disk"
+    );
+
+    // only safe to drop the log once the batch is in leveldb's own log. if we die before
+    // the truncate the hints are in both places and dropSpilled sorts it out on load
+    spilled_keys_ += mem_.size();
+    mem_.clear();
+    mem_bytes_ = 0;
+    openLog(true);
+}
+
+bool HybridHintEngine::onDisk(const std::string &key) {
+    return spilled_keys_ > 0 && spill_->contains(key);
+}
+
+StorageResult<ByteString> HybridHintEngine::lookup(const std::string &key) {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto it = mem_.find(key);
+    if(it != mem_.end()) {
+        return it->second;
+    }
+    if(spilled_keys_ > 0) {
+        return spill_->lookup(key);
+    }
+    return std::unexpected(StorageFailure{StorageCode::NOT_FOUND, "Key not found"});
+}
+
+StorageResult<void> HybridHintEngine::view(const std::string &key, const ViewFn &fn) {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto it = mem_.find(key);
+    if(it != mem_.end()) {
+        fn(it->second);
+        return {};
+    }
+    if(spilled_keys_ > 0) {
+        return spill_->view(key, fn);
+    }
+    return std::unexpected(StorageFailure{StorageCode::NOT_FOUND, "Key not found"});
+}
+
+bool HybridHintEngine::contains(const std::string &key) {
+    std::lock_guard<std::mutex> lk(mu_);
+    return mem_.contains(key) || onDisk(key);
+}
+
+void HybridHintEngine::put(const std::string &key, const ByteString value) {
+    std::lock_guard<std::mutex> lk(mu_);
+
+    // already spilled, keep it where it is
+    if(!mem_.contains(key) && onDisk(key)) {
+        spill_->put(key, value);
+        return;
+    }
+
+    appendLog(PUT, key, value);
+    auto it = mem_.find(key);
+    if(it != mem_.end()) {
+        mem_bytes_ -= entrySize(key, it->second);
+        it->second = value;
+    } else {
+        mem_.emplace(key, value);
+    }
+    mem_bytes_ += entrySize(key, value);
+
+    if(mem_bytes_ > budget_) {
+        spill();
+    }
+}
+
+void HybridHintEngine::remove(const std::string &key) {
+    std::lock_guard<std::mutex> lk(mu_);
+
+    auto it = mem_.find(key);
+    if(it != mem_.end()) {
+        appendLog(REMOVE, key, {});
+        mem_bytes_ -= entrySize(key, it->second);
+        mem_.erase(it);
+
+        if(log_bytes_ > LOG_REWRITE_FACTOR * mem_bytes_ + LOG_REWRITE_MIN_BYTES) {
+            rewriteLog();
+        }
+        return;
+    }
+
+    if(onDisk(key)) {
+        spill_->remove(key);
+        spilled_keys_--;
+    }
+}
+
+void HybridHintEngine::scan(const std::string &from, const ScanFn &fn) {
+    std::lock_guard<std::mutex> lk(mu_);
+
+    auto mem_it = mem_.lower_bound(from);
+    std::unique_ptr<leveldb::Iterator> disk_it;
+    if(spilled_keys_ > 0) {
+        disk_it.reset(spill_->getDB()->NewIterator(leveldb::ReadOptions()));
+        disk_it->Seek(from);
+    }
+
+    // keys are never in both places so a plain merge is enough
+    while(true) {
+        bool mem_valid = mem_it != mem_.end();
+        bool disk_valid = disk_it && disk_it->Valid();
+        if(!mem_valid && !disk_valid) {
+            break;
+        }
+
+        bool take_mem = mem_valid && (!disk_valid || disk_it->key().ToString() > mem_it->first);
+        if(take_mem) {
+            if(!fn(mem_it->first, mem_it->second)) {
+                break;
+            }
+            ++mem_it;
+        } else {
+            std::string key{disk_it->key().data(), disk_it->key().size()};
+            ByteString value{disk_it->value().data(), disk_it->value().size()};
+            if(!fn(key, value)) {
+                break;
+            }
+            disk_it->Next();
+        }
+    }
+}
+
+size_t HybridHintEngine::memoryBytes() {
+    std::lock_guard<std::mutex> lk(mu_);
+    return mem_bytes_;
+}
+
+uint64_t HybridHintEngine::spilledKeys() {
+    std::lock_guard<std::mutex> lk(mu_);
+    return spilled_keys_;
+}
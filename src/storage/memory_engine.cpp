@@ -1,22 +1,235 @@
 #include "storage/memory_engine.h"
 #include "error/storage_error.h"
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <vector>
 
-ByteString MemoryEngine::get(const std::string &key) {
-    auto it = map_.find(key);
-    if(it != map_.end()) {
-        return it -> second;
+// bookkeeping per entry on top of key and value: list node, index slot, strings
+const size_t ENTRY_OVERHEAD = 96;
+// share of the capacity for the small fifo, 10% as in the S3-FIFO paper
+const size_t SMALL_FIFO_DIVISOR = 10;
+const uint8_t MAX_FREQ = 3;
+
+void to_json(json& j, const MemoryEngineStats& s) {
+    j = json{
+        {"bytes", s.bytes_},
+        {"capacity", s.capacity_},
+        {"entries", s.entries_},
+        {"hits", s.hits_},
+        {"misses", s.misses_},
+        {"evictions", s.evictions_},
+        {"hit_ratio", s.hitRatio()},
+    };
+}
+
+MemoryEngine::MemoryEngine(size_t capacity_bytes) : capacity_(capacity_bytes) {}
+
+size_t MemoryEngine::charge(const std::string &key, const ByteString &value) {
+    return key.size() + value.size() + ENTRY_OVERHEAD;
+}
+
+void MemoryEngine::touch(Entry &entry) {
+    uint8_t freq = entry.freq_.load(std::memory_order_relaxed);
+    // lost updates under contention are fine, this is only a hint
+    if(freq < MAX_FREQ) {
+        entry.freq_.store(freq + 1, std::memory_order_relaxed);
+    }
+}
+
+StorageResult<ByteString> MemoryEngine::lookup(const std::string &key) {
+    std::shared_lock lk(mu_);
+    auto it = index_.find(key);
+    if(it == index_.end()) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return std::unexpected(StorageFailure{StorageCode::NOT_FOUND, "Key not found"});
+    }
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    touch(*it->second);
+    return it->second->value_;
+}
+
+StorageResult<void> MemoryEngine::view(const std::string &key, const ViewFn &fn) {
+    std::shared_lock lk(mu_);
+    auto it = index_.find(key);
+    if(it == index_.end()) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return std::unexpected(StorageFailure{StorageCode::NOT_FOUND, "Key not found"});
     }
-    throw StorageError("Key not found");
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    touch(*it->second);
+    fn(it->second->value_);
+    return {};
 }
 
 bool MemoryEngine::contains(const std::string &key) {
-    return map_.contains(key);
+    std::shared_lock lk(mu_);
+    return index_.contains(key);
 }
 
-void MemoryEngine::put(const std::string &key, const ByteString value) {
-    map_[key] = value;
+void MemoryEngine::put(const std::string &key, ByteString value) {
+    std::unique_lock lk(mu_);
+
+    size_t cost = charge(key, value);
+    auto it = index_.find(key);
+
+    // can never fit, make sure we don't keep serving an older value either
+    if(capacity_ != 0 && cost > capacity_) {
+        if(it != index_.end()) {
+            auto entry = it->second;
+            drop(entry->queue_ == Queue::SMALL ? small_ : main_, entry);
+        }
+        return;
+    }
+
+    if(it != index_.end()) {
+        Entry &entry = *it->second;
+        size_t old_cost = charge(entry.key_, entry.value_);
+        bytes_ += cost - old_cost;
+        if(entry.queue_ == Queue::SMALL) {
+            small_bytes_ += cost - old_cost;
+        }
+        entry.value_ = std::move(value);
+        touch(entry);
+    } else if(capacity_ != 0 && takeGhost(key)) {
+        // evicted from small not long ago and wanted again, skip the probation
+        main_.emplace_front(key, std::move(value), Queue::MAIN);
+        index_.emplace(key, main_.begin());
+        bytes_ += cost;
+    } else {
+        small_.emplace_front(key, std::move(value), Queue::SMALL);
+        index_.emplace(key, small_.begin());
+        bytes_ += cost;
+        small_bytes_ += cost;
+    }
+
+    evict();
 }
 
 void MemoryEngine::remove(const std::string &key) {
-    map_.erase(key);
+    std::unique_lock lk(mu_);
+    auto it = index_.find(key);
+    if(it == index_.end()) {
+        return;
+    }
+    auto entry = it->second;
+    drop(entry->queue_ == Queue::SMALL ? small_ : main_, entry);
+}
+
+void MemoryEngine::drop(Fifo &fifo, Fifo::iterator it) {
+    size_t cost = charge(it->key_, it->value_);
+    bytes_ -= cost;
+    if(it->queue_ == Queue::SMALL) {
+        small_bytes_ -= cost;
+    }
+    index_.erase(it->key_);
+    fifo.erase(it);
+}
+
+void MemoryEngine::evict() {
+    if(capacity_ == 0) {
+        return;
+    }
+    while(bytes_ > capacity_) {
+        if(!small_.empty() && (small_bytes_ >= capacity_ / SMALL_FIFO_DIVISOR || main_.empty())) {
+            evictSmall();
+        } else {
+            evictMain();
+        }
+    }
+}
+
+void MemoryEngine::evictSmall() {
+    auto it = std::prev(small_.end());
+    if(it->freq_.load(std::memory_order_relaxed) > 0) {
+        // read again while on probation, promote
+        small_bytes_ -= charge(it->key_, it->value_);
+        it->queue_ = Queue::MAIN;
+        it->freq_.store(0, std::memory_order_relaxed);
+        main_.splice(main_.begin(), small_, it);
+        return;
+    }
+
+    rememberGhost(it->key_);
+    drop(small_, it);
+    evictions_++;
+}
+
+void MemoryEngine::evictMain() {
+    // each pass either evicts or spends one unit of frequency, so this terminates
+    while(true) {
+        auto it = std::prev(main_.end());
+        uint8_t freq = it->freq_.load(std::memory_order_relaxed);
+        if(freq > 0) {
+            it->freq_.store(freq - 1, std::memory_order_relaxed);
+            main_.splice(main_.begin(), main_, it);
+            continue;
+        }
+        drop(main_, it);
+        evictions_++;
+        return;
+    }
+}
+
+void MemoryEngine::rememberGhost(const std::string &key) {
+    size_t h = std::hash<std::string>{}(key);
+    ghost_.push_front(h);
+    ghost_counts_[h]++;
+
+    // as many keys as we currently cache, the paper sizes it like the main fifo
+    // but main starts out empty and would leave the ghost with no memory at all
+    size_t limit = std::max<size_t>(index_.size(), 1);
+    while(ghost_.size() > limit) {
+        size_t old = ghost_.back();
+        ghost_.pop_back();
+        auto it = ghost_counts_.find(old);
+        if(it != ghost_counts_.end() && --it->second == 0) {
+            ghost_counts_.erase(it);
+        }
+    }
+}
+
+// true if the key was in the ghost fifo, the stale list entry ages out on its own
+bool MemoryEngine::takeGhost(const std::string &key) {
+    auto it = ghost_counts_.find(std::hash<std::string>{}(key));
+    if(it == ghost_counts_.end()) {
+        return false;
+    }
+    if(--it->second == 0) {
+        ghost_counts_.erase(it);
+    }
+    return true;
+}
+
+void MemoryEngine::scan(const std::string &from, const ScanFn &fn) {
+    std::vector<std::pair<std::string, ByteString>> entries;
+    {
+        std::shared_lock lk(mu_);
+        for(auto &[key, it] : index_) {
+            if(key >= from) {
+                entries.emplace_back(key, it->value_);
+            }
+        }
+    }
+    std::sort(entries.begin(), entries.end(), [](const auto &a, const auto &b) {
+        return a.first < b.first;
+    });
+
+    for(auto &[key, value] : entries) {
+        if(!fn(key, value)) {
+            break;
+        }
+    }
+}
+
+MemoryEngineStats MemoryEngine::stats() {
+    std::shared_lock lk(mu_);
+    MemoryEngineStats out;
+    out.bytes_ = bytes_;
+    out.capacity_ = capacity_;
+    out.entries_ = index_.size();
+    out.hits_ = hits_.load(std::memory_order_relaxed);
+    out.misses_ = misses_.load(std::memory_order_relaxed);
+    out.evictions_ = evictions_;
+    return out;
 }
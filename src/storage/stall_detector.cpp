@@ -0,0 +1,88 @@
+#include "storage/stall_detector.h"
+#include "logging/logger.h"
+#include <algorithm>
+
+void to_json(json& j, const StallStats& s) {
+    j = json{
+        {"episodes", s.episodes_},
+        {"stalled_us", s.stalled_us_},
+        {"stalled", s.stalled_},
+        {"open_us", s.open_us_},
+        {"episode_us", s.episode_us_},
+        {"recent", s.recent_},
+    };
+}
+
+StallDetector::StallDetector(std::chrono::microseconds threshold, std::chrono::milliseconds quiet) :
+    threshold_(threshold),
+    quiet_(quiet) {}
+
+void StallDetector::setL0Files(uint64_t files) {
+    l0_files_.store(files, std::memory_order_relaxed);
+}
+
+void StallDetector::onCommit(std::chrono::steady_clock::time_point start, std::chrono::microseconds latency, size_t writes) {
+    std::lock_guard<std::mutex> lk(mu_);
+    if(latency < threshold_) {
+        if(stalled_) {
+            close();
+        }
+        return;
+    }
+
+    if(!stalled_) {
+        stalled_ = true;
+        started_ = start;
+        // steady clock for the duration, wall clock so the episode can be lined up with logs
+        auto age = std::chrono::steady_clock::now() - start;
+        current_ = StallEpisode{};
+        current_.started_at_ms_ = std::chrono::duration_cast<std::chrono::milliseconds>(
+            (std::chrono::system_clock::now() - age).time_since_epoch()
+        ).count();
+    }
+    current_.commits_++;
+    current_.writes_ += writes;
+    current_.l0_files_ = l0_files_.load(std::memory_order_relaxed);
+    last_slow_end_ = std::max(last_slow_end_, start + latency);
+}
+
+void StallDetector::tick(std::chrono::steady_clock::time_point now) {
+    std::lock_guard<std::mutex> lk(mu_);
+    if(stalled_ && now - last_slow_end_ >= quiet_) {
+        close();
+    }
+}
+
+// mu_ held
+void StallDetector::close() {
+    stalled_ = false;
+    current_.duration_us_ = std::chrono::duration_cast<std::chrono::microseconds>(last_slow_end_ - started_).count();
+
+    episodes_++;
+    stalled_us_ += current_.duration_us_;
+    episode_us_.record(current_.duration_us_);
+    recent_.push_back(current_);
+    if(recent_.size() > RECENT_EPISODES) {
+        recent_.pop_front();
+    }
+
+    Logger::instance().warn(
+        "Write stall: " + std::to_string(current_.duration_us_ / 1000) + "ms, "
+        + std::to_string(current_.writes_) + " writes, "
+        + std::to_string(current_.l0_files_) + " level 0 files"
+    );
+}
+
+StallStats StallDetector::stats() {
+    std::lock_guard<std::mutex> lk(mu_);
+    StallStats out;
+    out.episodes_ = episodes_;
+    out.stalled_us_ = stalled_us_;
+    out.stalled_ = stalled_;
+    if(stalled_) {
+        out.open_us_ = std::chrono::duration_cast<std::chrono::microseconds>(last_slow_end_ - started_).count();
+    }
+    out.episode_us_ = episode_us_.snapshot();
+    out.recent_.assign(recent_.begin(), recent_.end());
+    return out;
+}
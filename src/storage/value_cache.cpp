@@ -0,0 +1,154 @@
+#include "storage/value_cache.h"
+#include <functional>
+
+// list node, map slot, shared_ptr control block and vector header
+const size_t ENTRY_OVERHEAD = 128;
+// per vector clock entry on top of the node id, unordered_map node + counter
+const size_t CLOCK_ENTRY_OVERHEAD = 48;
+
+void to_json(json& j, const ValueCacheStats& s) {
+    uint64_t lookups = s.hits_ + s.misses_;
+    j = json{
+        {"bytes", s.bytes_},
+        {"capacity", s.capacity_},
+        {"entries", s.entries_},
+        {"hits", s.hits_},
+        {"misses", s.misses_},
+        {"hit_ratio", lookups == 0 ? 0.0 : static_cast<double>(s.hits_) / lookups},
+        {"stale_fills", s.stale_fills_},
+        {"rejected_fills", s.rejected_fills_},
+        {"evictions", s.evictions_},
+    };
+}
+
+ValueCache::ValueCache(size_t capacity_bytes, size_t shards) :
+    generations_(std::make_unique<std::array<std::atomic<uint64_t>, GENERATIONS>>()),
+    capacity_(capacity_bytes) {
+        if(shards == 0) {
+            shards = 1;
+        }
+        shards_.reserve(shards);
+        for(size_t i = 0; i < shards; i++) {
+            shards_.push_back(std::make_unique<Shard>());
+        }
+        shard_capacity_ = capacity_ / shards;
+    }
+
+size_t ValueCache::charge(const std::string &key, const ValueList &values) {
+    size_t bytes = key.size() + ENTRY_OVERHEAD;
+    for(auto &v : values) {
+        bytes += sizeof(Value) + v.data_.size();
+        for(auto &[node, _] : v.clock_.getTimes()) {
+            bytes += node.size() + CLOCK_ENTRY_OVERHEAD;
+        }
+    }
+    return bytes;
+}
+
+ValueCache::Shard& ValueCache::shardFor(size_t hash) {
+    // high bits for the shard, the flat map inside uses the low ones
+    return *shards_[(hash >> 32) % shards_.size()];
+}
+
+std::atomic<uint64_t>& ValueCache::generationFor(size_t hash) {
+    return (*generations_)[hash % GENERATIONS];
+}
+
+ValueCache::Ptr ValueCache::get(const std::string &key) {
+    if(capacity_ == 0) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    auto &shard = shardFor(std::hash<std::string>{}(key));
+    std::lock_guard<std::mutex> lk(shard.mu_);
+    auto it = shard.map_.find(key);
+    if(it == shard.map_.end()) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    shard.lru_.splice(shard.lru_.begin(), shard.lru_, it->second.lru_);
+    return it->second.values_;
+}
+
+uint64_t ValueCache::ticket(const std::string &key) {
+    return generationFor(std::hash<std::string>{}(key)).load(std::memory_order_acquire);
+}
+
+void ValueCache::fill(const std::string &key, Ptr values, uint64_t ticket) {
+    if(capacity_ == 0) {
+        return;
+    }
+
+    size_t hash = std::hash<std::string>{}(key);
+    size_t bytes = charge(key, *values);
+    if(bytes > shard_capacity_) {
+        return;
+    }
+
+    auto &shard = shardFor(hash);
+    std::lock_guard<std::mutex> lk(shard.mu_);
+
+    // checked under the shard lock, invalidate bumps the generation before it takes it
+    if(generationFor(hash).load(std::memory_order_acquire) != ticket) {
+        stale_fills_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    auto it = shard.map_.find(key);
+    if(it != shard.map_.end()) {
+        erase(shard, it);
+    } else if(admit_ && shard.bytes_ + bytes > shard_capacity_ && !admit_(key)) {
+        // a full cache only makes room for keys worth it
+        rejected_fills_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    shard.lru_.push_front(key);
+    shard.map_.emplace(key, Entry{std::move(values), bytes, shard.lru_.begin()});
+    shard.bytes_ += bytes;
+
+    while(shard.bytes_ > shard_capacity_) {
+        erase(shard, shard.map_.find(shard.lru_.back()));
+        evictions_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void ValueCache::invalidate(const std::string &key) {
+    size_t hash = std::hash<std::string>{}(key);
+    generationFor(hash).fetch_add(1, std::memory_order_acq_rel);
+
+    if(capacity_ == 0) {
+        return;
+    }
+
+    auto &shard = shardFor(hash);
+    std::lock_guard<std::mutex> lk(shard.mu_);
+    auto it = shard.map_.find(key);
+    if(it != shard.map_.end()) {
+        erase(shard, it);
+    }
+}
+
+void ValueCache::erase(Shard &shard, boost::unordered_flat_map<std::string, Entry>::iterator it) {
+    shard.bytes_ -= it->second.bytes_;
+    shard.lru_.erase(it->second.lru_);
+    shard.map_.erase(it);
+}
+
+ValueCacheStats ValueCache::stats() {
+    ValueCacheStats out;
+    out.capacity_ = capacity_;
+    for(auto &shard : shards_) {
+        std::lock_guard<std::mutex> lk(shard->mu_);
+        out.bytes_ += shard->bytes_;
+        out.entries_ += shard->map_.size();
+    }
+    out.hits_ = hits_.load(std::memory_order_relaxed);
+    out.misses_ = misses_.load(std::memory_order_relaxed);
+    out.stale_fills_ = stale_fills_.load(std::memory_order_relaxed);
+    out.rejected_fills_ = rejected_fills_.load(std::memory_order_relaxed);
+    out.evictions_ = evictions_.load(std::memory_order_relaxed);
+    return out;
+}
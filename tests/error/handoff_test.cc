@@ -0,0 +1,293 @@
+#include <gtest/gtest.h>
+#include "error/handoff.h"
+#include "storage/disk_engine.h"
+#include "storage/hybrid_hint_engine.h"
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+Value makeValue(const std::string& data, const std::string& node, int ticks) {
+    Value v{data, {}};
+    for(int i = 0; i < ticks; i++) {
+        v.clock_.increment(node);
+    }
+    return v;
+}
+
+std::string hintKey(const std::string& target, const std::string& key) {
+    return target + std::string(1, '\0') + key;
+}
+
+// a recovered target on a loopback port, records the keys of every batch it is sent
+class FakeTarget {
+    public:
+        FakeTarget() {
+            svr_.Post("/replication/batch", [this](const httplib::Request& req, httplib::Response& res) {
+                auto rpc = Serializer::fromBinary<BatchPutRpc>(req.body);
+                std::vector<std::string> keys;
+                for (auto& put : rpc.puts_) {
+                    keys.push_back(put.key_);
+                }
+                std::function<void()> hook;
+                {
+                    std::lock_guard<std::mutex> lk(mu_);
+                    batches_.push_back(keys);
+                    hook = std::exchange(on_first_batch_, nullptr);
+                }
+                if (hook) {
+                    hook();
+                }
+                res.status = 200;
+            });
+            port_ = svr_.bind_to_any_port("127.0.0.1");
+            thread_ = std::thread([this] {
+                svr_.listen_after_bind();
+            });
+            svr_.wait_until_ready();
+            id_ = "127.0.0.1:" + std::to_string(port_);
+        }
+
+        ~FakeTarget() {
+            svr_.stop();
+            if (thread_.joinable()) {
+                thread_.join();
+            }
+        }
+
+        std::vector<std::vector<std::string>> batches() {
+            std::lock_guard<std::mutex> lk(mu_);
+            return batches_;
+        }
+
+        // runs while the first batch is in flight, before it is answered
+        void onFirstBatch(std::function<void()> hook) {
+            std::lock_guard<std::mutex> lk(mu_);
+            on_first_batch_ = std::move(hook);
+        }
+
+        int port_{0};
+        std::string id_;
+
+    private:
+        httplib::Server svr_;
+        std::thread thread_;
+        std::mutex mu_;
+        std::vector<std::vector<std::string>> batches_;
+        std::function<void()> on_first_batch_;
+};
+
+template <typename Store>
+bool drained(Handoff<Store>& handoff, const std::string& target) {
+    for (int i = 0; i < 200; i++) {
+        auto stats = handoff.stats()[target];
+        if (stats.delivered_ > 0 && !stats.draining_) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+}
+
+template <typename Store>
+struct StoreFactory;
+
+template <>
+struct StoreFactory<DiskEngine> {
+    static std::shared_ptr<DiskEngine> make(const std::string& id) {
+        return std::make_shared<DiskEngine>(id, "");
+    }
+};
+
+template <>
+struct StoreFactory<HybridHintEngine> {
+    static std::shared_ptr<HybridHintEngine> make(const std::string& id) {
+        auto spill = std::make_shared<DiskEngine>(id, "");
+        return std::make_shared<HybridHintEngine>("/tmp/dynamo" + id + ".log", spill, 1 << 20);
+    }
+};
+
+template <typename Store>
+class HandoffTest : public ::testing::Test {
+    protected:
+        void SetUp() override {
+            id_ = std::string("handoff-test-") + ::testing::UnitTest::GetInstance()->current_test_info()->name() + "-" + std::to_string(getpid());
+            storage_ = StoreFactory<Store>::make(id_);
+            ring_ = std::make_shared<HashRing>();
+        }
+
+        void TearDown() override {
+            storage_.reset();
+            std::filesystem::remove_all("/tmp/dynamo" + id_);
+            std::filesystem::remove("/tmp/dynamo" + id_ + ".log");
+        }
+
+        std::string id_;
+        std::shared_ptr<Store> storage_;
+        std::shared_ptr<HashRing> ring_;
+};
+
+using Stores = ::testing::Types<DiskEngine, HybridHintEngine>;
+TYPED_TEST_SUITE(HandoffTest, Stores);
+
+TYPED_TEST(HandoffTest, BacklogIsPerTarget) {
+    Handoff<TypeParam> handoff{this->storage_, this->ring_};
+
+    handoff.append("k1", "a:1", makeValue("x", "n", 1));
+    handoff.append("k2", "a:1", makeValue("y", "n", 1));
+    handoff.append("k1", "b:1", makeValue("x", "n", 1));
+    // same key and target again only replaces the hint
+    handoff.append("k1", "a:1", makeValue("z", "n", 2));
+
+    EXPECT_EQ(handoff.backlog(), 3);
+    auto stats = handoff.stats();
+    EXPECT_EQ(stats["a:1"].backlog_, 2);
+    EXPECT_EQ(stats["b:1"].backlog_, 1);
+}
+
+TYPED_TEST(HandoffTest, KeepsSiblingsAndDropsSuperseded) {
+    Handoff<TypeParam> handoff{this->storage_, this->ring_};
+
+    handoff.append("k", "a:1", makeValue("old", "n", 1));
+    handoff.append("k", "a:1", makeValue("new", "n", 2));
+    handoff.append("k", "a:1", makeValue("sibling", "m", 1));
+    // older than what we hold, ignored
+    handoff.append("k", "a:1", makeValue("stale", "n", 1));
+
+    auto values = Serializer::fromBinary<ValueList>(this->storage_->get(hintKey("a:1", "k")));
+    ASSERT_EQ(values.size(), 2);
+    EXPECT_EQ(values[0].data_, "new");
+    EXPECT_EQ(values[1].data_, "sibling");
+    EXPECT_EQ(handoff.backlog(), 1);
+}
+
+TYPED_TEST(HandoffTest, BacklogSurvivesRestart) {
+    {
+        Handoff<TypeParam> handoff{this->storage_, this->ring_};
+        handoff.append("k1", "a:1", makeValue("x", "n", 1));
+        handoff.append("k2", "b:1", makeValue("y", "n", 1));
+    }
+
+    Handoff<TypeParam> handoff{this->storage_, this->ring_};
+    EXPECT_EQ(handoff.backlog(), 2);
+    EXPECT_EQ(handoff.stats()["b:1"].backlog_, 1);
+}
+
+TYPED_TEST(HandoffTest, MigratesLegacyRecords) {
+    HandoffData legacy;
+    legacy.targets_ = {"a:1", "b:1"};
+    legacy.data = makeValue("x", "n", 1);
+    this->storage_->put("k", Serializer::toBinary(legacy));
+
+    Handoff<TypeParam> handoff{this->storage_, this->ring_};
+
+    EXPECT_FALSE(this->storage_->contains("k"));
+    EXPECT_TRUE(this->storage_->contains(hintKey("a:1", "k")));
+    EXPECT_TRUE(this->storage_->contains(hintKey("b:1", "k")));
+    EXPECT_EQ(handoff.backlog(), 2);
+}
+
+TYPED_TEST(HandoffTest, UnknownTargetIsNotDrained) {
+    Handoff<TypeParam> handoff{this->storage_, this->ring_, HandoffConfig{.workers_ = 1}};
+    handoff.append("k", "a:1", makeValue("x", "n", 1));
+    handoff.start();
+
+    // not on the ring, so there is nobody to deliver to
+    handoff.notifyRecovered("a:1");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    handoff.stop();
+
+    EXPECT_EQ(handoff.backlog(), 1);
+    EXPECT_EQ(handoff.stats()["a:1"].delivered_, 0);
+}
+
+TYPED_TEST(HandoffTest, RecoveredTargetIsDrained) {
+    FakeTarget target;
+    this->ring_->addNode(std::make_shared<Node>("127.0.0.1", target.port_, 10));
+    Handoff<TypeParam> handoff{this->storage_, this->ring_, HandoffConfig{.workers_ = 1}};
+    for (int i = 0; i < 3; i++) {
+        handoff.append("k" + std::to_string(i), target.id_, makeValue("x", "n", 1));
+    }
+    handoff.append("k", "b:1", makeValue("x", "n", 1));
+    handoff.start();
+
+    handoff.notifyRecovered(target.id_);
+    ASSERT_TRUE(drained(handoff, target.id_));
+    handoff.stop();
+
+    auto stats = handoff.stats();
+    EXPECT_EQ(stats[target.id_].backlog_, 0);
+    EXPECT_EQ(stats[target.id_].delivered_, 3);
+    EXPECT_GT(stats[target.id_].drain_rate_, 0);
+    // other targets' hints stay where they are
+    EXPECT_EQ(handoff.backlog(), 1);
+    EXPECT_EQ(target.batches(), (std::vector<std::vector<std::string>>{{"k0", "k1", "k2"}}));
+    EXPECT_FALSE(this->storage_->contains(hintKey(target.id_, "k0")));
+}
+
+TYPED_TEST(HandoffTest, DrainIsSentInBatches) {
+    FakeTarget target;
+    this->ring_->addNode(std::make_shared<Node>("127.0.0.1", target.port_, 10));
+    Handoff<TypeParam> handoff{this->storage_, this->ring_, HandoffConfig{.workers_ = 1, .batch_size_ = 2}};
+    for (int i = 0; i < 5; i++) {
+        handoff.append("k" + std::to_string(i), target.id_, makeValue("x", "n", 1));
+    }
+    handoff.start();
+
+    handoff.notifyRecovered(target.id_);
+    ASSERT_TRUE(drained(handoff, target.id_));
+    handoff.stop();
+
+    EXPECT_EQ(target.batches(), (std::vector<std::vector<std::string>>{{"k0", "k1"}, {"k2", "k3"}, {"k4"}}));
+    EXPECT_EQ(handoff.backlog(), 0);
+}
+
+// the hint read for the batch is no longer what is stored, so it stays for the next drain
+TYPED_TEST(HandoffTest, HintRewrittenInFlightIsKept) {
+    FakeTarget target;
+    this->ring_->addNode(std::make_shared<Node>("127.0.0.1", target.port_, 10));
+    Handoff<TypeParam> handoff{this->storage_, this->ring_, HandoffConfig{.workers_ = 1}};
+    handoff.append("k0", target.id_, makeValue("old", "n", 1));
+    handoff.append("k1", target.id_, makeValue("x", "n", 1));
+    target.onFirstBatch([&] {
+        handoff.append("k0", target.id_, makeValue("new", "n", 2));
+    });
+    handoff.start();
+
+    handoff.notifyRecovered(target.id_);
+    ASSERT_TRUE(drained(handoff, target.id_));
+    handoff.stop();
+
+    auto stats = handoff.stats()[target.id_];
+    EXPECT_EQ(stats.delivered_, 1);
+    EXPECT_EQ(stats.backlog_, 1);
+    auto values = Serializer::fromBinary<ValueList>(this->storage_->get(hintKey(target.id_, "k0")));
+    ASSERT_EQ(values.size(), 1);
+    EXPECT_EQ(values[0].data_, "new");
+    EXPECT_FALSE(this->storage_->contains(hintKey(target.id_, "k1")));
+}
+
+// the worker goes back to waiting after its first drain, behind the sleeping sweeper. the
+// next recovery has to wake the worker, not the sweeper
+TYPED_TEST(HandoffTest, RecoveryWakesAWorkerNotTheSweeper) {
+    FakeTarget target;
+    this->ring_->addNode(std::make_shared<Node>("127.0.0.1", target.port_, 10));
+    Handoff<TypeParam> handoff{this->storage_, this->ring_, HandoffConfig{.workers_ = 1}};
+    handoff.append("k0", target.id_, makeValue("x", "n", 1));
+    handoff.start();
+    ASSERT_TRUE(drained(handoff, target.id_));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    handoff.append("k1", target.id_, makeValue("x", "n", 1));
+    handoff.notifyRecovered(target.id_);
+    for (int i = 0; i < 200 && handoff.backlog() > 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(handoff.backlog(), 0);
+    handoff.stop();
+}
@@ -0,0 +1,339 @@
+#include <gtest/gtest.h>
+#include "hash_ring/quorom.h"
+#include "hash_ring/rpc.h"
+#include "storage/serializer.h"
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// a replica on a loopback port that answers every replication endpoint and records
+// what it was asked
+class FakeReplica {
+    public:
+        FakeReplica() {
+            svr_.Post("/replication/get", [this](const httplib::Request &req, httplib::Response &res) {
+                record(req.path);
+                res.set_content(Serializer::toBinary(ValueList{stored_}), "application/octet-stream");
+                res.status = 200;
+            });
+            svr_.Post("/replication/put", [this](const httplib::Request &req, httplib::Response &res) {
+                record(req.path);
+                res.status = 200;
+            });
+            svr_.Post("/replication/handoff", [this](const httplib::Request &req, httplib::Response &res) {
+                auto rpc = Serializer::fromBinary<HandoffRpc>(req.body);
+                record(req.path, rpc.target_node_id_);
+                res.status = 200;
+            });
+            svr_.Post("/replication/mget", [this](const httplib::Request &req, httplib::Response &res) {
+                auto rpc = Serializer::fromBinary<BatchGetRpc>(req.body);
+                record(req.path, "", rpc.keys_);
+                std::vector<ByteString> stored(rpc.keys_.size(), Serializer::toBinary(ValueList{stored_}));
+                res.set_content(Serializer::toBinary(stored), "application/octet-stream");
+                res.status = 200;
+            });
+            svr_.Post("/replication/batch", [this](const httplib::Request &req, httplib::Response &res) {
+                auto rpc = Serializer::fromBinary<BatchPutRpc>(req.body);
+                std::vector<std::string> keys;
+                for(auto &put : rpc.puts_) {
+                    keys.push_back(put.key_);
+                }
+                record(req.path, "", keys);
+                res.status = 200;
+            });
+            port_ = svr_.bind_to_any_port("127.0.0.1");
+            thread_ = std::thread([this] {
+                svr_.listen_after_bind();
+            });
+            svr_.wait_until_ready();
+            stored_ = Value{"on-" + std::to_string(port_), {}};
+        }
+
+        ~FakeReplica() {
+            kill();
+        }
+
+        // refuses connections from here on
+        void kill() {
+            svr_.stop();
+            if(thread_.joinable()) {
+                thread_.join();
+            }
+        }
+
+        std::vector<std::string> paths() {
+            std::lock_guard lk(mu_);
+            return paths_;
+        }
+
+        std::vector<std::string> hintTargets() {
+            std::lock_guard lk(mu_);
+            return hint_targets_;
+        }
+
+        // every key of every batched request, in the order they came in
+        std::vector<std::string> batchedKeys() {
+            std::lock_guard lk(mu_);
+            return batched_keys_;
+        }
+
+        int port_{0};
+        Value stored_;
+
+    private:
+        void record(const std::string &path, const std::string &hint_target = "", const std::vector<std::string> &keys = {}) {
+            std::lock_guard lk(mu_);
+            paths_.push_back(path);
+            if(!hint_target.empty()) {
+                hint_targets_.push_back(hint_target);
+            }
+            batched_keys_.insert(batched_keys_.end(), keys.begin(), keys.end());
+        }
+
+        httplib::Server svr_;
+        std::thread thread_;
+        std::mutex mu_;
+        std::vector<std::string> paths_;
+        std::vector<std::string> hint_targets_;
+        std::vector<std::string> batched_keys_;
+};
+
+// this node and four replicas, N=3 so every key has two spares
+class QuoromTest : public ::testing::Test {
+    protected:
+        void SetUp() override {
+            ring_ = std::make_shared<HashRing>();
+            self_ = std::make_shared<Node>("127.0.0.1", 1, 100);
+            ring_->addNode(self_);
+            for(int i = 0; i < 4; i++) {
+                replicas_.push_back(std::make_unique<FakeReplica>());
+                ring_->addNode(std::make_shared<Node>("127.0.0.1", replicas_.back()->port_, 100));
+            }
+            // never marks a node down, the tests pick which nodes fail
+            detector_ = std::make_shared<ErrorDetector>(ring_, 1000000);
+            // markError and markSuccess insert into a plain map, do it before the threads do
+            for(auto &node : ring_->getNodes()) {
+                detector_->markSuccess(node->getId());
+            }
+            quorom_ = std::make_unique<Quorom>(3, 2, 2, self_, ring_, detector_);
+        }
+
+        // a key whose preference list has this node at position
+        std::string keyWithSelfAt(size_t position, int skip = 0) {
+            for(int i = 0; i < 10000; i++) {
+                std::string key = "key-" + std::to_string(i);
+                if(ring_->getNextNodes(key, 6).at(position)->getId() == self_->getId() && skip-- == 0) {
+                    return key;
+                }
+            }
+            ADD_FAILURE() << "no key with this node at " << position;
+            return "";
+        }
+
+        FakeReplica& replicaOf(const std::shared_ptr<Node> &node) {
+            for(auto &replica : replicas_) {
+                if(replica->port_ == node->getPort()) {
+                    return *replica;
+                }
+            }
+            throw std::runtime_error("not a fake replica: " + node->getId());
+        }
+
+        std::shared_ptr<HashRing> ring_;
+        std::shared_ptr<Node> self_;
+        std::vector<std::unique_ptr<FakeReplica>> replicas_;
+        std::shared_ptr<ErrorDetector> detector_;
+        std::unique_ptr<Quorom> quorom_;
+};
+
+// the k-th replica other than this node is stood in for by the k-th node past N, counted
+// by position prefs[2] would map to prefs[5] which a five node ring doesn't have
+TEST_F(QuoromTest, PutStandInSkipsThisNodeMidList) {
+    std::string key = keyWithSelfAt(1);
+    auto prefs = ring_->getNextNodes(key, 6);
+    ASSERT_EQ(prefs.size(), 5);
+    replicaOf(prefs[2]).kill();
+
+    ASSERT_TRUE(quorom_->put(key, Value{"v", {}}).has_value());
+
+    EXPECT_EQ(replicaOf(prefs[0]).paths(), std::vector<std::string>{"/replication/put"});
+    EXPECT_EQ(replicaOf(prefs[4]).hintTargets(), std::vector<std::string>{prefs[2]->getId()});
+    EXPECT_TRUE(replicaOf(prefs[3]).paths().empty());
+}
+
+TEST_F(QuoromTest, PutHintsEachSpareForItsOwnReplica) {
+    std::string key = keyWithSelfAt(0);
+    auto prefs = ring_->getNextNodes(key, 6);
+    replicaOf(prefs[1]).kill();
+    replicaOf(prefs[2]).kill();
+
+    ASSERT_TRUE(quorom_->put(key, Value{"v", {}}).has_value());
+
+    EXPECT_EQ(replicaOf(prefs[3]).hintTargets(), std::vector<std::string>{prefs[1]->getId()});
+    EXPECT_EQ(replicaOf(prefs[4]).hintTargets(), std::vector<std::string>{prefs[2]->getId()});
+}
+
+TEST_F(QuoromTest, PutNeedsWMinusOneReplicas) {
+    std::string key = keyWithSelfAt(0);
+    auto prefs = ring_->getNextNodes(key, 6);
+    for(auto &node : prefs) {
+        if(node->getId() != self_->getId()) {
+            replicaOf(node).kill();
+        }
+    }
+
+    auto result = quorom_->put(key, Value{"v", {}});
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(result.error().code_, QuoromCode::NOT_ENOUGH_RESPONSES);
+}
+
+TEST_F(QuoromTest, GetStandInSkipsThisNodeMidList) {
+    std::string key = keyWithSelfAt(1);
+    auto prefs = ring_->getNextNodes(key, 6);
+    replicaOf(prefs[2]).kill();
+
+    auto values = quorom_->get(key);
+    ASSERT_TRUE(values.has_value());
+
+    EXPECT_EQ(replicaOf(prefs[0]).paths(), std::vector<std::string>{"/replication/get"});
+    EXPECT_EQ(replicaOf(prefs[4]).paths(), std::vector<std::string>{"/replication/get"});
+    EXPECT_TRUE(replicaOf(prefs[3]).paths().empty());
+}
+
+TEST_F(QuoromTest, ThisNodeIsOnlyAReplicaInTheFirstN) {
+    EXPECT_TRUE(quorom_->isReplica(keyWithSelfAt(0)));
+    EXPECT_TRUE(quorom_->isReplica(keyWithSelfAt(2)));
+    EXPECT_FALSE(quorom_->isReplica(keyWithSelfAt(3)));
+}
+
+// one request per replica however many keys it holds, this node's own keys aren't sent to it
+TEST_F(QuoromTest, PutManySendsOneBatchPerReplica) {
+    std::vector<std::string> keys{keyWithSelfAt(0), keyWithSelfAt(3), keyWithSelfAt(0, 1), keyWithSelfAt(4)};
+    std::vector<PutRpc> puts;
+    for(auto &key : keys) {
+        puts.emplace_back(key, Value{"v", {}});
+    }
+
+    auto results = quorom_->putMany(puts);
+    ASSERT_EQ(results.size(), keys.size());
+    for(auto &result : results) {
+        EXPECT_TRUE(result.has_value());
+    }
+
+    for(auto &replica : replicas_) {
+        auto paths = replica->paths();
+        EXPECT_LE(paths.size(), 1);
+        for(auto &path : paths) {
+            EXPECT_EQ(path, "/replication/batch");
+        }
+    }
+    for(auto &key : keys) {
+        auto prefs = ring_->getNextNodes(key, 3);
+        for(auto &node : prefs) {
+            if(node->getId() == self_->getId()) {
+                continue;
+            }
+            auto batched = replicaOf(node).batchedKeys();
+            EXPECT_EQ(std::count(batched.begin(), batched.end(), key), 1) << key << " on " << node->getId();
+        }
+    }
+}
+
+// the failed replica holds keys at different positions, each key's hint goes to the spare
+// for that position
+TEST_F(QuoromTest, PutManyHandsAFailedBatchToEachKeysOwnSpare) {
+    std::string first = keyWithSelfAt(0);
+    auto down = ring_->getNextNodes(first, 6)[2];
+    std::vector<PutRpc> puts;
+    std::map<std::string, int> expected;
+    for(int i = 0; i < 200 && puts.size() < 8; i++) {
+        std::string key = "key-" + std::to_string(i);
+        auto prefs = ring_->getNextNodes(key, 6);
+        std::vector<std::shared_ptr<Node>> others;
+        for(size_t j = 0; j < 3; j++) {
+            if(prefs[j]->getId() != self_->getId()) {
+                others.push_back(prefs[j]);
+            }
+        }
+        size_t pos = std::find(others.begin(), others.end(), down) - others.begin();
+        if(pos == others.size() || 3 + pos >= prefs.size()) {
+            continue;
+        }
+        puts.emplace_back(key, Value{"v", {}});
+        expected[prefs[3 + pos]->getId()]++;
+    }
+    ASSERT_GT(expected.size(), 1);
+    replicaOf(down).kill();
+
+    for(auto &result : quorom_->putMany(puts)) {
+        EXPECT_TRUE(result.has_value());
+    }
+
+    for(auto &node : ring_->getNodes()) {
+        if(node->getId() == self_->getId() || node == down) {
+            continue;
+        }
+        auto hinted = replicaOf(node).hintTargets();
+        EXPECT_EQ(hinted.size(), expected[node->getId()]) << node->getId();
+        EXPECT_EQ(std::count(hinted.begin(), hinted.end(), down->getId()), hinted.size());
+    }
+}
+
+TEST_F(QuoromTest, PutManyNeedsWMinusOneReplicas) {
+    for(auto &replica : replicas_) {
+        replica->kill();
+    }
+
+    auto results = quorom_->putMany({PutRpc{keyWithSelfAt(0), Value{"v", {}}}, PutRpc{keyWithSelfAt(3), Value{"v", {}}}});
+    for(auto &result : results) {
+        ASSERT_FALSE(result.has_value());
+        EXPECT_EQ(result.error().code_, QuoromCode::NOT_ENOUGH_RESPONSES);
+    }
+}
+
+TEST_F(QuoromTest, GetManyCollectsEveryReplicasVersions) {
+    std::string local = keyWithSelfAt(0);
+    std::string remote = keyWithSelfAt(3);
+
+    auto results = quorom_->getMany({local, remote});
+    ASSERT_TRUE(results[0].has_value());
+    ASSERT_TRUE(results[1].has_value());
+    // this node's own versions aren't part of it, the caller reads those
+    EXPECT_EQ(results[0]->size(), 2);
+    EXPECT_EQ(results[1]->size(), 3);
+    for(auto &node : ring_->getNextNodes(remote, 3)) {
+        EXPECT_EQ(replicaOf(node).paths(), std::vector<std::string>{"/replication/mget"});
+    }
+}
+
+TEST_F(QuoromTest, GetManyAsksTheSpareOfAFailedReplica) {
+    std::string key = keyWithSelfAt(0);
+    auto prefs = ring_->getNextNodes(key, 6);
+    replicaOf(prefs[1]).kill();
+    replicaOf(prefs[2]).kill();
+
+    auto results = quorom_->getMany({key});
+    ASSERT_TRUE(results[0].has_value());
+    EXPECT_EQ(replicaOf(prefs[3]).batchedKeys(), std::vector<std::string>{key});
+    EXPECT_EQ(replicaOf(prefs[4]).batchedKeys(), std::vector<std::string>{key});
+}
+
+TEST_F(QuoromTest, BatchesOfAClusterSmallerThanNFail) {
+    auto ring = std::make_shared<HashRing>();
+    ring->addNode(self_);
+    ring->addNode(std::make_shared<Node>("127.0.0.1", replicas_[0]->port_, 100));
+    Quorom small{3, 2, 2, self_, ring, detector_};
+
+    auto gets = small.getMany({"a"});
+    ASSERT_FALSE(gets[0].has_value());
+    EXPECT_EQ(gets[0].error().code_, QuoromCode::TOO_FEW_NODES);
+    auto puts = small.putMany({PutRpc{"a", Value{"v", {}}}});
+    ASSERT_FALSE(puts[0].has_value());
+    EXPECT_EQ(puts[0].error().code_, QuoromCode::TOO_FEW_NODES);
+    EXPECT_TRUE(replicas_[0]->paths().empty());
+}
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "membership/membership.h"
+
+static NodeState makeState(int port, uint64_t incarnation, NodeState::Status status = NodeState::Status::ACTIVE) {
+    return NodeState{
+        "localhost:" + std::to_string(port),
+        "localhost",
+        port,
+        status,
+        incarnation,
+        10
+    };
+}
+
+TEST(MembershipTest, MergeAddsNodesToRing) {
+    auto ring = std::make_shared<HashRing>();
+    Membership membership{ring};
+
+    auto a = makeState(9000, 1);
+    auto b = makeState(9001, 1);
+
+    EXPECT_TRUE(membership.merge({{a.id_, a}, {b.id_, b}}));
+    EXPECT_EQ(ring->getNodes().size(), 2);
+    EXPECT_EQ(membership.snapshot()->nodes_.size(), 2);
+
+    // same incarnation is a no-op and does not bump the version
+    auto version = membership.version();
+    EXPECT_FALSE(membership.merge({{a.id_, a}}));
+    EXPECT_EQ(membership.version(), version);
+}
+
+TEST(MembershipTest, NewerIncarnationWins) {
+    auto ring = std::make_shared<HashRing>();
+    Membership membership{ring};
+
+    auto a = makeState(9000, 1);
+    membership.merge({{a.id_, a}});
+
+    auto killed = makeState(9000, 2, NodeState::Status::KILLED);
+    EXPECT_TRUE(membership.merge({{killed.id_, killed}}));
+    EXPECT_EQ(ring->getNode(a.id_), nullptr);
+
+    // stale alive message must not revive the node
+    EXPECT_FALSE(membership.merge({{a.id_, a}}));
+    EXPECT_EQ(ring->getNode(a.id_), nullptr);
+
+    auto revived = makeState(9000, 3);
+    EXPECT_TRUE(membership.merge({{revived.id_, revived}}));
+    EXPECT_NE(ring->getNode(a.id_), nullptr);
+    EXPECT_EQ(membership.get(a.id_)->incarnation_, 3);
+}
+
+TEST(MembershipTest, SnapshotIsStableWhileUpdating) {
+    auto ring = std::make_shared<HashRing>();
+    Membership membership{ring};
+
+    auto a = makeState(9000, 1);
+    membership.merge({{a.id_, a}});
+
+    auto before = membership.snapshot();
+    membership.update(a.id_, [](NodeState &s) { s.incarnation_ = 5; });
+
+    EXPECT_EQ(before->nodes_.at(a.id_).incarnation_, 1);
+    EXPECT_EQ(membership.snapshot()->nodes_.at(a.id_).incarnation_, 5);
+    EXPECT_FALSE(membership.update("missing", [](NodeState &) {}));
+}
+
+TEST(MembershipTest, ConcurrentMergesConverge) {
+    auto ring = std::make_shared<HashRing>();
+    Membership membership{ring};
+
+    const int threads = 8;
+    const int nodes = 16;
+    const int rounds = 200;
+
+    std::vector<std::thread> workers;
+    for(int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            for(int r = 1; r <= rounds; r++) {
+                ClusterState state;
+                for(int n = 0; n < nodes; n++) {
+                    // odd incarnations are kills, even are revivals
+                    auto status = (r + t) % 2 == 1 ? NodeState::Status::KILLED : NodeState::Status::ACTIVE;
+                    auto s = makeState(9000 + n, r * threads + t, status);
+                    state[s.id_] = s;
+                }
+                membership.merge(state);
+            }
+        });
+    }
+
+    for(auto &w : workers) {
+        w.join();
+    }
+
+    auto snapshot = membership.snapshot();
+    ASSERT_EQ(snapshot->nodes_.size(), nodes);
+
+    for(auto &[id, state] : snapshot->nodes_) {
+        EXPECT_EQ(state.incarnation_, rounds * threads + threads - 1);
+        bool on_ring = ring->getNode(id) != nullptr;
+        EXPECT_EQ(on_ring, state.status_ == NodeState::Status::ACTIVE) << id;
+    }
+}
@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include "membership/snapshot.h"
+
+static std::string tempPath(const std::string& name) {
+    std::string path = "/tmp/dynamo-snapshot-test-" + name;
+    std::remove(path.c_str());
+    return path;
+}
+
+TEST(SnapshotTest, RoundTrip) {
+    MembershipStore store{tempPath("roundtrip")};
+
+    MembershipSnapshot snapshot;
+    snapshot.version_ = 42;
+    snapshot.nodes_["localhost:8080"] = NodeState{"localhost:8080", "localhost", 8080, NodeState::Status::ACTIVE, 3, 1000};
+    snapshot.nodes_["localhost:8081"] = NodeState{"localhost:8081", "localhost", 8081, NodeState::Status::KILLED, 7, 500};
+
+    ASSERT_TRUE(store.save(snapshot, "localhost:8080"));
+
+    auto loaded = store.load();
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_EQ(loaded->self_id_, "localhost:8080");
+    EXPECT_EQ(loaded->membership_version_, 42);
+    ASSERT_EQ(loaded->nodes_.size(), 2);
+    EXPECT_EQ(loaded->nodes_.at("localhost:8081").status_, NodeState::Status::KILLED);
+    EXPECT_EQ(loaded->nodes_.at("localhost:8081").incarnation_, 7);
+    EXPECT_EQ(loaded->nodes_.at("localhost:8081").tokens_, 500);
+}
+
+TEST(SnapshotTest, MissingOrCorruptFileIsIgnored) {
+    MembershipStore missing{tempPath("missing")};
+    EXPECT_FALSE(missing.load().has_value());
+
+    std::string path = tempPath("corrupt");
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "definitely not a snapshot";
+    }
+    MembershipStore corrupt{path};
+    EXPECT_FALSE(corrupt.load().has_value());
+}
+
+TEST(SnapshotTest, RestoredRingMatchesOriginal) {
+    auto original = std::make_shared<HashRing>();
+    Membership membership{original};
+
+    ClusterState state;
+    for(int port = 8080; port < 8085; port++) {
+        std::string id = "localhost:" + std::to_string(port);
+        state[id] = NodeState{id, "localhost", port, NodeState::Status::ACTIVE, 1, 50};
+    }
+    membership.merge(state);
+
+    MembershipStore store{tempPath("ring")};
+    ASSERT_TRUE(store.save(*membership.snapshot(), "localhost:8080"));
+
+    auto restored = std::make_shared<HashRing>();
+    Membership restored_membership{restored};
+    restored_membership.merge(store.load()->nodes_);
+
+    for(int i = 0; i < 500; i++) {
+        std::string key = "key-" + std::to_string(i);
+        EXPECT_EQ(original->findNode(key)->getId(), restored->findNode(key)->getId());
+    }
+}
@@ -0,0 +1,140 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "membership/swim.h"
+
+// each member gets its own ring, membership table and udp socket on loopback
+struct SwimMember {
+    std::shared_ptr<HashRing> ring;
+    std::shared_ptr<Membership> membership;
+    std::shared_ptr<Swim> swim;
+};
+
+static NodeState stateFor(int port, uint64_t incarnation = 1) {
+    return NodeState{
+        "127.0.0.1:" + std::to_string(port),
+        "127.0.0.1",
+        port,
+        NodeState::Status::ACTIVE,
+        incarnation,
+        8
+    };
+}
+
+static SwimConfig fastConfig() {
+    SwimConfig config;
+    config.protocol_period_ = std::chrono::milliseconds(40);
+    config.ack_timeout_ = std::chrono::milliseconds(10);
+    config.suspicion_mult_ = 3;
+    return config;
+}
+
+static std::vector<SwimMember> startCluster(int base_port, int size) {
+    ClusterState everyone;
+    for(int i = 0; i < size; i++) {
+        auto s = stateFor(base_port + i);
+        everyone[s.id_] = s;
+    }
+
+    std::vector<SwimMember> members;
+    for(int i = 0; i < size; i++) {
+        SwimMember m;
+        m.ring = std::make_shared<HashRing>();
+        m.membership = std::make_shared<Membership>(m.ring);
+        m.membership->merge(everyone);
+        auto self = std::make_shared<Node>("127.0.0.1", base_port + i, 8);
+        m.swim = std::make_shared<Swim>(m.membership, self, fastConfig());
+        members.push_back(m);
+    }
+
+    for(auto &m : members) {
+        m.swim->start();
+    }
+    return members;
+}
+
+static bool eventually(const std::function<bool()>& pred, std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while(std::chrono::steady_clock::now() < deadline) {
+        if(pred()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    return pred();
+}
+
+TEST(SwimTest, HealthyClusterStaysActive) {
+    auto members = startCluster(47100, 6);
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    for(auto &m : members) {
+        for(auto &[id, state] : m.membership->snapshot()->nodes_) {
+            EXPECT_EQ(state.status_, NodeState::Status::ACTIVE) << id;
+        }
+    }
+}
+
+TEST(SwimTest, CrashedMemberIsDetected) {
+    const int size = 8;
+    auto members = startCluster(47200, size);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    // no leave message, the socket just goes away
+    std::string dead_id = stateFor(47203).id_;
+    members[3].swim.reset();
+
+    bool detected = eventually([&] {
+        for(int i = 0; i < size; i++) {
+            if(i == 3) continue;
+            auto state = members[i].membership->get(dead_id);
+            if(!state || state->status_ != NodeState::Status::KILLED) return false;
+        }
+        return true;
+    }, std::chrono::seconds(5));
+
+    EXPECT_TRUE(detected);
+    for(int i = 0; i < size; i++) {
+        if(i == 3) continue;
+        EXPECT_EQ(members[i].ring->getNode(dead_id), nullptr);
+    }
+}
+
+TEST(SwimTest, FalseSuspicionIsRefuted) {
+    const int size = 5;
+    auto members = startCluster(47300, size);
+
+    auto suspect = stateFor(47302);
+    suspect.status_ = NodeState::Status::SUSPECT;
+    members[0].membership->merge({{suspect.id_, suspect}});
+
+    bool refuted = eventually([&] {
+        for(auto &m : members) {
+            auto state = m.membership->get(suspect.id_);
+            if(!state || state->status_ != NodeState::Status::ACTIVE || state->incarnation_ < 2) return false;
+        }
+        return true;
+    }, std::chrono::seconds(5));
+
+    EXPECT_TRUE(refuted);
+}
+
+TEST(SwimTest, UpdatesArePiggybacked) {
+    const int size = 6;
+    auto members = startCluster(47400, size);
+
+    // only one member hears about the new node, everyone else has to learn it over swim
+    auto newcomer = stateFor(47499);
+    members[0].membership->merge({{newcomer.id_, newcomer}});
+
+    bool spread = eventually([&] {
+        for(auto &m : members) {
+            if(!m.membership->get(newcomer.id_)) return false;
+        }
+        return true;
+    }, std::chrono::seconds(5));
+
+    EXPECT_TRUE(spread);
+}
@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+#include <set>
+#include <string>
+#include "membership/vitals.h"
+
+static NodeVitals vitalsAt(uint64_t version, uint64_t backlog = 0) {
+    NodeVitals v;
+    v.version_ = version;
+    v.handoff_backlog_ = backlog;
+    return v;
+}
+
+static VitalsTable::MemberFn members(std::set<std::string> ids) {
+    return [ids = std::move(ids)](const std::string& id) { return ids.contains(id); };
+}
+
+TEST(VitalsTest, MergeKeepsNewerVersion) {
+    VitalsTable table;
+    table.set("a", vitalsAt(10, 1));
+
+    table.merge({{"a", vitalsAt(5, 2)}}, members({"a"}));
+    EXPECT_EQ(table.get("a")->handoff_backlog_, 1);
+
+    table.merge({{"a", vitalsAt(20, 3)}}, members({"a"}));
+    EXPECT_EQ(table.get("a")->handoff_backlog_, 3);
+}
+
+TEST(VitalsTest, MergeSkipsNonMembers) {
+    VitalsTable table;
+    table.merge({{"a", vitalsAt(10)}, {"gone", vitalsAt(10)}}, members({"a"}));
+
+    EXPECT_TRUE(table.get("a").has_value());
+    EXPECT_FALSE(table.get("gone").has_value());
+    EXPECT_EQ(table.getAll().size(), 1);
+}
+
+TEST(VitalsTest, PruneDropsNodesThatLeft) {
+    VitalsTable table;
+    table.set("a", vitalsAt(1000));
+    table.set("b", vitalsAt(1000));
+
+    table.prune(members({"a"}), 1000, 100);
+
+    EXPECT_TRUE(table.get("a").has_value());
+    EXPECT_FALSE(table.get("b").has_value());
+}
+
+TEST(VitalsTest, PruneDropsEntriesPastTtl) {
+    VitalsTable table;
+    table.set("stale", vitalsAt(100));
+    table.set("fresh", vitalsAt(950));
+
+    table.prune(members({"stale", "fresh"}), 1000, 100);
+
+    EXPECT_FALSE(table.get("stale").has_value());
+    EXPECT_TRUE(table.get("fresh").has_value());
+}
+
+TEST(VitalsTest, PrunedEntryIsNotMergedBackForNonMember) {
+    VitalsTable table;
+    table.set("gone", vitalsAt(1000));
+    table.prune(members({}), 1000, 100);
+
+    // a peer that hasn't noticed yet still gossips it
+    table.merge({{"gone", vitalsAt(1000)}}, members({}));
+    EXPECT_FALSE(table.get("gone").has_value());
+}
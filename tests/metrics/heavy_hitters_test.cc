@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+#include "metrics/heavy_hitters.h"
+#include <algorithm>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+TEST(HeavyHittersTest, EstimateNeverUndercounts) {
+    HeavyHitters hitters(8, 256, 4, 1);
+    std::unordered_map<std::string, uint64_t> truth;
+    std::mt19937_64 gen(1);
+    for(int i = 0; i < 20000; i++) {
+        std::string key = "key-" + std::to_string(gen() % 2000);
+        hitters.record(key);
+        truth[key]++;
+    }
+    for(auto &[key, count] : truth) {
+        EXPECT_GE(hitters.estimate(key), count);
+    }
+    EXPECT_EQ(hitters.total(), 20000);
+}
+
+TEST(HeavyHittersTest, FindsTheHotKeysInASkewedStream) {
+    HeavyHitters hitters(8);
+    std::mt19937_64 gen(7);
+    // three keys get half the traffic, the rest is spread over 10k keys
+    for(int i = 0; i < 60000; i++) {
+        if(i % 2 == 0) {
+            hitters.record("hot-" + std::to_string(i % 3));
+        } else {
+            hitters.record("cold-" + std::to_string(gen() % 10000));
+        }
+    }
+
+    auto top = hitters.top(3);
+    ASSERT_EQ(top.size(), 3);
+    std::vector<std::string> keys;
+    for(auto &h : top) {
+        keys.push_back(h.key_);
+        EXPECT_GE(h.count_, 9000);
+    }
+    std::sort(keys.begin(), keys.end());
+    EXPECT_EQ(keys, (std::vector<std::string>{"hot-0", "hot-1", "hot-2"}));
+
+    EXPECT_TRUE(hitters.isHot("hot-1"));
+    EXPECT_FALSE(hitters.isHot("cold-17"));
+    EXPECT_FALSE(hitters.isHot("never-seen"));
+}
+
+TEST(HeavyHittersTest, KeysBelowMinHotStayOut) {
+    HeavyHitters hitters(8, 4096, 4, 10);
+    for(int i = 0; i < 9; i++) {
+        hitters.record("a");
+    }
+    EXPECT_TRUE(hitters.top(8).empty());
+    EXPECT_FALSE(hitters.isHot("a"));
+
+    hitters.record("a");
+    EXPECT_EQ(hitters.top(8).size(), 1);
+    EXPECT_TRUE(hitters.isHot("a"));
+}
+
+TEST(HeavyHittersTest, DecayForgetsKeysThatWentCold) {
+    HeavyHitters hitters(8, 4096, 4, 16);
+    for(int i = 0; i < 100; i++) {
+        hitters.record("was-hot");
+    }
+    EXPECT_TRUE(hitters.isHot("was-hot"));
+
+    hitters.decay();
+    EXPECT_EQ(hitters.estimate("was-hot"), 50);
+    EXPECT_EQ(hitters.top(1).front().count_, 50);
+
+    for(int i = 0; i < 3; i++) {
+        hitters.decay();
+    }
+    EXPECT_TRUE(hitters.top(8).empty());
+    EXPECT_FALSE(hitters.isHot("was-hot"));
+}
+
+TEST(HeavyHittersTest, ConcurrentRecording) {
+    HeavyHitters hitters(16);
+    const int threads = 4;
+    const int per_thread = 20000;
+
+    std::vector<std::thread> workers;
+    for(int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            std::mt19937_64 gen(t);
+            for(int i = 0; i < per_thread; i++) {
+                hitters.record(i % 4 == 0 ? "shared" : "key-" + std::to_string(gen() % 5000));
+            }
+        });
+    }
+    for(auto &w : workers) {
+        w.join();
+    }
+
+    EXPECT_EQ(hitters.total(), threads * per_thread);
+    EXPECT_GE(hitters.estimate("shared"), threads * per_thread / 4);
+    EXPECT_EQ(hitters.top(1).front().key_, "shared");
+}
@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+#include "metrics/histogram.h"
+#include <thread>
+#include <vector>
+
+TEST(HistogramTest, SmallValuesAreExact) {
+    for(uint64_t v = 0; v < 4; v++) {
+        EXPECT_EQ(Histogram::bucketUpperBound(Histogram::bucketFor(v)), v);
+    }
+}
+
+TEST(HistogramTest, BucketsBoundRelativeError) {
+    for(uint64_t v : {5ull, 17ull, 1000ull, 123456ull, 987654321ull, (1ull << 40) + 7}) {
+        uint64_t upper = Histogram::bucketUpperBound(Histogram::bucketFor(v));
+        EXPECT_GE(upper, v);
+        EXPECT_LE(upper - v, v / 4 + 1);
+    }
+    EXPECT_LT(Histogram::bucketFor(UINT64_MAX), HISTOGRAM_BUCKETS);
+    EXPECT_EQ(Histogram::bucketUpperBound(Histogram::bucketFor(UINT64_MAX)), UINT64_MAX);
+}
+
+TEST(HistogramTest, Percentiles) {
+    Histogram h;
+    for(uint64_t v = 1; v <= 1000; v++) {
+        h.record(v);
+    }
+    auto snap = h.snapshot();
+    EXPECT_EQ(snap.count_, 1000);
+    EXPECT_DOUBLE_EQ(snap.mean(), 500.5);
+
+    uint64_t p50 = snap.percentile(0.5);
+    EXPECT_GE(p50, 500);
+    EXPECT_LE(p50, 500 * 5 / 4);
+
+    uint64_t p99 = snap.percentile(0.99);
+    EXPECT_GE(p99, 990);
+    EXPECT_LE(p99, 1000 * 5 / 4);
+
+    EXPECT_EQ(HistogramSnapshot{}.percentile(0.99), 0);
+}
+
+TEST(HistogramTest, SnapshotDiffIsWindowed) {
+    Histogram h;
+    for(int i = 0; i < 100; i++) {
+        h.record(10000);
+    }
+    auto before = h.snapshot();
+    for(int i = 0; i < 100; i++) {
+        h.record(10);
+    }
+    auto window = h.snapshot() - before;
+    EXPECT_EQ(window.count_, 100);
+    EXPECT_LE(window.percentile(0.99), 12);
+}
+
+TEST(HistogramTest, ConcurrentRecord) {
+    Histogram h;
+    std::vector<std::thread> threads;
+    for(int t = 0; t < 4; t++) {
+        threads.emplace_back([&h] {
+            for(int i = 0; i < 10000; i++) {
+                h.record(i);
+            }
+        });
+    }
+    for(auto& t : threads) {
+        t.join();
+    }
+    EXPECT_EQ(h.snapshot().count_, 40000);
+}
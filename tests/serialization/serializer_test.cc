@@ -36,3 +36,27 @@ TEST(SerializerTest, EmptyValueList) {
     auto deserialized = Serializer::fromBinary<ValueList>(binary);
     EXPECT_TRUE(deserialized.empty());
 }
+
+TEST(SerializerTest, DecodesFromAView) {
+    VectorClock clock;
+    clock.increment("one");
+    ValueList original{Value{"first", clock}};
+
+    // the view points into a bigger buffer, only the slice is read
+    std::string buffer = "xx" + Serializer::toBinary(original) + "yy";
+    std::string_view slice{buffer.data() + 2, buffer.size() - 4};
+    auto deserialized = Serializer::fromBinary<ValueList>(slice);
+
+    ASSERT_EQ(deserialized.size(), 1);
+    EXPECT_EQ(deserialized[0].data_, "first");
+    EXPECT_EQ(deserialized[0].clock_.get("one"), 1);
+}
+
+TEST(SerializerTest, AppendBinaryMatchesToBinary) {
+    VectorClock clock;
+    clock.increment("one");
+
+    std::string out = "prefix";
+    Serializer::appendBinary(clock, out);
+    EXPECT_EQ(out, "prefix" + Serializer::toBinary(clock));
+}
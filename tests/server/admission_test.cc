@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+#include "server/admission.h"
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+AdmissionOptions smallBudgets() {
+    AdmissionOptions options;
+    options.client_inflight_ = 4;
+    options.replication_inflight_ = 2;
+    options.max_wait_ = 0ms;
+    // poll on every admit
+    options.health_interval_ = 0ms;
+    return options;
+}
+
+TEST(AdmissionTest, FullBudgetRejectsWithRetryAfter) {
+    AdmissionController admission(smallBudgets());
+
+    std::vector<AdmissionController::Ticket> held;
+    for(int i = 0; i < 4; i++) {
+        held.push_back(admission.admit(TrafficClass::CLIENT, false));
+        ASSERT_TRUE(held.back());
+    }
+
+    auto rejected = admission.admit(TrafficClass::CLIENT, false);
+    EXPECT_FALSE(rejected);
+    EXPECT_EQ(rejected.status(), 429);
+    EXPECT_EQ(rejected.retryAfter(), 1s);
+
+    held.pop_back();
+    EXPECT_TRUE(admission.admit(TrafficClass::CLIENT, false));
+
+    auto stats = admission.stats();
+    EXPECT_EQ(stats.client_.inflight_, 3);
+    EXPECT_EQ(stats.client_.admitted_, 5);
+    EXPECT_EQ(stats.client_.rejected_busy_, 1);
+}
+
+TEST(AdmissionTest, ClassesHaveSeparateBudgets) {
+    AdmissionController admission(smallBudgets());
+
+    std::vector<AdmissionController::Ticket> held;
+    for(int i = 0; i < 4; i++) {
+        held.push_back(admission.admit(TrafficClass::CLIENT, true));
+    }
+    EXPECT_FALSE(admission.admit(TrafficClass::CLIENT, true));
+
+    auto a = admission.admit(TrafficClass::REPLICATION, true);
+    auto b = admission.admit(TrafficClass::REPLICATION, true);
+    EXPECT_TRUE(a);
+    EXPECT_TRUE(b);
+    EXPECT_FALSE(admission.admit(TrafficClass::REPLICATION, true));
+}
+
+TEST(AdmissionTest, WaitsForASlot) {
+    auto options = smallBudgets();
+    options.client_inflight_ = 1;
+    options.max_wait_ = 2s;
+    AdmissionController admission(options);
+
+    auto held = admission.admit(TrafficClass::CLIENT, false);
+    std::thread releaser([&] {
+        std::this_thread::sleep_for(20ms);
+        held = AdmissionController::Ticket{};
+    });
+
+    auto waited = admission.admit(TrafficClass::CLIENT, false);
+    releaser.join();
+    EXPECT_TRUE(waited);
+    EXPECT_EQ(admission.stats().client_.delayed_, 1);
+}
+
+TEST(AdmissionTest, ClassifiesEngineHealth) {
+    AdmissionController admission(smallBudgets());
+
+    EXPECT_EQ(admission.classify({}), Pressure::NONE);
+    EXPECT_EQ(admission.classify({.l0_files_ = 8}), Pressure::SOFT);
+    EXPECT_EQ(admission.classify({.pending_compaction_bytes_ = 100 << 20}), Pressure::SOFT);
+    EXPECT_EQ(admission.classify({.put_p99_us_ = 300000}), Pressure::HARD);
+    EXPECT_EQ(admission.classify({.l0_files_ = 12}), Pressure::HARD);
+    // a stall is soft until it has lasted
+    EXPECT_EQ(admission.classify({.stalled_ = true, .stall_us_ = 60000}), Pressure::SOFT);
+    EXPECT_EQ(admission.classify({.stalled_ = true, .stall_us_ = 1500000}), Pressure::HARD);
+}
+
+TEST(AdmissionTest, HardPressureShedsClientWritesOnly) {
+    AdmissionController admission(smallBudgets());
+    EngineHealth health{.l0_files_ = 12};
+    admission.setHealthProvider([&] { return health; });
+
+    auto write = admission.admit(TrafficClass::CLIENT, true);
+    EXPECT_FALSE(write);
+    EXPECT_EQ(write.status(), 503);
+    EXPECT_EQ(write.retryAfter(), 2s);
+    EXPECT_EQ(admission.pressure(), Pressure::HARD);
+
+    // reads still go through on a quarter of the budget
+    auto read = admission.admit(TrafficClass::CLIENT, false);
+    EXPECT_TRUE(read);
+    EXPECT_FALSE(admission.admit(TrafficClass::CLIENT, false));
+
+    // replication is never shed for pressure, only squeezed
+    auto replica = admission.admit(TrafficClass::REPLICATION, true);
+    EXPECT_TRUE(replica);
+    EXPECT_FALSE(admission.admit(TrafficClass::REPLICATION, true));
+
+    auto stats = admission.stats();
+    EXPECT_EQ(stats.client_.rejected_pressure_, 1);
+    EXPECT_EQ(stats.client_.limit_, 1);
+    EXPECT_EQ(stats.replication_.limit_, 1);
+
+    // compaction caught up
+    health = {};
+    EXPECT_TRUE(admission.admit(TrafficClass::CLIENT, true));
+    EXPECT_EQ(admission.pressure(), Pressure::NONE);
+}
+
+TEST(AdmissionTest, SoftPressureHalvesClientBudget) {
+    AdmissionController admission(smallBudgets());
+    admission.setHealthProvider([] { return EngineHealth{.pending_compaction_bytes_ = 100 << 20}; });
+    admission.refreshHealth();
+
+    EXPECT_EQ(admission.pressure(), Pressure::SOFT);
+    EXPECT_EQ(admission.limitFor(TrafficClass::CLIENT, Pressure::SOFT), 2);
+    EXPECT_EQ(admission.limitFor(TrafficClass::REPLICATION, Pressure::SOFT), 2);
+
+    auto a = admission.admit(TrafficClass::CLIENT, true);
+    auto b = admission.admit(TrafficClass::CLIENT, true);
+    EXPECT_TRUE(a);
+    EXPECT_TRUE(b);
+    EXPECT_EQ(admission.admit(TrafficClass::CLIENT, true).status(), 429);
+}
@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+#include "server/binary_codec.h"
+#include "storage/serializer.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace {
+
+VectorClock clockOf(std::vector<std::pair<std::string, uint64_t>> entries) {
+    VectorClock clock;
+    for(auto &[node, time] : entries) {
+        clock.set(node, time);
+    }
+    return clock;
+}
+
+}
+
+TEST(BinaryCodecTest, VarintRoundTrip) {
+    for(uint64_t v : std::vector<uint64_t>{0, 1, 127, 128, 300, 1ull << 35, UINT64_MAX}) {
+        std::string out;
+        BinaryCodec::appendVarint(v, out);
+        std::string_view in{out};
+        EXPECT_EQ(BinaryCodec::readVarint(in), v);
+        EXPECT_TRUE(in.empty());
+    }
+
+    std::string cut;
+    BinaryCodec::appendVarint(1ull << 20, cut);
+    cut.pop_back();
+    std::string_view in{cut};
+    EXPECT_FALSE(BinaryCodec::readVarint(in).has_value());
+}
+
+TEST(BinaryCodecTest, EqualClocksEncodeTheSame) {
+    auto a = clockOf({{"node-a", 3}, {"node-b", 1}, {"node-c", 7}});
+    auto b = clockOf({{"node-c", 7}, {"node-a", 3}, {"node-b", 1}});
+    EXPECT_EQ(BinaryCodec::encodeClock(a), BinaryCodec::encodeClock(b));
+
+    auto decoded = BinaryCodec::decodeClock(BinaryCodec::encodeClock(a));
+    ASSERT_TRUE(decoded.has_value());
+    EXPECT_EQ(decoded->getTimes(), a.getTimes());
+}
+
+TEST(BinaryCodecTest, ContextIsSmallerThanTheJsonOne) {
+    auto clock = clockOf({{"127.0.0.1:8080", 12}, {"127.0.0.1:8081", 4}, {"127.0.0.1:8082", 9}});
+    std::string header = BinaryCodec::clockHeader(clock);
+    std::string json_context = base64::to_base64(Serializer::toBinary(clock));
+    EXPECT_LT(header.size(), json_context.size());
+}
+
+TEST(BinaryCodecTest, ClockHeader) {
+    auto clock = clockOf({{"a", 1}, {"b", 2}});
+    auto parsed = BinaryCodec::parseContext(BinaryCodec::clockHeader(clock));
+    ASSERT_TRUE(parsed.has_value());
+    EXPECT_EQ(parsed->getTimes(), clock.getTimes());
+
+    // no header is a write without context
+    auto empty = BinaryCodec::parseContext("");
+    ASSERT_TRUE(empty.has_value());
+    EXPECT_TRUE(empty->getTimes().empty());
+
+    EXPECT_FALSE(BinaryCodec::parseContext("not base64!").has_value());
+    // valid base64, not a clock
+    EXPECT_FALSE(BinaryCodec::parseContext(base64::to_base64("\x05garbage")).has_value());
+}
+
+TEST(BinaryCodecTest, ContextAcceptsTheJsonEncodingToo) {
+    auto clock = clockOf({{"127.0.0.1:8080", 12}, {"127.0.0.1:8081", 4}});
+    auto parsed = BinaryCodec::parseContext(base64::to_base64(Serializer::toBinary(clock)));
+    ASSERT_TRUE(parsed.has_value());
+    EXPECT_EQ(parsed->getTimes(), clock.getTimes());
+
+    auto single = clockOf({{"a", 1}});
+    parsed = BinaryCodec::parseContext(base64::to_base64(Serializer::toBinary(single)));
+    ASSERT_TRUE(parsed.has_value());
+    EXPECT_EQ(parsed->getTimes(), single.getTimes());
+
+    parsed = BinaryCodec::parseContext(base64::to_base64(Serializer::toBinary(VectorClock{})));
+    ASSERT_TRUE(parsed.has_value());
+    EXPECT_TRUE(parsed->getTimes().empty());
+}
+
+TEST(BinaryCodecTest, SiblingFrameRoundTrip) {
+    Value a{"first", clockOf({{"n1", 1}})};
+    Value b{std::string("bin\0ary", 7), clockOf({{"n2", 2}})};
+    Value c{"", VectorClock{}};
+
+    std::string frame = BinaryCodec::encodeSiblings({&a, &b, &c});
+    auto decoded = BinaryCodec::decodeSiblings(frame);
+    ASSERT_TRUE(decoded.has_value());
+    ASSERT_EQ(decoded->size(), 3);
+    EXPECT_EQ((*decoded)[0].data_, "first");
+    EXPECT_EQ((*decoded)[0].clock_.get("n1"), 1);
+    EXPECT_EQ((*decoded)[1].data_, std::string("bin\0ary", 7));
+    EXPECT_EQ((*decoded)[1].clock_.get("n2"), 2);
+    EXPECT_EQ((*decoded)[2].data_, "");
+
+    // raw bytes plus a few of framing, no base64
+    EXPECT_LT(frame.size(), a.data_.size() + b.data_.size() + 32);
+
+    frame.pop_back();
+    EXPECT_FALSE(BinaryCodec::decodeSiblings(frame).has_value());
+    EXPECT_FALSE(BinaryCodec::decodeSiblings(BinaryCodec::encodeSiblings({&a}) + "x").has_value());
+}
+
+TEST(BinaryCodecTest, UniqueDropsRepeatedVersions) {
+    Value a{"v", clockOf({{"n1", 1}, {"n2", 1}})};
+    Value same{"v", clockOf({{"n2", 1}, {"n1", 1}})};
+    Value newer{"v", clockOf({{"n1", 2}})};
+    Value other{"w", clockOf({{"n1", 1}, {"n2", 1}})};
+
+    auto kept = BinaryCodec::unique({&a, &same, &newer, &other});
+    EXPECT_EQ(kept, (std::vector<const Value*>{&a, &newer, &other}));
+}
+
+TEST(BinaryCodecTest, PathForEncodesTheKey) {
+    EXPECT_EQ(BinaryCodec::pathFor("user-1.name_x~"), "/bin/user-1.name_x~");
+    EXPECT_EQ(BinaryCodec::pathFor("a b/c?"), "/bin/a%20b%2Fc%3F");
+}
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include "server/client_request.h"
+#include <string>
+#include <vector>
+
+TEST(ClientRequestTest, PlainBody) {
+    auto request = ClientRequest::parse(R"({"key":"user-1","data":"aGk=","context":""})");
+    ASSERT_TRUE(request.has_value());
+    EXPECT_EQ(request->key_, "user-1");
+    EXPECT_EQ(request->data_, "aGk=");
+    EXPECT_EQ(request->context_, "");
+}
+
+TEST(ClientRequestTest, WhitespaceOrderAndUnknownMembers) {
+    auto request = ClientRequest::parse(" {\n \"context\" : \"Y3R4\",\t\"client\": \"webui\", \"key\":\"k\" }\n");
+    ASSERT_TRUE(request.has_value());
+    EXPECT_EQ(request->key_, "k");
+    EXPECT_EQ(request->context_, "Y3R4");
+    EXPECT_EQ(request->data_, "");
+}
+
+TEST(ClientRequestTest, EscapesAndNonStringMembersTakeTheSlowPath) {
+    auto escaped = ClientRequest::parse(R"({"key":"a\"bé","data":"x"})");
+    ASSERT_TRUE(escaped.has_value());
+    EXPECT_EQ(escaped->key_, "a\"b\xc3\xa9");
+
+    auto nested = ClientRequest::parse(R"({"key":"k","meta":{"retries":2},"context":null})");
+    ASSERT_TRUE(nested.has_value());
+    EXPECT_EQ(nested->key_, "k");
+    EXPECT_EQ(nested->context_, "");
+}
+
+TEST(ClientRequestTest, FastAndSlowPathsAgree) {
+    std::vector<std::string> bodies{
+        R"({"key":"a","data":"ZGF0YQ==","context":"Y3R4"})",
+        R"({"key":"a","key":"b"})",
+        R"({ "data" : "" , "key" : "" })",
+        R"({"key":"k","extra":"ignored"})",
+    };
+    for(auto &body : bodies) {
+        auto fast = ClientRequest::parse(body);
+        auto slow = ClientRequest::parseJson(body);
+        ASSERT_TRUE(fast.has_value()) << body;
+        ASSERT_TRUE(slow.has_value()) << body;
+        EXPECT_EQ(fast->key_, slow->key_) << body;
+        EXPECT_EQ(fast->data_, slow->data_) << body;
+        EXPECT_EQ(fast->context_, slow->context_) << body;
+    }
+}
+
+TEST(ClientRequestTest, MalformedBodies) {
+    for(const char *body : {
+        "",
+        "not json",
+        "[]",
+        R"({"data":"x"})",
+        R"({"key":1})",
+        R"({"key":"k","data":5})",
+        R"({"key":"k")",
+        R"({"key":"k"} trailing)",
+    }) {
+        EXPECT_FALSE(ClientRequest::parse(body).has_value()) << body;
+    }
+}
+
+TEST(ClientRequestTest, NonAsciiIsValidatedLikeTheSlowPath) {
+    auto valid = ClientRequest::parse("{\"key\":\"caf\xc3\xa9\"}");
+    ASSERT_TRUE(valid.has_value());
+    EXPECT_EQ(valid->key_, "caf\xc3\xa9");
+
+    // lone continuation byte, truncated sequence, overlong encoding
+    for(const char *body : {
+        "{\"key\":\"a\x80\"}",
+        "{\"key\":\"a\xc3\"}",
+        "{\"key\":\"k\",\"data\":\"\xc0\xaf\"}",
+    }) {
+        EXPECT_FALSE(ClientRequest::parseJson(body).has_value());
+        EXPECT_FALSE(ClientRequest::parse(body).has_value());
+    }
+}
+
+TEST(ClientRequestTest, MultiGetKeepsFirstOccurrenceOrder) {
+    auto request = MultiGetRequest::parse(R"({"keys":["b","a","b","c","a"]})");
+    ASSERT_TRUE(request.has_value());
+    EXPECT_EQ(request->keys_, (std::vector<std::string>{"b", "a", "c"}));
+
+    auto empty = MultiGetRequest::parse(R"({"keys":[]})");
+    ASSERT_TRUE(empty.has_value());
+    EXPECT_TRUE(empty->keys_.empty());
+}
+
+TEST(ClientRequestTest, MultiGetRejectsMalformedBodies) {
+    EXPECT_FALSE(MultiGetRequest::parse(R"({"keys":["a",1]})").has_value());
+    EXPECT_FALSE(MultiGetRequest::parse(R"({"keys":"a"})").has_value());
+    EXPECT_FALSE(MultiGetRequest::parse(R"({"key":"a"})").has_value());
+    EXPECT_FALSE(MultiGetRequest::parse(R"(["a"])").has_value());
+    EXPECT_FALSE(MultiGetRequest::parse("{").has_value());
+}
+
+TEST(ClientRequestTest, MultiPutKeepsOrderAndDuplicates) {
+    auto request = MultiPutRequest::parse(
+        R"({"puts":[{"key":"a","data":"eA=="},{"key":"b","data":"eQ==","context":"Y3R4"},{"key":"a","data":null}]})");
+    ASSERT_TRUE(request.has_value());
+    ASSERT_EQ(request->puts_.size(), 3);
+    EXPECT_EQ(request->puts_[0].key_, "a");
+    EXPECT_EQ(request->puts_[0].data_, "eA==");
+    EXPECT_EQ(request->puts_[1].context_, "Y3R4");
+    EXPECT_EQ(request->puts_[2].key_, "a");
+    EXPECT_EQ(request->puts_[2].data_, "");
+}
+
+TEST(ClientRequestTest, MultiPutRejectsAnyMalformedPut) {
+    EXPECT_FALSE(MultiPutRequest::parse(R"({"puts":[{"key":"a"},{"data":"eA=="}]})").has_value());
+    EXPECT_FALSE(MultiPutRequest::parse(R"({"puts":[{"key":"a"},"b"]})").has_value());
+    EXPECT_FALSE(MultiPutRequest::parse(R"({"puts":[{"key":"a","data":5}]})").has_value());
+    EXPECT_FALSE(MultiPutRequest::parse(R"({"puts":{"key":"a"}})").has_value());
+}
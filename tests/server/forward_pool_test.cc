@@ -0,0 +1,164 @@
+#include <gtest/gtest.h>
+#include "server/forward_pool.h"
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+// a node on a loopback port that answers like the binary put endpoint
+class ForwardPoolTest : public ::testing::Test {
+    protected:
+        void SetUp() override {
+            svr_.Put(R"(/bin/(.+))", [this](const httplib::Request &req, httplib::Response &res) {
+                seen_body_ = req.body;
+                seen_context_ = req.get_header_value("X-Dynamo-Context");
+                seen_forwarded_ = req.has_header(ForwardPool::FORWARDED_HEADER);
+                res.set_header("X-Dynamo-Context", "new-context");
+                res.status = 204;
+            });
+            svr_.Post("/get", [](const httplib::Request &req, httplib::Response &res) {
+                res.set_content("{\"values\":[]}", "application/json");
+                res.status = 200;
+            });
+            port_ = svr_.bind_to_any_port("127.0.0.1");
+            thread_ = std::thread([this] {
+                svr_.listen_after_bind();
+            });
+            svr_.wait_until_ready();
+        }
+
+        void TearDown() override {
+            svr_.stop();
+            thread_.join();
+        }
+
+        httplib::Server svr_;
+        std::thread thread_;
+        int port_{0};
+        std::string seen_body_;
+        std::string seen_context_;
+        std::atomic<bool> seen_forwarded_{false};
+};
+
+TEST_F(ForwardPoolTest, PassesRequestAndAnswerThrough) {
+    ForwardPool pool;
+    httplib::Request req;
+    req.method = "PUT";
+    req.body = std::string("raw\0bytes", 9);
+    req.headers.emplace("Content-Type", "application/octet-stream");
+    req.headers.emplace("X-Dynamo-Context", "old-context");
+
+    httplib::Response res;
+    ASSERT_EQ(pool.forward("127.0.0.1", port_, "/bin/key", req, res), ForwardOutcome::ANSWERED);
+    EXPECT_EQ(res.status, 204);
+    EXPECT_EQ(res.get_header_value("X-Dynamo-Context"), "new-context");
+    EXPECT_EQ(seen_body_, req.body);
+    EXPECT_EQ(seen_context_, "old-context");
+    EXPECT_TRUE(seen_forwarded_);
+}
+
+TEST_F(ForwardPoolTest, ReusesIdleConnections) {
+    ForwardPool pool;
+    httplib::Request req;
+    req.method = "POST";
+    req.body = "{\"key\":\"k\"}";
+
+    for(int i = 0; i < 5; i++) {
+        httplib::Response res;
+        ASSERT_EQ(pool.forward("127.0.0.1", port_, "/get", req, res), ForwardOutcome::ANSWERED);
+        EXPECT_EQ(res.status, 200);
+        EXPECT_EQ(res.body, "{\"values\":[]}");
+    }
+
+    auto stats = pool.stats();
+    EXPECT_EQ(stats.forwarded_, 5);
+    EXPECT_EQ(stats.unreachable_, 0);
+    EXPECT_EQ(stats.connections_opened_, 1);
+    EXPECT_EQ(stats.idle_connections_, 1);
+}
+
+TEST_F(ForwardPoolTest, UnreachableNodeLeavesResponseAlone) {
+    int port = port_;
+    svr_.stop();
+    thread_.join();
+    thread_ = std::thread([] {});
+
+    RoutingOptions options;
+    options.connect_timeout_ = std::chrono::milliseconds(50);
+    ForwardPool pool(options);
+    httplib::Request req;
+    req.method = "POST";
+    req.body = "{\"key\":\"k\"}";
+
+    httplib::Response res;
+    res.status = 123;
+    EXPECT_EQ(pool.forward("127.0.0.1", port, "/get", req, res), ForwardOutcome::UNREACHABLE);
+    EXPECT_EQ(res.status, 123);
+
+    auto stats = pool.stats();
+    EXPECT_EQ(stats.unreachable_, 1);
+    EXPECT_EQ(stats.idle_connections_, 0);
+}
+
+TEST_F(ForwardPoolTest, SlowAnswerIsNotUnreachable) {
+    std::atomic<int> served{0};
+    svr_.Post("/slow", [&](const httplib::Request &, httplib::Response &res) {
+        served++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        res.status = 200;
+    });
+
+    RoutingOptions options;
+    options.read_timeout_ = std::chrono::milliseconds(50);
+    ForwardPool pool(options);
+    httplib::Request req;
+    req.method = "POST";
+    req.body = "{\"key\":\"k\"}";
+
+    // the node got the request, trying another one could apply it twice
+    httplib::Response res;
+    res.status = 123;
+    EXPECT_EQ(pool.forward("127.0.0.1", port_, "/slow", req, res), ForwardOutcome::NO_ANSWER);
+    EXPECT_EQ(res.status, 123);
+    EXPECT_EQ(served, 1);
+
+    auto stats = pool.stats();
+    EXPECT_EQ(stats.unanswered_, 1);
+    EXPECT_EQ(stats.unreachable_, 0);
+    EXPECT_EQ(stats.idle_connections_, 0);
+}
+
+TEST(ForwardOutcomeTest, OnlyConnectFailuresAreUnreachable) {
+    EXPECT_EQ(ForwardPool::outcomeOf(httplib::Error::Connection), ForwardOutcome::UNREACHABLE);
+    EXPECT_EQ(ForwardPool::outcomeOf(httplib::Error::ConnectionTimeout), ForwardOutcome::UNREACHABLE);
+    EXPECT_EQ(ForwardPool::outcomeOf(httplib::Error::Read), ForwardOutcome::NO_ANSWER);
+    EXPECT_EQ(ForwardPool::outcomeOf(httplib::Error::Write), ForwardOutcome::NO_ANSWER);
+    EXPECT_EQ(ForwardPool::outcomeOf(httplib::Error::Unknown), ForwardOutcome::NO_ANSWER);
+}
+
+TEST(RouteForTest, CoordinatorAlwaysHandlesItsKeys) {
+    for(auto mode : {RoutingMode::REDIRECT, RoutingMode::PROXY}) {
+        EXPECT_EQ(routeFor(mode, true, true, false), RouteAction::LOCAL);
+        EXPECT_EQ(routeFor(mode, true, true, true), RouteAction::LOCAL);
+    }
+}
+
+TEST(RouteForTest, RedirectModeSendsEveryoneToTheCoordinator) {
+    EXPECT_EQ(routeFor(RoutingMode::REDIRECT, false, true, false), RouteAction::REDIRECT);
+    EXPECT_EQ(routeFor(RoutingMode::REDIRECT, false, false, false), RouteAction::REDIRECT);
+}
+
+TEST(RouteForTest, ProxyModeCoordinatesOnReplicasAndForwardsOnce) {
+    EXPECT_EQ(routeFor(RoutingMode::PROXY, false, true, false), RouteAction::LOCAL);
+    EXPECT_EQ(routeFor(RoutingMode::PROXY, false, true, true), RouteAction::LOCAL);
+    EXPECT_EQ(routeFor(RoutingMode::PROXY, false, false, false), RouteAction::FORWARD);
+    // the sender thought we were a replica, don't pass it on again
+    EXPECT_EQ(routeFor(RoutingMode::PROXY, false, false, true), RouteAction::REDIRECT);
+}
+
+TEST(RoutingModeTest, ParsesNames) {
+    EXPECT_EQ(routingModeFromStr("redirect"), RoutingMode::REDIRECT);
+    EXPECT_EQ(routingModeFromStr("proxy"), RoutingMode::PROXY);
+    EXPECT_STREQ(routingModeToStr(RoutingMode::PROXY), "proxy");
+    EXPECT_THROW(routingModeFromStr("bounce"), std::invalid_argument);
+}
@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+#include "server/get_response_writer.h"
+#include "hash_ring/rpc.h"
+#include "storage/base64.hpp"
+#include "storage/serializer.h"
+#include <memory>
+#include <string>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace {
+
+Value version(const std::string& data, const std::string& node, int ticks) {
+    VectorClock clock;
+    for(int i = 0; i < ticks; i++) {
+        clock.increment(node);
+    }
+    return Value{data, clock};
+}
+
+// the body /get built before the writer existed
+std::string viaJson(const ValueList& local, const ValueList& replicas) {
+    GetResponse out{0};
+    for(const ValueList* list : {&local, &replicas}) {
+        for(auto& v : *list) {
+            GetResponse::ResponseValue rv{
+                base64::to_base64(v.data_),
+                base64::to_base64(Serializer::toBinary(v.clock_))
+            };
+            bool seen = false;
+            for(auto& o : out.values) {
+                seen = seen || (o.data == rv.data && o.context == rv.context);
+            }
+            if(!seen) {
+                out.values.push_back(rv);
+            }
+        }
+    }
+    json j = out;
+    return j.dump();
+}
+
+}
+
+TEST(GetResponseWriterTest, MatchesTheJsonEncoding) {
+    ValueList local{version("a", "n1", 1), version("bb", "n2", 2)};
+    ValueList replicas{version("ccc", "n3", 3), version("", "n1", 1), version(std::string(5000, 'x'), "n1", 4)};
+
+    GetResponseWriter writer{std::make_shared<const ValueList>(local), std::make_shared<const ValueList>(replicas)};
+    std::string body = writer.str();
+
+    EXPECT_EQ(body, viaJson(local, replicas));
+    EXPECT_EQ(body.size(), writer.size());
+    EXPECT_EQ(writer.versions(), 5);
+}
+
+TEST(GetResponseWriterTest, DropsDuplicateVersions) {
+    ValueList local{version("a", "n1", 1)};
+    // the replica holds the same version, plus one with the same data and a newer clock
+    ValueList replicas{version("a", "n1", 1), version("a", "n1", 2)};
+
+    GetResponseWriter writer{std::make_shared<const ValueList>(local), std::make_shared<const ValueList>(replicas)};
+    EXPECT_EQ(writer.versions(), 2);
+    EXPECT_EQ(writer.str(), viaJson(local, replicas));
+}
+
+TEST(GetResponseWriterTest, EmptyAndMissingLists) {
+    GetResponseWriter writer{nullptr, std::make_shared<const ValueList>()};
+    EXPECT_EQ(writer.str(), "{\"values\":[]}");
+    EXPECT_EQ(writer.size(), writer.str().size());
+}
+
+TEST(GetResponseWriterTest, LargeValuesAreWrittenInPieces) {
+    // bigger than the staging buffer, and not a multiple of 3
+    ValueList local{version(std::string(100001, 'v'), "n1", 1)};
+    GetResponseWriter writer{std::make_shared<const ValueList>(local), nullptr};
+
+    size_t writes = 0;
+    std::string body;
+    EXPECT_TRUE(writer.writeTo([&](const char* data, size_t n) {
+        writes++;
+        body.append(data, n);
+        return true;
+    }));
+    EXPECT_GT(writes, 1);
+    EXPECT_EQ(body, viaJson(local, {}));
+}
+
+TEST(GetResponseWriterTest, SinkFailureStopsTheWrite) {
+    ValueList local{version(std::string(100000, 'v'), "n1", 1)};
+    GetResponseWriter writer{std::make_shared<const ValueList>(local), nullptr};
+
+    size_t writes = 0;
+    EXPECT_FALSE(writer.writeTo([&](const char*, size_t) {
+        writes++;
+        return false;
+    }));
+    EXPECT_EQ(writes, 1);
+}
@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+#include "server/local_merge.h"
+#include "storage/concurrent_memory_engine.h"
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+Value versionOf(const std::string& writer, int times) {
+    VectorClock clock;
+    for(int i = 0; i < times; i++) {
+        clock.increment(writer);
+    }
+    return Value{writer + "-" + std::to_string(times), clock};
+}
+
+TEST(LocalMergeTest, SupersededVersionsAreDropped) {
+    LocalMerge<ConcurrentMemoryEngine> local(std::make_shared<ConcurrentMemoryEngine>(), 1 << 20);
+
+    EXPECT_EQ(local.merge("k", versionOf("a", 1)), MergeResult::APPLIED);
+    EXPECT_EQ(local.merge("k", versionOf("b", 1)), MergeResult::APPLIED);
+    EXPECT_EQ(local.merge("k", versionOf("a", 2)), MergeResult::APPLIED);
+
+    auto values = local.load("k");
+    ASSERT_EQ(values->size(), 2);
+    EXPECT_EQ((*values)[0].data_, "b-1");
+    EXPECT_EQ((*values)[1].data_, "a-2");
+}
+
+TEST(LocalMergeTest, OlderVersionIsOutdated) {
+    LocalMerge<ConcurrentMemoryEngine> local(std::make_shared<ConcurrentMemoryEngine>(), 1 << 20);
+
+    EXPECT_EQ(local.merge("k", versionOf("a", 3)), MergeResult::APPLIED);
+    EXPECT_EQ(local.merge("k", versionOf("a", 2)), MergeResult::OUTDATED);
+    EXPECT_EQ(local.load("k")->size(), 1);
+}
+
+// every writer's last version is concurrent with every other writer's, so all of them
+// have to survive as siblings no matter how the merges interleave
+TEST(LocalMergeTest, ConcurrentWritersKeepEverySibling) {
+    auto engine = std::make_shared<ConcurrentMemoryEngine>();
+    LocalMerge<ConcurrentMemoryEngine> local(engine, 1 << 20);
+    const int writers = 8;
+    const int versions = 200;
+
+    std::vector<std::thread> threads;
+    for(int w = 0; w < writers; w++) {
+        threads.emplace_back([&, w] {
+            std::string id = "node" + std::to_string(w);
+            for(int i = 1; i <= versions; i++) {
+                EXPECT_EQ(local.merge("hot", versionOf(id, i)), MergeResult::APPLIED);
+                local.merge("cold-" + id, versionOf(id, i));
+            }
+        });
+    }
+    for(auto &t : threads) {
+        t.join();
+    }
+
+    auto values = Serializer::fromBinary<ValueList>(engine->get("hot"));
+    ASSERT_EQ(values.size(), writers);
+    for(auto &v : values) {
+        EXPECT_EQ(v.data_.substr(v.data_.find('-') + 1), std::to_string(versions));
+    }
+}
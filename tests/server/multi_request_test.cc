@@ -0,0 +1,285 @@
+#include <gtest/gtest.h>
+#include "server/server.h"
+#include "storage/concurrent_memory_engine.h"
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// fails every write of a key starting with "broken", the rest is a plain memory engine
+class BrokenKeyEngine : public ConcurrentMemoryEngine {
+    public:
+        void put(const std::string &key, ByteString value) {
+            if(key.starts_with("broken")) {
+                throw StorageError("disk on fire");
+            }
+            ConcurrentMemoryEngine::put(key, std::move(value));
+        }
+};
+
+int freePort() {
+    httplib::Server probe;
+    return probe.bind_to_any_port("127.0.0.1");
+}
+
+}
+
+// one node of an in-process cluster, every node knows every other one from the start
+struct ClusterNode {
+    ClusterNode(int port) : port_(port), id_("multi-request-test-" + std::to_string(port)) {
+        self_ = std::make_shared<Node>("127.0.0.1", port, 50);
+        ring_ = std::make_shared<HashRing>();
+        // never marks a node down, the tests pick which nodes fail
+        detector_ = std::make_shared<ErrorDetector>(ring_, 1000000);
+        quorom_ = std::make_shared<Quorom>(3, 2, 2, self_, ring_, detector_);
+        gossip_ = std::make_shared<Gossip>(ring_, 2, self_, std::vector<std::pair<std::string, int>>{}, detector_);
+        handoff_ = std::make_shared<Handoff<DiskEngine>>(std::make_shared<DiskEngine>(id_, "-handoff"), ring_);
+        engine_ = std::make_shared<BrokenKeyEngine>();
+        server_ = std::make_unique<Server<BrokenKeyEngine>>(engine_, ring_, quorom_, gossip_, handoff_);
+    }
+
+    ~ClusterNode() {
+        stop();
+        server_.reset();
+        handoff_.reset();
+        std::filesystem::remove_all("/tmp/dynamo" + id_ + "-handoff");
+    }
+
+    void start() {
+        thread_ = std::thread([this] {
+            server_->start("127.0.0.1", port_);
+        });
+        httplib::Client client("127.0.0.1", port_);
+        for(int i = 0; i < 200; i++) {
+            auto res = client.Get("/admin/health");
+            if(res && res->status == 200) {
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        FAIL() << "node on port " << port_ << " never came up";
+    }
+
+    // refuses connections from here on
+    void stop() {
+        server_->stop();
+        if(thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    std::string getId() {
+        return self_->getId();
+    }
+
+    int port_;
+    std::string id_;
+    std::shared_ptr<Node> self_;
+    std::shared_ptr<HashRing> ring_;
+    std::shared_ptr<ErrorDetector> detector_;
+    std::shared_ptr<Quorom> quorom_;
+    std::shared_ptr<Gossip> gossip_;
+    std::shared_ptr<Handoff<DiskEngine>> handoff_;
+    std::shared_ptr<BrokenKeyEngine> engine_;
+    std::unique_ptr<Server<BrokenKeyEngine>> server_;
+    std::thread thread_;
+};
+
+// five nodes, N=3 so every key has two spares. requests go in through nodes_[0]
+class MultiRequestTest : public ::testing::Test {
+    protected:
+        void SetUp() override {
+            for(int i = 0; i < 5; i++) {
+                nodes_.push_back(std::make_unique<ClusterNode>(freePort()));
+            }
+            ClusterState everyone;
+            for(auto &node : nodes_) {
+                everyone[node->getId()] = NodeState{node->getId(), "127.0.0.1", node->port_, NodeState::ACTIVE, 1, 50};
+            }
+            for(auto &node : nodes_) {
+                ClusterState peers = everyone;
+                peers.erase(node->getId());
+                node->gossip_->getMembership()->merge(peers);
+                // markError and markSuccess insert into a plain map, do it before the threads do
+                for(auto &peer : nodes_) {
+                    node->detector_->markSuccess(peer->getId());
+                }
+            }
+            for(auto &node : nodes_) {
+                node->start();
+            }
+        }
+
+        ClusterNode& entry() {
+            return *nodes_[0];
+        }
+
+        ClusterNode& nodeFor(const std::shared_ptr<Node> &node) {
+            for(auto &n : nodes_) {
+                if(n->getId() == node->getId()) {
+                    return *n;
+                }
+            }
+            throw std::runtime_error("not in the cluster: " + node->getId());
+        }
+
+        // a key the entry node is, or isn't, a replica of
+        std::string keyWhere(bool replica, const std::string &prefix = "key-", int skip = 0) {
+            for(int i = 0; i < 10000; i++) {
+                std::string key = prefix + std::to_string(i);
+                if(entry().quorom_->isReplica(key) == replica && skip-- == 0) {
+                    return key;
+                }
+            }
+            ADD_FAILURE() << "no key found";
+            return "";
+        }
+
+        std::vector<std::shared_ptr<Node>> prefsOf(const std::string &key) {
+            return entry().ring_->getNextNodes(key, 6);
+        }
+
+        json mput(const json &puts, const httplib::Headers &headers = {}) {
+            httplib::Client client("127.0.0.1", entry().port_);
+            auto res = client.Post("/mput", headers, json{{"puts", puts}}.dump(), "application/json");
+            EXPECT_TRUE(res);
+            EXPECT_EQ(res->status, 200);
+            return json::parse(res->body)["results"];
+        }
+
+        json mget(const std::vector<std::string> &keys) {
+            httplib::Client client("127.0.0.1", entry().port_);
+            auto res = client.Post("/mget", json{{"keys", keys}}.dump(), "application/json");
+            EXPECT_TRUE(res);
+            EXPECT_EQ(res->status, 200);
+            return json::parse(res->body);
+        }
+
+        static json put(const std::string &key, const std::string &data, const std::string &context = "") {
+            return json{{"key", key}, {"data", base64::to_base64(data)}, {"context", context}};
+        }
+
+        static VectorClock clockOf(const json &result) {
+            auto clock = BinaryCodec::parseContext(result.at("context").get<std::string>());
+            EXPECT_TRUE(clock);
+            return clock.value_or(VectorClock{});
+        }
+
+        std::vector<std::unique_ptr<ClusterNode>> nodes_;
+};
+
+TEST_F(MultiRequestTest, ReplicaKeysAreCoordinatedHere) {
+    std::string key = keyWhere(true);
+
+    auto results = mput(json::array({put(key, "v")}));
+    ASSERT_TRUE(results[0].contains("context")) << results.dump();
+    EXPECT_EQ(clockOf(results[0]).get(entry().getId()), 1);
+    EXPECT_TRUE(entry().engine_->contains(key));
+}
+
+// the first replica coordinates, this node neither ticks its own entry nor keeps a copy
+TEST_F(MultiRequestTest, OtherKeysAreCoordinatedOnAReplica) {
+    std::string key = keyWhere(false);
+    auto coordinator = prefsOf(key)[0];
+
+    auto results = mput(json::array({put(key, "v")}));
+    ASSERT_TRUE(results[0].contains("context")) << results.dump();
+    EXPECT_EQ(results[0]["key"], key);
+    auto clock = clockOf(results[0]);
+    EXPECT_EQ(clock.get(entry().getId()), 0);
+    EXPECT_EQ(clock.get(coordinator->getId()), 1);
+    EXPECT_FALSE(entry().engine_->contains(key));
+    EXPECT_TRUE(nodeFor(coordinator).engine_->contains(key));
+}
+
+TEST_F(MultiRequestTest, StaleContextOnAnotherNodesKeyIsOutdated) {
+    std::string key = keyWhere(false);
+
+    auto first = mput(json::array({put(key, "a")}));
+    std::string context = first[0].at("context");
+    auto second = mput(json::array({put(key, "b", context)}));
+    ASSERT_TRUE(second[0].contains("context")) << second.dump();
+
+    auto stale = mput(json::array({put(key, "c", context)}));
+    ASSERT_TRUE(stale[0].contains("error")) << stale.dump();
+    EXPECT_NE(stale[0]["error"].get<std::string>().find("Outdated"), std::string::npos);
+}
+
+// results stay in the client's order however the puts were split between nodes
+TEST_F(MultiRequestTest, MixedBatchAnswersInOrder) {
+    std::vector<std::string> keys{keyWhere(false), keyWhere(true), keyWhere(false, "key-", 1), keyWhere(true, "key-", 1)};
+    json puts = json::array();
+    for(auto &key : keys) {
+        puts.push_back(put(key, "v-" + key));
+    }
+
+    auto results = mput(puts);
+    ASSERT_EQ(results.size(), keys.size());
+    for(size_t i = 0; i < keys.size(); i++) {
+        EXPECT_EQ(results[i]["key"], keys[i]);
+        EXPECT_TRUE(results[i].contains("context")) << results[i].dump();
+    }
+
+    auto read = mget(keys);
+    for(auto &key : keys) {
+        ASSERT_TRUE(read[key].contains("values")) << read.dump();
+        ASSERT_EQ(read[key]["values"].size(), 1);
+        EXPECT_EQ(read[key]["values"][0]["data"], base64::to_base64("v-" + key));
+    }
+}
+
+TEST_F(MultiRequestTest, UnreachableReplicaMovesOnToTheNext) {
+    std::string key = keyWhere(false);
+    auto prefs = prefsOf(key);
+    nodeFor(prefs[0]).stop();
+
+    auto results = mput(json::array({put(key, "v")}));
+    ASSERT_TRUE(results[0].contains("context")) << results.dump();
+    EXPECT_EQ(clockOf(results[0]).get(prefs[1]->getId()), 1);
+}
+
+TEST_F(MultiRequestTest, ForwardedPutOfAKeyThisNodeDoesntHoldIsRefused) {
+    std::string key = keyWhere(false);
+
+    auto results = mput(json::array({put(key, "v")}), {{ForwardPool::FORWARDED_HEADER, "1"}});
+    ASSERT_TRUE(results[0].contains("error")) << results.dump();
+    for(auto &node : nodes_) {
+        EXPECT_FALSE(node->engine_->contains(key));
+    }
+}
+
+TEST_F(MultiRequestTest, StorageErrorFailsOnlyItsOwnPut) {
+    std::string broken = keyWhere(true, "broken-");
+    std::string fine = keyWhere(true);
+
+    auto results = mput(json::array({put(broken, "v"), put(fine, "v")}));
+    ASSERT_TRUE(results[0].contains("error")) << results.dump();
+    EXPECT_EQ(results[0]["error"], "disk on fire");
+    EXPECT_TRUE(results[1].contains("context")) << results.dump();
+}
+
+// with both other replicas down the write is hinted to the spares, and the read is
+// answered by them plus this node's own copy
+TEST_F(MultiRequestTest, SparesStandInForDownReplicas) {
+    std::string key;
+    for(int i = 0; key.empty(); i++) {
+        std::string candidate = keyWhere(true, "key-", i);
+        if(prefsOf(candidate)[0]->getId() == entry().getId()) {
+            key = candidate;
+        }
+    }
+    auto prefs = prefsOf(key);
+    nodeFor(prefs[1]).stop();
+    nodeFor(prefs[2]).stop();
+
+    auto results = mput(json::array({put(key, "v")}));
+    ASSERT_TRUE(results[0].contains("context")) << results.dump();
+
+    auto read = mget({key});
+    ASSERT_TRUE(read[key].contains("values")) << read.dump();
+    ASSERT_EQ(read[key]["values"].size(), 1);
+    EXPECT_EQ(read[key]["values"][0]["data"], base64::to_base64("v"));
+}
@@ -0,0 +1,174 @@
+#include <gtest/gtest.h>
+#include "server/server.h"
+#include "storage/concurrent_memory_engine.h"
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// a replica that takes too long on every client endpoint but answers replication reads
+// straight away, so a proxied request to it never gets an answer
+class SlowReplica {
+    public:
+        SlowReplica() {
+            auto slow = [this](const httplib::Request &req, httplib::Response &res) {
+                client_requests_++;
+                std::this_thread::sleep_for(std::chrono::milliseconds(300));
+                res.status = 200;
+            };
+            svr_.Post("/get", slow);
+            svr_.Post("/put", slow);
+            svr_.Get("/bin/(.*)", slow);
+            svr_.Put("/bin/(.*)", slow);
+            // the same version on every replica
+            svr_.Post("/replication/get", [](const httplib::Request &req, httplib::Response &res) {
+                VectorClock clock;
+                clock.increment("writer");
+                res.set_content(Serializer::toBinary(ValueList{Value{"stored", clock}}), "application/octet-stream");
+                res.status = 200;
+            });
+            port_ = svr_.bind_to_any_port("127.0.0.1");
+            id_ = "127.0.0.1:" + std::to_string(port_);
+            thread_ = std::thread([this] {
+                svr_.listen_after_bind();
+            });
+            svr_.wait_until_ready();
+        }
+
+        ~SlowReplica() {
+            svr_.stop();
+            if(thread_.joinable()) {
+                thread_.join();
+            }
+        }
+
+        int port_{0};
+        std::string id_;
+        std::atomic<int> client_requests_{0};
+
+    private:
+        httplib::Server svr_;
+        std::thread thread_;
+};
+
+// this node and three slow replicas, N=3 so keys this node doesn't hold are proxied to
+// the three of them
+class RoutingTest : public ::testing::Test {
+    protected:
+        void SetUp() override {
+            httplib::Server probe;
+            port_ = probe.bind_to_any_port("127.0.0.1");
+            probe.stop();
+
+            auto self = std::make_shared<Node>("127.0.0.1", port_, 50);
+            ring_ = std::make_shared<HashRing>();
+            auto detector = std::make_shared<ErrorDetector>(ring_, 1000000);
+            quorom_ = std::make_shared<Quorom>(3, 2, 2, self, ring_, detector);
+            auto gossip = std::make_shared<Gossip>(ring_, 2, self, std::vector<std::pair<std::string, int>>{}, detector);
+            id_ = "routing-test-" + std::to_string(port_);
+            auto handoff = std::make_shared<Handoff<DiskEngine>>(std::make_shared<DiskEngine>(id_, "-handoff"), ring_);
+
+            ClusterState peers;
+            for(int i = 0; i < 3; i++) {
+                replicas_.push_back(std::make_unique<SlowReplica>());
+                auto &r = *replicas_.back();
+                peers[r.id_] = NodeState{r.id_, "127.0.0.1", r.port_, NodeState::ACTIVE, 1, 50};
+            }
+            gossip->getMembership()->merge(peers);
+            // markError and markSuccess insert into a plain map, do it before the threads do
+            for(auto &node : ring_->getNodes()) {
+                detector->markSuccess(node->getId());
+            }
+
+            RoutingOptions routing;
+            routing.read_timeout_ = std::chrono::milliseconds(100);
+            server_ = std::make_unique<Server<ConcurrentMemoryEngine>>(
+                std::make_shared<ConcurrentMemoryEngine>(), ring_, quorom_, gossip, handoff,
+                1 << 20, AdmissionOptions{}, WriteCombinerOptions{}, routing
+            );
+            thread_ = std::thread([this] {
+                server_->start("127.0.0.1", port_);
+            });
+
+            httplib::Client client("127.0.0.1", port_);
+            for(int i = 0; i < 200; i++) {
+                auto res = client.Get("/admin/health");
+                if(res && res->status == 200) {
+                    return;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            FAIL() << "server never came up";
+        }
+
+        void TearDown() override {
+            server_->stop();
+            if(thread_.joinable()) {
+                thread_.join();
+            }
+            server_.reset();
+            std::filesystem::remove_all("/tmp/dynamo" + id_ + "-handoff");
+        }
+
+        std::string keyThisNodeDoesntHold() {
+            for(int i = 0; i < 10000; i++) {
+                std::string key = "key-" + std::to_string(i);
+                if(!quorom_->isReplica(key)) {
+                    return key;
+                }
+            }
+            ADD_FAILURE() << "every key is held here";
+            return "";
+        }
+
+        int clientRequests() {
+            int total = 0;
+            for(auto &replica : replicas_) {
+                total += replica->client_requests_.load();
+            }
+            return total;
+        }
+
+        int port_{0};
+        std::string id_;
+        std::shared_ptr<HashRing> ring_;
+        std::shared_ptr<Quorom> quorom_;
+        std::vector<std::unique_ptr<SlowReplica>> replicas_;
+        std::unique_ptr<Server<ConcurrentMemoryEngine>> server_;
+        std::thread thread_;
+};
+
+// a read is safe to send again, every replica is tried and then it is coordinated here
+TEST_F(RoutingTest, UnansweredReadIsCoordinatedHere) {
+    std::string key = keyThisNodeDoesntHold();
+    httplib::Client client("127.0.0.1", port_);
+
+    auto res = client.Post("/get", json{{"key", key}}.dump(), "application/json");
+    ASSERT_TRUE(res);
+    EXPECT_EQ(res->status, 200);
+    EXPECT_NE(res->body.find(base64::to_base64("stored")), std::string::npos) << res->body;
+    EXPECT_EQ(clientRequests(), 3);
+}
+
+TEST_F(RoutingTest, UnansweredBinaryReadIsCoordinatedHere) {
+    std::string key = keyThisNodeDoesntHold();
+    httplib::Client client("127.0.0.1", port_);
+
+    auto res = client.Get(BinaryCodec::pathFor(key));
+    ASSERT_TRUE(res);
+    EXPECT_EQ(res->status, 200);
+    EXPECT_EQ(res->body, "stored");
+}
+
+// the write may have been applied, sending it on could write a second sibling
+TEST_F(RoutingTest, UnansweredWriteIsNotSentAgain) {
+    std::string key = keyThisNodeDoesntHold();
+    httplib::Client client("127.0.0.1", port_);
+
+    auto res = client.Post("/put", json{{"key", key}, {"data", base64::to_base64("v")}, {"context", ""}}.dump(), "application/json");
+    ASSERT_TRUE(res);
+    EXPECT_EQ(res->status, 504);
+    EXPECT_EQ(clientRequests(), 1);
+}
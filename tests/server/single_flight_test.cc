@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+#include "server/single_flight.h"
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+TEST(SingleFlightTest, ConcurrentCallsShareOneExecution) {
+    SingleFlight<int> flight;
+    std::atomic<int> executions{0};
+
+    auto slow = [&] {
+        executions++;
+        std::this_thread::sleep_for(100ms);
+        return 42;
+    };
+
+    std::thread leader([&] { EXPECT_EQ(flight.run("k", slow), 42); });
+    std::this_thread::sleep_for(20ms);
+
+    std::vector<std::thread> waiters;
+    for(int i = 0; i < 8; i++) {
+        waiters.emplace_back([&] { EXPECT_EQ(flight.run("k", slow), 42); });
+    }
+    leader.join();
+    for(auto &t : waiters) {
+        t.join();
+    }
+
+    EXPECT_EQ(executions, 1);
+    auto stats = flight.stats();
+    EXPECT_EQ(stats.leaders_, 1);
+    EXPECT_EQ(stats.collapsed_, 8);
+}
+
+TEST(SingleFlightTest, ResultsAreNotCached) {
+    SingleFlight<int> flight;
+    int n = 0;
+    EXPECT_EQ(flight.run("k", [&] { return ++n; }), 1);
+    EXPECT_EQ(flight.run("k", [&] { return ++n; }), 2);
+    EXPECT_EQ(flight.stats().collapsed_, 0);
+}
+
+TEST(SingleFlightTest, DifferentKeysDontWait) {
+    SingleFlight<int> flight;
+    std::thread slow([&] {
+        flight.run("a", [] {
+            std::this_thread::sleep_for(200ms);
+            return 1;
+        });
+    });
+    std::this_thread::sleep_for(20ms);
+
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(flight.run("b", [] { return 2; }), 2);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 100ms);
+    slow.join();
+}
+
+TEST(SingleFlightTest, LeaderErrorReachesWaiters) {
+    SingleFlight<int> flight;
+
+    std::thread leader([&] {
+        EXPECT_THROW(flight.run("k", []() -> int {
+            std::this_thread::sleep_for(50ms);
+            throw std::runtime_error("Not enough read responses");
+        }), std::runtime_error);
+    });
+    std::this_thread::sleep_for(10ms);
+
+    EXPECT_THROW(flight.run("k", [] { return 1; }), std::runtime_error);
+    leader.join();
+
+    auto stats = flight.stats();
+    EXPECT_EQ(stats.failures_, 1);
+    EXPECT_EQ(stats.collapsed_, 1);
+
+    // the failed flight is gone
+    EXPECT_EQ(flight.run("k", [] { return 7; }), 7);
+}
+
+TEST(SingleFlightTest, SlowLeaderIsAbandonedAfterMaxWait) {
+    SingleFlight<int> flight(20ms);
+
+    std::thread leader([&] {
+        flight.run("k", [] {
+            std::this_thread::sleep_for(200ms);
+            return 1;
+        });
+    });
+    std::this_thread::sleep_for(10ms);
+
+    EXPECT_EQ(flight.run("k", [] { return 2; }), 2);
+    EXPECT_EQ(flight.stats().timeouts_, 1);
+    leader.join();
+}
+
+TEST(SingleFlightTest, ForgetStartsANewFlight) {
+    SingleFlight<int> flight;
+
+    std::thread leader([&] {
+        EXPECT_EQ(flight.run("k", [] {
+            std::this_thread::sleep_for(100ms);
+            return 1;
+        }), 1);
+    });
+    std::this_thread::sleep_for(20ms);
+
+    // the key was written, the read in flight may be stale
+    flight.forget("k");
+    EXPECT_EQ(flight.run("k", [] { return 2; }), 2);
+    leader.join();
+
+    EXPECT_EQ(flight.stats().leaders_, 2);
+}
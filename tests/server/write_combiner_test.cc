@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include "server/write_combiner.h"
+#include "storage/concurrent_memory_engine.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+Value versionOf(const std::string& writer, int times) {
+    VectorClock clock;
+    for(int i = 0; i < times; i++) {
+        clock.increment(writer);
+    }
+    return Value{writer + "-" + std::to_string(times), clock};
+}
+
+class WriteCombinerTest : public ::testing::Test {
+    protected:
+        std::shared_ptr<ConcurrentMemoryEngine> engine_ = std::make_shared<ConcurrentMemoryEngine>();
+        LocalMerge<ConcurrentMemoryEngine> local_{engine_, 1 << 20};
+        std::atomic<int> fanouts_{0};
+        std::atomic<size_t> replicated_values_{0};
+};
+
+TEST_F(WriteCombinerTest, LonePutIsMergedAndReplicated) {
+    WriteCombiner<ConcurrentMemoryEngine> combiner(local_, [&](const std::string&, const ValueList& values) {
+        fanouts_++;
+        replicated_values_ += values.size();
+        return true;
+    });
+
+    auto out = combiner.put("k", versionOf("a", 1));
+    EXPECT_EQ(out.result_, MergeResult::APPLIED);
+    EXPECT_TRUE(out.replicated_);
+    EXPECT_EQ(out.group_size_, 1);
+    EXPECT_EQ(fanouts_, 1);
+    EXPECT_EQ(local_.load("k")->size(), 1);
+}
+
+TEST_F(WriteCombinerTest, PutsQueuedBehindAGroupShareOneFanout) {
+    // the first group is slow to replicate so everyone else piles up behind it
+    WriteCombiner<ConcurrentMemoryEngine> combiner(local_, [&](const std::string&, const ValueList& values) {
+        if(fanouts_++ == 0) {
+            std::this_thread::sleep_for(100ms);
+        }
+        replicated_values_ += values.size();
+        return true;
+    });
+
+    std::thread first([&] {
+        combiner.put("hot", versionOf("node0", 1));
+    });
+    std::this_thread::sleep_for(20ms);
+
+    const int writers = 8;
+    std::vector<CombinedPut> outs(writers);
+    std::vector<std::thread> threads;
+    for(int w = 1; w <= writers; w++) {
+        threads.emplace_back([&, w] {
+            outs[w - 1] = combiner.put("hot", versionOf("node" + std::to_string(w), 1));
+        });
+    }
+    first.join();
+    for(auto &t : threads) {
+        t.join();
+    }
+
+    EXPECT_EQ(fanouts_, 2);
+    EXPECT_EQ(replicated_values_, writers + 1);
+    for(auto &out : outs) {
+        EXPECT_EQ(out.result_, MergeResult::APPLIED);
+        EXPECT_TRUE(out.replicated_);
+        EXPECT_EQ(out.group_size_, writers);
+    }
+    EXPECT_EQ(local_.load("hot")->size(), writers + 1);
+
+    auto stats = combiner.stats();
+    EXPECT_EQ(stats.puts_, writers + 1);
+    EXPECT_EQ(stats.groups_, 2);
+}
+
+TEST_F(WriteCombinerTest, GroupBehavesLikeSequentialPuts) {
+    WriteCombiner<ConcurrentMemoryEngine> combiner(local_, [&](const std::string&, const ValueList& values) {
+        replicated_values_ += values.size();
+        return true;
+    });
+    combiner.put("k", versionOf("a", 2));
+
+    std::vector<Value> batch{versionOf("a", 1), versionOf("a", 3), versionOf("b", 1)};
+    auto results = local_.mergeBatch("k", batch);
+    EXPECT_EQ(results[0], MergeResult::OUTDATED);
+    EXPECT_EQ(results[1], MergeResult::APPLIED);
+    EXPECT_EQ(results[2], MergeResult::APPLIED);
+
+    auto values = local_.load("k");
+    ASSERT_EQ(values->size(), 2);
+    EXPECT_EQ((*values)[0].data_, "a-3");
+    EXPECT_EQ((*values)[1].data_, "b-1");
+
+    // an outdated put is never replicated
+    EXPECT_EQ(combiner.put("k", versionOf("a", 1)).result_, MergeResult::OUTDATED);
+    EXPECT_EQ(replicated_values_, 1);
+}
+
+TEST_F(WriteCombinerTest, ReplicationErrorReachesEveryWriter) {
+    WriteCombiner<ConcurrentMemoryEngine> combiner(local_, [&](const std::string&, const ValueList&) -> bool {
+        std::this_thread::sleep_for(20ms);
+        throw std::runtime_error("Not enough responses for put requet");
+    });
+
+    std::atomic<int> errors{0};
+    std::vector<std::thread> threads;
+    for(int w = 0; w < 4; w++) {
+        threads.emplace_back([&, w] {
+            try {
+                combiner.put("k", versionOf("node" + std::to_string(w), 1));
+            } catch(const std::runtime_error&) {
+                errors++;
+            }
+        });
+    }
+    for(auto &t : threads) {
+        t.join();
+    }
+    EXPECT_EQ(errors, 4);
+}
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#include "storage/base64.hpp"
+#include "storage/base64_simd.h"
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// every kernel this cpu can run, scalar first
+static std::vector<base64::Isa> supportedIsas() {
+    std::vector<base64::Isa> isas;
+    for(auto isa : {base64::Isa::SCALAR, base64::Isa::SSSE3, base64::Isa::AVX2}) {
+        if(isa <= base64::detected_isa()) {
+            isas.push_back(isa);
+        }
+    }
+    return isas;
+}
+
+static std::string randomBytes(std::mt19937_64& gen, size_t n) {
+    std::string s(n, '\0');
+    for(auto& c : s) {
+        c = static_cast<char>(gen());
+    }
+    return s;
+}
+
+static std::vector<size_t> testSizes() {
+    std::vector<size_t> sizes;
+    for(size_t n = 0; n <= 300; n++) {
+        sizes.push_back(n);
+    }
+    for(size_t n : {1023, 1024, 1025, 4096, 16384, 65535, 65536, 100003}) {
+        sizes.push_back(n);
+    }
+    return sizes;
+}
+
+TEST(Base64Test, EncodeMatchesScalar) {
+    std::mt19937_64 gen(1);
+    for(size_t n : testSizes()) {
+        std::string data = randomBytes(gen, n);
+        std::string expected = base64::encode_into<std::string>(data);
+        ASSERT_EQ(expected.size(), base64::encoded_size(n));
+        for(auto isa : supportedIsas()) {
+            ASSERT_EQ(base64::encode_with(isa, data), expected) << base64::isa_name(isa) << " size " << n;
+        }
+        EXPECT_EQ(base64::to_base64(data), expected);
+    }
+}
+
+TEST(Base64Test, DecodeMatchesScalar) {
+    std::mt19937_64 gen(2);
+    for(size_t n : testSizes()) {
+        std::string data = randomBytes(gen, n);
+        std::string text = base64::encode_into<std::string>(data);
+        ASSERT_EQ(base64::decode_into<std::string>(text), data);
+        for(auto isa : supportedIsas()) {
+            ASSERT_EQ(base64::decode_with(isa, text), data) << base64::isa_name(isa) << " size " << n;
+        }
+        EXPECT_EQ(base64::from_base64(text), data);
+    }
+}
+
+TEST(Base64Test, EncodeToWritesExactlyEncodedSize) {
+    std::mt19937_64 gen(3);
+    for(size_t n : {0, 1, 2, 3, 12, 16, 28, 29, 100, 1000}) {
+        std::string data = randomBytes(gen, n);
+        for(auto isa : supportedIsas()) {
+            // the guard bytes after the output must survive the wide stores
+            std::string out(base64::encoded_size(n) + 64, '#');
+            EXPECT_EQ(base64::encode_to(isa, data, out.data()), base64::encoded_size(n));
+            EXPECT_EQ(out.substr(0, base64::encoded_size(n)), base64::encode_into<std::string>(data));
+            EXPECT_EQ(out.substr(base64::encoded_size(n)), std::string(64, '#'));
+        }
+    }
+}
+
+TEST(Base64Test, InvalidCharacterThrowsAnywhere) {
+    std::mt19937_64 gen(4);
+    std::string text = base64::encode_into<std::string>(randomBytes(gen, 300));
+    for(auto isa : supportedIsas()) {
+        // positions inside the wide blocks, the narrow ones and the scalar tail
+        for(size_t pos = 0; pos < text.size() - 4; pos += 7) {
+            for(char bad : {'!', '=', '\x80', '\xff', ' ', '-'}) {
+                std::string broken = text;
+                broken[pos] = bad;
+                EXPECT_THROW(base64::decode_with(isa, broken), std::runtime_error)
+                    << base64::isa_name(isa) << " pos " << pos << " char " << int(bad);
+            }
+        }
+    }
+}
+
+TEST(Base64Test, MalformedSizesAndPaddingThrow) {
+    std::mt19937_64 gen(5);
+    std::string text = base64::encode_into<std::string>(randomBytes(gen, 96));
+    for(auto isa : supportedIsas()) {
+        EXPECT_THROW(base64::decode_with(isa, text.substr(0, text.size() - 1)), std::runtime_error);
+        EXPECT_THROW(base64::decode_with(isa, text + "A"), std::runtime_error);
+
+        std::string padded = text;
+        padded.replace(padded.size() - 3, 3, "===");
+        EXPECT_THROW(base64::decode_with(isa, padded), std::runtime_error);
+    }
+}
+
+TEST(Base64Test, EmptyInput) {
+    for(auto isa : supportedIsas()) {
+        EXPECT_EQ(base64::encode_with(isa, ""), "");
+        EXPECT_EQ(base64::decode_with(isa, ""), "");
+    }
+}
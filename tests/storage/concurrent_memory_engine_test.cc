@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+#include "storage/concurrent_memory_engine.h"
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(ConcurrentMemoryEngineTest, PutGetRemove) {
+    ConcurrentMemoryEngine engine{4};
+    EXPECT_EQ(engine.shardCount(), 4);
+    EXPECT_EQ(engine.get("a"), "");
+    EXPECT_FALSE(engine.contains("a"));
+
+    engine.put("a", "1");
+    engine.put("a", "2");
+    EXPECT_EQ(engine.get("a"), "2");
+    EXPECT_TRUE(engine.contains("a"));
+    EXPECT_EQ(engine.size(), 1);
+
+    engine.remove("a");
+    EXPECT_FALSE(engine.contains("a"));
+    EXPECT_EQ(engine.size(), 0);
+}
+
+TEST(ConcurrentMemoryEngineTest, ViewSeesTheStoredValue) {
+    ConcurrentMemoryEngine engine{4};
+    engine.put("a", "stored");
+
+    std::string seen;
+    auto found = engine.view("a", [&seen](std::string_view value) {
+        seen = value;
+    });
+    EXPECT_TRUE(found.has_value());
+    EXPECT_EQ(seen, "stored");
+
+    bool called = false;
+    auto missing = engine.view("b", [&called](std::string_view) {
+        called = true;
+    });
+    ASSERT_FALSE(missing.has_value());
+    EXPECT_TRUE(missing.error().notFound());
+    EXPECT_FALSE(called);
+}
+
+TEST(ConcurrentMemoryEngineTest, ShardCountIsPowerOfTwo) {
+    EXPECT_EQ(ConcurrentMemoryEngine{5}.shardCount(), 8);
+    EXPECT_EQ(ConcurrentMemoryEngine{1}.shardCount(), 1);
+    EXPECT_GE(ConcurrentMemoryEngine{}.shardCount(), 1);
+}
+
+TEST(ConcurrentMemoryEngineTest, ScanIsOrdered) {
+    ConcurrentMemoryEngine engine{8};
+    for(char c : std::string("dbeac")) {
+        engine.put(std::string(1, c), "v");
+    }
+
+    std::string seen;
+    engine.scan("b", [&](const std::string& key, const ByteString&) {
+        seen += key;
+        return seen.size() < 3;
+    });
+    EXPECT_EQ(seen, "bcd");
+}
+
+TEST(ConcurrentMemoryEngineTest, ConcurrentWriters) {
+    ConcurrentMemoryEngine engine{16};
+    const int threads = 8;
+    const int per_thread = 5000;
+
+    std::vector<std::thread> workers;
+    for(int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            for(int i = 0; i < per_thread; i++) {
+                std::string key = std::to_string(t) + "-" + std::to_string(i);
+                engine.put(key, key);
+                EXPECT_EQ(engine.get(key), key);
+                // some shared keys so writers actually collide
+                engine.put("shared-" + std::to_string(i % 64), key);
+            }
+        });
+    }
+    for(auto& w : workers) {
+        w.join();
+    }
+
+    EXPECT_EQ(engine.size(), threads * per_thread + 64);
+}
+
+TEST(ConcurrentMemoryEngineTest, BudgetIsSplitOverShards) {
+    ConcurrentMemoryEngine engine{4, 4 * 20 * 220};
+    EXPECT_EQ(engine.stats().capacity_, 4 * 20 * 220);
+
+    std::string value(100, 'v');
+    for(int i = 0; i < 1000; i++) {
+        engine.put("key-" + std::to_string(i), value);
+    }
+
+    auto stats = engine.stats();
+    EXPECT_LE(stats.bytes_, stats.capacity_);
+    EXPECT_GT(stats.evictions_, 0);
+    EXPECT_EQ(stats.entries_, engine.size());
+    EXPECT_LT(engine.size(), 1000);
+}
+
+TEST(ConcurrentMemoryEngineTest, StatsAddUpOverShards) {
+    ConcurrentMemoryEngine engine{8};
+    for(int i = 0; i < 10; i++) {
+        engine.put("key-" + std::to_string(i), "v");
+    }
+    for(int i = 0; i < 20; i++) {
+        engine.tryGet("key-" + std::to_string(i));
+    }
+
+    auto stats = engine.stats();
+    EXPECT_EQ(stats.hits_, 10);
+    EXPECT_EQ(stats.misses_, 10);
+    EXPECT_EQ(stats.capacity_, 0);
+    EXPECT_EQ(stats.evictions_, 0);
+}
+
+// every shard runs its own S3-FIFO, so a one off scan still can't flush the working set
+TEST(ConcurrentMemoryEngineTest, WorkingSetSurvivesScan) {
+    std::string value(100, 'v');
+    ConcurrentMemoryEngine engine{4, 800 * 220};
+    auto key = [](int i) {
+        return "key-" + std::to_string(i);
+    };
+
+    for(int round = 0; round < 3; round++) {
+        for(int i = 0; i < 200; i++) {
+            if(!engine.tryGet(key(i))) {
+                engine.put(key(i), value);
+            }
+        }
+    }
+    for(int i = 1000; i < 9000; i++) {
+        engine.put(key(i), value);
+    }
+
+    int survivors = 0;
+    for(int i = 0; i < 200; i++) {
+        survivors += engine.contains(key(i));
+    }
+    EXPECT_GE(survivors, 180);
+}
@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+#include "storage/disk_engine.h"
+#include "error/storage_error.h"
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <unistd.h>
+
+using namespace std::chrono_literals;
+
+TEST(DiskTelemetryTest, ParsesLevelStats) {
+    std::string raw =
+        "                               Compactions\n"
+        "Level  Files Size(MB) Time(sec) Read(MB) Write(MB)\n"
+        "--------------------------------------------------\n"
+        "  0        9        7         1        0         7\n"
+        "  1        5       10         3       20        18\n";
+
+    auto levels = parseLevelStats(raw);
+    ASSERT_EQ(levels.size(), 2);
+    EXPECT_EQ(levels[0].level_, 0);
+    EXPECT_EQ(levels[0].files_, 9);
+    EXPECT_EQ(levels[0].bytes_, 7u << 20);
+    EXPECT_EQ(levels[1].compaction_seconds_, 3);
+    EXPECT_EQ(levels[1].compaction_read_bytes_, 20u << 20);
+    EXPECT_EQ(levels[1].compaction_write_bytes_, 18u << 20);
+}
+
+TEST(DiskTelemetryTest, ParsesLargestFile) {
+    std::string raw =
+        "--- level 0 ---\n"
+        " 12:4321['a' @ 5 : 1 .. 'z' @ 9 : 1]\n"
+        "--- level 1 ---\n"
+        " 7:2097152['a:b' @ 1 : 1 .. 'c' @ 2 : 1]\n"
+        " 8:1024['d' @ 3 : 1 .. 'e' @ 4 : 1]\n";
+
+    EXPECT_EQ(parseLargestFile(raw), 2097152);
+    EXPECT_EQ(parseLargestFile(""), 0);
+}
+
+TEST(StallDetectorTest, SlowCommitsFormOneEpisode) {
+    StallDetector detector(10ms);
+    auto t = std::chrono::steady_clock::now();
+    detector.setL0Files(12);
+
+    detector.onCommit(t, 1ms, 1);
+    EXPECT_FALSE(detector.stats().stalled_);
+
+    detector.onCommit(t + 1ms, 40ms, 5);
+    detector.onCommit(t + 41ms, 30ms, 3);
+    EXPECT_TRUE(detector.stats().stalled_);
+    EXPECT_EQ(detector.stats().open_us_, 70000);
+    EXPECT_EQ(detector.stats().episodes_, 0);
+
+    // a fast commit ends it
+    detector.onCommit(t + 71ms, 1ms, 1);
+    auto stats = detector.stats();
+    EXPECT_FALSE(stats.stalled_);
+    EXPECT_EQ(stats.episodes_, 1);
+    EXPECT_EQ(stats.stalled_us_, 70000);
+    ASSERT_EQ(stats.recent_.size(), 1);
+    EXPECT_EQ(stats.recent_[0].commits_, 2);
+    EXPECT_EQ(stats.recent_[0].writes_, 8);
+    EXPECT_EQ(stats.recent_[0].l0_files_, 12);
+    EXPECT_EQ(stats.episode_us_.count_, 1);
+}
+
+TEST(StallDetectorTest, QuietPeriodClosesEpisode) {
+    StallDetector detector(10ms, 100ms);
+    auto t = std::chrono::steady_clock::now();
+
+    detector.onCommit(t, 20ms, 1);
+    detector.tick(t + 50ms);
+    EXPECT_TRUE(detector.stats().stalled_);
+
+    detector.tick(t + 200ms);
+    auto stats = detector.stats();
+    EXPECT_FALSE(stats.stalled_);
+    EXPECT_EQ(stats.episodes_, 1);
+    EXPECT_EQ(stats.recent_[0].duration_us_, 20000);
+}
+
+TEST(StallDetectorTest, KeepsOnlyRecentEpisodes) {
+    StallDetector detector(10ms);
+    auto t = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < StallDetector::RECENT_EPISODES + 4; i++) {
+        detector.onCommit(t, 20ms, i);
+        detector.onCommit(t + 20ms, 1ms, 1);
+        t += 1s;
+    }
+    auto stats = detector.stats();
+    EXPECT_EQ(stats.episodes_, StallDetector::RECENT_EPISODES + 4);
+    ASSERT_EQ(stats.recent_.size(), StallDetector::RECENT_EPISODES);
+    EXPECT_EQ(stats.recent_.back().writes_, StallDetector::RECENT_EPISODES + 3);
+}
+
+TEST(DiskEngineOptionsTest, Profiles) {
+    DiskEngineOptions options;
+    options.commit_.sync_ = SyncPolicy::BATCH;
+    options.applyProfile("write-heavy");
+    EXPECT_EQ(options.profile_, "write-heavy");
+    EXPECT_EQ(options.write_buffer_bytes_, 64 << 20);
+    EXPECT_EQ(options.bloom_bits_per_key_, 10);
+    // commit settings are left alone
+    EXPECT_EQ(options.commit_.sync_, SyncPolicy::BATCH);
+
+    EXPECT_THROW(options.applyProfile("fast"), StorageError);
+}
+
+TEST(DiskEngineOptionsTest, EngineReportsProfileAndSamples) {
+    std::string id = "disk-telemetry-test-" + std::to_string(getpid());
+    {
+        DiskEngineOptions options;
+        options.applyProfile("balanced");
+        options.sample_interval_ = 0ms;
+        DiskEngine engine(id, "", options);
+        engine.put("a", "1");
+        EXPECT_EQ(engine.get("a"), "1");
+
+        auto stats = engine.stats();
+        EXPECT_NE(stats.sampled_at_ms_, 0);
+        EXPECT_EQ(stats.options_.profile_, "balanced");
+        EXPECT_EQ(stats.options_.block_cache_bytes_, 64 << 20);
+        EXPECT_GE(stats.l0_files_.count_, 1);
+        EXPECT_EQ(stats.commit_.commit_latency_us_.count_, 1);
+
+        json j = stats;
+        EXPECT_EQ(j["options"]["profile"], "balanced");
+        EXPECT_TRUE(j["stalls"].contains("episodes"));
+    }
+    std::filesystem::remove_all("/tmp/dynamo" + id);
+}
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include "storage/disk_engine.h"
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+class GroupCommitTest : public ::testing::Test {
+    protected:
+        void SetUp() override {
+            id_ = std::string("group-commit-test-") + ::testing::UnitTest::GetInstance()->current_test_info()->name() + "-" + std::to_string(getpid());
+        }
+
+        void TearDown() override {
+            engine_.reset();
+            std::filesystem::remove_all("/tmp/dynamo" + id_);
+        }
+
+        void open(GroupCommitOptions options) {
+            engine_ = std::make_shared<DiskEngine>(id_, "", DiskEngineOptions{options});
+        }
+
+        std::string id_;
+        std::shared_ptr<DiskEngine> engine_;
+};
+
+TEST_F(GroupCommitTest, ConcurrentPutsAllLand) {
+    open({});
+    const int threads = 8;
+    const int per_thread = 500;
+
+    std::vector<std::thread> workers;
+    for(int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            for(int i = 0; i < per_thread; i++) {
+                std::string key = std::to_string(t) + "-" + std::to_string(i);
+                engine_->put(key, key);
+            }
+        });
+    }
+    for(auto& w : workers) {
+        w.join();
+    }
+
+    for(int t = 0; t < threads; t++) {
+        for(int i = 0; i < per_thread; i++) {
+            std::string key = std::to_string(t) + "-" + std::to_string(i);
+            ASSERT_EQ(engine_->get(key), key);
+        }
+    }
+
+    // every write is in exactly one group
+    auto commit = engine_->stats().commit_;
+    EXPECT_EQ(commit.batch_size_.sum_, threads * per_thread);
+    EXPECT_LE(commit.batch_size_.count_, threads * per_thread);
+    EXPECT_EQ(commit.syncs_, 0);
+}
+
+TEST_F(GroupCommitTest, RemoveGoesThroughTheGroup) {
+    open({});
+    engine_->put("a", "1");
+    engine_->remove("a");
+    EXPECT_FALSE(engine_->contains("a"));
+    EXPECT_EQ(engine_->stats().commit_.batch_size_.sum_, 2);
+}
+
+TEST_F(GroupCommitTest, BatchPolicySyncsEveryGroup) {
+    open({.sync_ = SyncPolicy::BATCH});
+    for(int i = 0; i < 10; i++) {
+        engine_->put(std::to_string(i), "v");
+    }
+    auto commit = engine_->stats().commit_;
+    EXPECT_EQ(commit.syncs_, commit.batch_size_.count_);
+}
+
+TEST_F(GroupCommitTest, IntervalPolicySyncsWhenIdle) {
+    open({.sync_ = SyncPolicy::INTERVAL, .sync_interval_ = std::chrono::milliseconds(20)});
+    engine_->put("a", "1");
+
+    // the background syncer picks up the unsynced write without another put
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while(engine_->stats().commit_.syncs_ == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_GE(engine_->stats().commit_.syncs_, 1);
+}
+
+TEST(SyncPolicyTest, ParsesNames) {
+    EXPECT_EQ(syncPolicyFromStr("none"), SyncPolicy::NONE);
+    EXPECT_EQ(syncPolicyFromStr("batch"), SyncPolicy::BATCH);
+    EXPECT_EQ(syncPolicyFromStr("interval"), SyncPolicy::INTERVAL);
+    EXPECT_STREQ(syncPolicyToStr(SyncPolicy::INTERVAL), "interval");
+    EXPECT_ANY_THROW(syncPolicyFromStr("sometimes"));
+}
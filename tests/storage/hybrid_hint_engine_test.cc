@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+#include "storage/hybrid_hint_engine.h"
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+#include <vector>
+
+class HybridHintEngineTest : public ::testing::Test {
+    protected:
+        void SetUp() override {
+            id_ = std::string("hint-engine-test-") + ::testing::UnitTest::GetInstance()->current_test_info()->name() + "-" + std::to_string(getpid());
+            log_path_ = "/tmp/dynamo" + id_ + ".log";
+        }
+
+        void TearDown() override {
+            engine_.reset();
+            std::filesystem::remove_all("/tmp/dynamo" + id_);
+            std::filesystem::remove(log_path_);
+        }
+
+        void open(size_t budget) {
+            // leveldb holds a lock on its directory, close the old one first
+            engine_.reset();
+            engine_ = std::make_shared<HybridHintEngine>(log_path_, std::make_shared<DiskEngine>(id_, ""), budget);
+        }
+
+        std::vector<std::string> keys() {
+            std::vector<std::string> out;
+            engine_->scan("", [&](const std::string& key, const ByteString&) {
+                out.push_back(key);
+                return true;
+            });
+            return out;
+        }
+
+        std::string id_;
+        std::string log_path_;
+        std::shared_ptr<HybridHintEngine> engine_;
+};
+
+TEST_F(HybridHintEngineTest, PutGetRemove) {
+    open(1 << 20);
+    EXPECT_EQ(engine_->get("a"), "");
+
+    engine_->put("a", "1");
+    engine_->put("a", "2");
+    EXPECT_EQ(engine_->get("a"), "2");
+    EXPECT_TRUE(engine_->contains("a"));
+    EXPECT_EQ(engine_->memoryBytes(), 2);
+
+    engine_->remove("a");
+    EXPECT_FALSE(engine_->contains("a"));
+    EXPECT_EQ(engine_->memoryBytes(), 0);
+    EXPECT_EQ(engine_->spilledKeys(), 0);
+}
+
+TEST_F(HybridHintEngineTest, ReplaysLogOnReopen) {
+    open(1 << 20);
+    engine_->put("a", "1");
+    engine_->put("b", "2");
+    engine_->put("a", "3");
+    engine_->remove("b");
+
+    open(1 << 20);
+    EXPECT_EQ(engine_->get("a"), "3");
+    EXPECT_FALSE(engine_->contains("b"));
+    EXPECT_EQ(engine_->spilledKeys(), 0);
+}
+
+TEST_F(HybridHintEngineTest, IgnoresTornTail) {
+    open(1 << 20);
+    engine_->put("a", "1");
+    engine_.reset();
+
+    {
+        std::ofstream out(log_path_, std::ios::binary | std::ios::app);
+        out.write("P\x05\x00", 3);
+    }
+
+    open(1 << 20);
+    EXPECT_EQ(engine_->get("a"), "1");
+
+    // new records land after the good prefix, not after the garbage
+    engine_->put("b", "2");
+    open(1 << 20);
+    EXPECT_EQ(engine_->get("b"), "2");
+}
+
+TEST_F(HybridHintEngineTest, SpillsOverBudget) {
+    open(16);
+    engine_->put("a", "12345");
+    engine_->put("b", "12345");
+    EXPECT_EQ(engine_->spilledKeys(), 0);
+
+    // 18 bytes is over the budget, everything moves to disk
+    engine_->put("c", "12345");
+    EXPECT_EQ(engine_->spilledKeys(), 3);
+    EXPECT_EQ(engine_->memoryBytes(), 0);
+    EXPECT_EQ(engine_->get("b"), "12345");
+
+    // updates to a spilled key stay on disk
+    engine_->put("b", "x");
+    EXPECT_EQ(engine_->get("b"), "x");
+    EXPECT_EQ(engine_->memoryBytes(), 0);
+
+    engine_->remove("a");
+    EXPECT_EQ(engine_->spilledKeys(), 2);
+
+    open(16);
+    EXPECT_EQ(engine_->spilledKeys(), 2);
+    EXPECT_EQ(engine_->get("c"), "12345");
+}
+
+TEST_F(HybridHintEngineTest, InterruptedSpillIsNotCountedTwice) {
+    open(1 << 20);
+    engine_->put("a", "1");
+    engine_->put("b", "2");
+    engine_.reset();
+
+    // the spill batch made it to leveldb but the log was never truncated
+    {
+        DiskEngine disk{id_, ""};
+        disk.put("a", "1");
+        disk.put("b", "2");
+    }
+
+    open(1 << 20);
+    EXPECT_EQ(engine_->spilledKeys(), 2);
+    EXPECT_EQ(engine_->memoryBytes(), 0);
+    EXPECT_EQ(keys(), (std::vector<std::string>{"a", "b"}));
+
+    // gone from both places, the log doesn't bring it back
+    engine_->remove("a");
+    open(1 << 20);
+    EXPECT_FALSE(engine_->contains("a"));
+    EXPECT_EQ(engine_->get("b"), "2");
+    EXPECT_EQ(engine_->spilledKeys(), 1);
+    EXPECT_EQ(engine_->memoryBytes(), 0);
+}
+
+TEST_F(HybridHintEngineTest, ScanMergesInOrder) {
+    open(8);
+    engine_->put("b", "12345");
+    engine_->put("d", "12345");
+    EXPECT_EQ(engine_->spilledKeys(), 2);
+
+    engine_->put("a", "1");
+    engine_->put("c", "1");
+    engine_->put("e", "1");
+
+    EXPECT_EQ(keys(), (std::vector<std::string>{"a", "b", "c", "d", "e"}));
+
+    std::vector<std::string> from_c;
+    engine_->scan("c", [&](const std::string& key, const ByteString&) {
+        from_c.push_back(key);
+        return from_c.size() < 2;
+    });
+    EXPECT_EQ(from_c, (std::vector<std::string>{"c", "d"}));
+}
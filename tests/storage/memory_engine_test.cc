@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+#include "storage/memory_engine.h"
+#include "error/storage_error.h"
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::string key(int i) {
+    return "key-" + std::to_string(i);
+}
+
+// every entry costs about the same so capacities can be reasoned about in entries
+const std::string VALUE(100, 'v');
+
+}
+
+TEST(MemoryEngineTest, UnboundedByDefault) {
+    MemoryEngine engine;
+    for(int i = 0; i < 1000; i++) {
+        engine.put(key(i), VALUE);
+    }
+    auto stats = engine.stats();
+    EXPECT_EQ(stats.entries_, 1000);
+    EXPECT_EQ(stats.evictions_, 0);
+    EXPECT_EQ(stats.capacity_, 0);
+}
+
+TEST(MemoryEngineTest, MissingKey) {
+    MemoryEngine engine{1 << 20};
+    // misses are a result, not an exception
+    EXPECT_NO_THROW(engine.get("nope"));
+    EXPECT_EQ(engine.get("nope"), "");
+    EXPECT_FALSE(engine.tryGet("nope").has_value());
+    auto missing = engine.lookup("nope");
+    ASSERT_FALSE(missing.has_value());
+    EXPECT_EQ(missing.error().code_, StorageCode::NOT_FOUND);
+
+    engine.put("a", "1");
+    EXPECT_EQ(engine.get("a"), "1");
+    EXPECT_EQ(engine.lookup("a").value(), "1");
+    engine.remove("a");
+    EXPECT_FALSE(engine.contains("a"));
+    EXPECT_EQ(engine.stats().bytes_, 0);
+}
+
+TEST(MemoryEngineTest, StaysUnderBudget) {
+    const size_t capacity = 50 * 1024;
+    MemoryEngine engine{capacity};
+    for(int i = 0; i < 5000; i++) {
+        engine.put(key(i), VALUE);
+        ASSERT_LE(engine.stats().bytes_, capacity);
+    }
+    auto stats = engine.stats();
+    EXPECT_GT(stats.evictions_, 0);
+    EXPECT_EQ(stats.entries_ + stats.evictions_, 5000);
+}
+
+TEST(MemoryEngineTest, BytesFollowOverwrites) {
+    MemoryEngine engine{1 << 20};
+    engine.put("a", std::string(10, 'x'));
+    size_t before = engine.stats().bytes_;
+    engine.put("a", std::string(110, 'x'));
+    EXPECT_EQ(engine.stats().bytes_, before + 100);
+    engine.put("a", std::string(10, 'x'));
+    EXPECT_EQ(engine.stats().bytes_, before);
+}
+
+TEST(MemoryEngineTest, OversizedValueIsNotKept) {
+    MemoryEngine engine{1024};
+    engine.put("a", "small");
+    engine.put("a", std::string(4096, 'x'));
+    EXPECT_FALSE(engine.contains("a"));
+    EXPECT_EQ(engine.stats().bytes_, 0);
+}
+
+TEST(MemoryEngineTest, HitRatio) {
+    MemoryEngine engine{1 << 20};
+    engine.put("a", "1");
+    engine.tryGet("a");
+    engine.tryGet("a");
+    engine.tryGet("a");
+    engine.tryGet("b");
+    auto stats = engine.stats();
+    EXPECT_EQ(stats.hits_, 3);
+    EXPECT_EQ(stats.misses_, 1);
+    EXPECT_DOUBLE_EQ(stats.hitRatio(), 0.75);
+}
+
+TEST(MemoryEngineTest, WorkingSetSurvivesScan) {
+    // room for roughly 200 entries
+    MemoryEngine engine{200 * 220};
+
+    // a hot set of 100 keys read a few times each
+    for(int round = 0; round < 3; round++) {
+        for(int i = 0; i < 100; i++) {
+            if(!engine.tryGet(key(i))) {
+                engine.put(key(i), VALUE);
+            }
+        }
+    }
+
+    // one pass over 10x the cache, none of these are read again
+    for(int i = 1000; i < 3000; i++) {
+        engine.put(key(i), VALUE);
+    }
+
+    int survivors = 0;
+    for(int i = 0; i < 100; i++) {
+        survivors += engine.contains(key(i));
+    }
+    // plain fifo or lru would have flushed all of them
+    EXPECT_GE(survivors, 90);
+}
+
+TEST(MemoryEngineTest, GhostHitGoesStraightToMain) {
+    MemoryEngine engine{20 * 220};
+    for(int i = 0; i < 100; i++) {
+        engine.put(key(i), VALUE);
+    }
+    EXPECT_FALSE(engine.contains(key(70)));
+
+    // key 70 was evicted recently, so it comes back straight into the main fifo
+    // and outlives another flood of one-hit keys
+    engine.put(key(70), VALUE);
+    for(int i = 200; i < 250; i++) {
+        engine.put(key(i), VALUE);
+    }
+    EXPECT_TRUE(engine.contains(key(70)));
+}
+
+TEST(MemoryEngineTest, ConcurrentAccess) {
+    MemoryEngine engine{64 * 1024};
+    std::vector<std::thread> workers;
+    for(int t = 0; t < 4; t++) {
+        workers.emplace_back([&, t] {
+            for(int i = 0; i < 5000; i++) {
+                engine.put(key((t * 5000 + i) % 2000), VALUE);
+                engine.tryGet(key(i % 2000));
+            }
+        });
+    }
+    for(auto& w : workers) {
+        w.join();
+    }
+    EXPECT_LE(engine.stats().bytes_, 64 * 1024);
+}
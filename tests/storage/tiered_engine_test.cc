@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include "storage/concurrent_memory_engine.h"
+#include "storage/memory_engine.h"
+#include "storage/tiered_engine.h"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ConcurrentMemoryEngine stands in for the disk so the tests don't need leveldb
+using Tiered = TieredEngine<MemoryEngine, ConcurrentMemoryEngine>;
+
+class TieredEngineTest : public ::testing::Test {
+    protected:
+        void SetUp() override {
+            hot_ = std::make_shared<MemoryEngine>(64 * 1024);
+            cold_ = std::make_shared<ConcurrentMemoryEngine>(4);
+            engine_ = std::make_shared<Tiered>(hot_, cold_);
+        }
+
+        std::shared_ptr<MemoryEngine> hot_;
+        std::shared_ptr<ConcurrentMemoryEngine> cold_;
+        std::shared_ptr<Tiered> engine_;
+};
+
+TEST_F(TieredEngineTest, WritesGoThroughToCold) {
+    engine_->put("a", "1");
+    EXPECT_EQ(cold_->get("a"), "1");
+    EXPECT_EQ(hot_->get("a"), "1");
+    EXPECT_EQ(engine_->get("a"), "1");
+}
+
+TEST_F(TieredEngineTest, MissFillsHot) {
+    cold_->put("a", "1");
+    EXPECT_FALSE(hot_->contains("a"));
+
+    EXPECT_EQ(engine_->get("a"), "1");
+    EXPECT_TRUE(hot_->contains("a"));
+    EXPECT_EQ(hot_->stats().misses_, 1);
+
+    EXPECT_EQ(engine_->get("a"), "1");
+    EXPECT_EQ(hot_->stats().hits_, 1);
+}
+
+TEST_F(TieredEngineTest, MissingKeyIsNotCached) {
+    EXPECT_EQ(engine_->get("nope"), "");
+    EXPECT_TRUE(engine_->lookup("nope").error().notFound());
+    EXPECT_FALSE(hot_->contains("nope"));
+    EXPECT_FALSE(engine_->contains("nope"));
+}
+
+TEST_F(TieredEngineTest, RemoveClearsBothTiers) {
+    engine_->put("a", "1");
+    engine_->remove("a");
+    EXPECT_FALSE(hot_->contains("a"));
+    EXPECT_FALSE(cold_->contains("a"));
+    EXPECT_EQ(engine_->get("a"), "");
+}
+
+TEST_F(TieredEngineTest, EvictedKeysFallThrough) {
+    for(int i = 0; i < 2000; i++) {
+        engine_->put("key-" + std::to_string(i), std::string(100, 'v'));
+    }
+    EXPECT_GT(hot_->stats().evictions_, 0);
+    for(int i = 0; i < 2000; i++) {
+        ASSERT_EQ(engine_->get("key-" + std::to_string(i)), std::string(100, 'v'));
+    }
+}
+
+TEST_F(TieredEngineTest, FillsNeverResurrectOldValues) {
+    const int keys = 16;
+    const int writes = 2000;
+    std::atomic<bool> done{false};
+
+    std::vector<std::thread> readers;
+    for(int t = 0; t < 4; t++) {
+        readers.emplace_back([&, t] {
+            int i = t;
+            while(!done.load()) {
+                std::string key = "k" + std::to_string(i++ % keys);
+                engine_->get(key);
+                // force misses so fills race with the writer
+                hot_->remove(key);
+            }
+        });
+    }
+
+    std::thread writer([&] {
+        for(int i = 0; i < writes; i++) {
+            engine_->put("k" + std::to_string(i % keys), std::to_string(i));
+        }
+    });
+
+    writer.join();
+    done.store(true);
+    for(auto& r : readers) {
+        r.join();
+    }
+
+    for(int k = 0; k < keys; k++) {
+        std::string key = "k" + std::to_string(k);
+        auto cached = hot_->tryGet(key);
+        if(cached) {
+            EXPECT_EQ(*cached, cold_->get(key)) << key;
+        }
+    }
+}
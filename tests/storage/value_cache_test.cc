@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+#include "storage/value_cache.h"
+#include <memory>
+#include <string>
+
+namespace {
+
+ValueCache::Ptr makeList(const std::string& data) {
+    Value v{data, {}};
+    v.clock_.increment("node");
+    return std::make_shared<const ValueList>(ValueList{v});
+}
+
+}
+
+TEST(ValueCacheTest, MissThenHit) {
+    ValueCache cache{1 << 20};
+    EXPECT_EQ(cache.get("a"), nullptr);
+
+    auto values = makeList("x");
+    cache.fill("a", values, cache.ticket("a"));
+
+    auto cached = cache.get("a");
+    ASSERT_NE(cached, nullptr);
+    // the same decoded object is shared, not a copy
+    EXPECT_EQ(cached.get(), values.get());
+
+    auto stats = cache.stats();
+    EXPECT_EQ(stats.hits_, 1);
+    EXPECT_EQ(stats.misses_, 1);
+    EXPECT_EQ(stats.entries_, 1);
+}
+
+TEST(ValueCacheTest, InvalidateDropsEntry) {
+    ValueCache cache{1 << 20};
+    cache.fill("a", makeList("x"), cache.ticket("a"));
+    cache.invalidate("a");
+    EXPECT_EQ(cache.get("a"), nullptr);
+    EXPECT_EQ(cache.stats().bytes_, 0);
+}
+
+TEST(ValueCacheTest, StaleFillIsDropped) {
+    ValueCache cache{1 << 20};
+
+    // a reader takes its ticket and reads the old value from the engine...
+    uint64_t ticket = cache.ticket("a");
+    auto old_values = makeList("old");
+
+    // ...a writer stores a new value and invalidates in the meantime...
+    cache.invalidate("a");
+
+    // ...so the reader's fill must not land
+    cache.fill("a", old_values, ticket);
+    EXPECT_EQ(cache.get("a"), nullptr);
+    EXPECT_EQ(cache.stats().stale_fills_, 1);
+
+    // a fresh ticket works again
+    cache.fill("a", makeList("new"), cache.ticket("a"));
+    ASSERT_NE(cache.get("a"), nullptr);
+    EXPECT_EQ(cache.get("a")->front().data_, "new");
+}
+
+TEST(ValueCacheTest, EvictsLeastRecentlyUsed) {
+    auto sample = makeList(std::string(100, 'v'));
+    size_t entry = ValueCache::charge("key-0", *sample);
+    // one shard so the budget is exact, room for 3 entries
+    ValueCache cache{entry * 3 + entry / 2, 1};
+
+    for(int i = 0; i < 3; i++) {
+        std::string key = "key-" + std::to_string(i);
+        cache.fill(key, sample, cache.ticket(key));
+    }
+    // touch key-0 so key-1 is the oldest
+    EXPECT_NE(cache.get("key-0"), nullptr);
+
+    cache.fill("key-3", sample, cache.ticket("key-3"));
+
+    EXPECT_NE(cache.get("key-0"), nullptr);
+    EXPECT_EQ(cache.get("key-1"), nullptr);
+    EXPECT_NE(cache.get("key-3"), nullptr);
+    EXPECT_EQ(cache.stats().evictions_, 1);
+    EXPECT_LE(cache.stats().bytes_, cache.stats().capacity_);
+}
+
+TEST(ValueCacheTest, ZeroCapacityDisables) {
+    ValueCache cache{0};
+    cache.fill("a", makeList("x"), cache.ticket("a"));
+    EXPECT_EQ(cache.get("a"), nullptr);
+    EXPECT_EQ(cache.stats().entries_, 0);
+}
+
+TEST(ValueCacheTest, AdmissionOnlyAppliesWhenFull) {
+    auto sample = makeList(std::string(100, 'v'));
+    size_t entry = ValueCache::charge("key-0", *sample);
+    ValueCache cache{entry * 2 + entry / 2, 1};
+    cache.setAdmission([](const std::string &key) {
+        return key.starts_with("hot");
+    });
+
+    // room left, anything goes in
+    cache.fill("key-0", sample, cache.ticket("key-0"));
+    cache.fill("key-1", sample, cache.ticket("key-1"));
+    EXPECT_EQ(cache.stats().entries_, 2);
+
+    // full, a cold key doesn't displace anything
+    cache.fill("key-2", sample, cache.ticket("key-2"));
+    EXPECT_EQ(cache.get("key-2"), nullptr);
+    EXPECT_NE(cache.get("key-0"), nullptr);
+    EXPECT_EQ(cache.stats().rejected_fills_, 1);
+
+    // a hot one does
+    cache.fill("hot-0", sample, cache.ticket("hot-0"));
+    EXPECT_NE(cache.get("hot-0"), nullptr);
+    EXPECT_EQ(cache.stats().evictions_, 1);
+}
@@ -175,11 +175,14 @@ function renderMembership(data) {
     // Sort nodes: self/local first, then by ID
     nodes.sort((a, b) => a.id_ > b.id_ ? 1 : -1);
 
+    // matches NodeState::Status on the server
+    const statusNames = ['ACTIVE', 'KILLED', 'SUSPECT'];
+
     listContainer.innerHTML = nodes.map(node => `
-        <div class="membership-card ${node.status_ === 0 ? 'status-active' : 'status-killed'}">
+        <div class="membership-card status-${(statusNames[node.status_] || 'KILLED').toLowerCase()}">
             <div class="member-header">
                 <span class="member-id" title="${node.id_}">${node.id_.substring(0, 8)}...</span>
-                <span class="member-status badge">${node.status_ === 0 ? 'ACTIVE' : 'KILLED'}</span>
+                <span class="member-status badge">${statusNames[node.status_] || 'UNKNOWN'}</span>
             </div>
             <div class="member-details">
                 <div class="detail-row">